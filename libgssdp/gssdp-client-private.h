@@ -20,6 +20,11 @@ typedef enum {
         _GSSDP_ANNOUNCEMENT       = 2
 } _GSSDPMessageType;
 
+typedef enum {
+        _GSSDP_CLIENT_ROLE_PUBLISHER,
+        _GSSDP_CLIENT_ROLE_BROWSER
+} _GSSDPClientRole;
+
 G_GNUC_INTERNAL void
 _gssdp_client_send_message (GSSDPClient       *client,
                             const char        *dest_ip,
@@ -27,9 +32,30 @@ _gssdp_client_send_message (GSSDPClient       *client,
                             const char        *message,
                             _GSSDPMessageType  type);
 
+G_GNUC_INTERNAL void
+_gssdp_client_send_messages (GSSDPClient       *client,
+                             const char        *dest_ip,
+                             gushort            dest_port,
+                             const char *const *messages,
+                             guint              n_messages,
+                             _GSSDPMessageType  type);
+
 G_GNUC_INTERNAL const char *
 _gssdp_client_get_mcast_group (GSSDPClient    *client);
 
+G_GNUC_INTERNAL void
+_gssdp_client_queue_search (GSSDPClient       *client,
+                            const char        *target,
+                            gushort            mx);
+
+G_GNUC_INTERNAL void
+_gssdp_client_hold_role    (GSSDPClient       *client,
+                            _GSSDPClientRole   role);
+
+G_GNUC_INTERNAL void
+_gssdp_client_release_role (GSSDPClient       *client,
+                            _GSSDPClientRole   role);
+
 G_END_DECLS
 
 #endif /* GSSDP_CLIENT_PRIVATE_H */
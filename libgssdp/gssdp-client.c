@@ -25,11 +25,18 @@
 #include "gssdp-socket-source.h"
 #include "gssdp-protocol.h"
 #include "gssdp-net.h"
+#include "gssdp-network-monitor.h"
 #include "gssdp-socket-functions.h"
 #ifdef HAVE_PKTINFO
 #include "gssdp-pktinfo-message.h"
 #include "gssdp-pktinfo6-message.h"
 #endif
+#ifdef HAVE_SO_RXQ_OVFL
+#include "gssdp-rxq-ovfl-message.h"
+#endif
+#ifdef HAVE_SO_TIMESTAMPNS
+#include "gssdp-timestamp-message.h"
+#endif
 
 #include <sys/types.h>
 #include <glib.h>
@@ -48,10 +55,20 @@
 
 /* Size of the buffer used for reading from the socket */
 #define BUF_SIZE 65536
+#define RECEIVE_BATCH 8
 
 /* interface index for loopback device */
 #define LOOPBACK_IFINDEX 1
 
+/* Time to collect M-SEARCH requests from all browsers before sending */
+#define SEARCH_COALESCE_DELAY 20 /* 20 ms */
+
+/* Number of buckets in the arrival-to-dispatch latency histogram */
+#define LATENCY_BUCKETS 24
+
+/* Time to let a burst of address and link changes settle before rebinding */
+#define REBIND_DELAY 200 /* 200 ms */
+
 static GInetAddress *SSDP_V6_LL_ADDR = NULL;
 static GInetAddress *SSDP_V6_SL_ADDR = NULL;
 static GInetAddress *SSDP_V6_GL_ADDR = NULL;
@@ -60,6 +77,9 @@ static GInetAddress *SSDP_V4_ADDR = NULL;
 static void
 gssdp_client_initable_iface_init (gpointer g_iface,
                                   gpointer iface_data);
+static void
+gssdp_client_async_initable_iface_init (gpointer g_iface,
+                                        gpointer iface_data);
 
 struct _GSSDPClientPrivate {
         char              *server_id;
@@ -68,6 +88,7 @@ struct _GSSDPClientPrivate {
         GHashTable        *user_agent_cache;
         guint              socket_ttl;
         guint              msearch_port;
+        gboolean           msearch_port_fixed;
         GSSDPNetworkDevice device;
         GList             *headers;
 
@@ -81,6 +102,42 @@ struct _GSSDPClientPrivate {
         gboolean           initialized;
         gint32             boot_id; /* "Non-negative 31 bit integer */
         gint32             config_id; /* "Non-negative 31 bit integer, User-assignable from 0 - 2^24 -1 */
+
+        GHashTable        *pending_searches; /* target -> MX */
+        GHashTable        *sent_searches; /* targets sent in this window */
+        GSource           *search_src;
+        guint              search_coalesce_threshold;
+
+        GSSDPNetworkMonitor *monitor;
+        gboolean           address_lost;
+        GSource           *rebind_src;
+
+        gboolean           lazy_sockets;
+        gboolean           listen_only;
+        guint              socket_idle_timeout;
+        gint64             search_last_used;
+        GSource           *search_idle_src;
+
+        GSSDPSocketTuning  tuning;
+        guint64            kernel_drops;
+        guint64            kernel_filter_drops;
+
+        gboolean           receive_timestamps;
+        gint64             message_arrival_time;
+        guint64            latency_histogram[LATENCY_BUCKETS];
+
+        gboolean           kernel_filter;
+        guint              n_publishers;
+        guint              n_browsers;
+
+        guint              receive_threads;
+        GPtrArray         *receive_workers;
+        GMainContext      *dispatch_context;
+        GMutex             dispatch_mutex;
+        GQueue             dispatch_queue;
+        GSource           *dispatch_src;
+
+        char              *receive_buffer;
 };
 
 typedef struct _GSSDPClientPrivate GSSDPClientPrivate;
@@ -103,7 +160,10 @@ G_DEFINE_TYPE_EXTENDED (GSSDPClient,
                         G_ADD_PRIVATE(GSSDPClient)
                         G_IMPLEMENT_INTERFACE
                                 (G_TYPE_INITABLE,
-                                 gssdp_client_initable_iface_init))
+                                 gssdp_client_initable_iface_init)
+                        G_IMPLEMENT_INTERFACE
+                                (G_TYPE_ASYNC_INITABLE,
+                                 gssdp_client_async_initable_iface_init))
 
 struct _GSSDPHeaderField {
         char *name;
@@ -111,6 +171,14 @@ struct _GSSDPHeaderField {
 };
 typedef struct _GSSDPHeaderField GSSDPHeaderField;
 
+/* A socket for a share of the multicast traffic, read by its own thread */
+typedef struct {
+        GSSDPClient       *client;
+        GSSDPSocketSource *socket_source;
+        GThread           *thread;
+        GCancellable      *cancellable;
+} ReceiveWorker;
+
 enum
 {
         PROP_0,
@@ -130,10 +198,28 @@ enum
         PROP_HOST_ADDR,
         PROP_TCP_SOCKET,
         PROP_ALLOCATE_TCP_SOCKET,
+        PROP_SEARCH_COALESCE_THRESHOLD,
+        PROP_MONITOR_NETWORK,
+        PROP_LAZY_SOCKETS,
+        PROP_SOCKET_IDLE_TIMEOUT,
+        PROP_LISTEN_ONLY,
+        PROP_RECEIVE_BUFFER_SIZE,
+        PROP_KERNEL_DROPS,
+        PROP_KERNEL_FILTER_DROPS,
+        PROP_RECEIVE_TIMESTAMPS,
+        PROP_KERNEL_FILTER,
+        PROP_RECEIVE_THREADS,
+        PROP_SEND_BUFFER_SIZE,
+        PROP_DSCP,
+        PROP_SOCKET_PRIORITY,
+        PROP_BUSY_POLL,
+        PROP_MULTICAST_LOOPBACK,
+        PROP_MULTICAST_ALL,
 };
 
 enum {
         MESSAGE_RECEIVED,
+        REBOUND,
         LAST_SIGNAL
 };
 
@@ -162,11 +248,39 @@ search_socket_source_cb       (GIOChannel   *source,
 static gboolean
 init_network_info             (GSSDPClient  *client,
                                GError      **error);
+static gboolean
+create_sockets                (GSSDPClient  *client,
+                               GError      **error);
+static void
+attach_sockets                (GSSDPClient  *client);
+static gboolean
+ensure_search_socket          (GSSDPClient  *client);
+static void
+schedule_search_socket_release (GSSDPClient *client,
+                                guint        delay);
+static void
+start_receive_workers         (GSSDPClient  *client);
+static void
+stop_receive_workers          (GSSDPClient  *client);
+
+typedef struct _ReceivedMessage ReceivedMessage;
+static void
+received_message_free         (ReceivedMessage *message);
 
 static gboolean
 gssdp_client_initable_init    (GInitable     *initable,
                                GCancellable  *cancellable,
                                GError       **error);
+static void
+gssdp_client_init_async       (GAsyncInitable      *initable,
+                               int                  io_priority,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data);
+static gboolean
+gssdp_client_init_finish      (GAsyncInitable  *initable,
+                               GAsyncResult    *res,
+                               GError         **error);
 
 static void
 gssdp_client_init (GSSDPClient *client)
@@ -174,7 +288,19 @@ gssdp_client_init (GSSDPClient *client)
         GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
 
         priv->active = TRUE;
+        priv->tuning = (GSSDPSocketTuning) GSSDP_SOCKET_TUNING_INIT;
 
+        g_mutex_init (&priv->dispatch_mutex);
+        g_queue_init (&priv->dispatch_queue);
+
+        priv->pending_searches = g_hash_table_new_full (g_str_hash,
+                                                        g_str_equal,
+                                                        g_free,
+                                                        NULL);
+        priv->sent_searches = g_hash_table_new_full (g_str_hash,
+                                                     g_str_equal,
+                                                     g_free,
+                                                     NULL);
 }
 
 static void
@@ -185,17 +311,20 @@ gssdp_client_initable_iface_init (gpointer               g_iface,
         iface->init = gssdp_client_initable_init;
 }
 
-static gboolean
-gssdp_client_initable_init (GInitable                   *initable,
-                            G_GNUC_UNUSED GCancellable  *cancellable,
-                            GError                     **error)
+static void
+gssdp_client_async_initable_iface_init (gpointer               g_iface,
+                                        G_GNUC_UNUSED gpointer iface_data)
 {
-        GSSDPClient *client = GSSDP_CLIENT (initable);
-        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
-        GError *internal_error = NULL;
+        GAsyncInitableIface *iface = (GAsyncInitableIface *)g_iface;
+        iface->init_async = gssdp_client_init_async;
+        iface->init_finish = gssdp_client_init_finish;
+}
 
-        if (priv->initialized)
-                return TRUE;
+/* Fill in the defaults for everything not set on construction */
+static void
+init_defaults (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
 
         /* The following two fall-backs are there to make things
          * compatible with GSSDP 1.0.x and earlier */
@@ -217,103 +346,127 @@ gssdp_client_initable_init (GInitable                   *initable,
                 version = gssdp_client_get_uda_version (client);
                 priv->server_id = make_server_id (version);
         }
+}
 
+/*
+ * Look up the network information and create the sockets. This does not
+ * touch any main context, so it may run in a worker thread.
+ */
+static gboolean
+init_network (GSSDPClient *client, GError **error)
+{
         if (!gssdp_net_init (error))
                 return FALSE;
 
         /* Make sure all network info is available to us */
-        if (!init_network_info (client, &internal_error))
-                goto errors;
-
-        /* Set up sockets (Will set errno if it failed) */
-        priv->request_socket =
-                gssdp_socket_source_new (GSSDP_SOCKET_SOURCE_TYPE_REQUEST,
-                                         priv->device.host_addr,
-                                         priv->socket_ttl,
-                                         priv->device.iface_name,
-                                         priv->device.index,
-                                         &internal_error);
-        if (priv->request_socket == NULL) {
-                goto errors;
-        }
+        if (!init_network_info (client, error))
+                return FALSE;
 
-        gssdp_socket_source_set_callback
-                        (priv->request_socket,
-                        (GSourceFunc) request_socket_source_cb,
-                        client);
-
-        priv->multicast_socket =
-                gssdp_socket_source_new (GSSDP_SOCKET_SOURCE_TYPE_MULTICAST,
-                                         priv->device.host_addr,
-                                         priv->socket_ttl,
-                                         priv->device.iface_name,
-                                         priv->device.index,
-                                         &internal_error);
-        if (priv->multicast_socket == NULL) {
-            goto errors;
-        }
+        return create_sockets (client, error);
+}
 
-        gssdp_socket_source_set_callback
-                        (priv->multicast_socket,
-                         (GSourceFunc) multicast_socket_source_cb,
-                         client);
+static void
+init_complete (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
 
-        /* Setup send socket. For security reasons, it is not recommended to
-         * send M-SEARCH with source port == SSDP_PORT */
-        priv->search_socket = GSSDP_SOCKET_SOURCE (g_initable_new
-                                        (GSSDP_TYPE_SOCKET_SOURCE,
-                                         NULL,
-                                         &internal_error,
-                                         "type", GSSDP_SOCKET_SOURCE_TYPE_SEARCH,
-                                         "address", priv->device.host_addr,
-                                         "ttl", priv->socket_ttl,
-                                         "port", priv->msearch_port,
-                                         "device-name", priv->device.iface_name,
-                                         "index", priv->device.index,
-                                         "allocate-tcp-socket", priv->allocate_tcp_socket,
-                                         NULL));
+        attach_sockets (client);
 
-        if (priv->search_socket != NULL) {
-                if (priv->msearch_port == 0) {
-                        g_object_get (priv->search_socket,
-                                      "port",
-                                      &priv->msearch_port,
-                                      NULL);
-                }
+        priv->initialized = TRUE;
 
-                priv->tcp_socket =
-                        gssdp_socket_source_steal_associated_tcp_socket (
-                                priv->search_socket);
+        priv->user_agent_cache = g_hash_table_new_full (g_str_hash,
+                                                        g_str_equal,
+                                                        g_free,
+                                                        g_free);
+}
 
-                gssdp_socket_source_set_callback
-                                        (priv->search_socket,
-                                         (GSourceFunc) search_socket_source_cb,
-                                         client);
-        }
+static gboolean
+gssdp_client_initable_init (GInitable                   *initable,
+                            G_GNUC_UNUSED GCancellable  *cancellable,
+                            GError                     **error)
+{
+        GSSDPClient *client = GSSDP_CLIENT (initable);
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
 
- errors:
-        if (!priv->request_socket ||
-            !priv->multicast_socket ||
-            !priv->search_socket) {
-                g_propagate_error (error, internal_error);
+        if (priv->initialized)
+                return TRUE;
 
-                g_clear_object (&priv->request_socket);
-                g_clear_object (&priv->multicast_socket);
-                g_clear_object (&priv->search_socket);
+        init_defaults (client);
 
+        if (!init_network (client, error))
                 return FALSE;
+
+        init_complete (client);
+
+        return TRUE;
+}
+
+static void
+init_thread (GTask                       *task,
+             gpointer                     source_object,
+             G_GNUC_UNUSED gpointer       task_data,
+             G_GNUC_UNUSED GCancellable  *cancellable)
+{
+        GError *error = NULL;
+
+        if (init_network (GSSDP_CLIENT (source_object), &error))
+                g_task_return_boolean (task, TRUE);
+        else
+                g_task_return_error (task, error);
+}
+
+static void
+gssdp_client_init_async (GAsyncInitable      *initable,
+                         int                  io_priority,
+                         GCancellable        *cancellable,
+                         GAsyncReadyCallback  callback,
+                         gpointer             user_data)
+{
+        GSSDPClient *client = GSSDP_CLIENT (initable);
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        GTask *task;
+
+        task = g_task_new (initable, cancellable, callback, user_data);
+        g_task_set_source_tag (task, gssdp_client_init_async);
+        g_task_set_priority (task, io_priority);
+
+        if (priv->initialized) {
+                g_task_return_boolean (task, TRUE);
+                g_object_unref (task);
+
+                return;
         }
 
-        gssdp_socket_source_attach (priv->request_socket);
-        gssdp_socket_source_attach (priv->multicast_socket);
-        gssdp_socket_source_attach (priv->search_socket);
+        if (g_task_return_error_if_cancelled (task)) {
+                g_object_unref (task);
 
-        priv->initialized = TRUE;
+                return;
+        }
 
-        priv->user_agent_cache = g_hash_table_new_full (g_str_hash,
-                                                        g_str_equal,
-                                                        g_free,
-                                                        g_free);
+        init_defaults (client);
+
+        /* Interface lookup and socket setup may block, keep them off the
+         * caller's main context */
+        g_task_run_in_thread (task, init_thread);
+        g_object_unref (task);
+}
+
+static gboolean
+gssdp_client_init_finish (GAsyncInitable  *initable,
+                          GAsyncResult    *res,
+                          GError         **error)
+{
+        GSSDPClient *client = GSSDP_CLIENT (initable);
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        g_return_val_if_fail (g_task_is_valid (res, initable), FALSE);
+
+        if (!g_task_propagate_boolean (G_TASK (res), error))
+                return FALSE;
+
+        /* The socket sources belong to the caller's main context */
+        if (!priv->initialized)
+                init_complete (client);
 
         return TRUE;
 }
@@ -348,6 +501,9 @@ gssdp_client_get_property (GObject    *object,
         case PROP_HOST_ADDR:
                 g_value_set_object (value, gssdp_client_get_address (client));
                 break;
+        case PROP_HOST_MASK:
+                g_value_set_object (value, priv->device.host_mask);
+                break;
         case PROP_ACTIVE:
                 g_value_set_boolean (value, priv->active);
                 break;
@@ -356,7 +512,7 @@ gssdp_client_get_property (GObject    *object,
                 break;
         case PROP_MSEARCH_PORT:
         case PROP_PORT:
-                g_value_set_uint (value, priv->msearch_port);
+                g_value_set_uint (value, gssdp_client_get_port (client));
                 break;
         case PROP_ADDRESS_FAMILY:
                 g_value_set_enum (value, priv->device.address_family);
@@ -374,7 +530,65 @@ gssdp_client_get_property (GObject    *object,
                 g_value_set_boolean (value, priv->allocate_tcp_socket);
                 break;
         case PROP_TCP_SOCKET:
-                g_value_set_object (value, priv->tcp_socket);
+                g_value_take_object (value,
+                                     gssdp_client_get_tcp_socket (client));
+                break;
+        case PROP_SEARCH_COALESCE_THRESHOLD:
+                g_value_set_uint (value, priv->search_coalesce_threshold);
+                break;
+        case PROP_MONITOR_NETWORK:
+                g_value_set_boolean (value,
+                                     gssdp_client_get_monitor_network (client));
+                break;
+        case PROP_LAZY_SOCKETS:
+                g_value_set_boolean (value, priv->lazy_sockets);
+                break;
+        case PROP_LISTEN_ONLY:
+                g_value_set_boolean (value, priv->listen_only);
+                break;
+        case PROP_SOCKET_IDLE_TIMEOUT:
+                g_value_set_uint (value,
+                                  gssdp_client_get_socket_idle_timeout (client));
+                break;
+        case PROP_RECEIVE_BUFFER_SIZE:
+                g_value_set_uint (value, priv->tuning.receive_buffer_size);
+                break;
+        case PROP_KERNEL_DROPS:
+                g_value_set_uint64 (value,
+                                    gssdp_client_get_kernel_drops (client));
+                break;
+        case PROP_KERNEL_FILTER_DROPS:
+                g_value_set_uint64 (
+                        value,
+                        gssdp_client_get_kernel_filter_drops (client));
+                break;
+        case PROP_RECEIVE_TIMESTAMPS:
+                g_value_set_boolean (value, priv->receive_timestamps);
+                break;
+        case PROP_KERNEL_FILTER:
+                g_value_set_boolean (value,
+                                     gssdp_client_get_kernel_filter (client));
+                break;
+        case PROP_RECEIVE_THREADS:
+                g_value_set_uint (value, priv->receive_threads);
+                break;
+        case PROP_SEND_BUFFER_SIZE:
+                g_value_set_uint (value, priv->tuning.send_buffer_size);
+                break;
+        case PROP_DSCP:
+                g_value_set_int (value, priv->tuning.dscp);
+                break;
+        case PROP_SOCKET_PRIORITY:
+                g_value_set_int (value, priv->tuning.priority);
+                break;
+        case PROP_BUSY_POLL:
+                g_value_set_uint (value, priv->tuning.busy_poll);
+                break;
+        case PROP_MULTICAST_LOOPBACK:
+                g_value_set_boolean (value, priv->tuning.multicast_loopback);
+                break;
+        case PROP_MULTICAST_ALL:
+                g_value_set_boolean (value, priv->tuning.multicast_all);
                 break;
         default:
                 G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -420,6 +634,7 @@ gssdp_client_set_property (GObject      *object,
         case PROP_MSEARCH_PORT:
         case PROP_PORT:
                 priv->msearch_port = g_value_get_uint (value);
+                priv->msearch_port_fixed = priv->msearch_port != 0;
                 break;
         case PROP_ADDRESS_FAMILY:
                 priv->device.address_family = g_value_get_enum (value);
@@ -436,6 +651,57 @@ gssdp_client_set_property (GObject      *object,
         case PROP_ALLOCATE_TCP_SOCKET:
                 priv->allocate_tcp_socket = g_value_get_boolean(value);
                 break;
+        case PROP_SEARCH_COALESCE_THRESHOLD:
+                gssdp_client_set_search_coalesce_threshold
+                                        (client,
+                                         g_value_get_uint (value));
+                break;
+        case PROP_MONITOR_NETWORK:
+                gssdp_client_set_monitor_network (client,
+                                                  g_value_get_boolean (value));
+                break;
+        case PROP_LAZY_SOCKETS:
+                priv->lazy_sockets = g_value_get_boolean (value);
+                break;
+        case PROP_LISTEN_ONLY:
+                priv->listen_only = g_value_get_boolean (value);
+                break;
+        case PROP_SOCKET_IDLE_TIMEOUT:
+                gssdp_client_set_socket_idle_timeout
+                                        (client,
+                                         g_value_get_uint (value));
+                break;
+        case PROP_RECEIVE_BUFFER_SIZE:
+                priv->tuning.receive_buffer_size = g_value_get_uint (value);
+                break;
+        case PROP_RECEIVE_TIMESTAMPS:
+                priv->receive_timestamps = g_value_get_boolean (value);
+                break;
+        case PROP_KERNEL_FILTER:
+                gssdp_client_set_kernel_filter (client,
+                                                g_value_get_boolean (value));
+                break;
+        case PROP_RECEIVE_THREADS:
+                priv->receive_threads = g_value_get_uint (value);
+                break;
+        case PROP_SEND_BUFFER_SIZE:
+                priv->tuning.send_buffer_size = g_value_get_uint (value);
+                break;
+        case PROP_DSCP:
+                priv->tuning.dscp = g_value_get_int (value);
+                break;
+        case PROP_SOCKET_PRIORITY:
+                priv->tuning.priority = g_value_get_int (value);
+                break;
+        case PROP_BUSY_POLL:
+                priv->tuning.busy_poll = g_value_get_uint (value);
+                break;
+        case PROP_MULTICAST_LOOPBACK:
+                priv->tuning.multicast_loopback = g_value_get_boolean (value);
+                break;
+        case PROP_MULTICAST_ALL:
+                priv->tuning.multicast_all = g_value_get_boolean (value);
+                break;
         default:
                 G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
                 break;
@@ -448,6 +714,26 @@ gssdp_client_dispose (GObject *object)
         GSSDPClient *client = GSSDP_CLIENT (object);
         GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
 
+        /* The workers read from the device, stop them first */
+        stop_receive_workers (client);
+        g_clear_pointer (&priv->receive_workers, g_ptr_array_unref);
+
+        g_mutex_lock (&priv->dispatch_mutex);
+        g_clear_pointer (&priv->dispatch_src, g_source_destroy);
+        g_queue_clear_full (&priv->dispatch_queue,
+                            (GDestroyNotify) received_message_free);
+        g_mutex_unlock (&priv->dispatch_mutex);
+        g_clear_pointer (&priv->dispatch_context, g_main_context_unref);
+
+        g_clear_pointer (&priv->search_src, g_source_destroy);
+        g_clear_pointer (&priv->search_idle_src, g_source_destroy);
+
+        g_clear_pointer (&priv->rebind_src, g_source_destroy);
+        if (priv->monitor != NULL) {
+                g_signal_handlers_disconnect_by_data (priv->monitor, client);
+                g_clear_object (&priv->monitor);
+        }
+
         /* Destroy the SocketSources */
         g_clear_object (&priv->request_socket);
         g_clear_object (&priv->multicast_socket);
@@ -473,6 +759,11 @@ gssdp_client_finalize (GObject *object)
         g_clear_pointer (&priv->device.network, g_free);
 
         g_clear_pointer (&priv->user_agent_cache, g_hash_table_unref);
+        g_clear_pointer (&priv->pending_searches, g_hash_table_unref);
+        g_clear_pointer (&priv->sent_searches, g_hash_table_unref);
+
+        g_mutex_clear (&priv->dispatch_mutex);
+        g_clear_pointer (&priv->receive_buffer, g_free);
 
         G_OBJECT_CLASS (gssdp_client_parent_class)->finalize (object);
 }
@@ -781,6 +1072,10 @@ gssdp_client_class_init (GSSDPClientClass *klass)
          * GSSDPClient:tcp-socket:
          *
          * The allocated TCP socket bound to the same port as [property@GSSDP.Client:port]
+         *
+         * With [property@GSSDP.Client:lazy-sockets], %NULL while there is
+         * no search socket.
+         *
          * Since: 1.6.5
          */
         g_object_class_install_property (
@@ -794,64 +1089,531 @@ gssdp_client_class_init (GSSDPClientClass *klass)
                                              G_PARAM_STATIC_STRINGS));
 
         /**
-         * GSSDPClient::message-received: (skip)
-         * @client: The #GSSDPClient that received the message.
-         * @from_ip: The IP address of the source.
-         * @from_port: The UDP port used by the sender.
-         * @type: The #_GSSDPMessageType.
-         * @headers: (type SoupMessageHeaders): Parsed #SoupMessageHeaders from the message.
+         * GSSDPClient:receive-timestamps:
          *
-         * Internal signal.
+         * Whether to ask the kernel for the time each datagram was received.
          *
-         * Stability: Private
-         **/
-        signals[MESSAGE_RECEIVED] =
-                g_signal_new ("message-received",
-                              GSSDP_TYPE_CLIENT,
-                              G_SIGNAL_RUN_LAST,
-                              0,
-                              NULL, NULL, NULL,
-                              G_TYPE_NONE,
-                              4,
-                              G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
-                              G_TYPE_UINT,
-                              G_TYPE_INT,
-                              soup_message_headers_get_type());
-}
+         * The time is available from
+         * [method@GSSDP.Client.get_message_arrival_time] while
+         * [signal@GSSDP.Client::message-received] is emitted, and the delay
+         * until the message is dispatched is collected in
+         * [method@GSSDP.Client.get_latency_histogram]. Only supported on
+         * platforms with SO_TIMESTAMPNS.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_RECEIVE_TIMESTAMPS,
+                g_param_spec_boolean ("receive-timestamps",
+                                      "Receive timestamps",
+                                      "Record kernel receive timestamps",
+                                      FALSE,
+                                      G_PARAM_READWRITE |
+                                              G_PARAM_CONSTRUCT_ONLY |
+                                              G_PARAM_STATIC_STRINGS));
 
+        /**
+         * GSSDPClient:kernel-filter:(attributes org.gtk.Property.get=gssdp_client_get_kernel_filter org.gtk.Property.set=gssdp_client_set_kernel_filter)
+         *
+         * Whether to let the kernel drop messages nobody on this client is
+         * interested in.
+         *
+         * Searches are only received while a [class@GSSDP.ResourceGroup]
+         * uses the client, announcements and search responses only while a
+         * [class@GSSDP.ResourceBrowser] does. Do not enable this if you
+         * handle [signal@GSSDP.Client::message-received] yourself.
+         *
+         * Only supported on Linux, ignored elsewhere.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_KERNEL_FILTER,
+                g_param_spec_boolean ("kernel-filter",
+                                      "Kernel filter",
+                                      "Drop unused messages in the kernel",
+                                      FALSE,
+                                      G_PARAM_READWRITE |
+                                              G_PARAM_STATIC_STRINGS));
 
-/**
- * gssdp_client_new:
- * @iface: (nullable): The name of the network interface, or %NULL for
- * auto-detection.
- * @error: (nullable): Location to store error, or %NULL
- *
- * Creates a GSSDP client on @iface. GSSDPClient will pick the address it finds
- * suitable for using.
- *
- * Using this utility function, the created client will be using UDA 1.0 and
- * IPv4 only.
- *
- * Deprecated: 1.6.0: Use [ctor@GSSDP.Client.new_for_address] instead.
- *
- * Return value: (nullable): A new #GSSDPClient object.
- **/
-GSSDPClient *
-gssdp_client_new (const char *iface, GError **error)
-{
-        return g_initable_new (GSSDP_TYPE_CLIENT,
-                               NULL,
-                               error,
-                               "interface", iface,
-                               NULL);
-}
+        /**
+         * GSSDPClient:receive-threads:
+         *
+         * The number of threads reading and parsing multicast traffic in
+         * addition to the main context the client was created in.
+         *
+         * Each thread gets its own socket on the SSDP port. The kernel
+         * splits the traffic between the sockets by a hash of the source
+         * address, so messages from one source are always handled by the
+         * same thread, in order.
+         *
+         * Only reading and parsing is spread over the threads. Signal
+         * dispatch still runs on a single context: every message is emitted
+         * by [signal@GSSDP.Client::message-received], and handled by the
+         * browsers and groups, one after another in the client's main
+         * context.
+         *
+         * Drops on the multicast sockets are not counted in
+         * [property@GSSDP.Client:kernel-drops] then, since the kernel counts
+         * every datagram a socket's share filter turns away as dropped.
+         *
+         * Only supported on Linux, ignored elsewhere.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_RECEIVE_THREADS,
+                g_param_spec_uint ("receive-threads",
+                                   "Receive threads",
+                                   "Number of threads reading multicast "
+                                   "traffic",
+                                   0,
+                                   64,
+                                   0,
+                                   G_PARAM_READWRITE |
+                                           G_PARAM_CONSTRUCT_ONLY |
+                                           G_PARAM_STATIC_STRINGS));
 
-/**
- * gssdp_client_new_with_port:
- * @iface: (nullable): The name of the network interface, or %NULL for
- * auto-detection.
- * @msearch_port: The network port to use for M-SEARCH requests or 0 for
- * random.
+        /**
+         * GSSDPClient:send-buffer-size:
+         *
+         * The size in bytes of the kernel send buffer of the client's UDP
+         * sockets, or 0 to use the system default. The kernel may clamp the
+         * value, see SO_SNDBUF in socket(7).
+         *
+         * Like all socket options of the client, this is applied to every
+         * socket the client creates, including those recreated by
+         * [method@GSSDP.Client.rebind]. Use
+         * [method@GSSDP.Client.get_socket_option] to read back the value
+         * the kernel actually uses.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_SEND_BUFFER_SIZE,
+                g_param_spec_uint ("send-buffer-size",
+                                   "Send buffer size",
+                                   "Size of the kernel send buffer",
+                                   0,
+                                   G_MAXINT,
+                                   0,
+                                   G_PARAM_READWRITE |
+                                           G_PARAM_CONSTRUCT_ONLY |
+                                           G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:dscp:
+         *
+         * The differentiated services code point to mark outgoing packets
+         * with, or -1 to use the system default.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_DSCP,
+                g_param_spec_int ("dscp",
+                                  "DSCP",
+                                  "Differentiated services code point of "
+                                  "outgoing packets",
+                                  -1,
+                                  63,
+                                  -1,
+                                  G_PARAM_READWRITE |
+                                          G_PARAM_CONSTRUCT_ONLY |
+                                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:socket-priority:
+         *
+         * The queueing priority of outgoing packets, or -1 to use the system
+         * default. Values above 6 need CAP_NET_ADMIN, see SO_PRIORITY in
+         * socket(7).
+         *
+         * Only supported on Linux, creating the client fails elsewhere if
+         * this is set.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_SOCKET_PRIORITY,
+                g_param_spec_int ("socket-priority",
+                                  "Socket priority",
+                                  "Queueing priority of outgoing packets",
+                                  -1,
+                                  G_MAXINT,
+                                  -1,
+                                  G_PARAM_READWRITE |
+                                          G_PARAM_CONSTRUCT_ONLY |
+                                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:busy-poll:
+         *
+         * The time in microseconds to busy poll the network device for
+         * packets when the receive queue is empty, or 0 to use the system
+         * default, see SO_BUSY_POLL in socket(7).
+         *
+         * Only supported on Linux, creating the client fails elsewhere if
+         * this is set.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_BUSY_POLL,
+                g_param_spec_uint ("busy-poll",
+                                   "Busy poll",
+                                   "Busy polling time in microseconds",
+                                   0,
+                                   G_MAXINT,
+                                   0,
+                                   G_PARAM_READWRITE |
+                                           G_PARAM_CONSTRUCT_ONLY |
+                                           G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:multicast-loopback:
+         *
+         * Whether multicast packets are looped back to sockets on the same
+         * host, including the client's own.
+         *
+         * This is only set on the client's socket on the SSDP multicast
+         * group, which is also where
+         * [method@GSSDP.Client.get_socket_option] reads it back. The
+         * sockets sending searches and announcements keep the system
+         * default.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_MULTICAST_LOOPBACK,
+                g_param_spec_boolean ("multicast-loopback",
+                                      "Multicast loopback",
+                                      "Loop back sent multicast packets",
+                                      TRUE,
+                                      G_PARAM_READWRITE |
+                                              G_PARAM_CONSTRUCT_ONLY |
+                                              G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:multicast-all:
+         *
+         * Whether the client's sockets receive packets of every multicast
+         * group joined on the host, instead of only the SSDP group. Setting
+         * this to %FALSE is only supported on Linux, creating the client
+         * fails elsewhere.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_MULTICAST_ALL,
+                g_param_spec_boolean ("multicast-all",
+                                      "Multicast all",
+                                      "Receive packets of all joined "
+                                      "multicast groups",
+                                      TRUE,
+                                      G_PARAM_READWRITE |
+                                              G_PARAM_CONSTRUCT_ONLY |
+                                              G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:search-coalesce-threshold:(attributes org.gtk.Property.get=gssdp_client_get_search_coalesce_threshold org.gtk.Property.set=gssdp_client_set_search_coalesce_threshold)
+         *
+         * M-SEARCH requests of all [class@GSSDP.ResourceBrowser]s using this
+         * client are sent right away if none went out recently. Otherwise
+         * they are collected for a short time and requests for the same
+         * target are only sent once.
+         *
+         * If this is not 0 and at least this many different targets are
+         * pending at the same time, a single `ssdp:all` search is sent
+         * instead. Every browser still only sees the responses matching its
+         * own target.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_SEARCH_COALESCE_THRESHOLD,
+                g_param_spec_uint ("search-coalesce-threshold",
+                                   "Search coalesce threshold",
+                                   "Number of concurrent search targets to "
+                                   "merge into one ssdp:all search",
+                                   0,
+                                   G_MAXUINT,
+                                   0,
+                                   G_PARAM_READWRITE |
+                                           G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:monitor-network:(attributes org.gtk.Property.get=gssdp_client_get_monitor_network org.gtk.Property.set=gssdp_client_set_monitor_network)
+         *
+         * Whether to follow address and link changes reported by the
+         * [class@GSSDP.NetworkMonitor].
+         *
+         * If the address of the client disappears, or the link of its
+         * interface comes back up, the client calls
+         * [method@GSSDP.Client.rebind] on its own.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_MONITOR_NETWORK,
+                g_param_spec_boolean ("monitor-network",
+                                      "Monitor network",
+                                      "Rebind on address and link changes",
+                                      FALSE,
+                                      G_PARAM_READWRITE |
+                                              G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:lazy-sockets:
+         *
+         * Whether to create the socket used for M-SEARCH requests, and the
+         * TCP socket if [property@GSSDP.Client:allocate-tcp-socket] is set,
+         * only when they are first needed.
+         *
+         * That is when the first search is sent. Until then, and while the
+         * search socket is released after
+         * [property@GSSDP.Client:socket-idle-timeout],
+         * [property@GSSDP.Client:port] is 0 and
+         * [property@GSSDP.Client:tcp-socket] is %NULL. A client that only
+         * announces resources never opens them.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_LAZY_SOCKETS,
+                g_param_spec_boolean ("lazy-sockets",
+                                      "Lazy sockets",
+                                      "Create the search socket on demand",
+                                      FALSE,
+                                      G_PARAM_READWRITE |
+                                              G_PARAM_CONSTRUCT_ONLY |
+                                              G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:socket-idle-timeout:(attributes org.gtk.Property.get=gssdp_client_get_socket_idle_timeout org.gtk.Property.set=gssdp_client_set_socket_idle_timeout)
+         *
+         * With [property@GSSDP.Client:lazy-sockets], the number of seconds
+         * after the last search until the search socket is closed again, or
+         * 0 to keep it open.
+         *
+         * A later search uses the same port again. If the port was picked
+         * at random and got taken in the meantime, a new one is picked and
+         * [property@GSSDP.Client:port] is notified. A TCP socket is kept
+         * bound while the search socket is released. The timeout should be
+         * longer than the MX value of the browsers, otherwise late responses
+         * are lost.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_SOCKET_IDLE_TIMEOUT,
+                g_param_spec_uint ("socket-idle-timeout",
+                                   "Socket idle timeout",
+                                   "Seconds until an unused search socket "
+                                   "is closed",
+                                   0,
+                                   G_MAXUINT / 1000,
+                                   0,
+                                   G_PARAM_READWRITE |
+                                           G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:listen-only:
+         *
+         * Whether the client only listens to the multicast traffic on its
+         * network.
+         *
+         * Only the multicast socket is opened. There is no socket for
+         * unicast responses or searches, no TCP socket, and nothing is ever
+         * sent, regardless of [property@GSSDP.Client:active]. Use this for
+         * monitoring announcements with as few resources as possible.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_LISTEN_ONLY,
+                g_param_spec_boolean ("listen-only",
+                                      "Listen only",
+                                      "Only open the multicast socket",
+                                      FALSE,
+                                      G_PARAM_READWRITE |
+                                              G_PARAM_CONSTRUCT_ONLY |
+                                              G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:receive-buffer-size:
+         *
+         * The size in bytes of the kernel receive buffer of the client's UDP
+         * sockets, or 0 to use the system default.
+         *
+         * A larger buffer lets the kernel hold on to more datagrams while
+         * the main loop is busy, e.g. during bursts of announcements. The
+         * kernel may clamp the value, see SO_RCVBUF in socket(7).
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_RECEIVE_BUFFER_SIZE,
+                g_param_spec_uint ("receive-buffer-size",
+                                   "Receive buffer size",
+                                   "Size of the kernel receive buffer",
+                                   0,
+                                   G_MAXINT,
+                                   0,
+                                   G_PARAM_READWRITE |
+                                           G_PARAM_CONSTRUCT_ONLY |
+                                           G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:kernel-drops:(attributes org.gtk.Property.get=gssdp_client_get_kernel_drops)
+         *
+         * The number of datagrams the kernel dropped on the client's sockets
+         * because their receive queue was full.
+         *
+         * This is only updated when a later datagram arrives on the same
+         * socket, and stays 0 on platforms that do not support SO_RXQ_OVFL.
+         * The kernel does not tell datagrams rejected by
+         * [property@GSSDP.Client:kernel-filter] apart from overflows, so
+         * drops on filtered sockets are counted in
+         * [property@GSSDP.Client:kernel-filter-drops] instead. With
+         * [property@GSSDP.Client:receive-threads], drops on the multicast
+         * sockets are not counted at all.
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_KERNEL_DROPS,
+                g_param_spec_uint64 ("kernel-drops",
+                                     "Kernel drops",
+                                     "Datagrams dropped by the kernel",
+                                     0,
+                                     G_MAXUINT64,
+                                     0,
+                                     G_PARAM_READABLE |
+                                             G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient:kernel-filter-drops:(attributes org.gtk.Property.get=gssdp_client_get_kernel_filter_drops)
+         *
+         * The number of datagrams the kernel dropped on sockets while
+         * [property@GSSDP.Client:kernel-filter] was restricting them.
+         *
+         * This includes both the datagrams rejected by the filter and those
+         * dropped because the receive queue was full. It is updated like
+         * [property@GSSDP.Client:kernel-drops].
+         *
+         * Since: 1.8.0
+         */
+        g_object_class_install_property (
+                object_class,
+                PROP_KERNEL_FILTER_DROPS,
+                g_param_spec_uint64 ("kernel-filter-drops",
+                                     "Kernel filter drops",
+                                     "Datagrams dropped by the kernel on "
+                                     "filtered sockets",
+                                     0,
+                                     G_MAXUINT64,
+                                     0,
+                                     G_PARAM_READABLE |
+                                             G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPClient::rebound:
+         * @client: The #GSSDPClient that was rebound
+         *
+         * The client's sockets were recreated by
+         * [method@GSSDP.Client.rebind], possibly on a new address.
+         *
+         * [class@GSSDP.ResourceGroup]s using the client re-announce their
+         * resources and [class@GSSDP.ResourceBrowser]s start a new
+         * discovery.
+         *
+         * Since: 1.8.0
+         **/
+        signals[REBOUND] =
+                g_signal_new ("rebound",
+                              GSSDP_TYPE_CLIENT,
+                              G_SIGNAL_RUN_LAST,
+                              0,
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              0);
+
+        /**
+         * GSSDPClient::message-received: (skip)
+         * @client: The #GSSDPClient that received the message.
+         * @from_ip: The IP address of the source.
+         * @from_port: The UDP port used by the sender.
+         * @type: The #_GSSDPMessageType.
+         * @headers: (type SoupMessageHeaders): Parsed #SoupMessageHeaders from the message.
+         *
+         * Internal signal.
+         *
+         * Stability: Private
+         **/
+        signals[MESSAGE_RECEIVED] =
+                g_signal_new ("message-received",
+                              GSSDP_TYPE_CLIENT,
+                              G_SIGNAL_RUN_LAST,
+                              0,
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              4,
+                              G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                              G_TYPE_UINT,
+                              G_TYPE_INT,
+                              soup_message_headers_get_type());
+}
+
+
+/**
+ * gssdp_client_new:
+ * @iface: (nullable): The name of the network interface, or %NULL for
+ * auto-detection.
+ * @error: (nullable): Location to store error, or %NULL
+ *
+ * Creates a GSSDP client on @iface. GSSDPClient will pick the address it finds
+ * suitable for using.
+ *
+ * Using this utility function, the created client will be using UDA 1.0 and
+ * IPv4 only.
+ *
+ * Deprecated: 1.6.0: Use [ctor@GSSDP.Client.new_for_address] instead.
+ *
+ * Return value: (nullable): A new #GSSDPClient object.
+ **/
+GSSDPClient *
+gssdp_client_new (const char *iface, GError **error)
+{
+        return g_initable_new (GSSDP_TYPE_CLIENT,
+                               NULL,
+                               error,
+                               "interface", iface,
+                               NULL);
+}
+
+/**
+ * gssdp_client_new_with_port:
+ * @iface: (nullable): The name of the network interface, or %NULL for
+ * auto-detection.
+ * @msearch_port: The network port to use for M-SEARCH requests or 0 for
+ * random.
  * @error: (allow-none): Location to store error, or %NULL.
  *
  * Creates a GSSDP client on @iface. GSSDPClient will pick the address it finds
@@ -917,6 +1679,80 @@ gssdp_client_new_full (const char *iface,
                                NULL);
 }
 
+/**
+ * gssdp_client_new_full_async:
+ * @iface: (nullable): the name of a network interface
+ * @addr: (nullable): an IP address or %NULL for auto-detection
+ * @port: The network port to use for M-SEARCH requests or 0 for
+ * random.
+ * @uda_version: The UDA version this client will adhere to
+ * @cancellable: (nullable): A #GCancellable, or %NULL
+ * @callback: (scope async): Callback to call when the client is ready
+ * @user_data: (closure): The user data for @callback
+ *
+ * Asynchronous version of [ctor@GSSDP.Client.new_full].
+ *
+ * The network interface lookup and the socket setup happen in a worker
+ * thread, so several clients can be set up concurrently without blocking
+ * the main context. Call [ctor@GSSDP.Client.new_full_finish] from @callback
+ * to get the client. The client's sockets will be dispatched in the
+ * thread-default main context of the thread calling the finish function.
+ *
+ * Since: 1.8.0
+ */
+void
+gssdp_client_new_full_async (const char          *iface,
+                             GInetAddress        *addr,
+                             guint16              port,
+                             GSSDPUDAVersion      uda_version,
+                             GCancellable        *cancellable,
+                             GAsyncReadyCallback  callback,
+                             gpointer             user_data)
+{
+        g_async_initable_new_async (GSSDP_TYPE_CLIENT,
+                                    G_PRIORITY_DEFAULT,
+                                    cancellable,
+                                    callback,
+                                    user_data,
+                                    "interface",
+                                    iface,
+                                    "address",
+                                    addr,
+                                    "port",
+                                    port,
+                                    "uda-version",
+                                    uda_version,
+                                    NULL);
+}
+
+/**
+ * gssdp_client_new_full_finish:
+ * @res: The #GAsyncResult passed to the callback of
+ * [ctor@GSSDP.Client.new_full_async]
+ * @error: (allow-none): Location to store error, or %NULL.
+ *
+ * Finishes the creation of a client started with
+ * [ctor@GSSDP.Client.new_full_async].
+ *
+ * Since: 1.8.0
+ *
+ * Return value: (nullable): A new #GSSDPClient object or %NULL on error.
+ */
+GSSDPClient *
+gssdp_client_new_full_finish (GAsyncResult *res, GError **error)
+{
+        GObject *source;
+        GObject *client;
+
+        source = g_async_result_get_source_object (res);
+        client = g_async_initable_new_finish (G_ASYNC_INITABLE (source),
+                                              res,
+                                              error);
+        g_object_unref (source);
+
+        return client != NULL ? GSSDP_CLIENT (client) : NULL;
+}
+
 /**
  * gssdp_client_new_for_address
  * @addr: (nullable): an IP address or %NULL for auto-detection. If you do not
@@ -1459,6 +2295,19 @@ gssdp_client_can_reach (GSSDPClient *client, GInetSocketAddress *address)
         return g_inet_address_mask_matches (priv->device.host_mask, addr);
 }
 
+/**
+ * gssdp_client_get_port:(attributes org.gtk.Method.get_property=port):
+ * @client: A #GSSDPClient
+ *
+ * Get the UDP port M-SEARCH requests are sent from.
+ *
+ * This does not create the search socket. With
+ * [property@GSSDP.Client:lazy-sockets], 0 is returned until the first search
+ * and while the search socket is released after being idle.
+ *
+ * Since: 1.6.0
+ * Returns: The port of the search socket, or 0 if there is none.
+ */
 guint
 gssdp_client_get_port (GSSDPClient *client)
 {
@@ -1466,6 +2315,9 @@ gssdp_client_get_port (GSSDPClient *client)
 
         GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
 
+        if (priv->search_socket == NULL)
+                return 0;
+
         return priv->msearch_port;
 }
 
@@ -1474,8 +2326,15 @@ gssdp_client_get_port (GSSDPClient *client)
  * @client: A #GSSDPClient
  *
  * Get the associated TCP socket.
+ *
+ * This does not create the search socket. With
+ * [property@GSSDP.Client:lazy-sockets], %NULL is returned until the first
+ * search and while the search socket is released after being idle.
+ *
  * Since: 1.6.5
- * Returns: (transfer full): A bound TCP socket
+ * Returns: (transfer full) (nullable): A bound TCP socket, or %NULL if
+ * [property@GSSDP.Client:allocate-tcp-socket] is not set or there is no
+ * search socket
  */
 GSocket *
 gssdp_client_get_tcp_socket (GSSDPClient *client)
@@ -1484,10 +2343,878 @@ gssdp_client_get_tcp_socket (GSSDPClient *client)
 
         GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
 
+        if (priv->search_socket == NULL || priv->tcp_socket == NULL)
+                return NULL;
+
         return g_object_ref (priv->tcp_socket);
 }
 
 
+/**
+ * gssdp_client_set_search_coalesce_threshold:(attributes org.gtk.Method.set_property=search-coalesce-threshold):
+ * @client: A #GSSDPClient
+ * @threshold: The number of concurrent targets, or 0 to disable
+ *
+ * Sets the number of different search targets that are merged into a single
+ * `ssdp:all` search.
+ *
+ * Since: 1.8.0
+ */
+void
+gssdp_client_set_search_coalesce_threshold (GSSDPClient *client,
+                                            guint        threshold)
+{
+        g_return_if_fail (GSSDP_IS_CLIENT (client));
+
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        if (priv->search_coalesce_threshold == threshold)
+                return;
+
+        priv->search_coalesce_threshold = threshold;
+
+        g_object_notify (G_OBJECT (client), "search-coalesce-threshold");
+}
+
+/**
+ * gssdp_client_get_search_coalesce_threshold:(attributes org.gtk.Method.get_property=search-coalesce-threshold):
+ * @client: A #GSSDPClient
+ *
+ * Since: 1.8.0
+ * Returns: The number of different search targets that are merged into a
+ * single `ssdp:all` search, 0 if disabled.
+ */
+guint
+gssdp_client_get_search_coalesce_threshold (GSSDPClient *client)
+{
+        g_return_val_if_fail (GSSDP_IS_CLIENT (client), 0);
+
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        return priv->search_coalesce_threshold;
+}
+
+static void
+network_device_clear (GSSDPNetworkDevice *device)
+{
+        g_clear_pointer (&device->iface_name, g_free);
+        g_clear_pointer (&device->host_ip, g_free);
+        g_clear_pointer (&device->network, g_free);
+        g_clear_object (&device->host_addr);
+        g_clear_object (&device->host_mask);
+}
+
+/**
+ * gssdp_client_rebind:
+ * @client: A #GSSDPClient
+ * @error: (nullable): Location to store error, or %NULL
+ *
+ * Recreates the sockets of @client on its network interface.
+ *
+ * If the address of @client is still assigned to the interface, it is kept.
+ * Otherwise another address of the same family is picked from the
+ * interface, and the host IP, address, mask and (unless it was set
+ * explicitly) the network of @client are updated.
+ *
+ * The search port is kept. If the address did not change, so is the TCP
+ * socket of [property@GSSDP.Client:allocate-tcp-socket], since it still
+ * holds that port.
+ *
+ * On success, [signal@GSSDP.Client::rebound] is emitted. On failure, the
+ * client is left unchanged.
+ *
+ * Returns: %TRUE if the sockets were recreated.
+ *
+ * Since: 1.8.0
+ */
+gboolean
+gssdp_client_rebind (GSSDPClient *client, GError **error)
+{
+        GSSDPClientPrivate *priv;
+        GSSDPNetworkDevice device = { 0 };
+        GSSDPNetworkDevice old;
+        GSocket *old_tcp_socket = NULL;
+        char *old_network = NULL;
+        gboolean address_changed;
+        gboolean tcp_socket_changed;
+
+        g_return_val_if_fail (GSSDP_IS_CLIENT (client), FALSE);
+
+        priv = gssdp_client_get_instance_private (client);
+
+        g_return_val_if_fail (priv->initialized, FALSE);
+
+        /* Do not pick the address from a cached, possibly stale, snapshot
+         * of the interfaces */
+        gssdp_net_invalidate_interfaces ();
+
+        device.iface_name = g_strdup (priv->device.iface_name);
+        device.address_family = priv->device.address_family;
+        device.host_addr = g_object_ref (priv->device.host_addr);
+
+        /* Only follow the network if it was derived from the address */
+        old_network = g_inet_address_mask_to_string (priv->device.host_mask);
+        if (g_strcmp0 (old_network, priv->device.network) != 0)
+                device.network = g_strdup (priv->device.network);
+        g_free (old_network);
+
+        if (!gssdp_net_get_host_ip (&device, error))
+                goto errors;
+
+        if (device.host_ip == NULL) {
+                /* The address is gone, pick another one from the interface */
+                g_clear_object (&device.host_addr);
+                g_clear_object (&device.host_mask);
+
+                if (!gssdp_net_get_host_ip (&device, error))
+                        goto errors;
+        }
+
+        if (device.host_addr == NULL || device.host_mask == NULL) {
+                g_set_error (error,
+                             GSSDP_ERROR,
+                             GSSDP_ERROR_NO_IP_ADDRESS,
+                             "Failed to find IP of interface %s",
+                             priv->device.iface_name);
+
+                goto errors;
+        }
+
+        /* The workers read from the device while it is swapped */
+        stop_receive_workers (client);
+
+        old = priv->device;
+        priv->device = device;
+
+        /* On an unchanged address, the TCP socket is carried over */
+        if (priv->tcp_socket != NULL)
+                old_tcp_socket = g_object_ref (priv->tcp_socket);
+
+        if (!create_sockets (client, error)) {
+                priv->device = old;
+                start_receive_workers (client);
+                g_clear_object (&old_tcp_socket);
+
+                goto errors;
+        }
+
+        attach_sockets (client);
+
+        address_changed = !g_inet_address_equal (old.host_addr,
+                                                 priv->device.host_addr);
+        tcp_socket_changed = priv->allocate_tcp_socket &&
+                             priv->tcp_socket != old_tcp_socket;
+        g_clear_object (&old_tcp_socket);
+        network_device_clear (&old);
+
+        priv->address_lost = FALSE;
+
+        g_debug ("Rebound SSDP client %p to %s on %s",
+                 client,
+                 priv->device.host_ip,
+                 priv->device.iface_name);
+
+        if (address_changed) {
+                g_object_notify (G_OBJECT (client), "host-ip");
+                g_object_notify (G_OBJECT (client), "host-addr");
+                g_object_notify (G_OBJECT (client), "host-mask");
+                g_object_notify (G_OBJECT (client), "network");
+        }
+
+        if (tcp_socket_changed)
+                g_object_notify (G_OBJECT (client), "tcp-socket");
+
+        g_signal_emit (client, signals[REBOUND], 0);
+
+        return TRUE;
+
+errors:
+        network_device_clear (&device);
+
+        return FALSE;
+}
+
+static gboolean
+rebind_timeout (gpointer user_data)
+{
+        GSSDPClient *client = GSSDP_CLIENT (user_data);
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        GError *error = NULL;
+
+        priv->rebind_src = NULL;
+
+        if (!gssdp_client_rebind (client, &error)) {
+                /* Try again once the next address shows up */
+                g_debug ("Failed to rebind client %p: %s",
+                         client,
+                         error->message);
+                g_clear_error (&error);
+        }
+
+        return FALSE;
+}
+
+static void
+schedule_rebind (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        if (!priv->initialized || priv->rebind_src != NULL)
+                return;
+
+        priv->rebind_src = g_timeout_source_new (REBIND_DELAY);
+        g_source_set_callback (priv->rebind_src, rebind_timeout, client, NULL);
+        g_source_attach (priv->rebind_src,
+                         g_main_context_get_thread_default ());
+        g_source_unref (priv->rebind_src);
+}
+
+static void
+on_address_added (G_GNUC_UNUSED GSSDPNetworkMonitor *monitor,
+                  G_GNUC_UNUSED const char          *iface,
+                  guint                              index,
+                  GInetAddress                      *address,
+                  gpointer                           user_data)
+{
+        GSSDPClient *client = GSSDP_CLIENT (user_data);
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        if (!priv->address_lost || (gint) index != priv->device.index)
+                return;
+
+        if (g_inet_address_get_family (address) !=
+            priv->device.address_family)
+                return;
+
+        schedule_rebind (client);
+}
+
+static void
+on_address_removed (G_GNUC_UNUSED GSSDPNetworkMonitor *monitor,
+                    G_GNUC_UNUSED const char          *iface,
+                    G_GNUC_UNUSED guint                index,
+                    GInetAddress                      *address,
+                    gpointer                           user_data)
+{
+        GSSDPClient *client = GSSDP_CLIENT (user_data);
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        if (priv->device.host_addr == NULL ||
+            !g_inet_address_equal (address, priv->device.host_addr))
+                return;
+
+        priv->address_lost = TRUE;
+
+        /* There might be another address on the interface already */
+        schedule_rebind (client);
+}
+
+static void
+on_link_changed (G_GNUC_UNUSED GSSDPNetworkMonitor *monitor,
+                 G_GNUC_UNUSED const char          *iface,
+                 guint                              index,
+                 gboolean                           up,
+                 gpointer                           user_data)
+{
+        GSSDPClient *client = GSSDP_CLIENT (user_data);
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        /* Multicast memberships do not survive a link going down */
+        if (up && (gint) index == priv->device.index)
+                schedule_rebind (client);
+}
+
+/**
+ * gssdp_client_set_monitor_network:(attributes org.gtk.Method.set_property=monitor-network):
+ * @client: A #GSSDPClient
+ * @monitor_network: %TRUE to follow address and link changes
+ *
+ * Sets whether @client rebinds on its own when its address or link changes.
+ *
+ * Since: 1.8.0
+ */
+void
+gssdp_client_set_monitor_network (GSSDPClient *client,
+                                  gboolean     monitor_network)
+{
+        GSSDPClientPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_CLIENT (client));
+
+        priv = gssdp_client_get_instance_private (client);
+
+        if ((priv->monitor != NULL) == monitor_network)
+                return;
+
+        if (monitor_network) {
+                priv->monitor = gssdp_network_monitor_dup_default ();
+                g_signal_connect_object (priv->monitor,
+                                         "address-added",
+                                         G_CALLBACK (on_address_added),
+                                         client,
+                                         0);
+                g_signal_connect_object (priv->monitor,
+                                         "address-removed",
+                                         G_CALLBACK (on_address_removed),
+                                         client,
+                                         0);
+                g_signal_connect_object (priv->monitor,
+                                         "link-changed",
+                                         G_CALLBACK (on_link_changed),
+                                         client,
+                                         0);
+        } else {
+                g_signal_handlers_disconnect_by_data (priv->monitor, client);
+                g_clear_object (&priv->monitor);
+                g_clear_pointer (&priv->rebind_src, g_source_destroy);
+                priv->address_lost = FALSE;
+        }
+
+        g_object_notify (G_OBJECT (client), "monitor-network");
+}
+
+/**
+ * gssdp_client_get_monitor_network:(attributes org.gtk.Method.get_property=monitor-network):
+ * @client: A #GSSDPClient
+ *
+ * Since: 1.8.0
+ * Returns: %TRUE if @client follows address and link changes.
+ */
+gboolean
+gssdp_client_get_monitor_network (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_CLIENT (client), FALSE);
+
+        priv = gssdp_client_get_instance_private (client);
+
+        return priv->monitor != NULL;
+}
+
+/**
+ * gssdp_client_set_socket_idle_timeout:(attributes org.gtk.Method.set_property=socket-idle-timeout):
+ * @client: A #GSSDPClient
+ * @timeout: Seconds until an unused search socket is closed, or 0
+ *
+ * Sets the time after which an unused search socket is closed again. Only
+ * has an effect with [property@GSSDP.Client:lazy-sockets].
+ *
+ * Since: 1.8.0
+ */
+void
+gssdp_client_set_socket_idle_timeout (GSSDPClient *client, guint timeout)
+{
+        GSSDPClientPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_CLIENT (client));
+        g_return_if_fail (timeout <= G_MAXUINT / 1000);
+
+        priv = gssdp_client_get_instance_private (client);
+
+        if (priv->socket_idle_timeout == timeout)
+                return;
+
+        priv->socket_idle_timeout = timeout;
+
+        /* Start over with the new value */
+        g_clear_pointer (&priv->search_idle_src, g_source_destroy);
+        if (priv->search_socket != NULL)
+                schedule_search_socket_release (client, timeout * 1000);
+
+        g_object_notify (G_OBJECT (client), "socket-idle-timeout");
+}
+
+/**
+ * gssdp_client_get_socket_idle_timeout:(attributes org.gtk.Method.get_property=socket-idle-timeout):
+ * @client: A #GSSDPClient
+ *
+ * Since: 1.8.0
+ * Returns: The seconds until an unused search socket is closed, 0 if it is
+ * kept open.
+ */
+guint
+gssdp_client_get_socket_idle_timeout (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_CLIENT (client), 0);
+
+        priv = gssdp_client_get_instance_private (client);
+
+        return priv->socket_idle_timeout;
+}
+
+/**
+ * gssdp_client_get_kernel_drops:(attributes org.gtk.Method.get_property=kernel-drops):
+ * @client: A #GSSDPClient
+ *
+ * Since: 1.8.0
+ * Returns: The number of datagrams the kernel dropped on the unfiltered
+ * sockets of @client so far.
+ */
+guint64
+gssdp_client_get_kernel_drops (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_CLIENT (client), 0);
+
+        priv = gssdp_client_get_instance_private (client);
+
+        return priv->kernel_drops;
+}
+
+/**
+ * gssdp_client_get_kernel_filter_drops:(attributes org.gtk.Method.get_property=kernel-filter-drops):
+ * @client: A #GSSDPClient
+ *
+ * Since: 1.8.0
+ * Returns: The number of datagrams the kernel dropped or rejected on the
+ * filtered sockets of @client so far.
+ */
+guint64
+gssdp_client_get_kernel_filter_drops (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_CLIENT (client), 0);
+
+        priv = gssdp_client_get_instance_private (client);
+
+        return priv->kernel_filter_drops;
+}
+
+/**
+ * gssdp_client_get_message_arrival_time:
+ * @client: A #GSSDPClient
+ *
+ * Get the time the kernel received the message that is currently being
+ * dispatched by [signal@GSSDP.Client::message-received].
+ *
+ * This requires [property@GSSDP.Client:receive-timestamps] to be set.
+ *
+ * Since: 1.8.0
+ * Returns: The arrival time in microseconds since the epoch, like
+ * g_get_real_time(), or 0 if it is not known.
+ */
+gint64
+gssdp_client_get_message_arrival_time (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_CLIENT (client), 0);
+
+        priv = gssdp_client_get_instance_private (client);
+
+        return priv->message_arrival_time;
+}
+
+/**
+ * gssdp_client_get_latency_histogram:
+ * @client: A #GSSDPClient
+ * @n_buckets: (out): Return location for the number of buckets
+ *
+ * Get the histogram of the delay between the kernel receiving a message and
+ * the client dispatching it, see
+ * [property@GSSDP.Client:receive-timestamps].
+ *
+ * Bucket 0 counts delays below 1 µs. Bucket n counts delays of at least
+ * 2^(n-1) µs and below 2^n µs; the last bucket also counts all longer
+ * delays.
+ *
+ * Since: 1.8.0
+ * Returns: (array length=n_buckets) (transfer none): The number of messages
+ * per bucket
+ */
+const guint64 *
+gssdp_client_get_latency_histogram (GSSDPClient *client, guint *n_buckets)
+{
+        GSSDPClientPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_CLIENT (client), NULL);
+        g_return_val_if_fail (n_buckets != NULL, NULL);
+
+        priv = gssdp_client_get_instance_private (client);
+
+        *n_buckets = LATENCY_BUCKETS;
+
+        return priv->latency_histogram;
+}
+
+static GSSDPSocketAcceptFlags
+get_accepted_messages (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        GSSDPSocketAcceptFlags accept = 0;
+
+        if (!priv->kernel_filter)
+                return GSSDP_SOCKET_ACCEPT_ALL;
+
+        if (priv->n_publishers > 0)
+                accept |= GSSDP_SOCKET_ACCEPT_SEARCH;
+
+        if (priv->n_browsers > 0)
+                accept |= GSSDP_SOCKET_ACCEPT_NOTIFY |
+                          GSSDP_SOCKET_ACCEPT_RESPONSE;
+
+        return accept;
+}
+
+static void
+apply_message_filter (GSSDPClient *client, GSSDPSocketSource *socket_source)
+{
+        GError *error = NULL;
+
+        if (socket_source == NULL)
+                return;
+
+        if (!gssdp_socket_source_set_message_filter (
+                                socket_source,
+                                get_accepted_messages (client),
+                                &error)) {
+                g_warning ("Failed to set message filter: %s",
+                           error->message);
+                g_error_free (error);
+        }
+}
+
+static void
+update_message_filters (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        apply_message_filter (client, priv->request_socket);
+        apply_message_filter (client, priv->multicast_socket);
+        apply_message_filter (client, priv->search_socket);
+
+        if (priv->receive_workers != NULL) {
+                guint i;
+
+                for (i = 0; i < priv->receive_workers->len; i++) {
+                        ReceiveWorker *worker;
+
+                        worker = g_ptr_array_index (priv->receive_workers, i);
+                        apply_message_filter (client, worker->socket_source);
+                }
+        }
+}
+
+/**
+ * gssdp_client_set_kernel_filter:(attributes org.gtk.Method.set_property=kernel-filter):
+ * @client: A #GSSDPClient
+ * @kernel_filter: %TRUE to drop unused messages in the kernel
+ *
+ * Sets [property@GSSDP.Client:kernel-filter].
+ *
+ * Since: 1.8.0
+ */
+void
+gssdp_client_set_kernel_filter (GSSDPClient *client, gboolean kernel_filter)
+{
+        GSSDPClientPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_CLIENT (client));
+
+        priv = gssdp_client_get_instance_private (client);
+
+        kernel_filter = !!kernel_filter;
+        if (priv->kernel_filter == kernel_filter)
+                return;
+
+        priv->kernel_filter = kernel_filter;
+        update_message_filters (client);
+
+        g_object_notify (G_OBJECT (client), "kernel-filter");
+}
+
+/**
+ * gssdp_client_get_kernel_filter:(attributes org.gtk.Method.get_property=kernel-filter):
+ * @client: A #GSSDPClient
+ *
+ * Since: 1.8.0
+ * Returns: %TRUE if the kernel drops messages not used on @client.
+ */
+gboolean
+gssdp_client_get_kernel_filter (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_CLIENT (client), FALSE);
+
+        priv = gssdp_client_get_instance_private (client);
+
+        return priv->kernel_filter;
+}
+
+/**
+ * gssdp_client_get_socket_option:
+ * @client: A #GSSDPClient
+ * @option: The option to read
+ * @value: (out): Return location for the value
+ * @error: (nullable): Return location for a #GError
+ *
+ * Read back the value of a socket option as the kernel applied it. This may
+ * differ from the value set on @client; Linux, for example, doubles buffer
+ * sizes and clamps them to the system maximum.
+ *
+ * The value is always read from the socket of @client on the SSDP multicast
+ * group. The other sockets, including the TCP socket of
+ * [property@GSSDP.Client:allocate-tcp-socket], get the same options, except
+ * for [property@GSSDP.Client:multicast-loopback], which is only set on the
+ * multicast socket, and the multicast options on the TCP socket.
+ *
+ * Since: 1.8.0
+ * Returns: %TRUE if @value was set, %FALSE if @client has no socket or the
+ * platform does not support @option.
+ */
+gboolean
+gssdp_client_get_socket_option (GSSDPClient      *client,
+                                GSSDPSocketOption option,
+                                gint             *value,
+                                GError          **error)
+{
+        GSSDPClientPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_CLIENT (client), FALSE);
+        g_return_val_if_fail (value != NULL, FALSE);
+        g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+        priv = gssdp_client_get_instance_private (client);
+
+        if (priv->multicast_socket == NULL) {
+                g_set_error_literal (error,
+                                     GSSDP_ERROR,
+                                     GSSDP_ERROR_FAILED,
+                                     "Client has no socket");
+
+                return FALSE;
+        }
+
+        return gssdp_socket_get_option_value (
+                        gssdp_socket_source_get_socket (priv->multicast_socket),
+                        option,
+                        value,
+                        error);
+}
+
+/*
+ * Called by resource groups and browsers using @client, so the kernel
+ * filter lets their messages through.
+ */
+void
+_gssdp_client_hold_role (GSSDPClient *client, _GSSDPClientRole role)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        if (role == _GSSDP_CLIENT_ROLE_PUBLISHER)
+                priv->n_publishers++;
+        else
+                priv->n_browsers++;
+
+        update_message_filters (client);
+}
+
+void
+_gssdp_client_release_role (GSSDPClient *client, _GSSDPClientRole role)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        if (role == _GSSDP_CLIENT_ROLE_PUBLISHER) {
+                g_return_if_fail (priv->n_publishers > 0);
+                priv->n_publishers--;
+        } else {
+                g_return_if_fail (priv->n_browsers > 0);
+                priv->n_browsers--;
+        }
+
+        update_message_filters (client);
+}
+
+static void
+record_latency (GSSDPClient *client, gint64 arrival_time)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        gint64 latency;
+        guint bucket = 0;
+
+        /* The wall clock might have been changed in between */
+        latency = g_get_real_time () - arrival_time;
+        if (latency > 0)
+                bucket = MIN (g_bit_storage (latency), LATENCY_BUCKETS - 1);
+
+        priv->latency_histogram[bucket]++;
+}
+
+static char *
+new_search_message (GSSDPClient *client, const char *target, guint mx)
+{
+        const char *group;
+        char *dest;
+        char *message;
+
+        group = _gssdp_client_get_mcast_group (client);
+
+        if (strchr (group, ':')) {
+                dest = g_strdup_printf ("[%s]", group);
+        } else {
+                dest = g_strdup (group);
+        }
+
+        message = g_strdup_printf (SSDP_DISCOVERY_REQUEST,
+                                   dest,
+                                   target,
+                                   mx,
+                                   gssdp_client_get_server_id (client));
+
+        g_free (dest);
+
+        return message;
+}
+
+static gboolean
+flush_searches (gpointer user_data);
+
+/* Starts the window in which further searches are held back */
+static void
+start_search_window (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        priv->search_src = g_timeout_source_new (SEARCH_COALESCE_DELAY);
+        g_source_set_callback (priv->search_src,
+                               flush_searches,
+                               client,
+                               NULL);
+        g_source_attach (priv->search_src,
+                         g_main_context_get_thread_default ());
+        g_source_unref (priv->search_src);
+}
+
+static gboolean
+flush_searches (gpointer user_data)
+{
+        GSSDPClient *client = GSSDP_CLIENT (user_data);
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        GHashTableIter iter;
+        gpointer key, value;
+        guint threshold;
+        GPtrArray *messages;
+
+        priv->search_src = NULL;
+        g_hash_table_remove_all (priv->sent_searches);
+
+        /* Quiet for a whole window, the next search can go out at once */
+        if (g_hash_table_size (priv->pending_searches) == 0)
+                return FALSE;
+
+        messages = g_ptr_array_new_with_free_func (g_free);
+        threshold = priv->search_coalesce_threshold;
+
+        if (threshold > 0 &&
+            g_hash_table_size (priv->pending_searches) >= threshold) {
+                guint mx = 0;
+
+                g_hash_table_iter_init (&iter, priv->pending_searches);
+                while (g_hash_table_iter_next (&iter, NULL, &value))
+                        mx = MAX (mx, GPOINTER_TO_UINT (value));
+
+                g_ptr_array_add (messages,
+                                 new_search_message (client,
+                                                     SSDP_ALL_TARGET,
+                                                     mx));
+        } else {
+                g_hash_table_iter_init (&iter, priv->pending_searches);
+                while (g_hash_table_iter_next (&iter, &key, &value))
+                        g_ptr_array_add (messages,
+                                         new_search_message (
+                                                client,
+                                                key,
+                                                GPOINTER_TO_UINT (value)));
+        }
+
+        g_hash_table_iter_init (&iter, priv->pending_searches);
+        while (g_hash_table_iter_next (&iter, &key, NULL)) {
+                g_hash_table_iter_steal (&iter);
+                g_hash_table_add (priv->sent_searches, key);
+        }
+
+        /* Send all searches in one go */
+        _gssdp_client_send_messages (client,
+                                     NULL,
+                                     0,
+                                     (const char *const *) messages->pdata,
+                                     messages->len,
+                                     _GSSDP_DISCOVERY_REQUEST);
+        g_ptr_array_unref (messages);
+
+        start_search_window (client);
+
+        return FALSE;
+}
+
+/**
+ * _gssdp_client_queue_search:
+ * @client: A #GSSDPClient
+ * @target: The search target
+ * @mx: The MX value of the search
+ *
+ * Queues a multicast M-SEARCH for @target. If no search went out
+ * recently, it is sent right away. Otherwise it waits for the end of a
+ * short window and all searches queued within it are sent together, with
+ * duplicate targets only sent once using the largest MX requested. A
+ * target that went out since the window started is not sent again.
+ **/
+void
+_gssdp_client_queue_search (GSSDPClient *client,
+                            const char  *target,
+                            gushort      mx)
+{
+        GSSDPClientPrivate *priv = NULL;
+        gpointer value;
+
+        g_return_if_fail (GSSDP_IS_CLIENT (client));
+        g_return_if_fail (target != NULL);
+
+        priv = gssdp_client_get_instance_private (client);
+
+        /* Nothing to send from, do not even start the timer */
+        if (priv->listen_only)
+                return;
+
+        /* Nothing went out recently, so there is nothing to wait for */
+        if (priv->search_src == NULL) {
+                char *message;
+
+                message = new_search_message (client, target, mx);
+                _gssdp_client_send_message (client,
+                                            NULL,
+                                            0,
+                                            message,
+                                            _GSSDP_DISCOVERY_REQUEST);
+                g_free (message);
+
+                g_hash_table_add (priv->sent_searches, g_strdup (target));
+                start_search_window (client);
+
+                return;
+        }
+
+        /* Its responses are already on their way */
+        if (g_hash_table_contains (priv->sent_searches, target))
+                return;
+
+        if (g_hash_table_lookup_extended (priv->pending_searches,
+                                          target,
+                                          NULL,
+                                          &value))
+                mx = MAX (mx, GPOINTER_TO_UINT (value));
+
+        g_hash_table_insert (priv->pending_searches,
+                             g_strdup (target),
+                             GUINT_TO_POINTER (mx));
+}
+
 /**
  * _gssdp_client_send_message:
  * @client: A #GSSDPClient
@@ -1503,24 +3230,58 @@ _gssdp_client_send_message (GSSDPClient      *client,
                             gushort           dest_port,
                             const char       *message,
                             _GSSDPMessageType type)
+{
+        _gssdp_client_send_messages (client,
+                                     dest_ip,
+                                     dest_port,
+                                     &message,
+                                     1,
+                                     type);
+}
+
+/**
+ * _gssdp_client_send_messages:
+ * @client: A #GSSDPClient
+ * @dest_ip: (allow-none): The destination IP address, or %NULL to broadcast
+ * @dest_port: (allow-none): The destination port, or %NULL for default
+ * @messages: (array length=n_messages): The messages to send
+ * @n_messages: The number of messages
+ *
+ * Sends all of @messages to @dest_ip, in order, with as few system calls as
+ * the platform allows.
+ **/
+void
+_gssdp_client_send_messages (GSSDPClient       *client,
+                             const char        *dest_ip,
+                             gushort            dest_port,
+                             const char *const *messages,
+                             guint              n_messages,
+                             _GSSDPMessageType  type)
 {
         GSSDPClientPrivate *priv = NULL;
-        gssize res;
+        gint res;
         GError *error = NULL;
         GInetAddress *inet_address = NULL;
         GSocketAddress *address = NULL;
         GSocket *socket;
-        char *extended_message;
+        GOutputMessage *output;
+        GOutputVector *vectors;
+        char **extended_messages;
+        guint sent = 0;
+        guint i;
 
         g_return_if_fail (GSSDP_IS_CLIENT (client));
-        g_return_if_fail (message != NULL);
+        g_return_if_fail (messages != NULL || n_messages == 0);
 
         priv = gssdp_client_get_instance_private (client);
 
         g_return_if_fail (priv->initialized);
 
-        if (!priv->active)
-                /* We don't send messages in passive mode */
+        if (!priv->active || priv->listen_only)
+                /* We don't send messages in passive or listen-only mode */
+                return;
+
+        if (n_messages == 0)
                 return;
 
         /* Broadcast if @dest_ip is NULL */
@@ -1532,32 +3293,58 @@ _gssdp_client_send_message (GSSDPClient      *client,
         if (dest_port == 0)
                 dest_port = SSDP_PORT;
 
-        if (type == _GSSDP_DISCOVERY_REQUEST)
+        if (type == _GSSDP_DISCOVERY_REQUEST) {
+                if (!ensure_search_socket (client))
+                        return;
+
                 socket = gssdp_socket_source_get_socket
                                         (priv->search_socket);
-        else
+        } else
                 socket = gssdp_socket_source_get_socket
                                         (priv->request_socket);
 
         inet_address = g_inet_address_new_from_string (dest_ip);
         address = g_inet_socket_address_new (inet_address, dest_port);
-        extended_message = append_header_fields (priv->headers, message);
-
-        res = g_socket_send_to (socket,
-                                address,
-                                extended_message,
-                                strlen (extended_message),
-                                NULL,
-                                &error);
-
-        if (res == -1) {
-                g_warning ("Error sending SSDP packet to %s: %s",
-                           dest_ip,
-                           error->message);
-                g_error_free (error);
+
+        extended_messages = g_new0 (char *, n_messages + 1);
+        output = g_new0 (GOutputMessage, n_messages);
+        vectors = g_new0 (GOutputVector, n_messages);
+
+        for (i = 0; i < n_messages; i++) {
+                extended_messages[i] = append_header_fields (priv->headers,
+                                                             messages[i]);
+                vectors[i].buffer = extended_messages[i];
+                vectors[i].size = strlen (extended_messages[i]);
+                output[i].address = address;
+                output[i].vectors = &vectors[i];
+                output[i].num_vectors = 1;
+        }
+
+        /* Uses sendmmsg() where available */
+        while (sent < n_messages) {
+                res = g_socket_send_messages (socket,
+                                              output + sent,
+                                              n_messages - sent,
+                                              0,
+                                              NULL,
+                                              &error);
+
+                if (res == -1) {
+                        g_warning ("Error sending SSDP packet to %s: %s",
+                                   dest_ip,
+                                   error->message);
+                        g_clear_error (&error);
+
+                        /* Skip the message that failed and go on */
+                        sent++;
+                } else {
+                        sent += res;
+                }
         }
 
-        g_free (extended_message);
+        g_strfreev (extended_messages);
+        g_free (output);
+        g_free (vectors);
         g_object_unref (address);
         g_object_unref (inet_address);
 }
@@ -1735,54 +3522,87 @@ parse_http_response (char                *buf,
         }
 }
 
+/* A message read from one of the sockets, waiting to be dispatched */
+struct _ReceivedMessage {
+        char               *ip_string;
+        guint16             port;
+        int                 type;
+        SoupMessageHeaders *headers;
+        gint64              arrival_time;
+        guint32             drops;
+        gboolean            drops_filtered;
+};
+
+static void
+received_message_clear (ReceivedMessage *message)
+{
+        g_clear_pointer (&message->ip_string, g_free);
+        g_clear_pointer (&message->headers, soup_message_headers_unref);
+}
+
+static void
+received_message_free (ReceivedMessage *message)
+{
+        received_message_clear (message);
+        g_slice_free (ReceivedMessage, message);
+}
+
 /*
- * Called when data can be read from the socket
+ * Parses one datagram received on @socket_source into @message. This only
+ * reads from @client, so it can run on a receive worker thread.
  */
-static gboolean
-socket_source_cb (GSSDPSocketSource *socket_source, GSSDPClient *client)
+static void
+process_datagram (GSSDPClient            *client,
+                  GSSDPSocketSource      *socket_source,
+                  char                   *buf,
+                  gssize                  bytes,
+                  GSocketAddress         *address,
+                  GSocketControlMessage **messages,
+                  gint                    num_messages,
+                  ReceivedMessage        *message)
 {
         int type, len;
-        char buf[BUF_SIZE], *end;
+        char *end;
         SoupMessageHeaders *headers = NULL;
-        GSocket *socket;
-        GSocketAddress *address = NULL;
-        gssize bytes;
         GInetAddress *inetaddr;
-        char *ip_string = NULL;
-        guint16 port;
-        GError *error = NULL;
-        GInputVector vector;
-        GSocketControlMessage **messages = NULL;
-        gint num_messages = 0;
         GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
-        gboolean ret = TRUE;
 
-        vector.buffer = buf;
-        vector.size = BUF_SIZE;
+        message->type = -1;
 
-        /* Get Socket */
-        socket = gssdp_socket_source_get_socket (socket_source);
-        bytes = g_socket_receive_message (socket,
-                                          &address,
-                                          &vector,
-                                          1,
-                                          &messages,
-                                          &num_messages,
-                                          NULL,
-                                          NULL,
-                                          &error);
+#if defined(HAVE_SO_RXQ_OVFL)
+        {
+                int i;
+                for (i = 0; i < num_messages; i++) {
+                        guint32 drops;
 
-        if (bytes == -1) {
-                if (!g_error_matches (error,
-                                      G_IO_ERROR,
-                                      G_IO_ERROR_WOULD_BLOCK)) {
-                        g_warning ("Failed to receive from socket: %s",
-                                   error->message);
-                        ret = FALSE;
+                        if (!GSSDP_IS_RXQ_OVFL_MESSAGE (messages[i]))
+                                continue;
+
+                        drops = gssdp_rxq_ovfl_message_get_drops (
+                                GSSDP_RXQ_OVFL_MESSAGE (messages[i]));
+                        message->drops =
+                                gssdp_socket_source_update_drops (socket_source,
+                                                                  drops);
+                        message->drops_filtered =
+                                gssdp_socket_source_is_filtered (
+                                        socket_source);
                 }
+        }
+#endif
 
-                goto out;
+#if defined(HAVE_SO_TIMESTAMPNS)
+        {
+                int i;
+                for (i = 0; i < num_messages; i++) {
+                        if (GSSDP_IS_TIMESTAMP_MESSAGE (messages[i])) {
+                                message->arrival_time =
+                                        gssdp_timestamp_message_get_time (
+                                        GSSDP_TIMESTAMP_MESSAGE (messages[i]));
+                                break;
+                        }
+                }
         }
+#endif
 
 #if defined(HAVE_PKTINFO)
         {
@@ -1821,116 +3641,481 @@ socket_source_cb (GSSDPSocketSource *socket_source, GSSDPClient *client)
                                 break;
                         }
 
-                        if (g_inet_address_equal (local_addr,
-                                                  priv->device.host_addr)) {
-                                // This is a "normal" packet. We can receive those
+                        if (g_inet_address_equal (local_addr,
+                                                  priv->device.host_addr)) {
+                                // This is a "normal" packet. We can receive those
+
+                                if (msg_ifindex != priv->device.index &&
+                                    msg_ifindex != LOOPBACK_IFINDEX) {
+                                        goto out;
+                                }
+                                break;
+                        }
+                }
+        }
+#else
+        /* We need the following lines to make sure the right client received
+         * the packet. We won't need to do this if there was any way to tell
+         * Mr. Unix that we are only interested in receiving multicast packets
+         * on this socket from a particular interface but AFAIK that is not
+         * possible, at least not in a portable way.
+         */
+
+        if (!gssdp_client_can_reach (client, G_INET_SOCKET_ADDRESS(address))) {
+                goto out;
+        }
+#endif
+
+        if (bytes >= BUF_SIZE) {
+                g_warning ("Received packet of %" G_GSSIZE_FORMAT " bytes, "
+                           "but the maximum buffer size is %d. Packed dropped.",
+                           bytes, BUF_SIZE);
+
+                goto out;
+        }
+
+        /* Add trailing \0 */
+        buf[bytes] = '\0';
+
+        /* Find length */
+        end = strstr (buf, "\r\n\r\n");
+        if (!end) {
+                g_debug ("Received packet lacks \"\\r\\n\\r\\n\" sequence. "
+                         "Packed dropped.");
+
+                goto out;
+        }
+
+        len = end - buf + 2;
+
+        /* Parse message */
+        type = -1;
+        headers = NULL;
+
+        if (!parse_http_request (buf,
+                                 len,
+                                 &headers,
+                                 &type)) {
+                if (!parse_http_response (buf,
+                                          len,
+                                          &headers,
+                                          &type)) {
+                        g_debug ("Unhandled packet '%s'", buf);
+                }
+        }
+
+        /* Hand out the message if parsing succeeded */
+        if (type >= 0) {
+                inetaddr = g_inet_socket_address_get_address (
+                                        G_INET_SOCKET_ADDRESS (address));
+                message->ip_string = g_inet_address_to_string (inetaddr);
+                message->port = g_inet_socket_address_get_port (
+                                        G_INET_SOCKET_ADDRESS (address));
+                message->type = type;
+                message->headers = g_steal_pointer (&headers);
+        }
+
+out:
+        g_clear_pointer (&headers, soup_message_headers_unref);
+}
+
+/*
+ * Reads up to RECEIVE_BATCH datagrams from @socket_source with a single
+ * recvmmsg() where available and parses them into @received. @buffer must
+ * hold RECEIVE_BATCH * BUF_SIZE bytes. This only reads from @client, so it
+ * can run on a receive worker thread.
+ *
+ * Returns FALSE if the socket failed.
+ */
+static gboolean
+read_messages (GSSDPClient       *client,
+               GSSDPSocketSource *socket_source,
+               char              *buffer,
+               GCancellable      *cancellable,
+               ReceivedMessage   *received,
+               guint             *n_received)
+{
+        GInputMessage messages[RECEIVE_BATCH];
+        GInputVector vectors[RECEIVE_BATCH];
+        GSocketAddress *addresses[RECEIVE_BATCH] = { NULL, };
+        GSocketControlMessage **control_messages[RECEIVE_BATCH] = { NULL, };
+        guint num_control_messages[RECEIVE_BATCH] = { 0, };
+        GSocket *socket;
+        GError *error = NULL;
+        gint flags = 0;
+        gint n, i;
+        gboolean ret = TRUE;
+
+        *n_received = 0;
+
+        for (i = 0; i < RECEIVE_BATCH; i++) {
+                vectors[i].buffer = buffer + i * BUF_SIZE;
+                vectors[i].size = BUF_SIZE;
+
+                messages[i].address = &addresses[i];
+                messages[i].vectors = &vectors[i];
+                messages[i].num_vectors = 1;
+                messages[i].bytes_received = 0;
+                messages[i].flags = 0;
+                messages[i].control_messages = &control_messages[i];
+                messages[i].num_control_messages = &num_control_messages[i];
+        }
+
+#if defined(MSG_DONTWAIT)
+        /* Only take what is already queued; we are called when the socket
+         * is readable, so there is at least one datagram */
+        flags = MSG_DONTWAIT;
+#endif
+
+        /* Get Socket */
+        socket = gssdp_socket_source_get_socket (socket_source);
+        n = g_socket_receive_messages (socket,
+                                       messages,
+                                       RECEIVE_BATCH,
+                                       flags,
+                                       cancellable,
+                                       &error);
+
+        if (n == -1) {
+                if (!g_error_matches (error,
+                                      G_IO_ERROR,
+                                      G_IO_ERROR_WOULD_BLOCK) &&
+                    !g_error_matches (error,
+                                      G_IO_ERROR,
+                                      G_IO_ERROR_CANCELLED)) {
+                        g_warning ("Failed to receive from socket: %s",
+                                   error->message);
+                        ret = FALSE;
+                }
+
+                g_clear_error (&error);
+
+                return ret;
+        }
+
+        for (i = 0; i < n; i++) {
+                process_datagram (client,
+                                  socket_source,
+                                  vectors[i].buffer,
+                                  messages[i].bytes_received,
+                                  addresses[i],
+                                  control_messages[i],
+                                  num_control_messages[i],
+                                  &received[i]);
+        }
+        *n_received = n;
+
+        for (i = 0; i < RECEIVE_BATCH; i++) {
+                guint j;
+
+                g_clear_object (&addresses[i]);
+
+                if (control_messages[i] == NULL)
+                        continue;
+
+                for (j = 0; j < num_control_messages[i]; j++)
+                        g_object_unref (control_messages[i][j]);
+
+                g_free (control_messages[i]);
+        }
+
+        return ret;
+}
+
+/*
+ * Emits a message read by read_messages()
+ */
+static void
+dispatch_message (GSSDPClient *client, ReceivedMessage *message)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        const char *agent;
+
+        if (message->drops > 0 && message->drops_filtered) {
+                g_debug ("Kernel dropped or filtered %u datagrams on %s",
+                         message->drops,
+                         priv->device.host_ip);
+                priv->kernel_filter_drops += message->drops;
+                g_object_notify (G_OBJECT (client), "kernel-filter-drops");
+        } else if (message->drops > 0) {
+                g_debug ("Kernel dropped %u datagrams on %s",
+                         message->drops,
+                         priv->device.host_ip);
+                priv->kernel_drops += message->drops;
+                g_object_notify (G_OBJECT (client), "kernel-drops");
+        }
+
+        if (message->type < 0)
+                return;
+
+        /* update client cache */
+        agent = soup_message_headers_get_one (message->headers, "Server");
+        if (!agent)
+                agent = soup_message_headers_get_one (message->headers,
+                                                      "User-Agent");
+
+        if (agent)
+                gssdp_client_add_cache_entry (client,
+                                              message->ip_string,
+                                              agent);
+
+        if (message->arrival_time > 0)
+                record_latency (client, message->arrival_time);
+
+        priv->message_arrival_time = message->arrival_time;
+        g_signal_emit (client,
+                       signals[MESSAGE_RECEIVED],
+                       0,
+                       message->ip_string,
+                       message->port,
+                       message->type,
+                       message->headers);
+        priv->message_arrival_time = 0;
+}
+
+/*
+ * Called when data can be read from the socket
+ */
+static gboolean
+socket_source_cb (GSSDPSocketSource *socket_source, GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        ReceivedMessage messages[RECEIVE_BATCH];
+        guint n_messages, i;
+        gboolean ret;
+
+        if (priv->receive_buffer == NULL)
+                priv->receive_buffer = g_malloc (RECEIVE_BATCH * BUF_SIZE);
+
+        memset (messages, 0, sizeof (messages));
+        ret = read_messages (client,
+                             socket_source,
+                             priv->receive_buffer,
+                             NULL,
+                             messages,
+                             &n_messages);
+
+        /* A handler might drop the last reference to the client */
+        g_object_ref (client);
+        for (i = 0; i < n_messages; i++) {
+                dispatch_message (client, &messages[i]);
+                received_message_clear (&messages[i]);
+        }
+        g_object_unref (client);
+
+        return ret;
+}
+
+/*
+ * Returns the number of sockets the multicast traffic is split between
+ */
+static guint
+get_n_shards (GSSDPClient *client)
+{
+#ifdef HAVE_SOCKET_FILTER
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        return priv->receive_threads + 1;
+#else
+        return 1;
+#endif
+}
+
+static gboolean
+dispatch_queued_messages (gpointer user_data)
+{
+        GSSDPClient *client = GSSDP_CLIENT (user_data);
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        GQueue queue;
+        ReceivedMessage *message;
+
+        g_mutex_lock (&priv->dispatch_mutex);
+        queue = priv->dispatch_queue;
+        g_queue_init (&priv->dispatch_queue);
+        priv->dispatch_src = NULL;
+        g_mutex_unlock (&priv->dispatch_mutex);
+
+        g_object_ref (client);
+        while ((message = g_queue_pop_head (&queue)) != NULL) {
+                dispatch_message (client, message);
+                received_message_free (message);
+        }
+        g_object_unref (client);
+
+        return G_SOURCE_REMOVE;
+}
+
+/*
+ * Hands @message from a receive worker over to the client's main context.
+ * Messages are dispatched in the order they were queued.
+ */
+static void
+queue_received_message (GSSDPClient *client, ReceivedMessage *message)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
 
-                                if (msg_ifindex != priv->device.index &&
-                                    msg_ifindex != LOOPBACK_IFINDEX) {
-                                        goto out;
-                                }
-                                break;
+        g_mutex_lock (&priv->dispatch_mutex);
+        g_queue_push_tail (&priv->dispatch_queue, message);
+        if (priv->dispatch_src == NULL) {
+                priv->dispatch_src = g_idle_source_new ();
+                g_source_set_priority (priv->dispatch_src, G_PRIORITY_DEFAULT);
+                g_source_set_callback (priv->dispatch_src,
+                                       dispatch_queued_messages,
+                                       client,
+                                       NULL);
+                g_source_attach (priv->dispatch_src, priv->dispatch_context);
+                g_source_unref (priv->dispatch_src);
+        }
+        g_mutex_unlock (&priv->dispatch_mutex);
+}
+
+static gpointer
+receive_worker_thread (gpointer user_data)
+{
+        ReceiveWorker *worker = user_data;
+        GSocket *socket;
+        char *buffer;
+
+        socket = gssdp_socket_source_get_socket (worker->socket_source);
+        buffer = g_malloc (RECEIVE_BATCH * BUF_SIZE);
+
+        while (g_socket_condition_wait (socket,
+                                        G_IO_IN,
+                                        worker->cancellable,
+                                        NULL)) {
+                ReceivedMessage messages[RECEIVE_BATCH];
+                guint n_messages, i;
+                gboolean ret;
+
+                memset (messages, 0, sizeof (messages));
+                ret = read_messages (worker->client,
+                                     worker->socket_source,
+                                     buffer,
+                                     worker->cancellable,
+                                     messages,
+                                     &n_messages);
+
+                for (i = 0; i < n_messages; i++) {
+                        if (messages[i].type < 0 && messages[i].drops == 0) {
+                                received_message_clear (&messages[i]);
+
+                                continue;
                         }
+
+                        queue_received_message (
+                                worker->client,
+                                g_slice_dup (ReceivedMessage, &messages[i]));
                 }
-        }
-#else
-        /* We need the following lines to make sure the right client received
-         * the packet. We won't need to do this if there was any way to tell
-         * Mr. Unix that we are only interested in receiving multicast packets
-         * on this socket from a particular interface but AFAIK that is not
-         * possible, at least not in a portable way.
-         */
 
-        if (!gssdp_client_can_reach (client, G_INET_SOCKET_ADDRESS(address))) {
-                goto out;
+                if (!ret)
+                        break;
         }
-#endif
 
-        if (bytes >= BUF_SIZE) {
-                g_warning ("Received packet of %" G_GSSIZE_FORMAT " bytes, "
-                           "but the maximum buffer size is %d. Packed dropped.",
-                           bytes, BUF_SIZE);
+        g_free (buffer);
 
-                goto out;
-        }
+        return NULL;
+}
 
-        /* Add trailing \0 */
-        buf[bytes] = '\0';
+static void
+receive_worker_stop (ReceiveWorker *worker)
+{
+        if (worker->thread == NULL)
+                return;
 
-        /* Find length */
-        end = strstr (buf, "\r\n\r\n");
-        if (!end) {
-                g_debug ("Received packet lacks \"\\r\\n\\r\\n\" sequence. "
-                         "Packed dropped.");
+        g_cancellable_cancel (worker->cancellable);
+        g_thread_join (worker->thread);
+        worker->thread = NULL;
+        g_clear_object (&worker->cancellable);
+}
 
-                goto out;
-        }
+static void
+receive_worker_free (ReceiveWorker *worker)
+{
+        receive_worker_stop (worker);
+        g_clear_object (&worker->socket_source);
 
-        len = end - buf + 2;
+        g_slice_free (ReceiveWorker, worker);
+}
 
-        /* Parse message */
-        type = -1;
-        headers = NULL;
+static void
+start_receive_workers (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        guint i;
 
-        if (!parse_http_request (buf,
-                                 len,
-                                 &headers,
-                                 &type)) {
-                if (!parse_http_response (buf,
-                                          len,
-                                          &headers,
-                                          &type)) {
-                        g_debug ("Unhandled packet '%s'", buf);
-                }
-        }
+        if (priv->receive_workers == NULL)
+                return;
 
-        /* Emit signal if parsing succeeded */
-        inetaddr = g_inet_socket_address_get_address (
-                                        G_INET_SOCKET_ADDRESS (address));
-        ip_string = g_inet_address_to_string (inetaddr);
-        port = g_inet_socket_address_get_port (
-                                        G_INET_SOCKET_ADDRESS (address));
+        /* Messages are emitted in the context the client was set up in */
+        if (priv->dispatch_context == NULL)
+                priv->dispatch_context = g_main_context_ref_thread_default ();
 
-        if (type >= 0) {
-                const char *agent;
+        /* The group address is created on first use, make sure that does
+         * not happen on the workers */
+        _gssdp_client_get_mcast_group_addr (client);
 
-                /* update client cache */
-                agent = soup_message_headers_get_one (headers, "Server");
-                if (!agent)
-                        agent = soup_message_headers_get_one (headers,
-                                                              "User-Agent");
-
-                if (agent)
-                        gssdp_client_add_cache_entry (client,
-                                                      ip_string,
-                                                      agent);
-
-                g_signal_emit (client,
-                               signals[MESSAGE_RECEIVED],
-                               0,
-                               ip_string,
-                               port,
-                               type,
-                               headers);
+        for (i = 0; i < priv->receive_workers->len; i++) {
+                ReceiveWorker *worker;
+
+                worker = g_ptr_array_index (priv->receive_workers, i);
+                if (worker->thread != NULL)
+                        continue;
+
+                worker->cancellable = g_cancellable_new ();
+                worker->thread = g_thread_new ("gssdp-receive",
+                                               receive_worker_thread,
+                                               worker);
         }
+}
 
-out:
-        g_clear_error (&error);
+static void
+stop_receive_workers (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        guint i;
 
-        g_free (ip_string);
+        if (priv->receive_workers == NULL)
+                return;
 
-        g_clear_pointer (&headers, soup_message_headers_unref);
-        g_clear_object (&address);
+        for (i = 0; i < priv->receive_workers->len; i++)
+                receive_worker_stop (g_ptr_array_index (priv->receive_workers,
+                                                        i));
+}
 
-        if (messages) {
-                int i;
-                for (i = 0; i < num_messages; i++)
-                        g_object_unref (messages[i]);
+/*
+ * Creates a socket source of @type for the client's network interface.
+ */
+static GSSDPSocketSource *
+new_socket_source (GSSDPClient          *client,
+                   GSSDPSocketSourceType type,
+                   guint                 shard,
+                   GError              **error)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        GSSDPSocketSource *socket_source;
+        guint n_shards = 1;
 
-                g_free (messages);
-        }
+        if (type == GSSDP_SOCKET_SOURCE_TYPE_MULTICAST)
+                n_shards = get_n_shards (client);
 
-        return ret;
+        socket_source = GSSDP_SOCKET_SOURCE (g_initable_new
+                                        (GSSDP_TYPE_SOCKET_SOURCE,
+                                         NULL,
+                                         error,
+                                         "type", type,
+                                         "address", priv->device.host_addr,
+                                         "ttl", priv->socket_ttl,
+                                         "device-name", priv->device.iface_name,
+                                         "index", priv->device.index,
+                                         "tuning", &priv->tuning,
+                                         "timestamps",
+                                         priv->receive_timestamps,
+                                         "shard", shard,
+                                         "n-shards", n_shards,
+                                         NULL));
+        apply_message_filter (client, socket_source);
+
+        return socket_source;
 }
 
 static gboolean
@@ -1946,13 +4131,10 @@ request_socket_source_cb (G_GNUC_UNUSED GIOChannel  *source,
         if (socket_source_cb (priv->request_socket, client))
                 return TRUE;
 
-        request_socket = gssdp_socket_source_new (
-                                        GSSDP_SOCKET_SOURCE_TYPE_REQUEST,
-                                        priv->device.host_addr,
-                                        priv->socket_ttl,
-                                        gssdp_client_get_interface (client),
-                                        priv->device.index,
-                                        &error);
+        request_socket = new_socket_source (client,
+                                            GSSDP_SOCKET_SOURCE_TYPE_REQUEST,
+                                            0,
+                                            &error);
         if (request_socket != NULL) {
                 g_clear_object (&priv->request_socket);
                 priv->request_socket = request_socket;
@@ -1983,13 +4165,10 @@ multicast_socket_source_cb (G_GNUC_UNUSED GIOChannel  *source,
         if (socket_source_cb (priv->multicast_socket, client))
                 return TRUE;
 
-        multicast_socket = gssdp_socket_source_new (
-                                        GSSDP_SOCKET_SOURCE_TYPE_REQUEST,
-                                        priv->device.host_addr,
-                                        priv->socket_ttl,
-                                        gssdp_client_get_interface (client),
-                                        priv->device.index,
-                                        &error);
+        multicast_socket = new_socket_source (client,
+                                              GSSDP_SOCKET_SOURCE_TYPE_REQUEST,
+                                              0,
+                                              &error);
         if (multicast_socket != NULL) {
                 g_clear_object (&priv->multicast_socket);
                 priv->multicast_socket = multicast_socket;
@@ -2020,13 +4199,10 @@ search_socket_source_cb (G_GNUC_UNUSED GIOChannel  *source,
         if (socket_source_cb (priv->search_socket, client))
                 return TRUE;
 
-        search_socket = gssdp_socket_source_new (
-                                        GSSDP_SOCKET_SOURCE_TYPE_REQUEST,
-                                        priv->device.host_addr,
-                                        priv->socket_ttl,
-                                        gssdp_client_get_interface (client),
-                                        priv->device.index,
-                                        &error);
+        search_socket = new_socket_source (client,
+                                           GSSDP_SOCKET_SOURCE_TYPE_REQUEST,
+                                           0,
+                                           &error);
         if (search_socket != NULL) {
                 g_clear_object (&priv->search_socket);
                 priv->search_socket = search_socket;
@@ -2135,7 +4311,7 @@ init_network_info (GSSDPClient *client, GError **error)
         g_debug ("Created SSDP client %p", client);
         g_debug ("  iface_name : %s", priv->device.iface_name);
         g_debug ("  host_ip    : %s", gssdp_client_get_host_ip (client));
-        g_debug ("  port       : %u", gssdp_client_get_port (client));
+        g_debug ("  port       : %u", priv->msearch_port);
         g_debug ("  server_id  : %s", priv->server_id);
         g_debug ("  network    : %s", priv->device.network);
         g_debug ("  index      : %d", priv->device.index);
@@ -2144,3 +4320,340 @@ init_network_info (GSSDPClient *client, GError **error)
 
         return TRUE;
 }
+
+/*
+ * Returns the TCP socket of the current search socket if it is still bound
+ * to the address of the client, so a new search socket on the same port can
+ * take it over instead of binding another one next to it.
+ */
+static GSocket *
+get_reusable_tcp_socket (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        GSocketAddress *address;
+        gboolean reusable;
+
+        if (priv->tcp_socket == NULL || priv->msearch_port == 0)
+                return NULL;
+
+        address = g_socket_get_local_address (priv->tcp_socket, NULL);
+        if (address == NULL)
+                return NULL;
+
+        reusable = g_inet_address_equal (
+                g_inet_socket_address_get_address (
+                        G_INET_SOCKET_ADDRESS (address)),
+                priv->device.host_addr);
+        g_object_unref (address);
+
+        return reusable ? priv->tcp_socket : NULL;
+}
+
+/*
+ * Create a socket for sending M-SEARCH requests and receiving the responses,
+ * together with a TCP socket on the same port. @tcp_socket, if not %NULL, is
+ * taken over as that TCP socket.
+ */
+static GSSDPSocketSource *
+new_search_socket (GSSDPClient *client, GSocket *tcp_socket, GError **error)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        GSSDPSocketSource *socket_source;
+
+        /* Setup send socket. For security reasons, it is not recommended to
+         * send M-SEARCH with source port == SSDP_PORT */
+        socket_source = GSSDP_SOCKET_SOURCE (g_initable_new
+                                        (GSSDP_TYPE_SOCKET_SOURCE,
+                                         NULL,
+                                         error,
+                                         "type", GSSDP_SOCKET_SOURCE_TYPE_SEARCH,
+                                         "address", priv->device.host_addr,
+                                         "ttl", priv->socket_ttl,
+                                         "port", priv->msearch_port,
+                                         "device-name", priv->device.iface_name,
+                                         "index", priv->device.index,
+                                         "allocate-tcp-socket",
+                                         priv->allocate_tcp_socket,
+                                         "tcp-socket", tcp_socket,
+                                         "tuning", &priv->tuning,
+                                         "timestamps",
+                                         priv->receive_timestamps,
+                                         NULL));
+        apply_message_filter (client, socket_source);
+
+        return socket_source;
+}
+
+static void
+install_search_socket (GSSDPClient       *client,
+                       GSSDPSocketSource *search_socket)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        GSocket *tcp_socket;
+
+        /* Keep the port for later, re-created search sockets */
+        if (priv->msearch_port == 0) {
+                g_object_get (search_socket,
+                              "port",
+                              &priv->msearch_port,
+                              NULL);
+        }
+
+        g_clear_object (&priv->search_socket);
+        priv->search_socket = search_socket;
+
+        tcp_socket =
+                gssdp_socket_source_steal_associated_tcp_socket (search_socket);
+        if (tcp_socket != NULL) {
+                g_clear_object (&priv->tcp_socket);
+                priv->tcp_socket = tcp_socket;
+        }
+
+        gssdp_socket_source_set_callback
+                        (priv->search_socket,
+                         (GSourceFunc) search_socket_source_cb,
+                         client);
+}
+
+/*
+ * Create the request, multicast and search sockets for the current device
+ * information. On success, any previous sockets are replaced. The new
+ * sockets still need to be attached with attach_sockets().
+ *
+ * With lazy sockets, the search socket is only created if there was one
+ * before. In listen-only mode, only the multicast socket is created.
+ */
+static gboolean
+create_sockets (GSSDPClient *client, GError **error)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        GSSDPSocketSource *request_socket = NULL;
+        GSSDPSocketSource *multicast_socket = NULL;
+        GSSDPSocketSource *search_socket = NULL;
+        GPtrArray *receive_workers = NULL;
+        guint n_shards;
+        guint i;
+
+        /* Set up sockets (Will set errno if it failed) */
+        if (!priv->listen_only) {
+                request_socket = new_socket_source (client,
+                                                    GSSDP_SOCKET_SOURCE_TYPE_REQUEST,
+                                                    0,
+                                                    error);
+                if (request_socket == NULL)
+                        goto errors;
+        }
+
+        multicast_socket =
+                new_socket_source (client,
+                                   GSSDP_SOCKET_SOURCE_TYPE_MULTICAST,
+                                   0,
+                                   error);
+        if (multicast_socket == NULL)
+                goto errors;
+
+        /* The client's own multicast socket is the first shard */
+        n_shards = get_n_shards (client);
+        if (n_shards > 1) {
+                receive_workers = g_ptr_array_new_with_free_func (
+                                        (GDestroyNotify) receive_worker_free);
+
+                for (i = 1; i < n_shards; i++) {
+                        ReceiveWorker *worker;
+                        GSSDPSocketSource *socket_source;
+
+                        socket_source = new_socket_source (
+                                        client,
+                                        GSSDP_SOCKET_SOURCE_TYPE_MULTICAST,
+                                        i,
+                                        error);
+                        if (socket_source == NULL)
+                                goto errors;
+
+                        worker = g_slice_new0 (ReceiveWorker);
+                        worker->client = client;
+                        worker->socket_source = socket_source;
+                        g_ptr_array_add (receive_workers, worker);
+                }
+        }
+
+        if (!priv->listen_only &&
+            (!priv->lazy_sockets ||
+             priv->search_socket != NULL ||
+             priv->tcp_socket != NULL)) {
+                search_socket = new_search_socket (
+                                client,
+                                get_reusable_tcp_socket (client),
+                                error);
+                if (search_socket == NULL)
+                        goto errors;
+        }
+
+        g_clear_object (&priv->request_socket);
+        g_clear_object (&priv->multicast_socket);
+
+        priv->request_socket = request_socket;
+        priv->multicast_socket = multicast_socket;
+
+        g_clear_pointer (&priv->receive_workers, g_ptr_array_unref);
+        priv->receive_workers = receive_workers;
+
+        if (search_socket != NULL)
+                install_search_socket (client, search_socket);
+
+        if (priv->request_socket != NULL)
+                gssdp_socket_source_set_callback
+                                (priv->request_socket,
+                                (GSourceFunc) request_socket_source_cb,
+                                client);
+        gssdp_socket_source_set_callback
+                        (priv->multicast_socket,
+                         (GSourceFunc) multicast_socket_source_cb,
+                         client);
+
+        return TRUE;
+
+errors:
+        g_clear_object (&request_socket);
+        g_clear_object (&multicast_socket);
+        g_clear_object (&search_socket);
+        g_clear_pointer (&receive_workers, g_ptr_array_unref);
+
+        return FALSE;
+}
+
+static void
+attach_sockets (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        if (priv->request_socket != NULL)
+                gssdp_socket_source_attach (priv->request_socket);
+        gssdp_socket_source_attach (priv->multicast_socket);
+        if (priv->search_socket != NULL)
+                gssdp_socket_source_attach (priv->search_socket);
+
+        start_receive_workers (client);
+}
+
+static gboolean
+search_socket_idle_timeout (gpointer user_data)
+{
+        GSSDPClient *client = GSSDP_CLIENT (user_data);
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        gint64 idle;
+        gint64 timeout;
+
+        priv->search_idle_src = NULL;
+
+        idle = g_get_monotonic_time () - priv->search_last_used;
+        timeout = (gint64) priv->socket_idle_timeout * G_USEC_PER_SEC;
+
+        if (priv->socket_idle_timeout == 0)
+                return FALSE;
+
+        if (idle < timeout) {
+                schedule_search_socket_release (client,
+                                                (timeout - idle) / 1000);
+
+                return FALSE;
+        }
+
+        /* The TCP socket is left alone, it has been handed out already */
+        g_debug ("Releasing idle search socket of client %p", client);
+        g_clear_object (&priv->search_socket);
+
+        return FALSE;
+}
+
+static void
+schedule_search_socket_release (GSSDPClient *client, guint delay)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+
+        if (!priv->lazy_sockets ||
+            priv->socket_idle_timeout == 0 ||
+            priv->search_idle_src != NULL)
+                return;
+
+        priv->search_idle_src = g_timeout_source_new (delay);
+        g_source_set_callback (priv->search_idle_src,
+                               search_socket_idle_timeout,
+                               client,
+                               NULL);
+        g_source_attach (priv->search_idle_src,
+                         g_main_context_get_thread_default ());
+        g_source_unref (priv->search_idle_src);
+}
+
+/*
+ * Make sure there is a search socket, creating it on first use with lazy
+ * sockets
+ */
+static gboolean
+ensure_search_socket (GSSDPClient *client)
+{
+        GSSDPClientPrivate *priv = gssdp_client_get_instance_private (client);
+        GSSDPSocketSource *search_socket;
+        GSocket *old_tcp_socket;
+        GError *error = NULL;
+
+        priv->search_last_used = g_get_monotonic_time ();
+
+        if (priv->search_socket != NULL)
+                return TRUE;
+
+        if (!priv->initialized || priv->listen_only)
+                return FALSE;
+
+        /* A TCP socket that survived an idle release keeps its port, so do
+         * not try to bind another one */
+        old_tcp_socket = priv->tcp_socket != NULL
+                                 ? g_object_ref (priv->tcp_socket)
+                                 : NULL;
+        search_socket = new_search_socket (client,
+                                           get_reusable_tcp_socket (client),
+                                           &error);
+
+        /* The port of a released socket may have been taken in the meantime.
+         * If it was picked at random anyway, go for another one */
+        if (search_socket == NULL &&
+            priv->msearch_port != 0 &&
+            !priv->msearch_port_fixed) {
+                g_debug ("Search port %u of client %p is gone: %s",
+                         priv->msearch_port,
+                         client,
+                         error->message);
+                g_clear_error (&error);
+
+                priv->msearch_port = 0;
+                search_socket = new_search_socket (client, NULL, &error);
+        }
+
+        if (search_socket == NULL) {
+                g_warning ("Failed to create search socket on port %u: %s",
+                           priv->msearch_port,
+                           error->message);
+                g_error_free (error);
+                g_clear_object (&old_tcp_socket);
+
+                return FALSE;
+        }
+
+        install_search_socket (client, search_socket);
+        gssdp_socket_source_attach (priv->search_socket);
+
+        g_object_notify (G_OBJECT (client), "port");
+        if (priv->allocate_tcp_socket && priv->tcp_socket != old_tcp_socket)
+                g_object_notify (G_OBJECT (client), "tcp-socket");
+        g_clear_object (&old_tcp_socket);
+
+        g_debug ("Created search socket for client %p on port %u",
+                 client,
+                 priv->msearch_port);
+
+        schedule_search_socket_release (client,
+                                        priv->socket_idle_timeout * 1000);
+
+        return TRUE;
+}
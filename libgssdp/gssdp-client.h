@@ -37,6 +37,40 @@ typedef enum /*< prefix=GSSDP_UDA_ >*/
         GSSDP_UDA_VERSION_1_1,
 } GSSDPUDAVersion;
 
+/**
+ * GSSDPSocketOption:
+ * @GSSDP_SOCKET_OPTION_RECEIVE_BUFFER_SIZE: Size of the kernel receive buffer
+ *   in bytes (SO_RCVBUF)
+ * @GSSDP_SOCKET_OPTION_SEND_BUFFER_SIZE: Size of the kernel send buffer in
+ *   bytes (SO_SNDBUF)
+ * @GSSDP_SOCKET_OPTION_DSCP: Differentiated services code point of outgoing
+ *   packets (IP_TOS or IPV6_TCLASS)
+ * @GSSDP_SOCKET_OPTION_PRIORITY: Queueing priority of outgoing packets
+ *   (SO_PRIORITY)
+ * @GSSDP_SOCKET_OPTION_BUSY_POLL: Busy polling time in microseconds
+ *   (SO_BUSY_POLL)
+ * @GSSDP_SOCKET_OPTION_MULTICAST_LOOPBACK: Whether multicast packets are
+ *   looped back to local sockets (IP_MULTICAST_LOOP or IPV6_MULTICAST_LOOP)
+ * @GSSDP_SOCKET_OPTION_MULTICAST_ALL: Whether sockets receive packets of all
+ *   multicast groups joined on the system (IP_MULTICAST_ALL or
+ *   IPV6_MULTICAST_ALL)
+ *
+ * Socket options of a [class@GSSDP.Client] that can be read back with
+ * [method@GSSDP.Client.get_socket_option].
+ *
+ * Since: 1.8.0
+ */
+typedef enum
+{
+        GSSDP_SOCKET_OPTION_RECEIVE_BUFFER_SIZE,
+        GSSDP_SOCKET_OPTION_SEND_BUFFER_SIZE,
+        GSSDP_SOCKET_OPTION_DSCP,
+        GSSDP_SOCKET_OPTION_PRIORITY,
+        GSSDP_SOCKET_OPTION_BUSY_POLL,
+        GSSDP_SOCKET_OPTION_MULTICAST_LOOPBACK,
+        GSSDP_SOCKET_OPTION_MULTICAST_ALL,
+} GSSDPSocketOption;
+
 struct _GSSDPClientClass {
         GObjectClass parent_class;
 
@@ -71,6 +105,19 @@ gssdp_client_new_full (const char *iface,
                        GSSDPUDAVersion uda_version,
                        GError **error);
 
+void
+gssdp_client_new_full_async (const char          *iface,
+                             GInetAddress        *addr,
+                             guint16              port,
+                             GSSDPUDAVersion      uda_version,
+                             GCancellable        *cancellable,
+                             GAsyncReadyCallback  callback,
+                             gpointer             user_data);
+
+GSSDPClient *
+gssdp_client_new_full_finish (GAsyncResult  *res,
+                              GError       **error);
+
 void
 gssdp_client_set_server_id    (GSSDPClient  *client,
                                const char   *server_id);
@@ -148,6 +195,57 @@ gssdp_client_can_reach (GSSDPClient *client,
 GSocket *
 gssdp_client_get_tcp_socket (GSSDPClient *client);
 
+void
+gssdp_client_set_search_coalesce_threshold (GSSDPClient *client,
+                                            guint        threshold);
+
+guint
+gssdp_client_get_search_coalesce_threshold (GSSDPClient *client);
+
+gboolean
+gssdp_client_rebind (GSSDPClient *client,
+                     GError     **error);
+
+void
+gssdp_client_set_monitor_network (GSSDPClient *client,
+                                  gboolean     monitor_network);
+
+gboolean
+gssdp_client_get_monitor_network (GSSDPClient *client);
+
+void
+gssdp_client_set_socket_idle_timeout (GSSDPClient *client,
+                                      guint        timeout);
+
+guint
+gssdp_client_get_socket_idle_timeout (GSSDPClient *client);
+
+guint64
+gssdp_client_get_kernel_drops (GSSDPClient *client);
+
+guint64
+gssdp_client_get_kernel_filter_drops (GSSDPClient *client);
+
+gint64
+gssdp_client_get_message_arrival_time (GSSDPClient *client);
+
+const guint64 *
+gssdp_client_get_latency_histogram (GSSDPClient *client,
+                                    guint       *n_buckets);
+
+void
+gssdp_client_set_kernel_filter (GSSDPClient *client,
+                                gboolean     kernel_filter);
+
+gboolean
+gssdp_client_get_kernel_filter (GSSDPClient *client);
+
+gboolean
+gssdp_client_get_socket_option (GSSDPClient      *client,
+                                GSSDPSocketOption option,
+                                gint             *value,
+                                GError          **error);
+
 G_END_DECLS
 
 #endif /* GSSDP_CLIENT_H */
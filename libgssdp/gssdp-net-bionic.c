@@ -310,3 +310,8 @@ gssdp_net_list_devices (void)
 {
         return NULL;
 }
+
+void
+gssdp_net_invalidate_interfaces (void)
+{
+}
@@ -28,8 +28,28 @@
 #if defined(__linux__)
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
+#include <netpacket/packet.h>
+#elif defined(AF_LINK)
+#include <net/if_dl.h>
 #endif
 
+/* Interface enumerations younger than this are shared by all lookups, unless
+ * the network monitor saw a change in between */
+#define INTERFACE_TABLE_MAX_AGE (1 * G_USEC_PER_SEC)
+
+typedef struct {
+        gatomicrefcount ref_count;
+        struct ifaddrs *ifa_list;
+        GHashTable *indices; /* interface name → index */
+        gint64 created;
+} InterfaceTable;
+
+G_LOCK_DEFINE_STATIC (interface_table);
+static InterfaceTable *interface_table = NULL;
+
+static int
+query_ifindex_by_name (const char *iface_name);
+
 gboolean
 gssdp_net_init (GError **error)
 {
@@ -41,12 +61,136 @@ gssdp_net_shutdown (void)
 {
 }
 
+static void
+interface_table_unref (InterfaceTable *table)
+{
+        if (!g_atomic_ref_count_dec (&table->ref_count))
+                return;
+
+        g_hash_table_unref (table->indices);
+        freeifaddrs (table->ifa_list);
+        g_free (table);
+}
+
+/*
+ * Get the shared snapshot of all interface addresses, enumerating them if
+ * there is no recent one
+ */
+/*
+ * Returns the interface index carried by the link layer entry @ifa, or 0 if
+ * it is not one
+ */
+static int
+ifaddr_get_link_index (const struct ifaddrs *ifa)
+{
+        if (ifa->ifa_addr == NULL)
+                return 0;
+
+#if defined(__linux__)
+        if (ifa->ifa_addr->sa_family == AF_PACKET)
+                return ((const struct sockaddr_ll *) ifa->ifa_addr)
+                        ->sll_ifindex;
+#elif defined(AF_LINK)
+        if (ifa->ifa_addr->sa_family == AF_LINK)
+                return ((const struct sockaddr_dl *) ifa->ifa_addr)
+                        ->sdl_index;
+#endif
+
+        return 0;
+}
+
+static InterfaceTable *
+interface_table_get (GError **error)
+{
+        InterfaceTable *table;
+        struct ifaddrs *ifa_list, *ifa;
+        gint64 now = g_get_monotonic_time ();
+
+        G_LOCK (interface_table);
+        if (interface_table != NULL &&
+            now - interface_table->created > INTERFACE_TABLE_MAX_AGE) {
+                g_clear_pointer (&interface_table, interface_table_unref);
+        }
+
+        if (interface_table == NULL) {
+                errno = 0;
+                if (getifaddrs (&ifa_list) != 0) {
+                        int saved_errno = errno;
+
+                        G_UNLOCK (interface_table);
+                        g_set_error (
+                                error,
+                                G_IO_ERROR,
+                                g_io_error_from_errno (saved_errno),
+                                "Failed to retrieve list of network interfaces: %s",
+                                g_strerror (saved_errno));
+
+                        return NULL;
+                }
+
+                interface_table = g_new0 (InterfaceTable, 1);
+                g_atomic_ref_count_init (&interface_table->ref_count);
+                interface_table->ifa_list = ifa_list;
+                interface_table->created = now;
+
+                /* Names are owned by the ifaddrs list. The indices come from
+                 * the link layer entries, interfaces without one are looked
+                 * up by name on demand */
+                interface_table->indices = g_hash_table_new (g_str_hash,
+                                                             g_str_equal);
+                for (ifa = ifa_list; ifa != NULL; ifa = ifa->ifa_next) {
+                        int index = ifaddr_get_link_index (ifa);
+
+                        if (index > 0)
+                                g_hash_table_insert (interface_table->indices,
+                                                     ifa->ifa_name,
+                                                     GINT_TO_POINTER (index));
+                }
+        }
+
+        table = interface_table;
+        g_atomic_ref_count_inc (&table->ref_count);
+        G_UNLOCK (interface_table);
+
+        return table;
+}
+
+void
+gssdp_net_invalidate_interfaces (void)
+{
+        G_LOCK (interface_table);
+        g_clear_pointer (&interface_table, interface_table_unref);
+        G_UNLOCK (interface_table);
+}
+
 int
 gssdp_net_query_ifindex (GSSDPNetworkDevice *device)
+{
+        InterfaceTable *table;
+        gpointer index;
+        gboolean found = FALSE;
+
+        table = interface_table_get (NULL);
+        if (table != NULL) {
+                found = g_hash_table_lookup_extended (table->indices,
+                                                      device->iface_name,
+                                                      NULL,
+                                                      &index);
+                interface_table_unref (table);
+        }
+
+        if (found)
+                return GPOINTER_TO_INT (index);
+
+        return query_ifindex_by_name (device->iface_name);
+}
+
+static int
+query_ifindex_by_name (const char *iface_name)
 {
 #if defined(HAVE_IFNAMETOINDEX)
         errno = 0;
-        int index = if_nametoindex (device->iface_name);
+        int index = if_nametoindex (iface_name);
         if (index == 0 && errno != 0) {
                 return -1;
         } else {
@@ -63,7 +207,7 @@ gssdp_net_query_ifindex (GSSDPNetworkDevice *device)
         return -1;
 
     memset (&ifr, 0, sizeof(struct ifreq));
-    strncpy (ifr.ifr_ifrn.ifrn_name, device->iface_name, IFNAMSIZ);
+    strncpy (ifr.ifr_ifrn.ifrn_name, iface_name, IFNAMSIZ);
 
     result = ioctl (fd, SIOCGIFINDEX, (char *)&ifr);
     close (fd);
@@ -392,25 +536,20 @@ get_netmask (struct sockaddr *address,
 gboolean
 gssdp_net_get_host_ip (GSSDPNetworkDevice *device, GError **error)
 {
+        InterfaceTable *table;
         struct ifaddrs *ifa_list, *ifa;
         GList *up_ifaces, *ifaceptr;
         char addr_string[INET6_ADDRSTRLEN] = {0};
         sa_family_t family = AF_UNSPEC;
+        gboolean result = TRUE;
 
         up_ifaces = NULL;
 
-        errno = 0;
-        if (getifaddrs (&ifa_list) != 0) {
-                int saved_errno = errno;
-                g_set_error (
-                        error,
-                        G_IO_ERROR,
-                        g_io_error_from_errno (saved_errno),
-                        "Failed to retrieve list of network interfaces: %s",
-                        g_strerror (errno));
-
+        table = interface_table_get (error);
+        if (table == NULL)
                 return FALSE;
-        }
+
+        ifa_list = table->ifa_list;
 
         /*
          * First, check all the devices. Filter out everything that is not UP or
@@ -528,7 +667,8 @@ gssdp_net_get_host_ip (GSSDPNetworkDevice *device, GError **error)
                         if (!g_str_equal (device->iface_name, ifa->ifa_name)) {
                                 g_set_error(error, GSSDP_ERROR, GSSDP_ERROR_FAILED, "Information mismatch: Interface passed address is %s, but requested %s",
                                              device->iface_name, ifa->ifa_name);
-                                return FALSE;
+                                result = FALSE;
+                                break;
                         }
                 }
 
@@ -538,7 +678,8 @@ gssdp_net_get_host_ip (GSSDPNetworkDevice *device, GError **error)
                 g_clear_pointer (&device->host_ip, g_free);
                 device->host_ip = g_inet_address_to_string (device->host_addr);
 
-                device->index = gssdp_net_query_ifindex (device);
+                device->index = GPOINTER_TO_INT (
+                        g_hash_table_lookup (table->indices, ifa->ifa_name));
 
                 break;
         }
@@ -548,38 +689,33 @@ gssdp_net_get_host_ip (GSSDPNetworkDevice *device, GError **error)
         }
 
         g_list_free (up_ifaces);
-        freeifaddrs (ifa_list);
+        interface_table_unref (table);
 
-        return TRUE;
+        return result;
 }
 
 GList *
 gssdp_net_list_devices (void)
 {
-        struct ifaddrs *ifa_list, *ifa;
-        GHashTable *interfaces;
+        InterfaceTable *table;
+        GHashTableIter iter;
+        gpointer name;
         GList *result = NULL;
+        GError *error = NULL;
 
-        interfaces = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-
-        if (getifaddrs (&ifa_list) != 0) {
-                g_warning ("Failed to retrieve list of network interfaces: %s",
-                           strerror (errno));
+        table = interface_table_get (&error);
+        if (table == NULL) {
+                g_warning ("%s", error->message);
+                g_error_free (error);
 
-                goto out;
+                return NULL;
         }
 
-        for (ifa = ifa_list; ifa != NULL; ifa = ifa->ifa_next) {
-                g_hash_table_add (interfaces, g_strdup (ifa->ifa_name));
-        }
+        g_hash_table_iter_init (&iter, table->indices);
+        while (g_hash_table_iter_next (&iter, &name, NULL))
+                result = g_list_prepend (result, g_strdup (name));
 
-
-        freeifaddrs (ifa_list);
-
-out:
-        result = g_hash_table_get_keys (interfaces);
-        g_hash_table_steal_all (interfaces);
-        g_hash_table_destroy (interfaces);
+        interface_table_unref (table);
 
         return result;
 }
@@ -54,4 +54,7 @@ gssdp_net_mac_lookup            (GSSDPNetworkDevice *device,
 G_GNUC_INTERNAL GList*
 gssdp_net_list_devices          (void);
 
+G_GNUC_INTERNAL void
+gssdp_net_invalidate_interfaces (void);
+
 #endif /* GSSDP_NET_H */
@@ -0,0 +1,426 @@
+/*
+ * Copyright (C) 2024 GSSDP contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#define G_LOG_DOMAIN "gssdp-network-monitor"
+
+#include <config.h>
+
+#include "gssdp-network-monitor.h"
+#include "gssdp-net.h"
+
+#if defined(__linux__)
+#include <glib-unix.h>
+
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+
+struct _GSSDPNetworkMonitor {
+        GObject parent_instance;
+
+        int fd;
+        GSource *source;
+        GHashTable *links; /* interface index → up */
+};
+
+/**
+ * GSSDPNetworkMonitor:
+ *
+ * Process-wide watcher for address and link changes.
+ *
+ * The monitor listens to the kernel's routing socket and reports addresses
+ * appearing on or disappearing from network interfaces, as well as links
+ * going up or down. It is shared by all users in the process, get it with
+ * [func@GSSDP.NetworkMonitor.dup_default].
+ *
+ * A [class@GSSDP.Client] with [property@GSSDP.Client:monitor-network] set
+ * uses it to rebind its sockets when its address changes.
+ *
+ * On platforms without netlink support, no signals are emitted.
+ *
+ * Since: 1.8.0
+ */
+G_DEFINE_TYPE (GSSDPNetworkMonitor, gssdp_network_monitor, G_TYPE_OBJECT)
+
+enum {
+        ADDRESS_ADDED,
+        ADDRESS_REMOVED,
+        LINK_CHANGED,
+        LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
+G_LOCK_DEFINE_STATIC (default_monitor);
+static GSSDPNetworkMonitor *default_monitor = NULL;
+
+#if defined(__linux__)
+static void
+handle_address_message (GSSDPNetworkMonitor *self,
+                        struct nlmsghdr     *header)
+{
+        struct ifaddrmsg *ifa = NLMSG_DATA (header);
+        struct rtattr *rta = IFA_RTA (ifa);
+        int rta_len = IFA_PAYLOAD (header);
+        const void *local = NULL;
+        const void *address = NULL;
+        char name[IF_NAMESIZE] = { 0 };
+        GInetAddress *addr;
+        gsize size;
+
+        if (ifa->ifa_family == AF_INET)
+                size = 4;
+        else if (ifa->ifa_family == AF_INET6)
+                size = 16;
+        else
+                return;
+
+        for (; RTA_OK (rta, rta_len); rta = RTA_NEXT (rta, rta_len)) {
+                if (RTA_PAYLOAD (rta) < size)
+                        continue;
+
+                if (rta->rta_type == IFA_LOCAL)
+                        local = RTA_DATA (rta);
+                else if (rta->rta_type == IFA_ADDRESS)
+                        address = RTA_DATA (rta);
+        }
+
+        /* IFA_ADDRESS is the peer on point-to-point links, prefer
+         * IFA_LOCAL if there is one */
+        if (local == NULL)
+                local = address;
+
+        if (local == NULL)
+                return;
+
+        addr = g_inet_address_new_from_bytes (local, ifa->ifa_family);
+        if_indextoname (ifa->ifa_index, name);
+
+        if (header->nlmsg_type == RTM_NEWADDR)
+                g_signal_emit (self,
+                               signals[ADDRESS_ADDED],
+                               0,
+                               name,
+                               ifa->ifa_index,
+                               addr);
+        else
+                g_signal_emit (self,
+                               signals[ADDRESS_REMOVED],
+                               0,
+                               name,
+                               ifa->ifa_index,
+                               addr);
+
+        g_object_unref (addr);
+}
+
+static void
+handle_link_message (GSSDPNetworkMonitor *self,
+                     struct nlmsghdr     *header)
+{
+        struct ifinfomsg *ifi = NLMSG_DATA (header);
+        struct rtattr *rta = IFLA_RTA (ifi);
+        int rta_len = IFLA_PAYLOAD (header);
+        char name[IF_NAMESIZE] = { 0 };
+        gpointer key = GINT_TO_POINTER (ifi->ifi_index);
+        gpointer value;
+        gboolean known;
+        gboolean up;
+
+        for (; RTA_OK (rta, rta_len); rta = RTA_NEXT (rta, rta_len)) {
+                if (rta->rta_type == IFLA_IFNAME)
+                        g_strlcpy (name,
+                                   RTA_DATA (rta),
+                                   MIN (sizeof (name),
+                                        RTA_PAYLOAD (rta)));
+        }
+
+        up = header->nlmsg_type == RTM_NEWLINK &&
+             (ifi->ifi_flags & IFF_UP) &&
+             (ifi->ifi_flags & IFF_RUNNING);
+
+        /* RTM_NEWLINK is sent for every attribute change, only report
+         * changes of the operational state */
+        known = g_hash_table_lookup_extended (self->links, key, NULL, &value);
+        if (known && GPOINTER_TO_INT (value) == up)
+                return;
+
+        if (header->nlmsg_type == RTM_DELLINK)
+                g_hash_table_remove (self->links, key);
+        else
+                g_hash_table_insert (self->links, key, GINT_TO_POINTER (up));
+
+        /* Links we have not seen before are assumed to have been up */
+        if (!known && up)
+                return;
+
+        g_signal_emit (self,
+                       signals[LINK_CHANGED],
+                       0,
+                       name,
+                       ifi->ifi_index,
+                       up);
+}
+
+static gboolean
+on_netlink_readable (gint                       fd,
+                     G_GNUC_UNUSED GIOCondition condition,
+                     gpointer                   user_data)
+{
+        GSSDPNetworkMonitor *self = GSSDP_NETWORK_MONITOR (user_data);
+        char buf[8192];
+
+        while (TRUE) {
+                struct nlmsghdr *header = (struct nlmsghdr *) buf;
+                ssize_t len;
+
+                len = recv (fd, buf, sizeof (buf), 0);
+                if (len < 0) {
+                        int saved_errno = errno;
+
+                        if (saved_errno == EINTR)
+                                continue;
+
+                        /* The kernel dropped notifications, nothing we can
+                         * do but carry on with the next ones */
+                        if (saved_errno == ENOBUFS) {
+                                g_debug ("Netlink receive buffer overrun");
+                                gssdp_net_invalidate_interfaces ();
+
+                                continue;
+                        }
+
+                        if (saved_errno != EAGAIN &&
+                            saved_errno != EWOULDBLOCK)
+                                g_debug ("Failed to receive netlink msg: %s",
+                                         g_strerror (saved_errno));
+
+                        break;
+                }
+
+                if (len == 0)
+                        break;
+
+                for (; NLMSG_OK (header, len);
+                     header = NLMSG_NEXT (header, len)) {
+                        switch (header->nlmsg_type) {
+                        case RTM_NEWADDR:
+                        case RTM_DELADDR:
+                                gssdp_net_invalidate_interfaces ();
+                                handle_address_message (self, header);
+                                break;
+                        case RTM_NEWLINK:
+                        case RTM_DELLINK:
+                                gssdp_net_invalidate_interfaces ();
+                                handle_link_message (self, header);
+                                break;
+                        default:
+                                break;
+                        }
+                }
+        }
+
+        return G_SOURCE_CONTINUE;
+}
+
+static void
+open_netlink_socket (GSSDPNetworkMonitor *self)
+{
+        struct sockaddr_nl sa;
+        int saved_errno;
+
+        self->fd = socket (PF_NETLINK,
+                           SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                           NETLINK_ROUTE);
+        if (self->fd == -1) {
+                saved_errno = errno;
+                g_warning ("Failed to create netlink socket: %s",
+                           g_strerror (saved_errno));
+
+                return;
+        }
+
+        memset (&sa, 0, sizeof (sa));
+        sa.nl_family = AF_NETLINK;
+        sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+
+        if (bind (self->fd, (struct sockaddr *) &sa, sizeof (sa)) == -1) {
+                saved_errno = errno;
+                g_warning ("Failed to bind netlink socket: %s",
+                           g_strerror (saved_errno));
+                close (self->fd);
+                self->fd = -1;
+
+                return;
+        }
+
+        self->source = g_unix_fd_source_new (self->fd, G_IO_IN);
+        g_source_set_callback (self->source,
+                               G_SOURCE_FUNC (on_netlink_readable),
+                               self,
+                               NULL);
+        g_source_attach (self->source, g_main_context_get_thread_default ());
+        g_source_unref (self->source);
+}
+#endif
+
+static void
+gssdp_network_monitor_init (GSSDPNetworkMonitor *self)
+{
+        self->fd = -1;
+        self->links = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+#if defined(__linux__)
+        open_netlink_socket (self);
+#endif
+}
+
+static void
+gssdp_network_monitor_dispose (GObject *object)
+{
+        GSSDPNetworkMonitor *self = GSSDP_NETWORK_MONITOR (object);
+
+        g_clear_pointer (&self->source, g_source_destroy);
+
+#if defined(__linux__)
+        if (self->fd >= 0) {
+                close (self->fd);
+                self->fd = -1;
+        }
+#endif
+
+        G_OBJECT_CLASS (gssdp_network_monitor_parent_class)->dispose (object);
+}
+
+static void
+gssdp_network_monitor_finalize (GObject *object)
+{
+        GSSDPNetworkMonitor *self = GSSDP_NETWORK_MONITOR (object);
+
+        g_clear_pointer (&self->links, g_hash_table_unref);
+
+        G_OBJECT_CLASS (gssdp_network_monitor_parent_class)->finalize (object);
+}
+
+static void
+gssdp_network_monitor_class_init (GSSDPNetworkMonitorClass *klass)
+{
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+        object_class->dispose = gssdp_network_monitor_dispose;
+        object_class->finalize = gssdp_network_monitor_finalize;
+
+        /**
+         * GSSDPNetworkMonitor::address-added:
+         * @monitor: The #GSSDPNetworkMonitor that received the event
+         * @iface: The name of the network interface
+         * @index: The index of the network interface
+         * @address: The #GInetAddress that was added
+         *
+         * An address was assigned to the network interface @iface.
+         *
+         * Since: 1.8.0
+         **/
+        signals[ADDRESS_ADDED] =
+                g_signal_new ("address-added",
+                              GSSDP_TYPE_NETWORK_MONITOR,
+                              G_SIGNAL_RUN_LAST,
+                              0,
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              3,
+                              G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                              G_TYPE_UINT,
+                              G_TYPE_INET_ADDRESS);
+
+        /**
+         * GSSDPNetworkMonitor::address-removed:
+         * @monitor: The #GSSDPNetworkMonitor that received the event
+         * @iface: The name of the network interface, or an empty string if
+         * the interface is already gone
+         * @index: The index of the network interface
+         * @address: The #GInetAddress that was removed
+         *
+         * An address was removed from the network interface @iface.
+         *
+         * Since: 1.8.0
+         **/
+        signals[ADDRESS_REMOVED] =
+                g_signal_new ("address-removed",
+                              GSSDP_TYPE_NETWORK_MONITOR,
+                              G_SIGNAL_RUN_LAST,
+                              0,
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              3,
+                              G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                              G_TYPE_UINT,
+                              G_TYPE_INET_ADDRESS);
+
+        /**
+         * GSSDPNetworkMonitor::link-changed:
+         * @monitor: The #GSSDPNetworkMonitor that received the event
+         * @iface: The name of the network interface
+         * @index: The index of the network interface
+         * @up: Whether the link is up and running now
+         *
+         * The operational state of the network interface @iface changed.
+         *
+         * Since: 1.8.0
+         **/
+        signals[LINK_CHANGED] =
+                g_signal_new ("link-changed",
+                              GSSDP_TYPE_NETWORK_MONITOR,
+                              G_SIGNAL_RUN_LAST,
+                              0,
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              3,
+                              G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                              G_TYPE_UINT,
+                              G_TYPE_BOOLEAN);
+}
+
+/**
+ * gssdp_network_monitor_dup_default:
+ *
+ * Get the network monitor shared by the whole process, creating it if
+ * necessary.
+ *
+ * Signals are emitted in the main context that was the thread-default one
+ * when the monitor was created. The monitor is destroyed once the last
+ * reference is dropped.
+ *
+ * Returns: (transfer full): The default #GSSDPNetworkMonitor
+ *
+ * Since: 1.8.0
+ **/
+GSSDPNetworkMonitor *
+gssdp_network_monitor_dup_default (void)
+{
+        GSSDPNetworkMonitor *monitor;
+
+        G_LOCK (default_monitor);
+        if (default_monitor == NULL) {
+                default_monitor = g_object_new (GSSDP_TYPE_NETWORK_MONITOR,
+                                                NULL);
+                g_object_add_weak_pointer (G_OBJECT (default_monitor),
+                                           (gpointer *) &default_monitor);
+                monitor = default_monitor;
+        } else {
+                monitor = g_object_ref (default_monitor);
+        }
+        G_UNLOCK (default_monitor);
+
+        return monitor;
+}
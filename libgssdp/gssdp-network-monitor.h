@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2024 GSSDP contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#ifndef GSSDP_NETWORK_MONITOR_H
+#define GSSDP_NETWORK_MONITOR_H
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GSSDP_TYPE_NETWORK_MONITOR (gssdp_network_monitor_get_type ())
+
+G_DECLARE_FINAL_TYPE (GSSDPNetworkMonitor,
+                      gssdp_network_monitor,
+                      GSSDP,
+                      NETWORK_MONITOR,
+                      GObject)
+
+GSSDPNetworkMonitor *
+gssdp_network_monitor_dup_default (void);
+
+G_END_DECLS
+
+#endif /* GSSDP_NETWORK_MONITOR_H */
@@ -28,6 +28,14 @@ G_BEGIN_DECLS
         "MX: %d\r\n"                                \
         "User-Agent: %s\r\n"  \
 
+/* UDA 1.1, 1.3.3: Unicast searches have no MX header */
+#define SSDP_UNICAST_DISCOVERY_REQUEST              \
+        "M-SEARCH * HTTP/1.1\r\n"                   \
+        "Host: %s:" SSDP_PORT_STR "\r\n" \
+        "Man: \"ssdp:discover\"\r\n"                \
+        "ST: %s\r\n"                                \
+        "User-Agent: %s\r\n"  \
+
 #define SSDP_DISCOVERY_RESPONSE                     \
         "HTTP/1.1 200 OK\r\n"                       \
         "Location: %s\r\n"                          \
@@ -67,6 +75,8 @@ G_BEGIN_DECLS
         "USN: %s\r\n"                               \
         "NEXTBOOTID.UPNP.ORG: %u\r\n"
 
+#define SSDP_ALL_TARGET "ssdp:all"
+
 #define SSDP_SEARCH_METHOD "M-SEARCH"
 #define GENA_NOTIFY_METHOD "NOTIFY"
 
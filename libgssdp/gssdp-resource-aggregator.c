@@ -0,0 +1,755 @@
+/*
+ * Copyright (C) 2024 GSSDP contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#include <config.h>
+
+#include "gssdp-resource-aggregator.h"
+#include "gssdp-resource-browser.h"
+
+#include <string.h>
+
+typedef struct {
+        GSSDPResourceAggregator *aggregator;
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+} Member;
+
+typedef struct {
+        Member *member;
+        GList *locations;
+} Reach;
+
+typedef struct {
+        char *usn;
+        GPtrArray *reaches; /* Reach, one per client the device is seen on */
+} Device;
+
+struct _GSSDPResourceAggregatorPrivate {
+        char *target;
+
+        gboolean active;
+
+        GPtrArray *members;
+        GHashTable *devices; /* USN → Device */
+};
+typedef struct _GSSDPResourceAggregatorPrivate GSSDPResourceAggregatorPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (GSSDPResourceAggregator,
+                            gssdp_resource_aggregator,
+                            G_TYPE_OBJECT)
+
+enum {
+        PROP_0,
+        PROP_TARGET,
+        PROP_ACTIVE
+};
+
+enum {
+        RESOURCE_AVAILABLE,
+        RESOURCE_UNAVAILABLE,
+        REACHABILITY_CHANGED,
+        LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
+static void
+reach_free (Reach *reach)
+{
+        g_list_free_full (reach->locations, g_free);
+        g_slice_free (Reach, reach);
+}
+
+static void
+device_free (Device *device)
+{
+        g_free (device->usn);
+        g_ptr_array_unref (device->reaches);
+        g_slice_free (Device, device);
+}
+
+static Reach *
+device_find_reach (Device *device, Member *member, guint *index)
+{
+        guint i;
+
+        for (i = 0; i < device->reaches->len; i++) {
+                Reach *reach = g_ptr_array_index (device->reaches, i);
+
+                if (reach->member == member) {
+                        if (index != NULL)
+                                *index = i;
+
+                        return reach;
+                }
+        }
+
+        return NULL;
+}
+
+/* All locations of @device, without duplicates */
+static GList *
+device_get_locations (Device *device)
+{
+        GList *locations = NULL;
+        guint i;
+
+        for (i = 0; i < device->reaches->len; i++) {
+                Reach *reach = g_ptr_array_index (device->reaches, i);
+                GList *l;
+
+                for (l = reach->locations; l != NULL; l = l->next) {
+                        if (g_list_find_custom (locations,
+                                                l->data,
+                                                (GCompareFunc) strcmp))
+                                continue;
+
+                        locations = g_list_prepend (locations,
+                                                    g_strdup (l->data));
+                }
+        }
+
+        return g_list_reverse (locations);
+}
+
+static void
+on_resource_available (G_GNUC_UNUSED GSSDPResourceBrowser *browser,
+                       const char                         *usn,
+                       GList                              *locations,
+                       gpointer                            user_data)
+{
+        Member *member = user_data;
+        GSSDPResourceAggregator *aggregator = member->aggregator;
+        GSSDPResourceAggregatorPrivate *priv;
+        Device *device;
+        Reach *reach;
+        GList *all_locations;
+
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        device = g_hash_table_lookup (priv->devices, usn);
+        if (device == NULL) {
+                device = g_slice_new (Device);
+                device->usn = g_strdup (usn);
+                device->reaches = g_ptr_array_new_with_free_func
+                                        ((GDestroyNotify) reach_free);
+                g_hash_table_insert (priv->devices, device->usn, device);
+        }
+
+        reach = device_find_reach (device, member, NULL);
+        if (reach != NULL) {
+                /* New locations on the same interface */
+                g_list_free_full (reach->locations, g_free);
+                reach->locations = g_list_copy_deep (locations,
+                                                     (GCopyFunc) g_strdup,
+                                                     NULL);
+
+                return;
+        }
+
+        reach = g_slice_new (Reach);
+        reach->member = member;
+        reach->locations = g_list_copy_deep (locations,
+                                             (GCopyFunc) g_strdup,
+                                             NULL);
+        g_ptr_array_add (device->reaches, reach);
+
+        if (device->reaches->len > 1) {
+                g_signal_emit (aggregator,
+                               signals[REACHABILITY_CHANGED],
+                               0,
+                               usn,
+                               member->client,
+                               TRUE);
+
+                return;
+        }
+
+        all_locations = device_get_locations (device);
+        g_signal_emit (aggregator,
+                       signals[RESOURCE_AVAILABLE],
+                       0,
+                       usn,
+                       all_locations);
+        g_list_free_full (all_locations, g_free);
+}
+
+static void
+on_resource_locations_changed (GSSDPResourceBrowser *browser,
+                               const char           *usn,
+                               GList                *locations,
+                               gpointer              user_data)
+{
+        /* Handled like a re-announcement on the same interface */
+        on_resource_available (browser, usn, locations, user_data);
+}
+
+static void
+member_lost (Member *member, const char *usn)
+{
+        GSSDPResourceAggregator *aggregator = member->aggregator;
+        GSSDPResourceAggregatorPrivate *priv;
+        Device *device;
+        guint index;
+
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        device = g_hash_table_lookup (priv->devices, usn);
+        if (device == NULL ||
+            device_find_reach (device, member, &index) == NULL)
+                return;
+
+        g_ptr_array_remove_index_fast (device->reaches, index);
+
+        if (device->reaches->len > 0) {
+                g_signal_emit (aggregator,
+                               signals[REACHABILITY_CHANGED],
+                               0,
+                               usn,
+                               member->client,
+                               FALSE);
+
+                return;
+        }
+
+        /* Keep the USN alive for the signal */
+        g_hash_table_steal (priv->devices, usn);
+        g_signal_emit (aggregator,
+                       signals[RESOURCE_UNAVAILABLE],
+                       0,
+                       device->usn);
+        device_free (device);
+}
+
+static void
+on_resource_unavailable (G_GNUC_UNUSED GSSDPResourceBrowser *browser,
+                         const char                         *usn,
+                         gpointer                            user_data)
+{
+        member_lost (user_data, usn);
+}
+
+static void
+member_free (Member *member)
+{
+        g_signal_handlers_disconnect_by_data (member->browser, member);
+        g_object_unref (member->browser);
+        g_object_unref (member->client);
+        g_slice_free (Member, member);
+}
+
+static Member *
+find_member (GSSDPResourceAggregator *aggregator,
+             GSSDPClient             *client,
+             guint                   *index)
+{
+        GSSDPResourceAggregatorPrivate *priv;
+        guint i;
+
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        for (i = 0; i < priv->members->len; i++) {
+                Member *member = g_ptr_array_index (priv->members, i);
+
+                if (member->client == client) {
+                        if (index != NULL)
+                                *index = i;
+
+                        return member;
+                }
+        }
+
+        return NULL;
+}
+
+static void
+gssdp_resource_aggregator_init (GSSDPResourceAggregator *aggregator)
+{
+        GSSDPResourceAggregatorPrivate *priv;
+
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        priv->members = g_ptr_array_new ();
+        priv->devices = g_hash_table_new_full (g_str_hash,
+                                               g_str_equal,
+                                               NULL,
+                                               (GDestroyNotify) device_free);
+}
+
+static void
+gssdp_resource_aggregator_get_property (GObject    *object,
+                                        guint       property_id,
+                                        GValue     *value,
+                                        GParamSpec *pspec)
+{
+        GSSDPResourceAggregator *aggregator;
+
+        aggregator = GSSDP_RESOURCE_AGGREGATOR (object);
+
+        switch (property_id) {
+        case PROP_TARGET:
+                g_value_set_string
+                        (value,
+                         gssdp_resource_aggregator_get_target (aggregator));
+                break;
+        case PROP_ACTIVE:
+                g_value_set_boolean
+                        (value,
+                         gssdp_resource_aggregator_get_active (aggregator));
+                break;
+        default:
+                G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+                break;
+        }
+}
+
+static void
+gssdp_resource_aggregator_set_property (GObject      *object,
+                                        guint         property_id,
+                                        const GValue *value,
+                                        GParamSpec   *pspec)
+{
+        GSSDPResourceAggregator *aggregator;
+        GSSDPResourceAggregatorPrivate *priv;
+
+        aggregator = GSSDP_RESOURCE_AGGREGATOR (object);
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        switch (property_id) {
+        case PROP_TARGET:
+                priv->target = g_value_dup_string (value);
+                break;
+        case PROP_ACTIVE:
+                gssdp_resource_aggregator_set_active
+                                        (aggregator,
+                                         g_value_get_boolean (value));
+                break;
+        default:
+                G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+                break;
+        }
+}
+
+static void
+gssdp_resource_aggregator_dispose (GObject *object)
+{
+        GSSDPResourceAggregator *aggregator;
+        GSSDPResourceAggregatorPrivate *priv;
+
+        aggregator = GSSDP_RESOURCE_AGGREGATOR (object);
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        /* Drop the browsers without reporting their cache being cleared */
+        g_hash_table_remove_all (priv->devices);
+        g_ptr_array_foreach (priv->members, (GFunc) member_free, NULL);
+        g_ptr_array_set_size (priv->members, 0);
+
+        G_OBJECT_CLASS (gssdp_resource_aggregator_parent_class)->dispose
+                                        (object);
+}
+
+static void
+gssdp_resource_aggregator_finalize (GObject *object)
+{
+        GSSDPResourceAggregator *aggregator;
+        GSSDPResourceAggregatorPrivate *priv;
+
+        aggregator = GSSDP_RESOURCE_AGGREGATOR (object);
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        g_free (priv->target);
+        g_ptr_array_unref (priv->members);
+        g_hash_table_destroy (priv->devices);
+
+        G_OBJECT_CLASS (gssdp_resource_aggregator_parent_class)->finalize
+                                        (object);
+}
+
+/**
+ * GSSDPResourceAggregator:
+ *
+ * Resource discovery across several network interfaces.
+ *
+ * A multi-homed host typically sees the same device through the
+ * [class@GSSDP.Client] of each interface it is connected on. The aggregator
+ * runs a [class@GSSDP.ResourceBrowser] on every client added with
+ * [method@GSSDP.ResourceAggregator.add_client] and merges what they find by
+ * USN.
+ *
+ * [signal@GSSDP.ResourceAggregator::resource-available] is emitted when a
+ * resource is seen on the first interface and
+ * [signal@GSSDP.ResourceAggregator::resource-unavailable] when it is lost on
+ * the last one. Changes in between are reported with
+ * [signal@GSSDP.ResourceAggregator::reachability-changed].
+ *
+ * Since: 1.8.0
+ */
+static void
+gssdp_resource_aggregator_class_init (GSSDPResourceAggregatorClass *klass)
+{
+        GObjectClass *object_class;
+
+        object_class = G_OBJECT_CLASS (klass);
+
+        object_class->set_property = gssdp_resource_aggregator_set_property;
+        object_class->get_property = gssdp_resource_aggregator_get_property;
+        object_class->dispose      = gssdp_resource_aggregator_dispose;
+        object_class->finalize     = gssdp_resource_aggregator_finalize;
+
+        /**
+         * GSSDPResourceAggregator:target:(attributes org.gtk.Property.get=gssdp_resource_aggregator_get_target)
+         *
+         * The discovery target used on every interface.
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_TARGET,
+                 g_param_spec_string
+                         ("target",
+                          "Target",
+                          "The discovery target.",
+                          NULL,
+                          G_PARAM_READWRITE |
+                          G_PARAM_CONSTRUCT_ONLY |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceAggregator:active:(attributes org.gtk.Property.get=gssdp_resource_aggregator_get_active org.gtk.Property.set=gssdp_resource_aggregator_set_active)
+         *
+         * Whether discovery is running on the interfaces.
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_ACTIVE,
+                 g_param_spec_boolean
+                         ("active",
+                          "Active",
+                          "TRUE if the aggregator is active.",
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceAggregator::resource-available:
+         * @aggregator: The #GSSDPResourceAggregator that received the signal
+         * @usn: The USN of the discovered resource
+         * @locations: (type GList*) (transfer none) (element-type utf8): The
+         * locations of the resource
+         *
+         * Emitted when a resource is seen on the first interface.
+         *
+         * Since: 1.8.0
+         **/
+        signals[RESOURCE_AVAILABLE] =
+                g_signal_new ("resource-available",
+                              GSSDP_TYPE_RESOURCE_AGGREGATOR,
+                              G_SIGNAL_RUN_LAST,
+                              G_STRUCT_OFFSET (GSSDPResourceAggregatorClass,
+                                               resource_available),
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              2,
+                              G_TYPE_STRING,
+                              G_TYPE_POINTER);
+
+        /**
+         * GSSDPResourceAggregator::resource-unavailable:
+         * @aggregator: The #GSSDPResourceAggregator that received the signal
+         * @usn: The USN of the resource
+         *
+         * Emitted when a resource is not reachable on any interface any more.
+         *
+         * Since: 1.8.0
+         **/
+        signals[RESOURCE_UNAVAILABLE] =
+                g_signal_new ("resource-unavailable",
+                              GSSDP_TYPE_RESOURCE_AGGREGATOR,
+                              G_SIGNAL_RUN_LAST,
+                              G_STRUCT_OFFSET (GSSDPResourceAggregatorClass,
+                                               resource_unavailable),
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              1,
+                              G_TYPE_STRING);
+
+        /**
+         * GSSDPResourceAggregator::reachability-changed:
+         * @aggregator: The #GSSDPResourceAggregator that received the signal
+         * @usn: The USN of the resource
+         * @client: The #GSSDPClient of the interface
+         * @reachable: Whether the resource is now reachable through @client
+         *
+         * Emitted when an already available resource is found on another
+         * interface, or lost on one while still reachable on others.
+         *
+         * Since: 1.8.0
+         **/
+        signals[REACHABILITY_CHANGED] =
+                g_signal_new ("reachability-changed",
+                              GSSDP_TYPE_RESOURCE_AGGREGATOR,
+                              G_SIGNAL_RUN_LAST,
+                              G_STRUCT_OFFSET (GSSDPResourceAggregatorClass,
+                                               reachability_changed),
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              3,
+                              G_TYPE_STRING,
+                              GSSDP_TYPE_CLIENT,
+                              G_TYPE_BOOLEAN);
+}
+
+/**
+ * gssdp_resource_aggregator_new:
+ * @target: A SSDP search target
+ *
+ * Creates a new aggregator for @target. See [ctor@GSSDP.ResourceBrowser.new]
+ * for the possible targets.
+ *
+ * Return value: A new #GSSDPResourceAggregator object.
+ *
+ * Since: 1.8.0
+ **/
+GSSDPResourceAggregator *
+gssdp_resource_aggregator_new (const char *target)
+{
+        g_return_val_if_fail (target != NULL, NULL);
+
+        return g_object_new (GSSDP_TYPE_RESOURCE_AGGREGATOR,
+                             "target", target,
+                             NULL);
+}
+
+/**
+ * gssdp_resource_aggregator_get_target:(attributes org.gtk.Method.get_property=target)
+ * @aggregator: A #GSSDPResourceAggregator
+ *
+ * Returns: The discovery target.
+ *
+ * Since: 1.8.0
+ **/
+const char *
+gssdp_resource_aggregator_get_target (GSSDPResourceAggregator *aggregator)
+{
+        GSSDPResourceAggregatorPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_AGGREGATOR (aggregator), NULL);
+
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        return priv->target;
+}
+
+/**
+ * gssdp_resource_aggregator_add_client:
+ * @aggregator: A #GSSDPResourceAggregator
+ * @client: The #GSSDPClient of an interface
+ *
+ * Starts looking for resources on the interface of @client. Adding the
+ * same client twice has no effect.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_aggregator_add_client (GSSDPResourceAggregator *aggregator,
+                                      GSSDPClient             *client)
+{
+        GSSDPResourceAggregatorPrivate *priv;
+        Member *member;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_AGGREGATOR (aggregator));
+        g_return_if_fail (GSSDP_IS_CLIENT (client));
+
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        if (find_member (aggregator, client, NULL) != NULL)
+                return;
+
+        member = g_slice_new (Member);
+        member->aggregator = aggregator;
+        member->client = g_object_ref (client);
+        member->browser = gssdp_resource_browser_new (client, priv->target);
+
+        g_signal_connect (member->browser,
+                          "resource-available",
+                          G_CALLBACK (on_resource_available),
+                          member);
+        g_signal_connect (member->browser,
+                          "resource-unavailable",
+                          G_CALLBACK (on_resource_unavailable),
+                          member);
+        g_signal_connect (member->browser,
+                          "resource-locations-changed",
+                          G_CALLBACK (on_resource_locations_changed),
+                          member);
+
+        g_ptr_array_add (priv->members, member);
+
+        gssdp_resource_browser_set_active (member->browser, priv->active);
+}
+
+/**
+ * gssdp_resource_aggregator_remove_client:
+ * @aggregator: A #GSSDPResourceAggregator
+ * @client: A #GSSDPClient previously added
+ *
+ * Stops looking for resources on the interface of @client. Resources only
+ * reachable through @client are reported as unavailable.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_aggregator_remove_client (GSSDPResourceAggregator *aggregator,
+                                         GSSDPClient             *client)
+{
+        GSSDPResourceAggregatorPrivate *priv;
+        Member *member;
+        guint index;
+        GList *usns, *l;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_AGGREGATOR (aggregator));
+        g_return_if_fail (GSSDP_IS_CLIENT (client));
+
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        member = find_member (aggregator, client, &index);
+        if (member == NULL)
+                return;
+
+        g_ptr_array_remove_index (priv->members, index);
+
+        usns = g_hash_table_get_keys (priv->devices);
+        for (l = usns; l != NULL; l = l->next)
+                member_lost (member, l->data);
+        g_list_free (usns);
+
+        member_free (member);
+}
+
+/**
+ * gssdp_resource_aggregator_set_active:(attributes org.gtk.Method.set_property=active):
+ * @aggregator: A #GSSDPResourceAggregator
+ * @active: %TRUE to run discovery
+ *
+ * Starts or stops discovery on all interfaces.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_aggregator_set_active (GSSDPResourceAggregator *aggregator,
+                                      gboolean                 active)
+{
+        GSSDPResourceAggregatorPrivate *priv;
+        guint i;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_AGGREGATOR (aggregator));
+
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        if (priv->active == active)
+                return;
+
+        priv->active = active;
+
+        for (i = 0; i < priv->members->len; i++) {
+                Member *member = g_ptr_array_index (priv->members, i);
+
+                gssdp_resource_browser_set_active (member->browser, active);
+        }
+
+        g_object_notify (G_OBJECT (aggregator), "active");
+}
+
+/**
+ * gssdp_resource_aggregator_get_active:(attributes org.gtk.Method.get_property=active):
+ * @aggregator: A #GSSDPResourceAggregator
+ *
+ * Return value: %TRUE if discovery is running.
+ *
+ * Since: 1.8.0
+ **/
+gboolean
+gssdp_resource_aggregator_get_active (GSSDPResourceAggregator *aggregator)
+{
+        GSSDPResourceAggregatorPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_AGGREGATOR (aggregator),
+                              FALSE);
+
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        return priv->active;
+}
+
+/**
+ * gssdp_resource_aggregator_get_clients:
+ * @aggregator: A #GSSDPResourceAggregator
+ * @usn: The USN of a resource
+ *
+ * Returns: (transfer container) (element-type GSSDPClient): The clients
+ * of the interfaces @usn is reachable on, or %NULL if it is not available
+ *
+ * Since: 1.8.0
+ **/
+GList *
+gssdp_resource_aggregator_get_clients (GSSDPResourceAggregator *aggregator,
+                                       const char              *usn)
+{
+        GSSDPResourceAggregatorPrivate *priv;
+        Device *device;
+        GList *clients = NULL;
+        guint i;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_AGGREGATOR (aggregator), NULL);
+        g_return_val_if_fail (usn != NULL, NULL);
+
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        device = g_hash_table_lookup (priv->devices, usn);
+        if (device == NULL)
+                return NULL;
+
+        for (i = 0; i < device->reaches->len; i++) {
+                Reach *reach = g_ptr_array_index (device->reaches, i);
+
+                clients = g_list_prepend (clients, reach->member->client);
+        }
+
+        return g_list_reverse (clients);
+}
+
+/**
+ * gssdp_resource_aggregator_get_locations:
+ * @aggregator: A #GSSDPResourceAggregator
+ * @usn: The USN of a resource
+ *
+ * Returns: (transfer full) (element-type utf8): The locations of @usn on
+ * all interfaces, or %NULL if it is not available
+ *
+ * Since: 1.8.0
+ **/
+GList *
+gssdp_resource_aggregator_get_locations (GSSDPResourceAggregator *aggregator,
+                                         const char              *usn)
+{
+        GSSDPResourceAggregatorPrivate *priv;
+        Device *device;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_AGGREGATOR (aggregator), NULL);
+        g_return_val_if_fail (usn != NULL, NULL);
+
+        priv = gssdp_resource_aggregator_get_instance_private (aggregator);
+
+        device = g_hash_table_lookup (priv->devices, usn);
+        if (device == NULL)
+                return NULL;
+
+        return device_get_locations (device);
+}
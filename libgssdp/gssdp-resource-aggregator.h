@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 GSSDP contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#ifndef GSSDP_RESOURCE_AGGREGATOR_H
+#define GSSDP_RESOURCE_AGGREGATOR_H
+
+#include <libgssdp/gssdp-client.h>
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GSSDP_TYPE_RESOURCE_AGGREGATOR (gssdp_resource_aggregator_get_type ())
+
+G_DECLARE_DERIVABLE_TYPE (GSSDPResourceAggregator,
+                          gssdp_resource_aggregator,
+                          GSSDP,
+                          RESOURCE_AGGREGATOR,
+                          GObject)
+
+struct _GSSDPResourceAggregatorClass {
+        GObjectClass parent_class;
+
+        /* signals */
+        void (* resource_available)   (GSSDPResourceAggregator *aggregator,
+                                       const char              *usn,
+                                       const GList             *locations);
+
+        void (* resource_unavailable) (GSSDPResourceAggregator *aggregator,
+                                       const char              *usn);
+
+        void (* reachability_changed) (GSSDPResourceAggregator *aggregator,
+                                       const char              *usn,
+                                       GSSDPClient             *client,
+                                       gboolean                 reachable);
+
+        /* future padding */
+        void (* _gssdp_reserved1) (void);
+        void (* _gssdp_reserved2) (void);
+        void (* _gssdp_reserved3) (void);
+        void (* _gssdp_reserved4) (void);
+};
+typedef struct _GSSDPResourceAggregatorClass GSSDPResourceAggregatorClass;
+
+GSSDPResourceAggregator *
+gssdp_resource_aggregator_new           (const char              *target);
+
+const char *
+gssdp_resource_aggregator_get_target    (GSSDPResourceAggregator *aggregator);
+
+void
+gssdp_resource_aggregator_add_client    (GSSDPResourceAggregator *aggregator,
+                                         GSSDPClient             *client);
+
+void
+gssdp_resource_aggregator_remove_client (GSSDPResourceAggregator *aggregator,
+                                         GSSDPClient             *client);
+
+void
+gssdp_resource_aggregator_set_active    (GSSDPResourceAggregator *aggregator,
+                                         gboolean                 active);
+
+gboolean
+gssdp_resource_aggregator_get_active    (GSSDPResourceAggregator *aggregator);
+
+GList *
+gssdp_resource_aggregator_get_clients   (GSSDPResourceAggregator *aggregator,
+                                         const char              *usn);
+
+GList *
+gssdp_resource_aggregator_get_locations (GSSDPResourceAggregator *aggregator,
+                                         const char              *usn);
+
+G_END_DECLS
+
+#endif /* GSSDP_RESOURCE_AGGREGATOR_H */
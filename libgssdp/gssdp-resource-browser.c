@@ -10,8 +10,11 @@
 #include <config.h>
 
 #include "gssdp-resource-browser.h"
+#include "gssdp-resource-info-private.h"
 #include "gssdp-client-private.h"
 #include "gssdp-protocol.h"
+#include "gssdp-error.h"
+#include "gssdp-socket-functions.h"
 
 #include <libsoup/soup.h>
 #include <string.h>
@@ -19,29 +22,81 @@
 #include <stdlib.h>
 
 #define RESCAN_TIMEOUT 5 /* 5 seconds */
+#define MIN_DISCOVERY_MESSAGES 3
 #define MAX_DISCOVERY_MESSAGES 3
 #define DISCOVERY_FREQUENCY    500 /* 500 ms */
+#define MIN_DISCOVERY_INTERVAL 10 /* 10 ms */
+#define MAX_RESCAN_INTERVAL    1800 /* 30 minutes */
+#define MAX_REVALIDATION_RATE  10 /* Unicast probes per second */
+#define MIN_REVALIDATION_LEAD  5 /* 5 seconds */
+#define WAIT_MX                1 /* MX of searches for a single resource */
+
+/* Resources are tagged with the targets they match in a bit mask */
+#define MAX_TARGETS 64
+
+/* On-disk cache snapshot, see gssdp_resource_browser_save_cache () */
+#define CACHE_FILE_MAGIC "GSSDPBC"
+#define CACHE_FILE_VERSION 3
+#define CACHE_FILE_MIN_VERSION 2 /* Without config-id and host IP */
 
 struct _GSSDPResourceBrowserPrivate {
         GSSDPClient *client;
 
-        char        *target;
-        GRegex      *target_regex;
+        GPtrArray   *targets; /* The primary target comes first */
 
         gushort      mx;
 
         gboolean     active;
 
         gulong       message_received_id;
+        gulong       rebound_id;
 
         GHashTable  *resources;
+        GHashTable  *resources_by_host; /* Location host → Resources */
                         
         GSource     *timeout_src;
         guint        num_discovery;
-        guint        version;
+
+        /* Adaptive discovery */
+        guint        discovery_interval;
+        guint        min_discovery_messages;
+        guint        max_discovery_messages;
+        guint        num_new_resources;
+        gboolean     cache_changed;
+
+        guint        rescan_interval;
+        guint        max_rescan_interval;
+        guint        current_rescan_interval;
+        GSource     *rescan_src;
 
         GSource     *refresh_cache_src;
         GHashTable  *fresh_resources;
+
+        /* Unicast revalidation */
+        gboolean     revalidate;
+        guint        max_revalidation_rate;
+        guint        revalidation_tokens;
+        gint64       revalidation_second;
+        GHashTable  *revalidations; /* Device UUIDs with a pending probe */
+        guint        grace_period;
+        gboolean     track_location_changes;
+        guint        n_revalidations_sent;
+        guint        n_revalidations_suppressed;
+        guint        n_revalidations_answered;
+
+        /* Batched change notification */
+        gboolean     batch_signals;
+        guint        batch_interval;
+        GSource     *batch_src;
+        GHashTable  *batch_added; /* USN → GSSDPResourceInfo */
+        GHashTable  *batch_removed;
+        GHashTable  *batch_updated;
+
+        /* Pushdown filters, applied before resources are cached */
+        GPtrArray   *source_filters; /* SourceFilter */
+        GPtrArray   *usn_filters;
+        GPtrArray   *server_filters;
+        GPtrArray   *location_host_filters;
 };
 typedef struct _GSSDPResourceBrowserPrivate GSSDPResourceBrowserPrivate;
 
@@ -54,23 +109,61 @@ enum {
         PROP_CLIENT,
         PROP_TARGET,
         PROP_MX,
-        PROP_ACTIVE
+        PROP_ACTIVE,
+        PROP_DISCOVERY_INTERVAL,
+        PROP_MIN_DISCOVERY_MESSAGES,
+        PROP_MAX_DISCOVERY_MESSAGES,
+        PROP_RESCAN_INTERVAL,
+        PROP_MAX_RESCAN_INTERVAL,
+        PROP_REVALIDATE,
+        PROP_MAX_REVALIDATION_RATE,
+        PROP_GRACE_PERIOD,
+        PROP_TRACK_LOCATION_CHANGES,
+        PROP_BATCH_SIGNALS,
+        PROP_BATCH_INTERVAL
 };
 
 enum {
         RESOURCE_AVAILABLE,
         RESOURCE_UNAVAILABLE,
         RESOURCE_UPDATE,
+        RESOURCE_LOCATIONS_CHANGED,
+        RESOURCES_CHANGED,
+        TARGET_AVAILABLE,
+        TARGET_UNAVAILABLE,
         LAST_SIGNAL
 };
 
 static guint signals[LAST_SIGNAL];
 
+/* A network to accept resources from, kept as raw bytes so checking a
+ * sender does not need a GInetAddress */
+typedef struct {
+        guint8 bytes[16];
+        gsize  size; /* 4 or 16 */
+        guint  length; /* Prefix length in bits */
+} SourceFilter;
+
+typedef struct {
+        char   *target;
+        GRegex *target_regex;
+        char   *literal; /* What the regex matches, if it is a plain string */
+        guint   version;
+} Target;
+
 typedef struct {
         GSSDPResourceBrowser *resource_browser;
         char                 *usn;
         GSource              *timeout_src;
         GList                *locations;
+        gint64                expires; /* Wall-clock time, in µs */
+        gint64                last_seen; /* Wall-clock time, in µs, or 0 */
+        gint32                boot_id; /* -1 if unknown */
+        gint32                config_id; /* -1 if unknown */
+        char                 *host_ip; /* Sender of the last announcement */
+        GSource              *revalidate_src;
+        gboolean              suspect; /* Missed a discovery round */
+        guint64               targets; /* Bit mask of matching targets */
 } Resource;
 
 /* Function prototypes */
@@ -93,15 +186,174 @@ send_discovery_request            (GSSDPResourceBrowser *resource_browser);
 static gboolean
 discovery_timeout                (gpointer              data);
 static void
+client_rebound_cb                (GSSDPClient          *client,
+                                  gpointer              user_data);
+static void
 start_discovery                  (GSSDPResourceBrowser *resource_browser);
 static void
 stop_discovery                   (GSSDPResourceBrowser *resource_browser);
 static gboolean
 refresh_cache                    (gpointer data);
 static void
+schedule_rescan                  (GSSDPResourceBrowser *resource_browser);
+static void
 resource_unavailable             (GSSDPResourceBrowser *resource_browser,
+                                  guint64               targets,
+                                  SoupMessageHeaders   *headers);
+static void
+resource_set_timeout             (Resource             *resource,
+                                  guint                 timeout);
+static char *
+get_device_uuid                  (const char           *usn);
+static gboolean
+resource_revalidate              (gpointer              user_data);
+static guint64
+check_target_compat              (GSSDPResourceBrowser *resource_browser,
+                                  const char           *st);
+static void
+resource_index_add               (Resource             *resource);
+static void
+resource_index_remove            (Resource             *resource);
+static void
+emit_resource_available          (Resource             *resource,
+                                  const char           *usn);
+static void
+emit_resource_unavailable        (Resource             *resource,
+                                  const char           *usn);
+static void
+emit_resource_locations_changed  (Resource             *resource,
+                                  const char           *usn);
+static void
+remove_resource                  (Resource             *resource,
+                                  const char           *canonical_usn,
+                                  const char           *usn);
+static void
+emit_target_signals              (GSSDPResourceBrowser *resource_browser,
+                                  const char           *usn,
+                                  guint64               mask,
+                                  guint                 signal_id);
+static void
+batch_record                     (Resource             *resource,
+                                  guint                 signal_id);
+static void
+batch_flush                      (GSSDPResourceBrowser *resource_browser);
+static gboolean
+batch_timeout                    (gpointer              user_data);
+static const char *
+get_location_host                (const char           *location,
+                                  gsize                 size,
+                                  gsize                *length);
+static gboolean
+check_filters                    (GSSDPResourceBrowser *resource_browser,
+                                  const char           *from_ip,
                                   SoupMessageHeaders   *headers);
 
+static Target *
+target_new (const char *target)
+{
+        Target *t;
+        char *pattern;
+        char *version;
+        char *escaped;
+        const char version_pattern[] = "([0-9]+)";
+        GError *error;
+
+        t = g_slice_new0 (Target);
+        t->target = g_strdup (target);
+
+        /* Make sure we have enough room for version pattern */
+        pattern = g_strndup (target,
+                             strlen (target) + sizeof (version_pattern));
+
+        version = g_strrstr (pattern, ":");
+        if (version != NULL &&
+            (g_strstr_len (pattern, -1, "uuid:") != pattern ||
+             version != g_strstr_len (pattern, -1, ":")) &&
+            g_regex_match_simple (version_pattern,
+                                  version + 1,
+                                  G_REGEX_ANCHORED,
+                                  G_REGEX_MATCH_ANCHORED)) {
+                t->version = atoi (version + 1);
+                strncpy (version + 1, version_pattern, sizeof(version_pattern));
+                t->literal = g_strndup (pattern, version + 1 - pattern);
+        } else {
+                t->literal = g_strdup (pattern);
+        }
+
+        /* Only usable as a quick check if the regex is not more lenient */
+        escaped = g_regex_escape_string (t->literal, -1);
+        if (!g_str_equal (escaped, t->literal))
+                g_clear_pointer (&t->literal, g_free);
+        g_free (escaped);
+
+        error = NULL;
+        t->target_regex = g_regex_new (pattern,
+                                       0,
+                                       0,
+                                       &error);
+        if (error) {
+                g_warning ("Error compiling regular expression '%s': %s",
+                           pattern,
+                           error->message);
+
+                g_error_free (error);
+        }
+
+        g_free (pattern);
+
+        return t;
+}
+
+static void
+target_free (Target *target)
+{
+        g_free (target->target);
+        g_free (target->literal);
+        g_clear_pointer (&target->target_regex, g_regex_unref);
+        g_slice_free (Target, target);
+}
+
+/* Returns the part of @usn that is announced as NT */
+static const char *
+get_usn_target (const char *usn)
+{
+        const char *type;
+
+        type = strstr (usn, "::");
+
+        return type != NULL ? type + 2 : usn;
+}
+
+/* Resources are cached without the version of their type if they matched
+ * a versioned target, so that newer versions replace older ones */
+static char *
+get_canonical_usn (GSSDPResourceBrowser *resource_browser,
+                   const char           *usn,
+                   guint64               targets)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        guint i;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        for (i = 0; i < priv->targets->len; i++) {
+                Target *target = g_ptr_array_index (priv->targets, i);
+                const char *version;
+
+                if (!(targets & (G_GUINT64_CONSTANT (1) << i)) ||
+                    target->version == 0)
+                        continue;
+
+                version = g_strrstr (usn, ":");
+                if (version != NULL)
+                        return g_strndup (usn, version - usn);
+
+                break;
+        }
+
+        return g_strdup (usn);
+}
+
 static void
 gssdp_resource_browser_init (GSSDPResourceBrowser *resource_browser)
 {
@@ -109,12 +361,53 @@ gssdp_resource_browser_init (GSSDPResourceBrowser *resource_browser)
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
         priv->mx = SSDP_DEFAULT_MX;
+        priv->discovery_interval = DISCOVERY_FREQUENCY;
+        priv->min_discovery_messages = MIN_DISCOVERY_MESSAGES;
+        priv->max_discovery_messages = MAX_DISCOVERY_MESSAGES;
+        priv->max_rescan_interval = MAX_RESCAN_INTERVAL;
+        priv->max_revalidation_rate = MAX_REVALIDATION_RATE;
 
         priv->resources =
                 g_hash_table_new_full (g_str_hash,
                                        g_str_equal,
                                        g_free,
                                        (GFreeFunc) resource_free);
+        priv->resources_by_host =
+                g_hash_table_new_full (g_str_hash,
+                                       g_str_equal,
+                                       g_free,
+                                       (GDestroyNotify) g_ptr_array_unref);
+
+        priv->targets = g_ptr_array_new_with_free_func
+                                        ((GDestroyNotify) target_free);
+
+        priv->revalidations = g_hash_table_new_full (g_str_hash,
+                                                     g_str_equal,
+                                                     g_free,
+                                                     NULL);
+
+        priv->source_filters = g_ptr_array_new_with_free_func (g_free);
+        priv->usn_filters = g_ptr_array_new_with_free_func (g_free);
+        priv->server_filters = g_ptr_array_new_with_free_func (g_free);
+        priv->location_host_filters = g_ptr_array_new_with_free_func
+                                        (g_free);
+
+        /* Keys are owned by the values */
+        priv->batch_added = g_hash_table_new_full
+                        (g_str_hash,
+                         g_str_equal,
+                         NULL,
+                         (GDestroyNotify) gssdp_resource_info_unref);
+        priv->batch_removed = g_hash_table_new_full
+                        (g_str_hash,
+                         g_str_equal,
+                         NULL,
+                         (GDestroyNotify) gssdp_resource_info_unref);
+        priv->batch_updated = g_hash_table_new_full
+                        (g_str_hash,
+                         g_str_equal,
+                         NULL,
+                         (GDestroyNotify) gssdp_resource_info_unref);
 }
 
 static void
@@ -148,6 +441,72 @@ gssdp_resource_browser_get_property (GObject    *object,
                         (value,
                          gssdp_resource_browser_get_active (resource_browser));
                 break;
+        case PROP_DISCOVERY_INTERVAL:
+                g_value_set_uint
+                        (value,
+                         gssdp_resource_browser_get_discovery_interval
+                                        (resource_browser));
+                break;
+        case PROP_MIN_DISCOVERY_MESSAGES:
+                g_value_set_uint
+                        (value,
+                         gssdp_resource_browser_get_min_discovery_messages
+                                        (resource_browser));
+                break;
+        case PROP_MAX_DISCOVERY_MESSAGES:
+                g_value_set_uint
+                        (value,
+                         gssdp_resource_browser_get_max_discovery_messages
+                                        (resource_browser));
+                break;
+        case PROP_RESCAN_INTERVAL:
+                g_value_set_uint
+                        (value,
+                         gssdp_resource_browser_get_rescan_interval
+                                        (resource_browser));
+                break;
+        case PROP_MAX_RESCAN_INTERVAL:
+                g_value_set_uint
+                        (value,
+                         gssdp_resource_browser_get_max_rescan_interval
+                                        (resource_browser));
+                break;
+        case PROP_REVALIDATE:
+                g_value_set_boolean
+                        (value,
+                         gssdp_resource_browser_get_revalidate
+                                        (resource_browser));
+                break;
+        case PROP_MAX_REVALIDATION_RATE:
+                g_value_set_uint
+                        (value,
+                         gssdp_resource_browser_get_max_revalidation_rate
+                                        (resource_browser));
+                break;
+        case PROP_GRACE_PERIOD:
+                g_value_set_uint
+                        (value,
+                         gssdp_resource_browser_get_grace_period
+                                        (resource_browser));
+                break;
+        case PROP_TRACK_LOCATION_CHANGES:
+                g_value_set_boolean
+                        (value,
+                         gssdp_resource_browser_get_track_location_changes
+                                        (resource_browser));
+                break;
+        case PROP_BATCH_SIGNALS:
+                g_value_set_boolean
+                        (value,
+                         gssdp_resource_browser_get_batch_signals
+                                        (resource_browser));
+                break;
+        case PROP_BATCH_INTERVAL:
+                g_value_set_uint
+                        (value,
+                         gssdp_resource_browser_get_batch_interval
+                                        (resource_browser));
+                break;
         default:
                 G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
                 break;
@@ -181,6 +540,61 @@ gssdp_resource_browser_set_property (GObject      *object,
                 gssdp_resource_browser_set_active (resource_browser,
                                                    g_value_get_boolean (value));
                 break;
+        case PROP_DISCOVERY_INTERVAL:
+                gssdp_resource_browser_set_discovery_interval
+                                        (resource_browser,
+                                         g_value_get_uint (value));
+                break;
+        case PROP_MIN_DISCOVERY_MESSAGES:
+                gssdp_resource_browser_set_min_discovery_messages
+                                        (resource_browser,
+                                         g_value_get_uint (value));
+                break;
+        case PROP_MAX_DISCOVERY_MESSAGES:
+                gssdp_resource_browser_set_max_discovery_messages
+                                        (resource_browser,
+                                         g_value_get_uint (value));
+                break;
+        case PROP_RESCAN_INTERVAL:
+                gssdp_resource_browser_set_rescan_interval
+                                        (resource_browser,
+                                         g_value_get_uint (value));
+                break;
+        case PROP_MAX_RESCAN_INTERVAL:
+                gssdp_resource_browser_set_max_rescan_interval
+                                        (resource_browser,
+                                         g_value_get_uint (value));
+                break;
+        case PROP_REVALIDATE:
+                gssdp_resource_browser_set_revalidate
+                                        (resource_browser,
+                                         g_value_get_boolean (value));
+                break;
+        case PROP_MAX_REVALIDATION_RATE:
+                gssdp_resource_browser_set_max_revalidation_rate
+                                        (resource_browser,
+                                         g_value_get_uint (value));
+                break;
+        case PROP_GRACE_PERIOD:
+                gssdp_resource_browser_set_grace_period
+                                        (resource_browser,
+                                         g_value_get_uint (value));
+                break;
+        case PROP_TRACK_LOCATION_CHANGES:
+                gssdp_resource_browser_set_track_location_changes
+                                        (resource_browser,
+                                         g_value_get_boolean (value));
+                break;
+        case PROP_BATCH_SIGNALS:
+                gssdp_resource_browser_set_batch_signals
+                                        (resource_browser,
+                                         g_value_get_boolean (value));
+                break;
+        case PROP_BATCH_INTERVAL:
+                gssdp_resource_browser_set_batch_interval
+                                        (resource_browser,
+                                         g_value_get_uint (value));
+                break;
         default:
                 G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
                 break;
@@ -205,13 +619,18 @@ gssdp_resource_browser_dispose (GObject *object)
                                  priv->message_received_id);
                 }
 
+                g_clear_signal_handler (&priv->rebound_id, priv->client);
+
                 stop_discovery (resource_browser);
+                _gssdp_client_release_role (priv->client,
+                                            _GSSDP_CLIENT_ROLE_BROWSER);
 
                 g_object_unref (priv->client);
                 priv->client = NULL;
         }
 
         clear_cache (resource_browser);
+        g_clear_pointer (&priv->batch_src, g_source_destroy);
 
         G_OBJECT_CLASS (gssdp_resource_browser_parent_class)->dispose (object);
 }
@@ -225,11 +644,18 @@ gssdp_resource_browser_finalize (GObject *object)
         resource_browser = GSSDP_RESOURCE_BROWSER (object);
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
-        g_clear_pointer (&priv->target_regex, g_regex_unref);
-
-        g_free (priv->target);
+        g_ptr_array_unref (priv->targets);
 
         g_hash_table_destroy (priv->resources);
+        g_hash_table_destroy (priv->resources_by_host);
+        g_hash_table_destroy (priv->revalidations);
+        g_hash_table_destroy (priv->batch_added);
+        g_hash_table_destroy (priv->batch_removed);
+        g_hash_table_destroy (priv->batch_updated);
+        g_ptr_array_unref (priv->source_filters);
+        g_ptr_array_unref (priv->usn_filters);
+        g_ptr_array_unref (priv->server_filters);
+        g_ptr_array_unref (priv->location_host_filters);
 
         G_OBJECT_CLASS (gssdp_resource_browser_parent_class)->finalize (object);
 
@@ -334,6 +760,277 @@ gssdp_resource_browser_class_init (GSSDPResourceBrowserClass *klass)
                           G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
                           G_PARAM_STATIC_BLURB));
 
+        /**
+         * GSSDPResourceBrowser:discovery-interval:(attributes org.gtk.Property.get=gssdp_resource_browser_get_discovery_interval org.gtk.Property.set=gssdp_resource_browser_set_discovery_interval)
+         *
+         * The time in milliseconds between two discovery requests of the
+         * same discovery round. Requests beyond the first
+         * [property@GSSDP.ResourceBrowser:min-discovery-messages] wait at
+         * least [property@GSSDP.ResourceBrowser:mx] seconds, see
+         * [property@GSSDP.ResourceBrowser:max-discovery-messages].
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_DISCOVERY_INTERVAL,
+                 g_param_spec_uint
+                         ("discovery-interval",
+                          "Discovery interval",
+                          "Milliseconds between two discovery requests.",
+                          MIN_DISCOVERY_INTERVAL,
+                          G_MAXUINT,
+                          DISCOVERY_FREQUENCY,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceBrowser:min-discovery-messages:(attributes org.gtk.Property.get=gssdp_resource_browser_get_min_discovery_messages org.gtk.Property.set=gssdp_resource_browser_set_min_discovery_messages)
+         *
+         * The number of discovery requests sent
+         * [property@GSSDP.ResourceBrowser:discovery-interval] apart at the
+         * start of each discovery round. After these, the round ends as
+         * soon as a request yields no new resources.
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_MIN_DISCOVERY_MESSAGES,
+                 g_param_spec_uint
+                         ("min-discovery-messages",
+                          "Minimum discovery messages",
+                          "Number of discovery requests before stopping "
+                          "early.",
+                          1,
+                          G_MAXUINT,
+                          MIN_DISCOVERY_MESSAGES,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceBrowser:max-discovery-messages:(attributes org.gtk.Property.get=gssdp_resource_browser_get_max_discovery_messages org.gtk.Property.set=gssdp_resource_browser_set_max_discovery_messages)
+         *
+         * The maximum number of discovery requests sent per discovery round.
+         *
+         * The first [property@GSSDP.ResourceBrowser:min-discovery-messages]
+         * requests are sent
+         * [property@GSSDP.ResourceBrowser:discovery-interval] apart. If this
+         * is larger than that, the browser then keeps
+         * sending requests as long as the previous one yielded new
+         * resources. Each of these further requests waits at least the MX
+         * time for answers to the previous one, so slow devices are not
+         * mistaken for a converged network.
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_MAX_DISCOVERY_MESSAGES,
+                 g_param_spec_uint
+                         ("max-discovery-messages",
+                          "Maximum discovery messages",
+                          "Maximum number of discovery requests per round.",
+                          1,
+                          G_MAXUINT,
+                          MAX_DISCOVERY_MESSAGES,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceBrowser:rescan-interval:(attributes org.gtk.Property.get=gssdp_resource_browser_get_rescan_interval org.gtk.Property.set=gssdp_resource_browser_set_rescan_interval)
+         *
+         * The time in seconds after which an active browser automatically
+         * starts a new discovery round, or 0 to only rescan on
+         * [method@GSSDP.ResourceBrowser.rescan].
+         *
+         * Each round that neither finds new resources nor loses any doubles
+         * the interval, up to [property@GSSDP.ResourceBrowser:max-rescan-interval].
+         * Any change resets it to this value.
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_RESCAN_INTERVAL,
+                 g_param_spec_uint
+                         ("rescan-interval",
+                          "Rescan interval",
+                          "Seconds between automatic discovery rounds.",
+                          0,
+                          G_MAXUINT,
+                          0,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceBrowser:max-rescan-interval:(attributes org.gtk.Property.get=gssdp_resource_browser_get_max_rescan_interval org.gtk.Property.set=gssdp_resource_browser_set_max_rescan_interval)
+         *
+         * The upper limit in seconds for the automatic rescan interval on a
+         * stable network.
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_MAX_RESCAN_INTERVAL,
+                 g_param_spec_uint
+                         ("max-rescan-interval",
+                          "Maximum rescan interval",
+                          "Upper limit of the automatic rescan interval.",
+                          1,
+                          G_MAXUINT,
+                          MAX_RESCAN_INTERVAL,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceBrowser:revalidate:(attributes org.gtk.Property.get=gssdp_resource_browser_get_revalidate org.gtk.Property.set=gssdp_resource_browser_set_revalidate)
+         *
+         * Whether to probe cached resources shortly before they expire.
+         *
+         * If enabled, the browser sends a unicast M-SEARCH for the device
+         * UUID to the address the resource was last announced from, as
+         * described in UDA 1.1. Only devices that announced a BOOTID, and
+         * thus claim UDA 1.1 compliance, are probed. A response refreshes
+         * all cached resources of that device.
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_REVALIDATE,
+                 g_param_spec_boolean
+                         ("revalidate",
+                          "Revalidate",
+                          "Probe resources before they expire.",
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceBrowser:max-revalidation-rate:(attributes org.gtk.Property.get=gssdp_resource_browser_get_max_revalidation_rate org.gtk.Property.set=gssdp_resource_browser_set_max_revalidation_rate)
+         *
+         * The maximum number of unicast revalidation probes sent per second.
+         * Probes exceeding this rate are postponed to the next second, or
+         * skipped if the device could no longer answer before its entry
+         * expires.
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_MAX_REVALIDATION_RATE,
+                 g_param_spec_uint
+                         ("max-revalidation-rate",
+                          "Maximum revalidation rate",
+                          "Maximum number of revalidation probes per second.",
+                          1,
+                          G_MAXUINT,
+                          MAX_REVALIDATION_RATE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceBrowser:grace-period:(attributes org.gtk.Property.get=gssdp_resource_browser_get_grace_period org.gtk.Property.set=gssdp_resource_browser_set_grace_period)
+         *
+         * The time in seconds a resource that did not answer a discovery
+         * round is kept as suspect before it is considered gone, or 0 to
+         * remove it immediately.
+         *
+         * Suspect resources are probed once more, subject to
+         * [property@GSSDP.ResourceBrowser:max-revalidation-rate]. Any sign
+         * of life during the grace period turns them into regular
+         * resources again without emitting any signal.
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_GRACE_PERIOD,
+                 g_param_spec_uint
+                         ("grace-period",
+                          "Grace period",
+                          "Seconds to keep unresponsive resources.",
+                          0,
+                          G_MAXUINT,
+                          0,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceBrowser:track-location-changes:(attributes org.gtk.Property.get=gssdp_resource_browser_get_track_location_changes org.gtk.Property.set=gssdp_resource_browser_set_track_location_changes)
+         *
+         * Whether a known resource that is announced with different
+         * locations is updated in place.
+         *
+         * If %TRUE, the resource stays in the cache and
+         * [signal@GSSDP.ResourceBrowser::resource-locations-changed] is
+         * emitted. Otherwise the announcement is taken as a missed byebye:
+         * the resource is reported as unavailable and then as available
+         * again with its new locations.
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_TRACK_LOCATION_CHANGES,
+                 g_param_spec_boolean
+                         ("track-location-changes",
+                          "Track location changes",
+                          "Update moved resources in place.",
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceBrowser:batch-signals:(attributes org.gtk.Property.get=gssdp_resource_browser_get_batch_signals org.gtk.Property.set=gssdp_resource_browser_set_batch_signals)
+         *
+         * Whether to report changes to the cache in batches.
+         *
+         * If %TRUE, [signal@GSSDP.ResourceBrowser::resource-available],
+         * [signal@GSSDP.ResourceBrowser::resource-unavailable],
+         * [signal@GSSDP.ResourceBrowser::resource-update] and
+         * [signal@GSSDP.ResourceBrowser::resource-locations-changed] are not
+         * emitted. Instead, changes are collected for
+         * [property@GSSDP.ResourceBrowser:batch-interval] and reported with
+         * a single [signal@GSSDP.ResourceBrowser::resources-changed].
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_BATCH_SIGNALS,
+                 g_param_spec_boolean
+                         ("batch-signals",
+                          "Batch signals",
+                          "Report cache changes in batches.",
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
+        /**
+         * GSSDPResourceBrowser:batch-interval:(attributes org.gtk.Property.get=gssdp_resource_browser_get_batch_interval org.gtk.Property.set=gssdp_resource_browser_set_batch_interval)
+         *
+         * Time in milliseconds to collect changes for before emitting
+         * [signal@GSSDP.ResourceBrowser::resources-changed]. If 0, changes
+         * are reported once per main loop iteration.
+         *
+         * Since: 1.8.0
+         **/
+        g_object_class_install_property
+                (object_class,
+                 PROP_BATCH_INTERVAL,
+                 g_param_spec_uint
+                         ("batch-interval",
+                          "Batch interval",
+                          "Milliseconds to collect cache changes for.",
+                          0,
+                          G_MAXUINT,
+                          0,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
         /**
          * GSSDPResourceBrowser::resource-available:
          * @resource_browser: The #GSSDPResourceBrowser that received the
@@ -402,15 +1099,133 @@ gssdp_resource_browser_class_init (GSSDPResourceBrowserClass *klass)
                               G_TYPE_STRING,
                               G_TYPE_UINT,
                               G_TYPE_UINT);
-}
 
-/**
- * gssdp_resource_browser_new:
- * @client: The #GSSDPClient to associate with
- * @target: A SSDP search target
- *
- * Create a new resource browser for @target.
- *
+        /**
+         * GSSDPResourceBrowser::resource-locations-changed:
+         * @resource_browser: The #GSSDPResourceBrowser that received the
+         * signal
+         * @usn: The USN of the resource
+         * @locations: (type GList*) (transfer none) (element-type utf8): A [struct@GLib.List] of strings describing the new locations of the
+         * resource.
+         *
+         * The ::resource-locations-changed signal is emitted whenever a
+         * known resource is announced with different locations while
+         * [property@GSSDP.ResourceBrowser:track-location-changes] is set.
+         * The resource stays in the cache with its new locations.
+         *
+         * Since: 1.8.0
+         **/
+        signals[RESOURCE_LOCATIONS_CHANGED] =
+                g_signal_new ("resource-locations-changed",
+                              GSSDP_TYPE_RESOURCE_BROWSER,
+                              G_SIGNAL_RUN_LAST,
+                              G_STRUCT_OFFSET (GSSDPResourceBrowserClass,
+                                               resource_locations_changed),
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              2,
+                              G_TYPE_STRING,
+                              G_TYPE_POINTER);
+
+        /**
+         * GSSDPResourceBrowser::resources-changed:
+         * @resource_browser: The #GSSDPResourceBrowser that received the
+         * signal
+         * @added: (element-type GSSDPResourceInfo): Resources that became
+         * available
+         * @removed: (element-type GSSDPResourceInfo): Resources that are not
+         * available any more
+         * @updated: (element-type GSSDPResourceInfo): Resources whose
+         * locations changed, or that announced a new boot ID
+         *
+         * The ::resources-changed signal is emitted instead of the
+         * individual signals when
+         * [property@GSSDP.ResourceBrowser:batch-signals] is enabled.
+         *
+         * A resource that appeared and disappeared again within one batch is
+         * not reported at all.
+         *
+         * Since: 1.8.0
+         **/
+        signals[RESOURCES_CHANGED] =
+                g_signal_new ("resources-changed",
+                              GSSDP_TYPE_RESOURCE_BROWSER,
+                              G_SIGNAL_RUN_LAST,
+                              G_STRUCT_OFFSET (GSSDPResourceBrowserClass,
+                                               resources_changed),
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              3,
+                              G_TYPE_PTR_ARRAY,
+                              G_TYPE_PTR_ARRAY,
+                              G_TYPE_PTR_ARRAY);
+
+        /**
+         * GSSDPResourceBrowser::target-available:
+         * @resource_browser: The #GSSDPResourceBrowser that received the
+         * signal
+         * @usn: The USN of the resource
+         * @target: The target of @resource_browser the resource matches
+         *
+         * The ::target-available signal is emitted for each target of
+         * @resource_browser a resource starts to match, right after
+         * [signal@GSSDP.ResourceBrowser::resource-available] for a new
+         * resource.
+         *
+         * Like the other per-resource signals, it is not emitted when
+         * [property@GSSDP.ResourceBrowser:batch-signals] is enabled.
+         *
+         * Since: 1.8.0
+         **/
+        signals[TARGET_AVAILABLE] =
+                g_signal_new ("target-available",
+                              GSSDP_TYPE_RESOURCE_BROWSER,
+                              G_SIGNAL_RUN_LAST,
+                              0,
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              2,
+                              G_TYPE_STRING,
+                              G_TYPE_STRING);
+
+        /**
+         * GSSDPResourceBrowser::target-unavailable:
+         * @resource_browser: The #GSSDPResourceBrowser that received the
+         * signal
+         * @usn: The USN of the resource
+         * @target: The target of @resource_browser the resource no longer
+         * matches
+         *
+         * The ::target-unavailable signal is emitted for each target of a
+         * resource that goes away, right before
+         * [signal@GSSDP.ResourceBrowser::resource-unavailable], and when a
+         * target is removed with
+         * [method@GSSDP.ResourceBrowser.remove_target].
+         *
+         * Like the other per-resource signals, it is not emitted when
+         * [property@GSSDP.ResourceBrowser:batch-signals] is enabled.
+         *
+         * Since: 1.8.0
+         **/
+        signals[TARGET_UNAVAILABLE] =
+                g_signal_new ("target-unavailable",
+                              GSSDP_TYPE_RESOURCE_BROWSER,
+                              G_SIGNAL_RUN_LAST,
+                              0,
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              2,
+                              G_TYPE_STRING,
+                              G_TYPE_STRING);
+}
+
+/**
+ * gssdp_resource_browser_new:
+ * @client: The #GSSDPClient to associate with
+ * @target: A SSDP search target
+ *
+ * Create a new resource browser for @target.
+ *
  * @target is a generic string the resource browser listens for on the SSDP
  * bus. There are several possible targets such as
  *
@@ -456,9 +1271,38 @@ gssdp_resource_browser_set_client (GSSDPResourceBrowser *resource_browser,
                                          resource_browser,
                                          0);
 
+        priv->rebound_id =
+                g_signal_connect_object (priv->client,
+                                         "rebound",
+                                         G_CALLBACK (client_rebound_cb),
+                                         resource_browser,
+                                         0);
+        _gssdp_client_hold_role (priv->client, _GSSDP_CLIENT_ROLE_BROWSER);
+
         g_object_notify (G_OBJECT (resource_browser), "client");
 }
 
+/*
+ * The client's sockets were recreated, possibly on a new address, so
+ * anything said before might not have reached us
+ */
+static void
+client_rebound_cb (G_GNUC_UNUSED GSSDPClient *client,
+                   gpointer                   user_data)
+{
+        GSSDPResourceBrowser *resource_browser;
+        GSSDPResourceBrowserPrivate *priv;
+
+        resource_browser = GSSDP_RESOURCE_BROWSER (user_data);
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (!priv->active)
+                return;
+
+        stop_discovery (resource_browser);
+        start_discovery (resource_browser);
+}
+
 /**
  * gssdp_resource_browser_get_client:(attributes org.gtk.Method.get_property=client):
  * @resource_browser: A #GSSDPResourceBrowser
@@ -491,10 +1335,6 @@ void
 gssdp_resource_browser_set_target (GSSDPResourceBrowser *resource_browser,
                                    const char           *target)
 {
-        char *pattern;
-        char *version;
-        const char version_pattern[] = "([0-9]+)";
-        GError *error;
         GSSDPResourceBrowserPrivate *priv;
 
         g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
@@ -503,41 +1343,11 @@ gssdp_resource_browser_set_target (GSSDPResourceBrowser *resource_browser,
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
         g_return_if_fail (!priv->active);
 
-        g_free (priv->target);
-        priv->target = g_strdup (target);
-
-        g_clear_pointer (&priv->target_regex, g_regex_unref);
-
-        /* Make sure we have enough room for version pattern */
-        pattern = g_strndup (target,
-                             strlen (target) + sizeof (version_pattern));
-
-        version = g_strrstr (pattern, ":");
-        if (version != NULL &&
-            (g_strstr_len (pattern, -1, "uuid:") != pattern ||
-             version != g_strstr_len (pattern, -1, ":")) &&
-            g_regex_match_simple (version_pattern,
-                                  version + 1,
-                                  G_REGEX_ANCHORED,
-                                  G_REGEX_MATCH_ANCHORED)) {
-                priv->version = atoi (version + 1);
-                strncpy (version + 1, version_pattern, sizeof(version_pattern));
-        }
-
-        error = NULL;
-        priv->target_regex = g_regex_new (pattern,
-                                          0,
-                                          0,
-                                          &error);
-        if (error) {
-                g_warning ("Error compiling regular expression '%s': %s",
-                           pattern,
-                           error->message);
+        if (priv->targets->len > 0)
+                g_ptr_array_remove_index (priv->targets, 0);
 
-                g_error_free (error);
-        }
+        g_ptr_array_insert (priv->targets, 0, target_new (target));
 
-        g_free (pattern);
         g_object_notify (G_OBJECT (resource_browser), "target");
 }
 
@@ -557,7 +1367,248 @@ gssdp_resource_browser_get_target (GSSDPResourceBrowser *resource_browser)
                               NULL);
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
-        return priv->target;
+        if (priv->targets->len == 0)
+                return NULL;
+
+        return ((Target *) g_ptr_array_index (priv->targets, 0))->target;
+}
+
+/**
+ * gssdp_resource_browser_add_target:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @target: An additional SSDP search target
+ *
+ * Makes @resource_browser also look for resources matching @target, in
+ * addition to [property@GSSDP.ResourceBrowser:target] and any target added
+ * before. The same version rules apply as for the main target.
+ *
+ * All targets share one cache, so a resource matching several of them is
+ * only reported once. Use
+ * [method@GSSDP.ResourceBrowser.get_resource_targets] to find out which
+ * targets it matched.
+ *
+ * A browser can have at most 64 targets. Targets can only be changed while
+ * the browser is not active.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_add_target (GSSDPResourceBrowser *resource_browser,
+                                   const char           *target)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (target != NULL);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+        g_return_if_fail (!priv->active);
+        g_return_if_fail (priv->targets->len > 0);
+        g_return_if_fail (priv->targets->len < MAX_TARGETS);
+
+        g_ptr_array_add (priv->targets, target_new (target));
+}
+
+/* Drops bit @index from @mask, moving the bits of later targets down */
+static guint64
+mask_remove_index (guint64 mask, guint index)
+{
+        guint64 lower;
+
+        lower = mask & ((G_GUINT64_CONSTANT (1) << index) - 1);
+        if (index + 1 >= MAX_TARGETS)
+                return lower;
+
+        return lower | ((mask >> (index + 1)) << index);
+}
+
+/* Takes the target at @index out of the cache: resources only matching it
+ * go away, all others have their target masks and keys rebuilt */
+static void
+remove_target_index (GSSDPResourceBrowser *resource_browser, guint index)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        GHashTableIter iter;
+        gpointer key, value;
+        GPtrArray *affected;
+        GPtrArray *resources;
+        guint64 bit;
+        guint i;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+        bit = G_GUINT64_CONSTANT (1) << index;
+
+        affected = g_ptr_array_new_with_free_func (g_free);
+        g_hash_table_iter_init (&iter, priv->resources);
+        while (g_hash_table_iter_next (&iter, &key, &value)) {
+                if (((Resource *) value)->targets & bit)
+                        g_ptr_array_add (affected, g_strdup (key));
+        }
+
+        /* Signal while the target is still there */
+        for (i = 0; i < affected->len; i++) {
+                const char *canonical_usn = g_ptr_array_index (affected, i);
+                Resource *resource;
+
+                resource = g_hash_table_lookup (priv->resources,
+                                                canonical_usn);
+                if (resource == NULL)
+                        continue;
+
+                if (resource->targets == bit) {
+                        remove_resource (resource,
+                                         canonical_usn,
+                                         resource->usn);
+                } else {
+                        emit_target_signals (resource_browser,
+                                             resource->usn,
+                                             bit,
+                                             signals[TARGET_UNAVAILABLE]);
+                }
+        }
+        g_ptr_array_unref (affected);
+
+        /* Without a versioned target, the canonical USN may change */
+        resources = g_ptr_array_new ();
+        g_hash_table_iter_init (&iter, priv->resources);
+        while (g_hash_table_iter_next (&iter, &key, &value)) {
+                g_hash_table_iter_steal (&iter);
+                g_free (key);
+                g_ptr_array_add (resources, value);
+        }
+
+        g_ptr_array_remove_index (priv->targets, index);
+
+        for (i = 0; i < resources->len; i++) {
+                Resource *resource = g_ptr_array_index (resources, i);
+
+                resource->targets = mask_remove_index (resource->targets,
+                                                       index);
+                g_hash_table_replace (priv->resources,
+                                      get_canonical_usn (resource_browser,
+                                                         resource->usn,
+                                                         resource->targets),
+                                      resource);
+        }
+        g_ptr_array_unref (resources);
+}
+
+/**
+ * gssdp_resource_browser_remove_target:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @target: A target previously added with
+ * [method@GSSDP.ResourceBrowser.add_target]
+ *
+ * Stops looking for resources matching @target. The main target cannot be
+ * removed, use [method@GSSDP.ResourceBrowser.set_target] to change it.
+ *
+ * Cached resources that only matched @target are reported as unavailable,
+ * all others get [signal@GSSDP.ResourceBrowser::target-unavailable] for
+ * @target.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_remove_target (GSSDPResourceBrowser *resource_browser,
+                                      const char           *target)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        guint i;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (target != NULL);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+        g_return_if_fail (!priv->active);
+
+        for (i = 1; i < priv->targets->len; i++) {
+                Target *t = g_ptr_array_index (priv->targets, i);
+
+                if (g_str_equal (t->target, target)) {
+                        remove_target_index (resource_browser, i);
+
+                        return;
+                }
+        }
+}
+
+static char **
+get_target_list (GSSDPResourceBrowser *resource_browser, guint64 mask)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        GPtrArray *result;
+        guint i;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        result = g_ptr_array_new ();
+        for (i = 0; i < priv->targets->len; i++) {
+                Target *t = g_ptr_array_index (priv->targets, i);
+
+                if (mask & (G_GUINT64_CONSTANT (1) << i))
+                        g_ptr_array_add (result, g_strdup (t->target));
+        }
+        g_ptr_array_add (result, NULL);
+
+        return (char **) g_ptr_array_free (result, FALSE);
+}
+
+/**
+ * gssdp_resource_browser_get_targets:
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get all targets @resource_browser is looking for, the main target first.
+ *
+ * Return value: (transfer full): A %NULL-terminated array of targets.
+ *
+ * Since: 1.8.0
+ **/
+char **
+gssdp_resource_browser_get_targets (GSSDPResourceBrowser *resource_browser)
+{
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser),
+                              NULL);
+
+        return get_target_list (resource_browser, G_MAXUINT64);
+}
+
+/**
+ * gssdp_resource_browser_get_resource_targets:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @usn: The USN of a resource
+ *
+ * Get the targets of @resource_browser the resource @usn matched.
+ *
+ * Return value: (transfer full) (nullable): A %NULL-terminated array of
+ * targets, or %NULL if @usn is not known to @resource_browser.
+ *
+ * Since: 1.8.0
+ **/
+char **
+gssdp_resource_browser_get_resource_targets
+                                (GSSDPResourceBrowser *resource_browser,
+                                 const char           *usn)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        Resource *resource;
+        char *canonical_usn;
+        guint64 mask;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser),
+                              NULL);
+        g_return_val_if_fail (usn != NULL, NULL);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        mask = check_target_compat (resource_browser, get_usn_target (usn));
+        canonical_usn = get_canonical_usn (resource_browser, usn, mask);
+        resource = g_hash_table_lookup (priv->resources, canonical_usn);
+        g_free (canonical_usn);
+
+        if (resource == NULL)
+                return NULL;
+
+        return get_target_list (resource_browser, resource->targets);
 }
 
 /**
@@ -658,704 +1709,3934 @@ gssdp_resource_browser_get_active (GSSDPResourceBrowser *resource_browser)
 }
 
 /**
- * gssdp_resource_browser_rescan:
+ * gssdp_resource_browser_set_discovery_interval:(attributes org.gtk.Method.set_property=discovery-interval):
  * @resource_browser: A #GSSDPResourceBrowser
+ * @interval: The interval between discovery requests, in milliseconds
  *
- * Begins discovery if @resource_browser is active and no discovery is
- * performed. Otherwise does nothing.
+ * Sets the time between two discovery requests of one discovery round. The
+ * interval must be at least 10 milliseconds.
  *
- * Return value: %TRUE if rescaning has been started.
+ * Since: 1.8.0
  **/
-gboolean
-gssdp_resource_browser_rescan (GSSDPResourceBrowser *resource_browser)
+void
+gssdp_resource_browser_set_discovery_interval
+                                (GSSDPResourceBrowser *resource_browser,
+                                 guint                 interval)
 {
         GSSDPResourceBrowserPrivate *priv;
 
-        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser), 0);
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (interval >= MIN_DISCOVERY_INTERVAL);
 
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
-        if (priv->active &&
-            priv->timeout_src == NULL &&
-            priv->refresh_cache_src == NULL) {
-                start_discovery (resource_browser);
-                return TRUE;
-        }
+        if (priv->discovery_interval == interval)
+                return;
 
-        return FALSE;
+        priv->discovery_interval = interval;
+
+        g_object_notify (G_OBJECT (resource_browser), "discovery-interval");
 }
 
-/*
- * Resource expired: Remove
- */
-static gboolean
-resource_expire (gpointer user_data)
-{
-        GSSDPResourceBrowser *resource_browser;
-        GSSDPResourceBrowserPrivate *priv;
-        Resource *resource;
-        char *usn;
+/**
+ * gssdp_resource_browser_get_discovery_interval:(attributes org.gtk.Method.get_property=discovery-interval):
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get the time between two discovery requests of one discovery round.
+ *
+ * Return value: The interval in milliseconds.
+ *
+ * Since: 1.8.0
+ **/
+guint
+gssdp_resource_browser_get_discovery_interval
+                                (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser), 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        return priv->discovery_interval;
+}
+
+/**
+ * gssdp_resource_browser_set_min_discovery_messages:(attributes org.gtk.Method.set_property=min-discovery-messages):
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @min_messages: The number of discovery requests before stopping early
+ *
+ * Sets the number of discovery requests sent per discovery round before
+ * the round may end early because nothing new turned up.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_set_min_discovery_messages
+                                (GSSDPResourceBrowser *resource_browser,
+                                 guint                 min_messages)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (min_messages > 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (priv->min_discovery_messages == min_messages)
+                return;
+
+        priv->min_discovery_messages = min_messages;
+
+        g_object_notify (G_OBJECT (resource_browser),
+                         "min-discovery-messages");
+}
+
+/**
+ * gssdp_resource_browser_get_min_discovery_messages:(attributes org.gtk.Method.get_property=min-discovery-messages):
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get the number of discovery requests sent per discovery round before
+ * the round may end early.
+ *
+ * Return value: The minimum number of discovery requests.
+ *
+ * Since: 1.8.0
+ **/
+guint
+gssdp_resource_browser_get_min_discovery_messages
+                                (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser), 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        return priv->min_discovery_messages;
+}
+
+/**
+ * gssdp_resource_browser_set_max_discovery_messages:(attributes org.gtk.Method.set_property=max-discovery-messages):
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @max_messages: The maximum number of discovery requests per round
+ *
+ * Sets the maximum number of discovery requests sent per discovery round.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_set_max_discovery_messages
+                                (GSSDPResourceBrowser *resource_browser,
+                                 guint                 max_messages)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (max_messages > 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (priv->max_discovery_messages == max_messages)
+                return;
+
+        priv->max_discovery_messages = max_messages;
+
+        g_object_notify (G_OBJECT (resource_browser),
+                         "max-discovery-messages");
+}
+
+/**
+ * gssdp_resource_browser_get_max_discovery_messages:(attributes org.gtk.Method.get_property=max-discovery-messages):
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get the maximum number of discovery requests sent per discovery round.
+ *
+ * Return value: The maximum number of discovery requests.
+ *
+ * Since: 1.8.0
+ **/
+guint
+gssdp_resource_browser_get_max_discovery_messages
+                                (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser), 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        return priv->max_discovery_messages;
+}
+
+/**
+ * gssdp_resource_browser_set_rescan_interval:(attributes org.gtk.Method.set_property=rescan-interval):
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @interval: The initial automatic rescan interval in seconds, or 0
+ *
+ * Sets the interval after which an active @resource_browser starts a new
+ * discovery round on its own. A value of 0 disables automatic rescans.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_set_rescan_interval
+                                (GSSDPResourceBrowser *resource_browser,
+                                 guint                 interval)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (priv->rescan_interval == interval)
+                return;
+
+        priv->rescan_interval = interval;
+        priv->current_rescan_interval = 0;
+
+        /* (Re-)arm the rescan with the new interval, unless a discovery
+         * round is running; that one schedules the rescan when it ends */
+        g_clear_pointer (&priv->rescan_src, g_source_destroy);
+        if (priv->timeout_src == NULL && priv->refresh_cache_src == NULL)
+                schedule_rescan (resource_browser);
+
+        g_object_notify (G_OBJECT (resource_browser), "rescan-interval");
+}
+
+/**
+ * gssdp_resource_browser_get_rescan_interval:(attributes org.gtk.Method.get_property=rescan-interval):
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get the initial automatic rescan interval.
+ *
+ * Return value: The interval in seconds, 0 if automatic rescanning is
+ * disabled.
+ *
+ * Since: 1.8.0
+ **/
+guint
+gssdp_resource_browser_get_rescan_interval
+                                (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser), 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        return priv->rescan_interval;
+}
+
+/**
+ * gssdp_resource_browser_set_max_rescan_interval:(attributes org.gtk.Method.set_property=max-rescan-interval):
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @interval: The maximum automatic rescan interval in seconds
+ *
+ * Sets the upper limit the automatic rescan interval backs off to on a
+ * stable network.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_set_max_rescan_interval
+                                (GSSDPResourceBrowser *resource_browser,
+                                 guint                 interval)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (interval > 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (priv->max_rescan_interval == interval)
+                return;
+
+        priv->max_rescan_interval = interval;
+
+        g_object_notify (G_OBJECT (resource_browser), "max-rescan-interval");
+}
+
+/**
+ * gssdp_resource_browser_get_max_rescan_interval:(attributes org.gtk.Method.get_property=max-rescan-interval):
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get the upper limit of the automatic rescan interval.
+ *
+ * Return value: The interval in seconds.
+ *
+ * Since: 1.8.0
+ **/
+guint
+gssdp_resource_browser_get_max_rescan_interval
+                                (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser), 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        return priv->max_rescan_interval;
+}
+
+/**
+ * gssdp_resource_browser_set_revalidate:(attributes org.gtk.Method.set_property=revalidate):
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @revalidate: %TRUE to probe resources before they expire
+ *
+ * Enables or disables unicast revalidation of cached resources. Only
+ * affects resources announced after the change.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_set_revalidate (GSSDPResourceBrowser *resource_browser,
+                                       gboolean              revalidate)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (priv->revalidate == revalidate)
+                return;
+
+        priv->revalidate = revalidate;
+
+        g_object_notify (G_OBJECT (resource_browser), "revalidate");
+}
+
+/**
+ * gssdp_resource_browser_get_revalidate:(attributes org.gtk.Method.get_property=revalidate):
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get whether cached resources are probed before they expire.
+ *
+ * Return value: %TRUE if unicast revalidation is enabled.
+ *
+ * Since: 1.8.0
+ **/
+gboolean
+gssdp_resource_browser_get_revalidate (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser),
+                              FALSE);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        return priv->revalidate;
+}
+
+/**
+ * gssdp_resource_browser_set_max_revalidation_rate:(attributes org.gtk.Method.set_property=max-revalidation-rate):
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @rate: The maximum number of probes per second
+ *
+ * Limits the number of unicast revalidation probes sent per second.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_set_max_revalidation_rate
+                                (GSSDPResourceBrowser *resource_browser,
+                                 guint                 rate)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (rate > 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (priv->max_revalidation_rate == rate)
+                return;
+
+        priv->max_revalidation_rate = rate;
+
+        g_object_notify (G_OBJECT (resource_browser),
+                         "max-revalidation-rate");
+}
+
+/**
+ * gssdp_resource_browser_get_max_revalidation_rate:(attributes org.gtk.Method.get_property=max-revalidation-rate):
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get the maximum number of unicast revalidation probes sent per second.
+ *
+ * Return value: The maximum number of probes per second.
+ *
+ * Since: 1.8.0
+ **/
+guint
+gssdp_resource_browser_get_max_revalidation_rate
+                                (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser), 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        return priv->max_revalidation_rate;
+}
+
+/**
+ * gssdp_resource_browser_set_grace_period:(attributes org.gtk.Method.set_property=grace-period):
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @grace_period: The grace period in seconds, or 0 to disable
+ *
+ * Sets how long resources that did not answer a discovery round are kept
+ * as suspect before [signal@GSSDP.ResourceBrowser::resource-unavailable]
+ * is emitted for them.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_set_grace_period (GSSDPResourceBrowser *resource_browser,
+                                         guint                 grace_period)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (priv->grace_period == grace_period)
+                return;
+
+        priv->grace_period = grace_period;
+
+        g_object_notify (G_OBJECT (resource_browser), "grace-period");
+}
+
+/**
+ * gssdp_resource_browser_get_grace_period:(attributes org.gtk.Method.get_property=grace-period):
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get how long unresponsive resources are kept as suspect.
+ *
+ * Return value: The grace period in seconds, 0 if disabled.
+ *
+ * Since: 1.8.0
+ **/
+guint
+gssdp_resource_browser_get_grace_period (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser), 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        return priv->grace_period;
+}
+
+/**
+ * gssdp_resource_browser_set_track_location_changes:(attributes org.gtk.Method.set_property=track-location-changes):
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @track: %TRUE to update moved resources in place
+ *
+ * Sets [property@GSSDP.ResourceBrowser:track-location-changes].
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_set_track_location_changes
+                                (GSSDPResourceBrowser *resource_browser,
+                                 gboolean              track)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        track = !!track;
+        if (priv->track_location_changes == track)
+                return;
+
+        priv->track_location_changes = track;
+
+        g_object_notify (G_OBJECT (resource_browser),
+                         "track-location-changes");
+}
+
+/**
+ * gssdp_resource_browser_get_track_location_changes:(attributes org.gtk.Method.get_property=track-location-changes):
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get whether moved resources are updated in place.
+ *
+ * Return value: %TRUE if
+ * [signal@GSSDP.ResourceBrowser::resource-locations-changed] is used for
+ * moved resources.
+ *
+ * Since: 1.8.0
+ **/
+gboolean
+gssdp_resource_browser_get_track_location_changes
+                                (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser),
+                              FALSE);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        return priv->track_location_changes;
+}
+
+/**
+ * gssdp_resource_browser_set_batch_signals:(attributes org.gtk.Method.set_property=batch-signals):
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @batch_signals: %TRUE to report changes in batches
+ *
+ * Enables or disables batched change notification. Changes collected so
+ * far are reported right away when disabling it.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_set_batch_signals
+                                (GSSDPResourceBrowser *resource_browser,
+                                 gboolean              batch_signals)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (priv->batch_signals == batch_signals)
+                return;
+
+        priv->batch_signals = batch_signals;
+        if (!batch_signals)
+                batch_flush (resource_browser);
+
+        g_object_notify (G_OBJECT (resource_browser), "batch-signals");
+}
+
+/**
+ * gssdp_resource_browser_get_batch_signals:(attributes org.gtk.Method.get_property=batch-signals):
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get whether changes are reported in batches.
+ *
+ * Return value: %TRUE if batched change notification is enabled.
+ *
+ * Since: 1.8.0
+ **/
+gboolean
+gssdp_resource_browser_get_batch_signals
+                                (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser),
+                              FALSE);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        return priv->batch_signals;
+}
+
+/**
+ * gssdp_resource_browser_set_batch_interval:(attributes org.gtk.Method.set_property=batch-interval):
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @interval: Time to collect changes for, in milliseconds
+ *
+ * Sets the time to collect changes for before reporting them. Use 0 to
+ * report them once per main loop iteration. Takes effect with the next
+ * batch.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_set_batch_interval
+                                (GSSDPResourceBrowser *resource_browser,
+                                 guint                 interval)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (priv->batch_interval == interval)
+                return;
+
+        priv->batch_interval = interval;
+
+        g_object_notify (G_OBJECT (resource_browser), "batch-interval");
+}
+
+/**
+ * gssdp_resource_browser_get_batch_interval:(attributes org.gtk.Method.get_property=batch-interval):
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Get the time changes are collected for before they are reported.
+ *
+ * Return value: The batch interval in milliseconds.
+ *
+ * Since: 1.8.0
+ **/
+guint
+gssdp_resource_browser_get_batch_interval
+                                (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser), 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        return priv->batch_interval;
+}
+
+/**
+ * gssdp_resource_browser_get_revalidation_stats:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @sent: (out) (optional): Number of probes sent
+ * @suppressed: (out) (optional): Number of times a probe was postponed or
+ * skipped due to [property@GSSDP.ResourceBrowser:max-revalidation-rate]
+ * @answered: (out) (optional): Number of probes that were answered
+ *
+ * Get counters for the unicast revalidation of @resource_browser.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_get_revalidation_stats
+                                (GSSDPResourceBrowser *resource_browser,
+                                 guint                *sent,
+                                 guint                *suppressed,
+                                 guint                *answered)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (sent != NULL)
+                *sent = priv->n_revalidations_sent;
+
+        if (suppressed != NULL)
+                *suppressed = priv->n_revalidations_suppressed;
+
+        if (answered != NULL)
+                *answered = priv->n_revalidations_answered;
+}
+
+/**
+ * gssdp_resource_browser_add_source_filter:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @cidr: A network in CIDR notation, such as `192.168.1.0/24`
+ * @error: Return location for a #GError, or %NULL
+ *
+ * Only accept resources announced from an address in @cidr. If several
+ * networks are added, resources from any of them are accepted.
+ *
+ * Like all filters, this is applied before resources are added to the
+ * cache, so rejected resources cause no signal emission. Resources that
+ * are already cached are not affected.
+ *
+ * Return value: %TRUE if @cidr could be parsed.
+ *
+ * Since: 1.8.0
+ **/
+gboolean
+gssdp_resource_browser_add_source_filter
+                                (GSSDPResourceBrowser *resource_browser,
+                                 const char           *cidr,
+                                 GError              **error)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        GInetAddressMask *mask;
+        GInetAddress *address;
+        SourceFilter *filter;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser),
+                              FALSE);
+        g_return_val_if_fail (cidr != NULL, FALSE);
+        g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        mask = g_inet_address_mask_new_from_string (cidr, error);
+        if (mask == NULL)
+                return FALSE;
+
+        address = g_inet_address_mask_get_address (mask);
+        filter = g_new0 (SourceFilter, 1);
+        filter->size = g_inet_address_get_native_size (address);
+        filter->length = g_inet_address_mask_get_length (mask);
+        memcpy (filter->bytes,
+                g_inet_address_to_bytes (address),
+                filter->size);
+        g_object_unref (mask);
+
+        g_ptr_array_add (priv->source_filters, filter);
+
+        return TRUE;
+}
+
+/**
+ * gssdp_resource_browser_add_usn_prefix_filter:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @prefix: A USN prefix, such as the start of a vendor's UUIDs
+ *
+ * Only accept resources whose USN starts with @prefix. If several prefixes
+ * are added, resources matching any of them are accepted.
+ *
+ * See [method@GSSDP.ResourceBrowser.add_source_filter] for how filters are
+ * applied.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_add_usn_prefix_filter
+                                (GSSDPResourceBrowser *resource_browser,
+                                 const char           *prefix)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (prefix != NULL);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        g_ptr_array_add (priv->usn_filters, g_strdup (prefix));
+}
+
+/**
+ * gssdp_resource_browser_add_server_filter:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @substring: A part of the Server header
+ *
+ * Only accept resources whose Server header contains @substring. If several
+ * substrings are added, resources matching any of them are accepted.
+ *
+ * See [method@GSSDP.ResourceBrowser.add_source_filter] for how filters are
+ * applied.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_add_server_filter
+                                (GSSDPResourceBrowser *resource_browser,
+                                 const char           *substring)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (substring != NULL);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        g_ptr_array_add (priv->server_filters, g_strdup (substring));
+}
+
+/**
+ * gssdp_resource_browser_add_location_host_filter:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @host: A host name or IP address, without brackets for IPv6
+ *
+ * Only accept resources with at least one location on @host. If several
+ * hosts are added, resources on any of them are accepted.
+ *
+ * See [method@GSSDP.ResourceBrowser.add_source_filter] for how filters are
+ * applied.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_add_location_host_filter
+                                (GSSDPResourceBrowser *resource_browser,
+                                 const char           *host)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (host != NULL);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        g_ptr_array_add (priv->location_host_filters, g_strdup (host));
+}
+
+/**
+ * gssdp_resource_browser_clear_filters:
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Removes all filters, so that every resource matching the targets of
+ * @resource_browser is accepted again.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_browser_clear_filters (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        g_ptr_array_set_size (priv->source_filters, 0);
+        g_ptr_array_set_size (priv->usn_filters, 0);
+        g_ptr_array_set_size (priv->server_filters, 0);
+        g_ptr_array_set_size (priv->location_host_filters, 0);
+}
+
+/**
+ * gssdp_resource_browser_rescan:
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Begins discovery if @resource_browser is active and no discovery is
+ * performed. Otherwise does nothing.
+ *
+ * Return value: %TRUE if rescaning has been started.
+ **/
+gboolean
+gssdp_resource_browser_rescan (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser), 0);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (priv->active &&
+            priv->timeout_src == NULL &&
+            priv->refresh_cache_src == NULL) {
+                priv->current_rescan_interval = 0;
+                start_discovery (resource_browser);
+                return TRUE;
+        }
+
+        return FALSE;
+}
+
+static void
+cache_append_uint32 (GByteArray *data, guint32 value)
+{
+        value = GUINT32_TO_LE (value);
+        g_byte_array_append (data, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+cache_append_int64 (GByteArray *data, gint64 value)
+{
+        value = GINT64_TO_LE (value);
+        g_byte_array_append (data, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+cache_append_string (GByteArray *data, const char *value)
+{
+        guint32 len = strlen (value);
+
+        cache_append_uint32 (data, len);
+        g_byte_array_append (data, (const guint8 *) value, len);
+}
+
+static void
+cache_append_resource (G_GNUC_UNUSED gpointer key,
+                       gpointer               value,
+                       gpointer               user_data)
+{
+        Resource *resource = value;
+        GByteArray *data = user_data;
+        GList *l;
+
+        cache_append_int64 (data, resource->expires);
+        cache_append_uint32 (data, (guint32) resource->boot_id);
+        cache_append_uint32 (data, (guint32) resource->config_id);
+        cache_append_string (data,
+                             resource->host_ip ? resource->host_ip : "");
+        cache_append_string (data, resource->usn);
+        cache_append_uint32 (data, g_list_length (resource->locations));
+        for (l = resource->locations; l != NULL; l = l->next)
+                cache_append_string (data, l->data);
+}
+
+/**
+ * gssdp_resource_browser_save_cache:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @path: (type filename): The file to write the snapshot to
+ * @error: Return location for a #GError, or %NULL
+ *
+ * Writes the resources currently known to @resource_browser, including
+ * their locations, expiry time, boot-id, config-id and the address they
+ * were last heard from, to @path.
+ *
+ * The file can be loaded with [method@GSSDP.ResourceBrowser.load_cache]
+ * after a restart to make the resources available again without waiting
+ * for them to re-announce themselves. The file is replaced atomically.
+ *
+ * Return value: %TRUE on success, %FALSE if @error was set.
+ *
+ * Since: 1.8.0
+ **/
+gboolean
+gssdp_resource_browser_save_cache (GSSDPResourceBrowser *resource_browser,
+                                   const char           *path,
+                                   GError              **error)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        GByteArray *data;
+        gboolean result;
+        guint i;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser),
+                              FALSE);
+        g_return_val_if_fail (path != NULL, FALSE);
+        g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        data = g_byte_array_new ();
+        g_byte_array_append (data,
+                             (const guint8 *) CACHE_FILE_MAGIC,
+                             sizeof (CACHE_FILE_MAGIC));
+        cache_append_uint32 (data, CACHE_FILE_VERSION);
+        cache_append_uint32 (data, priv->targets->len);
+        for (i = 0; i < priv->targets->len; i++) {
+                Target *t = g_ptr_array_index (priv->targets, i);
+
+                cache_append_string (data, t->target);
+        }
+        cache_append_uint32 (data, g_hash_table_size (priv->resources));
+        g_hash_table_foreach (priv->resources, cache_append_resource, data);
+
+        result = g_file_set_contents (path,
+                                      (const char *) data->data,
+                                      data->len,
+                                      error);
+        g_byte_array_unref (data);
+
+        return result;
+}
+
+typedef struct {
+        const char *data;
+        gsize       len;
+        gsize       offset;
+} CacheReader;
+
+static gboolean
+cache_read_uint32 (CacheReader *reader, guint32 *value)
+{
+        if (reader->len - reader->offset < sizeof (*value))
+                return FALSE;
+
+        memcpy (value, reader->data + reader->offset, sizeof (*value));
+        *value = GUINT32_FROM_LE (*value);
+        reader->offset += sizeof (*value);
+
+        return TRUE;
+}
+
+static gboolean
+cache_read_int64 (CacheReader *reader, gint64 *value)
+{
+        if (reader->len - reader->offset < sizeof (*value))
+                return FALSE;
+
+        memcpy (value, reader->data + reader->offset, sizeof (*value));
+        *value = GINT64_FROM_LE (*value);
+        reader->offset += sizeof (*value);
+
+        return TRUE;
+}
+
+/* Returns a pointer into the mapped file, not nul-terminated */
+static gboolean
+cache_read_string (CacheReader *reader, const char **value, guint32 *len)
+{
+        if (!cache_read_uint32 (reader, len))
+                return FALSE;
+
+        if (reader->len - reader->offset < *len)
+                return FALSE;
+
+        *value = reader->data + reader->offset;
+        reader->offset += *len;
+
+        return TRUE;
+}
+
+typedef struct {
+        gint64  expires;
+        guint32 boot_id;
+        guint32 config_id;
+        char   *host_ip; /* %NULL if unknown */
+        char   *usn;
+        GList  *locations;
+} CacheEntry;
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+        g_free (entry->host_ip);
+        g_free (entry->usn);
+        g_list_free_full (entry->locations, g_free);
+        g_slice_free (CacheEntry, entry);
+}
+
+/* Reads an entry written in file format @version */
+static gboolean
+cache_read_entry (CacheReader *reader, guint32 version, CacheEntry **entry)
+{
+        CacheEntry *e;
+        const char *str;
+        guint32 len;
+        guint32 n_locations;
+        guint32 i;
+
+        e = g_slice_new0 (CacheEntry);
+        e->config_id = (guint32) -1;
+        *entry = e;
+
+        if (!cache_read_int64 (reader, &e->expires) ||
+            !cache_read_uint32 (reader, &e->boot_id))
+                return FALSE;
+
+        if (version >= 3) {
+                if (!cache_read_uint32 (reader, &e->config_id) ||
+                    !cache_read_string (reader, &str, &len))
+                        return FALSE;
+
+                if (len > 0)
+                        e->host_ip = g_strndup (str, len);
+        }
+
+        if (!cache_read_string (reader, &str, &len))
+                return FALSE;
+
+        e->usn = g_strndup (str, len);
+
+        if (!cache_read_uint32 (reader, &n_locations))
+                return FALSE;
+
+        for (i = 0; i < n_locations; i++) {
+                if (!cache_read_string (reader, &str, &len))
+                        return FALSE;
+
+                e->locations = g_list_prepend (e->locations,
+                                               g_strndup (str, len));
+        }
+        e->locations = g_list_reverse (e->locations);
+
+        return TRUE;
+}
+
+static gboolean
+has_target (GSSDPResourceBrowser *resource_browser, const char *target)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        guint i;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        for (i = 0; i < priv->targets->len; i++) {
+                Target *t = g_ptr_array_index (priv->targets, i);
+
+                if (g_str_equal (t->target, target))
+                        return TRUE;
+        }
+
+        return FALSE;
+}
+
+/**
+ * gssdp_resource_browser_load_cache:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @path: (type filename): The file to read the snapshot from
+ * @error: Return location for a #GError, or %NULL
+ *
+ * Loads a snapshot previously written with
+ * [method@GSSDP.ResourceBrowser.save_cache] for the same target.
+ *
+ * Additional targets stored in the snapshot that @resource_browser does
+ * not look for yet are added to it, unless it is already active.
+ *
+ * All resources from the snapshot that have not expired yet and are not
+ * already known are added to the cache with their remaining lifetime and
+ * announced using [signal@GSSDP.ResourceBrowser::resource-available]. They
+ * are then treated like any other cached resource, so those that do not
+ * answer the next discovery round are removed again.
+ *
+ * The whole file is checked before anything is added, so nothing changes
+ * if loading fails. Snapshots written by older versions of GSSDP are
+ * loaded without the config-id and the address the resources were heard
+ * from.
+ *
+ * Return value: %TRUE on success, %FALSE if @error was set.
+ *
+ * Since: 1.8.0
+ **/
+gboolean
+gssdp_resource_browser_load_cache (GSSDPResourceBrowser *resource_browser,
+                                   const char           *path,
+                                   GError              **error)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        GMappedFile *file;
+        CacheReader reader;
+        const char *str;
+        guint32 len;
+        guint32 version;
+        guint32 n_targets;
+        guint32 n_resources;
+        guint32 i;
+        gint64 now;
+        const char *target;
+        GPtrArray *targets = NULL;
+        GPtrArray *entries = NULL;
+        gboolean result = FALSE;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser),
+                              FALSE);
+        g_return_val_if_fail (path != NULL, FALSE);
+        g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        file = g_mapped_file_new (path, FALSE, error);
+        if (file == NULL)
+                return FALSE;
+
+        reader.data = g_mapped_file_get_contents (file);
+        reader.len = g_mapped_file_get_length (file);
+        reader.offset = sizeof (CACHE_FILE_MAGIC);
+
+        if (reader.len < sizeof (CACHE_FILE_MAGIC) ||
+            memcmp (reader.data,
+                    CACHE_FILE_MAGIC,
+                    sizeof (CACHE_FILE_MAGIC)) != 0 ||
+            !cache_read_uint32 (&reader, &version)) {
+                g_set_error (error,
+                             GSSDP_ERROR,
+                             GSSDP_ERROR_FAILED,
+                             "%s is not a resource cache file",
+                             path);
+
+                goto out;
+        }
+
+        if (version < CACHE_FILE_MIN_VERSION ||
+            version > CACHE_FILE_VERSION) {
+                g_set_error (error,
+                             GSSDP_ERROR,
+                             GSSDP_ERROR_FAILED,
+                             "Unsupported resource cache version %u",
+                             version);
+
+                goto out;
+        }
+
+        if (!cache_read_uint32 (&reader, &n_targets))
+                goto truncated;
+
+        if (n_targets == 0 || n_targets > MAX_TARGETS) {
+                g_set_error (error,
+                             GSSDP_ERROR,
+                             GSSDP_ERROR_FAILED,
+                             "Resource cache file %s is corrupt",
+                             path);
+
+                goto out;
+        }
+
+        targets = g_ptr_array_new_with_free_func (g_free);
+        for (i = 0; i < n_targets; i++) {
+                if (!cache_read_string (&reader, &str, &len))
+                        goto truncated;
+
+                g_ptr_array_add (targets, g_strndup (str, len));
+        }
+
+        target = gssdp_resource_browser_get_target (resource_browser);
+        if (!g_str_equal (target, g_ptr_array_index (targets, 0))) {
+                g_set_error (error,
+                             GSSDP_ERROR,
+                             GSSDP_ERROR_FAILED,
+                             "Resource cache was created for a different "
+                             "target");
+
+                goto out;
+        }
+
+        if (!cache_read_uint32 (&reader, &n_resources))
+                goto truncated;
+
+        /* Read everything first, so a broken file does not leave half of
+         * its resources behind */
+        entries = g_ptr_array_new_with_free_func
+                                        ((GDestroyNotify) cache_entry_free);
+        for (i = 0; i < n_resources; i++) {
+                CacheEntry *entry;
+                gboolean complete;
+
+                complete = cache_read_entry (&reader, version, &entry);
+                g_ptr_array_add (entries, entry);
+                if (!complete)
+                        goto truncated;
+        }
+
+        if (!priv->active) {
+                for (i = 1; i < targets->len; i++) {
+                        const char *t = g_ptr_array_index (targets, i);
+
+                        if (priv->targets->len < MAX_TARGETS &&
+                            !has_target (resource_browser, t))
+                                g_ptr_array_add (priv->targets,
+                                                 target_new (t));
+                }
+        }
+
+        now = g_get_real_time ();
+
+        for (i = 0; i < entries->len; i++) {
+                CacheEntry *entry = g_ptr_array_index (entries, i);
+                Resource *resource;
+                gint64 remaining;
+                guint64 mask;
+                char *canonical_usn;
+
+                /* Skip stale and bogus entries. max-age is parsed as an
+                 * int, so nothing valid lives longer than G_MAXINT seconds */
+                if (entry->expires <= now)
+                        continue;
+
+                remaining = (entry->expires - now) / G_USEC_PER_SEC;
+                if (remaining < 1 || remaining > G_MAXINT)
+                        continue;
+
+                if (entry->locations == NULL)
+                        continue;
+
+                mask = check_target_compat (resource_browser,
+                                            get_usn_target (entry->usn));
+                if (mask == 0)
+                        continue;
+
+                /* Skip entries we already heard about */
+                canonical_usn = get_canonical_usn (resource_browser,
+                                                   entry->usn,
+                                                   mask);
+                if (g_hash_table_contains (priv->resources, canonical_usn)) {
+                        g_free (canonical_usn);
+
+                        continue;
+                }
+
+                resource = g_slice_new (Resource);
+                resource->resource_browser = resource_browser;
+                resource->usn              = g_steal_pointer (&entry->usn);
+                resource->locations        =
+                                        g_steal_pointer (&entry->locations);
+                resource->expires          = entry->expires;
+                resource->last_seen        = 0;
+                resource->boot_id          = (gint32) entry->boot_id;
+                resource->config_id        = (gint32) entry->config_id;
+                resource->host_ip          = g_steal_pointer (&entry->host_ip);
+                resource->revalidate_src   = NULL;
+                resource->suspect          = FALSE;
+                resource->targets          = mask;
+                resource_set_timeout (resource, (guint) remaining);
+
+                g_hash_table_insert (priv->resources, canonical_usn, resource);
+                resource_index_add (resource);
+
+                emit_resource_available (resource, resource->usn);
+        }
+
+        result = TRUE;
+        goto out;
+
+truncated:
+        g_set_error (error,
+                     GSSDP_ERROR,
+                     GSSDP_ERROR_FAILED,
+                     "Resource cache file %s is truncated",
+                     path);
+out:
+        g_clear_pointer (&entries, g_ptr_array_unref);
+        g_clear_pointer (&targets, g_ptr_array_unref);
+        g_mapped_file_unref (file);
+
+        return result;
+}
+
+/*
+ * Resource expired: Remove
+ */
+static gboolean
+resource_expire (gpointer user_data)
+{
+        GSSDPResourceBrowser *resource_browser;
+        Resource *resource;
+        char *canonical_usn;
+
+        resource = user_data;
+        resource_browser = resource->resource_browser;
+
+        canonical_usn = get_canonical_usn (resource_browser,
+                                           resource->usn,
+                                           resource->targets);
+
+        remove_resource (resource, canonical_usn, resource->usn);
+        g_free (canonical_usn);
+
+        return FALSE;
+}
+
+/* Calculates the lifetime of an announcement */
+static guint
+get_max_age (SoupMessageHeaders *headers)
+{
+        const char *header;
+        guint timeout;
+
+        header = soup_message_headers_get_one (headers, "Cache-Control");
+        if (header) {
+                GSList *list;
+                int res;
+
+                res = 0;
+
+                for (list = soup_header_parse_list (header);
+                     list;
+                     list = list->next) {
+                        res = sscanf (list->data,
+                                      "max-age = %d",
+                                      &timeout);
+                        if (res == 1)
+                                break;
+                }
+
+                if (res != 1) {
+                        g_warning ("Invalid 'Cache-Control' header. Assuming "
+                                   "default max-age of %d.\n"
+                                   "Header was:\n%s",
+                                   SSDP_DEFAULT_MAX_AGE,
+                                   header);
+
+                        timeout = SSDP_DEFAULT_MAX_AGE;
+                }
+
+                soup_header_free_list (list);
+        } else {
+                const char *expires;
+
+                expires = soup_message_headers_get_one (headers, "Expires");
+                if (expires) {
+                        GDateTime *exp_time;
+
+                        exp_time = soup_date_time_new_from_http_string (expires);
+                        GDateTime *now = g_date_time_new_now_local ();
+
+                        if (g_date_time_compare (now, exp_time) == 1)
+                                timeout = g_date_time_difference (now, exp_time) / 1000 / 1000;
+                        else {
+                                g_warning ("Invalid 'Expires' header. Assuming "
+                                           "default max-age of %d.\n"
+                                           "Header was:\n%s",
+                                           SSDP_DEFAULT_MAX_AGE,
+                                           expires);
+
+                                timeout = SSDP_DEFAULT_MAX_AGE;
+                        }
+                        g_date_time_unref (exp_time);
+                        g_date_time_unref (now);
+                } else {
+                        g_warning ("No 'Cache-Control' nor any 'Expires' "
+                                   "header was specified. Assuming default "
+                                   "max-age of %d.", SSDP_DEFAULT_MAX_AGE);
+
+                        timeout = SSDP_DEFAULT_MAX_AGE;
+                }
+        }
+
+        return timeout;
+}
+
+/* Returns the device part of @usn, i.e. uuid:device-UUID */
+static char *
+get_device_uuid (const char *usn)
+{
+        const char *end;
+
+        end = strstr (usn, "::");
+        if (end == NULL)
+                return g_strdup (usn);
+
+        return g_strndup (usn, end - usn);
+}
+
+/* Asks the device of @resource whether it is still there. UDA 1.1 devices
+ * get a unicast M-SEARCH to the host they were announced from, all others
+ * a multicast one for their UUID. If the rate limit is hit, the probe is
+ * retried in the next second as long as the device could still answer
+ * before the entry expires. */
+static void
+probe_resource (Resource *resource)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        char *uuid;
+        gint64 now;
+        gint64 remaining;
+
+        priv = gssdp_resource_browser_get_instance_private
+                                        (resource->resource_browser);
+
+        uuid = get_device_uuid (resource->usn);
+
+        /* Another resource of this device already asked */
+        if (g_hash_table_contains (priv->revalidations, uuid)) {
+                g_free (uuid);
+
+                return;
+        }
+
+        now = g_get_monotonic_time () / G_USEC_PER_SEC;
+        if (now != priv->revalidation_second) {
+                priv->revalidation_second = now;
+                priv->revalidation_tokens = priv->max_revalidation_rate;
+        }
+
+        if (priv->revalidation_tokens == 0) {
+                priv->n_revalidations_suppressed++;
+                g_free (uuid);
+
+                remaining = (resource->expires - g_get_real_time ()) /
+                            G_USEC_PER_SEC;
+                if (remaining <= (gint64) priv->mx + 1)
+                        return;
+
+                g_clear_pointer (&resource->revalidate_src, g_source_destroy);
+
+                now = g_get_monotonic_time () % G_USEC_PER_SEC;
+                resource->revalidate_src = g_timeout_source_new
+                                ((G_USEC_PER_SEC - now) / 1000 + 1);
+                g_source_set_callback (resource->revalidate_src,
+                                       resource_revalidate,
+                                       resource, NULL);
+
+                g_source_attach (resource->revalidate_src,
+                                 g_main_context_get_thread_default ());
+
+                g_source_unref (resource->revalidate_src);
+
+                return;
+        }
+
+        priv->revalidation_tokens--;
+
+        if (resource->host_ip != NULL && resource->boot_id >= 0) {
+                char *dest;
+                char *message;
+
+                if (strchr (resource->host_ip, ':'))
+                        dest = g_strdup_printf ("[%s]", resource->host_ip);
+                else
+                        dest = g_strdup (resource->host_ip);
+
+                message = g_strdup_printf
+                                (SSDP_UNICAST_DISCOVERY_REQUEST,
+                                 dest,
+                                 uuid,
+                                 gssdp_client_get_server_id (priv->client));
+
+                _gssdp_client_send_message (priv->client,
+                                            resource->host_ip,
+                                            0,
+                                            message,
+                                            _GSSDP_DISCOVERY_REQUEST);
+                g_free (dest);
+                g_free (message);
+        } else {
+                _gssdp_client_queue_search (priv->client, uuid, priv->mx);
+        }
+
+        priv->n_revalidations_sent++;
+
+        g_hash_table_add (priv->revalidations, uuid);
+}
+
+static gboolean
+resource_revalidate (gpointer user_data)
+{
+        Resource *resource = user_data;
+
+        resource->revalidate_src = NULL;
+        probe_resource (resource);
+
+        return FALSE;
+}
+
+static void
+resource_set_timeout (Resource *resource, guint timeout)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        guint lead;
+
+        priv = gssdp_resource_browser_get_instance_private
+                                        (resource->resource_browser);
+
+        resource->timeout_src = g_timeout_source_new_seconds (timeout);
+        g_source_set_callback (resource->timeout_src,
+                               resource_expire,
+                               resource, NULL);
+
+        g_source_attach (resource->timeout_src,
+                         g_main_context_get_thread_default ());
+
+        g_source_unref (resource->timeout_src);
+
+        g_clear_pointer (&resource->revalidate_src, g_source_destroy);
+
+        /* Only UDA 1.1 devices are required to answer unicast searches */
+        if (!priv->revalidate ||
+            resource->host_ip == NULL ||
+            resource->boot_id < 0)
+                return;
+
+        /* Leave the device some time to answer before the entry expires */
+        lead = MAX (timeout / 10, MAX (MIN_REVALIDATION_LEAD,
+                                       (guint) priv->mx + 1));
+        if (timeout <= lead)
+                return;
+
+        resource->revalidate_src = g_timeout_source_new_seconds (timeout - lead);
+        g_source_set_callback (resource->revalidate_src,
+                               resource_revalidate,
+                               resource, NULL);
+
+        g_source_attach (resource->revalidate_src,
+                         g_main_context_get_thread_default ());
+
+        g_source_unref (resource->revalidate_src);
+}
+
+/* Builds the list of locations from the Location and AL headers */
+static GList *
+parse_locations (SoupMessageHeaders *headers)
+{
+        GList *locations = NULL;
+        const char *header;
+
+        header = soup_message_headers_get_one (headers, "Location");
+        if (header)
+                locations = g_list_append (locations, g_strdup (header));
+
+        header = soup_message_headers_get_one (headers, "AL");
+        if (header) {
+                /* Parse AL header. The format is:
+                 * <uri1><uri2>... */
+                const char *start, *end;
+                char *uri;
+
+                start = header;
+                while ((start = strchr (start, '<'))) {
+                        start += 1;
+                        if (!start || !*start)
+                                break;
+
+                        end = strchr (start, '>');
+                        if (!end || !*end)
+                                break;
+
+                        uri = g_strndup (start, end - start);
+                        locations = g_list_append (locations, uri);
+
+                        start = end;
+                }
+        }
+
+        return locations;
+}
+
+/* Returns the value of a numeric UDA 1.1 header such as BOOTID.UPNP.ORG,
+ * or -1 if it is missing or invalid */
+static gint32
+get_header_int32 (SoupMessageHeaders *headers, const char *name)
+{
+        const char *header;
+        gint64 out;
+
+        header = soup_message_headers_get_one (headers, name);
+        if (header == NULL)
+                return -1;
+
+        if (!g_ascii_string_to_signed (header, 10, 0, G_MAXINT32, &out, NULL))
+                return -1;
+
+        return out;
+}
+
+static gboolean
+has_string_match (GPtrArray  *filters,
+                  const char *value,
+                  gboolean    prefix)
+{
+        guint i;
+
+        for (i = 0; i < filters->len; i++) {
+                const char *filter = g_ptr_array_index (filters, i);
+
+                if (prefix ? g_str_has_prefix (value, filter)
+                           : strstr (value, filter) != NULL)
+                        return TRUE;
+        }
+
+        return FALSE;
+}
+
+static gboolean
+source_filter_matches (const SourceFilter *filter,
+                       const guint8       *bytes,
+                       gsize               size)
+{
+        guint whole;
+        guint rest;
+        guint8 mask;
+
+        if (size != filter->size)
+                return FALSE;
+
+        whole = filter->length / 8;
+        rest = filter->length % 8;
+
+        if (memcmp (bytes, filter->bytes, whole) != 0)
+                return FALSE;
+
+        if (rest == 0)
+                return TRUE;
+
+        mask = (guint8) (0xff << (8 - rest));
+
+        return (bytes[whole] & mask) == (filter->bytes[whole] & mask);
+}
+
+/* Whether the host of the @size bytes long @location is one of the
+ * location host filters */
+static gboolean
+location_host_matches (GSSDPResourceBrowserPrivate *priv,
+                       const char                  *location,
+                       gsize                        size)
+{
+        const char *host;
+        gsize length;
+        guint i;
+
+        host = get_location_host (location, size, &length);
+        if (host == NULL)
+                return FALSE;
+
+        for (i = 0; i < priv->location_host_filters->len; i++) {
+                const char *filter;
+
+                filter = g_ptr_array_index (priv->location_host_filters, i);
+                if (strlen (filter) == length &&
+                    g_ascii_strncasecmp (host, filter, length) == 0)
+                        return TRUE;
+        }
+
+        return FALSE;
+}
+
+/* Filters of the same kind are alternatives, all kinds in use have to
+ * match. Only the raw headers are looked at, so that filtered messages
+ * cost no allocations; the cheap string checks come first. The
+ * locations are scanned the same way parse_locations() splits them. */
+static gboolean
+check_filters (GSSDPResourceBrowser *resource_browser,
+               const char           *from_ip,
+               SoupMessageHeaders   *headers)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        const char *header;
+        gboolean ret;
+        guint i;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (priv->usn_filters->len > 0) {
+                header = soup_message_headers_get_one (headers, "USN");
+                if (header == NULL ||
+                    !has_string_match (priv->usn_filters, header, TRUE))
+                        return FALSE;
+        }
+
+        if (priv->server_filters->len > 0) {
+                header = soup_message_headers_get_one (headers, "Server");
+                if (header == NULL ||
+                    !has_string_match (priv->server_filters, header, FALSE))
+                        return FALSE;
+        }
+
+        if (priv->source_filters->len > 0) {
+                guint8 bytes[16];
+                gsize size;
+
+                size = gssdp_socket_parse_address (from_ip, bytes);
+                if (size == 0)
+                        return FALSE;
+
+                ret = FALSE;
+                for (i = 0; !ret && i < priv->source_filters->len; i++)
+                        ret = source_filter_matches
+                                (g_ptr_array_index (priv->source_filters, i),
+                                 bytes,
+                                 size);
+
+                if (!ret)
+                        return FALSE;
+        }
+
+        if (priv->location_host_filters->len > 0) {
+                header = soup_message_headers_get_one (headers, "Location");
+                ret = header != NULL &&
+                      location_host_matches (priv, header, strlen (header));
+
+                header = soup_message_headers_get_one (headers, "AL");
+                if (!ret && header != NULL) {
+                        const char *start, *end;
+
+                        start = header;
+                        while (!ret && (start = strchr (start, '<'))) {
+                                start += 1;
+
+                                end = strchr (start, '>');
+                                if (end == NULL)
+                                        break;
+
+                                ret = location_host_matches (priv,
+                                                             start,
+                                                             end - start);
+                                start = end;
+                        }
+                }
+
+                if (!ret)
+                        return FALSE;
+        }
+
+        return TRUE;
+}
+
+/* Compares the locations the way an announcement is checked against the
+ * cache: only as many as both lists have */
+static gboolean
+locations_differ (GList *locations, GList *cached)
+{
+        for (; locations && cached;
+             locations = locations->next, cached = cached->next) {
+                if (strcmp ((const char *) locations->data,
+                            (const char *) cached->data) != 0)
+                        return TRUE;
+        }
+
+        return FALSE;
+}
+
+static void
+resource_replace_locations (Resource *resource, GList *locations)
+{
+        resource_index_remove (resource);
+        g_list_free_full (resource->locations, g_free);
+        resource->locations = locations;
+        resource_index_add (resource);
+}
+
+/* Creates a resource for @usn and adds it to the cache under
+ * @canonical_usn. Takes ownership of @canonical_usn and @locations. */
+static Resource *
+resource_new (GSSDPResourceBrowser *resource_browser,
+              char                 *canonical_usn,
+              const char           *usn,
+              GList                *locations,
+              guint64               targets)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        Resource *resource;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        resource = g_slice_new (Resource);
+
+        resource->resource_browser = resource_browser;
+        resource->usn              = g_strdup (usn);
+        resource->locations        = locations;
+        resource->boot_id          = -1;
+        resource->config_id        = -1;
+        resource->host_ip          = NULL;
+        resource->timeout_src      = NULL;
+        resource->revalidate_src   = NULL;
+        resource->suspect          = FALSE;
+        resource->targets          = targets;
+
+        g_hash_table_insert (priv->resources, canonical_usn, resource);
+        resource_index_add (resource);
+
+        priv->num_new_resources++;
+        priv->cache_changed = TRUE;
+
+        return resource;
+}
+
+/* Updates @resource from an announcement or search response sent by
+ * @from_ip and restarts its expiry timeout */
+static void
+resource_refresh (Resource           *resource,
+                  const char         *from_ip,
+                  SoupMessageHeaders *headers)
+{
+        guint timeout;
+        gint32 boot_id;
+        gint32 config_id;
+
+        g_clear_pointer (&resource->timeout_src, g_source_destroy);
+        resource->suspect = FALSE;
+
+        /* Calculate new timeout */
+        timeout = get_max_age (headers);
+
+        boot_id = get_header_int32 (headers, "BOOTID.UPNP.ORG");
+        if (boot_id >= 0)
+                resource->boot_id = boot_id;
+
+        config_id = get_header_int32 (headers, "CONFIGID.UPNP.ORG");
+        if (config_id >= 0)
+                resource->config_id = config_id;
+
+        if (g_strcmp0 (resource->host_ip, from_ip) != 0) {
+                g_free (resource->host_ip);
+                resource->host_ip = g_strdup (from_ip);
+        }
+
+        resource->last_seen = g_get_real_time ();
+        resource->expires = resource->last_seen +
+                            (gint64) timeout * G_USEC_PER_SEC;
+        resource_set_timeout (resource, timeout);
+}
+
+/* Handles the answer to a unicast probe: the device is still alive, so
+ * refresh all of its cached resources like an announcement would */
+static void
+revalidation_response (GSSDPResourceBrowser *resource_browser,
+                       const char           *from_ip,
+                       const char           *uuid,
+                       SoupMessageHeaders   *headers)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        GHashTableIter iter;
+        gpointer key, value;
+        GPtrArray *keys;
+        GList *locations;
+        gsize len;
+        guint i;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        g_hash_table_remove (priv->revalidations, uuid);
+        priv->n_revalidations_answered++;
+
+        if (!check_filters (resource_browser, from_ip, headers))
+                return;
+
+        locations = parse_locations (headers);
+        if (!locations)
+                return; /* No location specified */
+
+        /* Collect first, signal handlers may change the cache */
+        keys = g_ptr_array_new_with_free_func (g_free);
+        len = strlen (uuid);
+
+        g_hash_table_iter_init (&iter, priv->resources);
+        while (g_hash_table_iter_next (&iter, &key, &value)) {
+                Resource *resource = value;
+                guint64 targets;
+
+                if (strncmp (resource->usn, uuid, len) != 0 ||
+                    (resource->usn[len] != '\0' &&
+                     !g_str_has_prefix (resource->usn + len, "::")))
+                        continue;
+
+                targets = check_target_compat (resource_browser,
+                                               get_usn_target (resource->usn));
+                if ((targets & resource->targets) == 0)
+                        continue;
+
+                g_ptr_array_add (keys, g_strdup (key));
+        }
+
+        for (i = 0; i < keys->len; i++) {
+                const char *canonical_usn = g_ptr_array_index (keys, i);
+                Resource *resource;
+                gboolean locations_changed = FALSE;
+
+                resource = g_hash_table_lookup (priv->resources,
+                                                canonical_usn);
+                if (resource == NULL)
+                        continue;
+
+                if (priv->fresh_resources != NULL)
+                        g_hash_table_add (priv->fresh_resources,
+                                          g_strdup (canonical_usn));
+
+                if (locations_differ (locations, resource->locations) &&
+                    !priv->track_location_changes) {
+                        guint64 targets = resource->targets;
+                        char *usn = g_strdup (resource->usn);
+
+                        /* Report it as gone and back at the new place */
+                        remove_resource (resource, canonical_usn, usn);
+                        resource = resource_new
+                                (resource_browser,
+                                 g_strdup (canonical_usn),
+                                 usn,
+                                 g_list_copy_deep (locations,
+                                                   (GCopyFunc) g_strdup,
+                                                   NULL),
+                                 targets);
+                        g_free (usn);
+
+                        resource_refresh (resource, from_ip, headers);
+                        emit_resource_available (resource, resource->usn);
+
+                        continue;
+                }
+
+                if (locations_differ (locations, resource->locations)) {
+                        resource_replace_locations
+                                (resource,
+                                 g_list_copy_deep (locations,
+                                                   (GCopyFunc) g_strdup,
+                                                   NULL));
+                        locations_changed = TRUE;
+                }
+
+                resource_refresh (resource, from_ip, headers);
+
+                if (locations_changed)
+                        emit_resource_locations_changed (resource,
+                                                         resource->usn);
+        }
+
+        g_ptr_array_unref (keys);
+        g_list_free_full (locations, g_free);
+}
+
+static void
+resource_available (GSSDPResourceBrowser *resource_browser,
+                    const char           *from_ip,
+                    guint64               targets,
+                    SoupMessageHeaders   *headers)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        const char *usn;
+        Resource *resource;
+        gboolean was_cached;
+        GList *locations;
+        gboolean destroyLocations;
+        gboolean locations_changed = FALSE;
+        guint64 new_targets = 0;
+        char *canonical_usn;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+        usn = soup_message_headers_get_one (headers, "USN");
+        if (!usn)
+                return; /* No USN specified */
+
+        if (!check_filters (resource_browser, from_ip, headers))
+                return;
+
+        /* Build list of locations */
+        locations = parse_locations (headers);
+        destroyLocations = TRUE;
+
+        if (!locations)
+                return; /* No location specified */
+
+        canonical_usn = get_canonical_usn (resource_browser, usn, targets);
+
+        /* Get from cache, if possible */
+        resource = g_hash_table_lookup (priv->resources,
+                                        canonical_usn);
+        /* Put usn into fresh resources, so this resource will not be
+         * removed on cache refreshing. */
+        if (priv->fresh_resources != NULL) {
+                g_hash_table_add (priv->fresh_resources,
+                                  g_strdup (canonical_usn));
+        }
+
+        /* The resource moved, e.g. after a DHCP renewal. Unless it is to be
+         * updated in place, expect that we missed its byebye packet */
+        if (resource && locations_differ (locations, resource->locations)) {
+                if (priv->track_location_changes) {
+                        resource_replace_locations (resource, locations);
+                        destroyLocations = FALSE;
+                        locations_changed = TRUE;
+                } else {
+                        remove_resource (resource, canonical_usn, usn);
+                        resource = NULL;
+                }
+        }
+
+        if (resource) {
+                new_targets = targets & ~resource->targets;
+                resource->targets |= targets;
+
+                was_cached = TRUE;
+        } else {
+                /* Create new Resource data structure */
+                resource = resource_new (resource_browser,
+                                         canonical_usn,
+                                         usn,
+                                         locations,
+                                         targets);
+                destroyLocations = FALSE; /* Ownership passed to resource */
+                was_cached = FALSE;
+
+                /* hash-table takes ownership of this */
+                canonical_usn = NULL;
+        }
+
+        g_free (canonical_usn);
+
+        resource_refresh (resource, from_ip, headers);
+
+        /* Only continue with signal emission if this resource was not
+         * cached already */
+        if (!was_cached) {
+                /* Emit signal */
+                emit_resource_available (resource, usn);
+        } else {
+                if (locations_changed)
+                        emit_resource_locations_changed (resource, usn);
+
+                emit_target_signals (resource_browser,
+                                     usn,
+                                     new_targets,
+                                     signals[TARGET_AVAILABLE]);
+        }
+        /* Cleanup */
+        if (destroyLocations)
+                g_list_free_full (locations, g_free);
+}
+
+static void
+resource_update (GSSDPResourceBrowser *resource_browser,
+                 guint64               targets,
+                 SoupMessageHeaders   *headers)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        const char *usn;
+        const char *boot_id_header;
+        const char *next_boot_id_header;
+        char *canonical_usn;
+        Resource *resource;
+        guint boot_id;
+        guint next_boot_id;
+        gint64 out;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+        usn = soup_message_headers_get_one (headers, "USN");
+        boot_id_header = soup_message_headers_get_one (headers, "BOOTID.UPNP.ORG");
+        next_boot_id_header = soup_message_headers_get_one (headers, "NEXTBOOTID.UPNP.ORG");
+
+        if (!usn)
+                return; /* No USN specified */
+
+        if (!boot_id_header)
+                return;
+
+        if (!next_boot_id_header)
+                return;
+
+        if (!g_ascii_string_to_signed (boot_id_header, 10, 0, G_MAXINT32, &out, NULL))
+                return;
+        boot_id = out;
+
+        if (!g_ascii_string_to_signed (next_boot_id_header, 10, 0, G_MAXINT32, &out, NULL))
+                return;
+        next_boot_id = out;
+
+        canonical_usn = get_canonical_usn (resource_browser, usn, targets);
+
+        /* Only continue if we know about this. if not, there will be an
+         * announcement afterwards anyway */
+        resource = g_hash_table_lookup (priv->resources, canonical_usn);
+        if (!resource)
+                goto out;
+
+        resource->boot_id = next_boot_id;
+
+        if (priv->batch_signals) {
+                batch_record (resource, signals[RESOURCE_UPDATE]);
+
+                goto out;
+        }
+
+        g_signal_emit (resource_browser,
+                       signals[RESOURCE_UPDATE],
+                       0,
+                       usn,
+                       boot_id,
+                       next_boot_id);
+out:
+        g_free (canonical_usn);
+
+}
+
+static void
+resource_unavailable (GSSDPResourceBrowser *resource_browser,
+                      guint64               targets,
+                      SoupMessageHeaders   *headers)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        const char *usn;
         char *canonical_usn;
+        Resource *resource;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+        usn = soup_message_headers_get_one (headers, "USN");
+        if (!usn)
+                return; /* No USN specified */
+
+        canonical_usn = get_canonical_usn (resource_browser, usn, targets);
+
+        /* Only process if we were cached */
+        resource = g_hash_table_lookup (priv->resources, canonical_usn);
+        if (!resource)
+                goto out;
+
+        remove_resource (resource, canonical_usn, usn);
+
+out:
+        g_free (canonical_usn);
+}
+
+static gboolean
+target_matches (Target *target, const char *st)
+{
+        GMatchInfo *info;
+        int         version;
+        char       *tmp;
+
+        if (g_str_equal (target->target, GSSDP_ALL_RESOURCES))
+                return TRUE;
+
+        if (target->target_regex == NULL)
+                return FALSE;
+
+        /* Most messages are about something else entirely, so avoid running
+         * the regex for them */
+        if (target->literal != NULL) {
+                if (strstr (st, target->literal) == NULL)
+                        return FALSE;
+
+                if (target->version == 0)
+                        return TRUE;
+        }
+
+        if (!g_regex_match (target->target_regex,
+                            st,
+                            0,
+                            &info)) {
+                g_match_info_free (info);
+
+                return FALSE;
+        }
+
+        /* If there was no version to match, we're done */
+        if (target->version == 0) {
+                g_match_info_free (info);
+
+                return TRUE;
+        }
+
+        if (g_match_info_get_match_count (info) != 2) {
+                g_match_info_free (info);
+
+                return FALSE;
+        }
+
+        version = atoi ((tmp = g_match_info_fetch (info, 1)));
+        g_free (tmp);
+        g_match_info_free (info);
+
+        if (version < 0) {
+            return FALSE;
+        }
+
+        return (guint) version >= target->version;
+}
+
+/* Returns the mask of all targets matching @st */
+static guint64
+check_target_compat (GSSDPResourceBrowser *resource_browser,
+                     const char           *st)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        guint64 mask = 0;
+        guint i;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        for (i = 0; i < priv->targets->len; i++) {
+                if (target_matches (g_ptr_array_index (priv->targets, i), st))
+                        mask |= G_GUINT64_CONSTANT (1) << i;
+        }
+
+        return mask;
+}
+
+static void
+received_discovery_response (GSSDPResourceBrowser *resource_browser,
+                             const char           *from_ip,
+                             SoupMessageHeaders   *headers)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        const char *st;
+        guint64 targets;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        st = soup_message_headers_get_one (headers, "ST");
+        if (!st)
+                return; /* No target specified */
+
+        if (g_hash_table_contains (priv->revalidations, st)) {
+                revalidation_response (resource_browser,
+                                       from_ip,
+                                       st,
+                                       headers);
+
+                return;
+        }
+
+        targets = check_target_compat (resource_browser, st);
+        if (targets == 0)
+                return; /* Target doesn't match */
+
+        resource_available (resource_browser, from_ip, targets, headers);
+}
+
+static void
+received_announcement (GSSDPResourceBrowser *resource_browser,
+                       const char           *from_ip,
+                       SoupMessageHeaders   *headers)
+{
+        const char *header;
+        guint64 targets;
+
+        header = soup_message_headers_get_one (headers, "NT");
+        if (!header)
+                return; /* No target specified */
+
+        targets = check_target_compat (resource_browser, header);
+        if (targets == 0)
+                return; /* Target doesn't match */
+
+        header = soup_message_headers_get_one (headers, "NTS");
+        if (!header)
+                return; /* No announcement type specified */
+
+        /* Check announcement type */
+        if      (strncmp (header,
+                          SSDP_ALIVE_NTS,
+                          strlen (SSDP_ALIVE_NTS)) == 0)
+                resource_available (resource_browser,
+                                    from_ip,
+                                    targets,
+                                    headers);
+        else if (strncmp (header,
+                          SSDP_BYEBYE_NTS,
+                          strlen (SSDP_BYEBYE_NTS)) == 0)
+                resource_unavailable (resource_browser, targets, headers);
+        else if (strncmp (header,
+                          SSDP_UPDATE_NTS,
+                          strlen (SSDP_UPDATE_NTS)) == 0)
+                resource_update (resource_browser, targets, headers);
+}
+
+/*
+ * Received a message
+ */
+static void
+message_received_cb (G_GNUC_UNUSED GSSDPClient *client,
+                     const char                *from_ip,
+                     G_GNUC_UNUSED gushort      from_port,
+                     _GSSDPMessageType          type,
+                     SoupMessageHeaders        *headers,
+                     gpointer                   user_data)
+{
+        GSSDPResourceBrowser *resource_browser;
+        GSSDPResourceBrowserPrivate *priv;
+
+        resource_browser = GSSDP_RESOURCE_BROWSER (user_data);
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+        if (!priv->active)
+                return;
+
+        switch (type) {
+        case _GSSDP_DISCOVERY_RESPONSE:
+                received_discovery_response (resource_browser,
+                                             from_ip,
+                                             headers);
+                break;
+        case _GSSDP_ANNOUNCEMENT:
+                received_announcement (resource_browser, from_ip, headers);
+                break;
+        case _GSSDP_DISCOVERY_REQUEST:
+                /* Should not happend */
+                break;
+        default:
+                break;
+        }
+}
+
+/* Finds the host part of the first @size bytes of @location, without
+ * brackets for IPv6. Returns a pointer into @location and the length of the
+ * host in @length, or %NULL if there is no host. */
+static const char *
+get_location_host (const char *location, gsize size, gsize *length)
+{
+        const char *start, *end, *at, *host_end;
+
+        start = g_strstr_len (location, size, "://");
+        if (start == NULL)
+                return NULL;
+        start += 3;
+
+        end = start;
+        while (end < location + size && strchr ("/?#", *end) == NULL)
+                end++;
+
+        /* Skip user info */
+        at = memchr (start, '@', end - start);
+        while (at != NULL) {
+                start = at + 1;
+                at = memchr (start, '@', end - start);
+        }
+
+        if (*start == '[') {
+                start++;
+                host_end = memchr (start, ']', end - start);
+                if (host_end == NULL)
+                        return NULL;
+        } else {
+                host_end = memchr (start, ':', end - start);
+                if (host_end == NULL)
+                        host_end = end;
+        }
+
+        if (host_end == start)
+                return NULL;
+
+        *length = host_end - start;
+
+        return start;
+}
+
+static void
+resource_index_add (Resource *resource)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        GList *l;
+
+        priv = gssdp_resource_browser_get_instance_private
+                                        (resource->resource_browser);
+
+        for (l = resource->locations; l != NULL; l = l->next) {
+                GPtrArray *hosted;
+                const char *start;
+                gsize length;
+                char *host;
+
+                start = get_location_host (l->data,
+                                           strlen (l->data),
+                                           &length);
+                if (start == NULL)
+                        continue;
+
+                host = g_strndup (start, length);
+                hosted = g_hash_table_lookup (priv->resources_by_host, host);
+                if (hosted == NULL) {
+                        hosted = g_ptr_array_new ();
+                        g_hash_table_insert (priv->resources_by_host,
+                                             host,
+                                             hosted);
+                        host = NULL;
+                }
+
+                if (!g_ptr_array_find (hosted, resource, NULL))
+                        g_ptr_array_add (hosted, resource);
+
+                g_free (host);
+        }
+}
+
+static void
+resource_index_remove (Resource *resource)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        GList *l;
+
+        priv = gssdp_resource_browser_get_instance_private
+                                        (resource->resource_browser);
+
+        for (l = resource->locations; l != NULL; l = l->next) {
+                GPtrArray *hosted;
+                const char *start;
+                gsize length;
+                char *host;
+
+                start = get_location_host (l->data,
+                                           strlen (l->data),
+                                           &length);
+                if (start == NULL)
+                        continue;
+
+                host = g_strndup (start, length);
+                hosted = g_hash_table_lookup (priv->resources_by_host, host);
+                if (hosted != NULL &&
+                    g_ptr_array_remove_fast (hosted, resource) &&
+                    hosted->len == 0)
+                        g_hash_table_remove (priv->resources_by_host, host);
+
+                g_free (host);
+        }
+}
+
+/*
+ * Free a Resource structure and its contained data
+ */
+static void
+resource_free (Resource *resource)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        char *uuid;
+
+        priv = gssdp_resource_browser_get_instance_private
+                                        (resource->resource_browser);
+
+        /* Whatever dropped the resource, a probe for its device is moot */
+        uuid = get_device_uuid (resource->usn);
+        g_hash_table_remove (priv->revalidations, uuid);
+        g_free (uuid);
+
+        resource_index_remove (resource);
+        g_free (resource->usn);
+        g_free (resource->host_ip);
+        g_source_destroy (resource->timeout_src);
+        g_clear_pointer (&resource->revalidate_src, g_source_destroy);
+        g_list_free_full (resource->locations, g_free);
+        g_slice_free (Resource, resource);
+}
+
+static gboolean
+clear_cache_helper (G_GNUC_UNUSED gpointer key,
+                    gpointer               value,
+                    G_GNUC_UNUSED gpointer data)
+{
+        Resource *resource;
+
+        resource = value;
+
+        emit_resource_unavailable (resource, resource->usn);
+
+        return TRUE;
+}
+
+/*
+ * Clears the cached resources hash
+ */
+static void
+clear_cache (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        /* Clear cache */
+        g_hash_table_foreach_remove (priv->resources,
+                                     clear_cache_helper,
+                                     NULL);
+        g_hash_table_remove_all (priv->revalidations);
+}
+
+/* Sends discovery request */
+static void
+send_discovery_request (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        guint i;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        /* The client merges this with the requests of other browsers */
+        for (i = 0; i < priv->targets->len; i++) {
+                Target *target = g_ptr_array_index (priv->targets, i);
+
+                _gssdp_client_queue_search (priv->client,
+                                            target->target,
+                                            priv->mx);
+        }
+}
+
+/*
+ * Time in milliseconds to wait after the @num_discovery th request of a
+ * round. The first requests go out in quick succession; after that, the
+ * answers to a request get the full MX time to arrive before deciding
+ * whether to send another one.
+ */
+static guint
+get_discovery_delay (GSSDPResourceBrowser *resource_browser,
+                     guint                 num_discovery)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (num_discovery < priv->min_discovery_messages)
+                return priv->discovery_interval;
+
+        return MAX (priv->discovery_interval, (guint) priv->mx * 1000);
+}
+
+static void
+schedule_discovery_timeout (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        priv->timeout_src = g_timeout_source_new
+                        (get_discovery_delay (resource_browser,
+                                              priv->num_discovery));
+        g_source_set_callback (priv->timeout_src,
+                               discovery_timeout,
+                               resource_browser, NULL);
+
+        g_source_attach (priv->timeout_src,
+                         g_main_context_get_thread_default ());
+
+        g_source_unref (priv->timeout_src);
+}
+
+/* The discovery round is over, drop whatever did not answer a bit later */
+static void
+finish_discovery (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        priv->timeout_src = NULL;
+        priv->num_discovery = 0;
+
+        /* Setup cache refreshing */
+        priv->refresh_cache_src =
+                          g_timeout_source_new_seconds (RESCAN_TIMEOUT);
+        g_source_set_callback
+                             (priv->refresh_cache_src,
+                              refresh_cache,
+                              resource_browser,
+                              NULL);
+        g_source_attach (priv->refresh_cache_src,
+                         g_main_context_get_thread_default ());
+        g_source_unref (priv->refresh_cache_src);
+}
 
-        resource = user_data;
-        resource_browser = resource->resource_browser;
+static gboolean
+discovery_timeout (gpointer data)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        GSSDPResourceBrowser *resource_browser;
+
+        resource_browser = GSSDP_RESOURCE_BROWSER (data);
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
-        /* Steal the USN pointer from the resource as we need it for the signal
-         * emission.
-         */
-        usn = g_steal_pointer (&resource->usn);
+        /* Keep searching as long as the last request turned up something
+         * new, stop once the network has converged */
+        if (priv->num_discovery >= priv->min_discovery_messages &&
+            priv->num_new_resources == 0) {
+                finish_discovery (resource_browser);
+
+                return FALSE;
+        }
 
-        if (priv->version > 0) {
-                char *version;
+        priv->num_new_resources = 0;
+        send_discovery_request (resource_browser);
 
-                version = g_strrstr (usn, ":");
-                canonical_usn = g_strndup (usn, version - usn);
-        } else {
-                canonical_usn = g_strdup (usn);
+        priv->num_discovery += 1;
+
+        if (priv->num_discovery >= priv->max_discovery_messages)
+                finish_discovery (resource_browser);
+        else
+                schedule_discovery_timeout (resource_browser);
+
+        return FALSE;
+}
+
+/* Starts sending discovery requests */
+static void
+start_discovery (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        g_clear_pointer (&priv->rescan_src, g_source_destroy);
+
+        /* Setup a set of responsive resources for cache refreshing */
+        priv->fresh_resources = g_hash_table_new_full
+                                        (g_str_hash,
+                                         g_str_equal,
+                                         g_free,
+                                         NULL);
+
+        /* Send one now */
+        priv->num_new_resources = 0;
+        priv->cache_changed = FALSE;
+        send_discovery_request (resource_browser);
+
+        /* And schedule the rest for later */
+        priv->num_discovery = 1;
+        if (priv->num_discovery >= priv->max_discovery_messages)
+                finish_discovery (resource_browser);
+        else
+                schedule_discovery_timeout (resource_browser);
+}
+
+/* Stops the sending of discovery messages */
+static void
+stop_discovery (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+        if (priv->timeout_src) {
+                priv->num_discovery = 0;
         }
 
-        g_hash_table_remove (priv->resources, canonical_usn);
+        g_clear_pointer (&priv->timeout_src, g_source_destroy);
+        g_clear_pointer (&priv->refresh_cache_src, g_source_destroy);
+        g_clear_pointer (&priv->fresh_resources, g_hash_table_destroy);
+        g_clear_pointer (&priv->rescan_src, g_source_destroy);
+        priv->current_rescan_interval = 0;
+}
 
-        g_signal_emit (resource_browser,
-                       signals[RESOURCE_UNAVAILABLE],
-                       0,
-                       usn);
-        g_free (usn);
-        g_free (canonical_usn);
+static gboolean
+rescan_timeout (gpointer data)
+{
+        GSSDPResourceBrowser *resource_browser;
+        GSSDPResourceBrowserPrivate *priv;
+
+        resource_browser = GSSDP_RESOURCE_BROWSER (data);
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        priv->rescan_src = NULL;
+        start_discovery (resource_browser);
 
         return FALSE;
 }
 
+/* Schedules the next automatic discovery round, backing off exponentially
+ * while the network does not change */
 static void
-resource_available (GSSDPResourceBrowser *resource_browser,
-                    SoupMessageHeaders   *headers)
+schedule_rescan (GSSDPResourceBrowser *resource_browser)
 {
         GSSDPResourceBrowserPrivate *priv;
-        const char *usn;
-        const char *header;
+
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+
+        if (!priv->active || priv->rescan_interval == 0)
+                return;
+
+        if (priv->current_rescan_interval == 0 || priv->cache_changed)
+                priv->current_rescan_interval = priv->rescan_interval;
+        else if (priv->current_rescan_interval <= G_MAXUINT / 2)
+                priv->current_rescan_interval *= 2;
+
+        priv->current_rescan_interval =
+                MIN (priv->current_rescan_interval,
+                     MAX (priv->max_rescan_interval, priv->rescan_interval));
+
+        priv->rescan_src =
+                g_timeout_source_new_seconds (priv->current_rescan_interval);
+        g_source_set_callback (priv->rescan_src,
+                               rescan_timeout,
+                               resource_browser,
+                               NULL);
+        g_source_attach (priv->rescan_src,
+                         g_main_context_get_thread_default ());
+        g_source_unref (priv->rescan_src);
+}
+
+static gboolean
+refresh_cache_helper (gpointer key, gpointer value, gpointer data)
+{
         Resource *resource;
-        gboolean was_cached;
-        guint timeout;
+        GHashTable *fresh_resources;
+
+        resource = value;
+        fresh_resources = data;
+
+        if (g_hash_table_contains (fresh_resources, key))
+                return FALSE;
+        else {
+                GSSDPResourceBrowserPrivate *priv;
+
+                priv = gssdp_resource_browser_get_instance_private
+                                        (resource->resource_browser);
+
+                /* Already waiting for its grace period to end */
+                if (resource->suspect)
+                        return FALSE;
+
+                if (priv->grace_period > 0) {
+                        resource->suspect = TRUE;
+                        g_source_destroy (resource->timeout_src);
+                        resource->expires = g_get_real_time () +
+                                            (gint64) priv->grace_period *
+                                            G_USEC_PER_SEC;
+                        resource_set_timeout (resource, priv->grace_period);
+                        probe_resource (resource);
+
+                        return FALSE;
+                }
+
+                priv->cache_changed = TRUE;
+
+                emit_resource_unavailable (resource, resource->usn);
+
+                return TRUE;
+        }
+}
+
+/* Removes non-responsive resources */
+static gboolean
+refresh_cache (gpointer data)
+{
+        GSSDPResourceBrowser *resource_browser;
+        GSSDPResourceBrowserPrivate *priv;
+
+        resource_browser = GSSDP_RESOURCE_BROWSER (data);
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+        g_hash_table_foreach_remove (priv->resources,
+                                     refresh_cache_helper,
+                                     priv->fresh_resources);
+        g_hash_table_unref (priv->fresh_resources);
+        priv->fresh_resources = NULL;
+        priv->refresh_cache_src = NULL;
+
+        schedule_rescan (resource_browser);
+
+        return FALSE;
+}
+
+typedef struct {
+        GSSDPResourceBrowser *resource_browser;
+        GHashTable *found; /* canonical USN → GSSDPResourceInfo */
+        gulong message_received_id;
+        GSource *search_src;
+        GSource *quiet_src;
+        GSource *deadline_src;
+        GSource *cancel_src;
+        guint num_discovery;
+        guint num_new_resources;
+} DiscoverData;
+
+static void
+discover_data_free (DiscoverData *data)
+{
+        g_hash_table_destroy (data->found);
+        g_slice_free (DiscoverData, data);
+}
+
+/* Drops everything that ties the task to the client and main loop */
+static void
+discover_cleanup (GTask *task)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        DiscoverData *data;
+
+        data = g_task_get_task_data (task);
+        priv = gssdp_resource_browser_get_instance_private
+                                        (data->resource_browser);
+
+        g_clear_signal_handler (&data->message_received_id, priv->client);
+        g_clear_pointer (&data->search_src, g_source_destroy);
+        g_clear_pointer (&data->quiet_src, g_source_destroy);
+        g_clear_pointer (&data->deadline_src, g_source_destroy);
+        g_clear_pointer (&data->cancel_src, g_source_destroy);
+}
+
+static void
+discover_complete (GTask *task)
+{
+        DiscoverData *data;
+        GPtrArray *result;
+        GHashTableIter iter;
+        gpointer value;
+
+        data = g_task_get_task_data (task);
+        discover_cleanup (task);
+
+        result = g_ptr_array_new_full
+                        (g_hash_table_size (data->found),
+                         (GDestroyNotify) gssdp_resource_info_unref);
+        g_hash_table_iter_init (&iter, data->found);
+        while (g_hash_table_iter_next (&iter, NULL, &value))
+                g_ptr_array_add (result, gssdp_resource_info_ref (value));
+
+        g_task_return_pointer (task,
+                               result,
+                               (GDestroyNotify) g_ptr_array_unref);
+        g_object_unref (task);
+}
+
+static gboolean
+discover_quiet_timeout (gpointer user_data)
+{
+        GTask *task = G_TASK (user_data);
+        DiscoverData *data;
+
+        data = g_task_get_task_data (task);
+        data->quiet_src = NULL;
+        discover_complete (task);
+
+        return FALSE;
+}
+
+/* (Re-)starts the timer that finishes the task once no new resources have
+ * shown up for MX seconds */
+static void
+discover_schedule_quiet (GTask *task)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        DiscoverData *data;
+
+        data = g_task_get_task_data (task);
+        priv = gssdp_resource_browser_get_instance_private
+                                        (data->resource_browser);
+
+        g_clear_pointer (&data->quiet_src, g_source_destroy);
+        data->quiet_src = g_timeout_source_new_seconds (MAX (priv->mx, 1));
+        g_source_set_callback (data->quiet_src,
+                               discover_quiet_timeout,
+                               task,
+                               NULL);
+        g_source_attach (data->quiet_src, g_task_get_context (task));
+        g_source_unref (data->quiet_src);
+}
+
+static gboolean
+discover_search_timeout (gpointer user_data);
+
+static void
+discover_schedule_search (GTask *task)
+{
+        DiscoverData *data;
+
+        data = g_task_get_task_data (task);
+
+        data->search_src = g_timeout_source_new
+                        (get_discovery_delay (data->resource_browser,
+                                              data->num_discovery));
+        g_source_set_callback (data->search_src,
+                               discover_search_timeout,
+                               task,
+                               NULL);
+        g_source_attach (data->search_src, g_task_get_context (task));
+        g_source_unref (data->search_src);
+}
+
+static gboolean
+discover_search_timeout (gpointer user_data)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        GTask *task = G_TASK (user_data);
+        DiscoverData *data;
+
+        data = g_task_get_task_data (task);
+        priv = gssdp_resource_browser_get_instance_private
+                                        (data->resource_browser);
+
+        data->search_src = NULL;
+
+        /* Same convergence rule as the continuous discovery */
+        if (data->num_discovery >= priv->min_discovery_messages &&
+            data->num_new_resources == 0) {
+                discover_schedule_quiet (task);
+
+                return FALSE;
+        }
+
+        data->num_new_resources = 0;
+        send_discovery_request (data->resource_browser);
+        data->num_discovery += 1;
+
+        if (data->num_discovery >= priv->max_discovery_messages)
+                discover_schedule_quiet (task);
+        else
+                discover_schedule_search (task);
+
+        return FALSE;
+}
+
+static gboolean
+discover_deadline_timeout (gpointer user_data)
+{
+        GTask *task = G_TASK (user_data);
+        DiscoverData *data;
+
+        data = g_task_get_task_data (task);
+        data->deadline_src = NULL;
+        discover_complete (task);
+
+        return FALSE;
+}
+
+static gboolean
+discover_cancelled (G_GNUC_UNUSED GCancellable *cancellable,
+                    gpointer                    user_data)
+{
+        GTask *task = G_TASK (user_data);
+        DiscoverData *data;
+
+        data = g_task_get_task_data (task);
+        data->cancel_src = NULL;
+        discover_cleanup (task);
+
+        g_task_return_error_if_cancelled (task);
+        g_object_unref (task);
+
+        return FALSE;
+}
+
+static void
+discover_resource_available (GTask              *task,
+                             const char         *from_ip,
+                             guint64             targets,
+                             SoupMessageHeaders *headers)
+{
+        DiscoverData *data;
+        const char *usn;
         GList *locations;
-        gboolean destroyLocations;
-        GList *it1, *it2;
         char *canonical_usn;
+        gint64 now;
+        GSSDPResourceInfo *info;
+
+        data = g_task_get_task_data (task);
 
-        priv = gssdp_resource_browser_get_instance_private (resource_browser);
         usn = soup_message_headers_get_one (headers, "USN");
         if (!usn)
                 return; /* No USN specified */
 
-        /* Build list of locations */
-        locations = NULL;
-        destroyLocations = TRUE;
+        if (!check_filters (data->resource_browser, from_ip, headers))
+                return;
 
-        header = soup_message_headers_get_one (headers, "Location");
-        if (header)
-                locations = g_list_append (locations, g_strdup (header));
+        locations = parse_locations (headers);
+        if (!locations)
+                return; /* No location specified */
 
-        header = soup_message_headers_get_one (headers, "AL");
-        if (header) {
-                /* Parse AL header. The format is:
-                 * <uri1><uri2>... */
-                const char *start, *end;
-                char *uri;
+        canonical_usn = get_canonical_usn (data->resource_browser,
+                                           usn,
+                                           targets);
+        if (!g_hash_table_contains (data->found, canonical_usn)) {
+                data->num_new_resources++;
 
-                start = header;
-                while ((start = strchr (start, '<'))) {
-                        start += 1;
-                        if (!start || !*start)
-                                break;
+                /* Still trickling in after the last search, keep waiting */
+                if (data->quiet_src != NULL)
+                        discover_schedule_quiet (task);
+        }
 
-                        end = strchr (start, '>');
-                        if (!end || !*end)
-                                break;
+        now = g_get_real_time ();
+        info = _gssdp_resource_info_new
+                        (usn,
+                         locations,
+                         from_ip,
+                         now + (gint64) get_max_age (headers) * G_USEC_PER_SEC,
+                         now,
+                         get_header_int32 (headers, "BOOTID.UPNP.ORG"),
+                         get_header_int32 (headers, "CONFIGID.UPNP.ORG"));
+        g_hash_table_replace (data->found, canonical_usn, info);
+
+        g_list_free_full (locations, g_free);
+}
 
-                        uri = g_strndup (start, end - start);
-                        locations = g_list_append (locations, uri);
+static void
+discover_message_received_cb (G_GNUC_UNUSED GSSDPClient *client,
+                              const char                *from_ip,
+                              G_GNUC_UNUSED gushort      from_port,
+                              _GSSDPMessageType          type,
+                              SoupMessageHeaders        *headers,
+                              gpointer                   user_data)
+{
+        GTask *task = G_TASK (user_data);
+        DiscoverData *data;
+        const char *header;
+        const char *usn;
+        char *canonical_usn;
+        guint64 targets;
 
-                        start = end;
+        data = g_task_get_task_data (task);
+
+        switch (type) {
+        case _GSSDP_DISCOVERY_RESPONSE:
+                header = soup_message_headers_get_one (headers, "ST");
+                if (!header)
+                        return;
+
+                targets = check_target_compat (data->resource_browser, header);
+                if (targets != 0)
+                        discover_resource_available (task,
+                                                     from_ip,
+                                                     targets,
+                                                     headers);
+                break;
+        case _GSSDP_ANNOUNCEMENT:
+                header = soup_message_headers_get_one (headers, "NT");
+                if (!header)
+                        return;
+
+                targets = check_target_compat (data->resource_browser, header);
+                if (targets == 0)
+                        return;
+
+                header = soup_message_headers_get_one (headers, "NTS");
+                if (!header)
+                        return;
+
+                if (strncmp (header,
+                             SSDP_ALIVE_NTS,
+                             strlen (SSDP_ALIVE_NTS)) == 0) {
+                        discover_resource_available (task,
+                                                     from_ip,
+                                                     targets,
+                                                     headers);
+                } else if (strncmp (header,
+                                    SSDP_BYEBYE_NTS,
+                                    strlen (SSDP_BYEBYE_NTS)) == 0) {
+                        usn = soup_message_headers_get_one (headers, "USN");
+                        if (!usn)
+                                return;
+
+                        canonical_usn = get_canonical_usn
+                                                (data->resource_browser,
+                                                 usn,
+                                                 targets);
+                        g_hash_table_remove (data->found, canonical_usn);
+                        g_free (canonical_usn);
                 }
+                break;
+        case _GSSDP_DISCOVERY_REQUEST:
+        default:
+                break;
         }
+}
 
-        if (!locations)
-                return; /* No location specified */
+/**
+ * gssdp_resource_browser_discover_async:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @timeout: Deadline for the discovery in milliseconds, or 0 for none
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: (scope async): Function to call when the discovery is done
+ * @user_data: (closure): User data for @callback
+ *
+ * Performs a single discovery run for the targets of @resource_browser and
+ * collects the resources that answer.
+ *
+ * Search requests are sent the same way as during continuous discovery,
+ * see [method@GSSDP.ResourceBrowser.set_discovery_interval] and
+ * [method@GSSDP.ResourceBrowser.set_max_discovery_messages]. The operation
+ * finishes once searching has stopped and no new resource showed up for the
+ * search's MX time, or when @timeout elapses, whichever comes first.
+ *
+ * This works independently of [property@GSSDP.ResourceBrowser:active]; the
+ * resources found are not added to the cache of @resource_browser and no
+ * timers are left running once the operation has finished.
+ *
+ * Since: 1.8.0
+ */
+void
+gssdp_resource_browser_discover_async (GSSDPResourceBrowser *resource_browser,
+                                       guint                 timeout,
+                                       GCancellable         *cancellable,
+                                       GAsyncReadyCallback   callback,
+                                       gpointer              user_data)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        DiscoverData *data;
+        GTask *task;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (cancellable == NULL ||
+                          G_IS_CANCELLABLE (cancellable));
 
-        if (priv->version > 0) {
-                char *version;
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
-                version = g_strrstr (usn, ":");
-                canonical_usn = g_strndup (usn, version - usn);
-        } else {
-                canonical_usn = g_strdup (usn);
-        }
+        task = g_task_new (resource_browser, cancellable, callback, user_data);
+        g_task_set_source_tag (task, gssdp_resource_browser_discover_async);
 
-        /* Get from cache, if possible */
-        resource = g_hash_table_lookup (priv->resources,
-                                        canonical_usn);
-        /* Put usn into fresh resources, so this resource will not be
-         * removed on cache refreshing. */
-        if (priv->fresh_resources != NULL) {
-                g_hash_table_add (priv->fresh_resources,
-                                  g_strdup (canonical_usn));
-        }
+        if (g_task_return_error_if_cancelled (task)) {
+                g_object_unref (task);
 
-        /* If location does not match, expect that we missed bye bye packet */
-        if (resource) {
-                for (it1 = locations, it2 = resource->locations;
-                     it1 && it2;
-                     it1 = it1->next, it2 = it2->next) {
-                        if (strcmp ((const char *) it1->data,
-                                    (const char *) it2->data) != 0) {
-                               resource_unavailable (resource_browser, headers);
-                               /* Will be destroyed by resource_unavailable */
-                               resource = NULL;
-
-                               break;
-                        }
-                }
+                return;
         }
 
-        if (resource) {
-                /* Remove old timeout */
-                g_source_destroy (resource->timeout_src);
-
-                was_cached = TRUE;
-        } else {
-                /* Create new Resource data structure */
-                resource = g_slice_new (Resource);
+        data = g_slice_new0 (DiscoverData);
+        data->resource_browser = resource_browser;
+        data->found = g_hash_table_new_full
+                        (g_str_hash,
+                         g_str_equal,
+                         g_free,
+                         (GDestroyNotify) gssdp_resource_info_unref);
+        g_task_set_task_data (task,
+                              data,
+                              (GDestroyNotify) discover_data_free);
+
+        data->message_received_id =
+                g_signal_connect_object (priv->client,
+                                         "message-received",
+                                         G_CALLBACK
+                                                (discover_message_received_cb),
+                                         task,
+                                         0);
 
-                resource->resource_browser = resource_browser;
-                resource->usn              = g_strdup (usn);
-                resource->locations        = locations;
-                destroyLocations = FALSE; /* Ownership passed to resource */
-                
-                g_hash_table_insert (priv->resources,
-                                     canonical_usn,
-                                     resource);
-                
-                was_cached = FALSE;
+        /* Send one now and schedule the rest */
+        send_discovery_request (resource_browser);
+        data->num_discovery = 1;
+
+        if (data->num_discovery >= priv->max_discovery_messages)
+                discover_schedule_quiet (task);
+        else
+                discover_schedule_search (task);
+
+        if (timeout > 0) {
+                data->deadline_src = g_timeout_source_new (timeout);
+                g_source_set_callback (data->deadline_src,
+                                       discover_deadline_timeout,
+                                       task,
+                                       NULL);
+                g_source_attach (data->deadline_src,
+                                 g_task_get_context (task));
+                g_source_unref (data->deadline_src);
+        }
 
-                /* hash-table takes ownership of this */
-                canonical_usn = NULL;
+        if (cancellable != NULL) {
+                data->cancel_src = g_cancellable_source_new (cancellable);
+                g_source_set_callback (data->cancel_src,
+                                       (GSourceFunc) discover_cancelled,
+                                       task,
+                                       NULL);
+                g_source_attach (data->cancel_src, g_task_get_context (task));
+                g_source_unref (data->cancel_src);
         }
+}
 
-        g_free (canonical_usn);
+/**
+ * gssdp_resource_browser_discover_finish:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @result: The #GAsyncResult passed to the callback
+ * @error: Return location for a #GError, or %NULL
+ *
+ * Finishes an operation started with
+ * [method@GSSDP.ResourceBrowser.discover_async].
+ *
+ * Returns: (transfer full) (element-type GSSDPResourceInfo): The
+ * resources that were found, or %NULL on error
+ *
+ * Since: 1.8.0
+ */
+GPtrArray *
+gssdp_resource_browser_discover_finish (GSSDPResourceBrowser *resource_browser,
+                                        GAsyncResult         *result,
+                                        GError              **error)
+{
+        g_return_val_if_fail (g_task_is_valid (result, resource_browser),
+                              NULL);
 
-        /* Calculate new timeout */
-        header = soup_message_headers_get_one (headers, "Cache-Control");
-        if (header) {
-                GSList *list;
-                int res;
+        return g_task_propagate_pointer (G_TASK (result), error);
+}
 
-                res = 0;
+static GSSDPResourceInfo *
+resource_to_info (Resource *resource)
+{
+        return _gssdp_resource_info_new (resource->usn,
+                                         resource->locations,
+                                         resource->host_ip,
+                                         resource->expires,
+                                         resource->last_seen,
+                                         resource->boot_id,
+                                         resource->config_id);
+}
 
-                for (list = soup_header_parse_list (header);
-                     list;
-                     list = list->next) {
-                        res = sscanf (list->data,
-                                      "max-age = %d",
-                                      &timeout);
-                        if (res == 1)
-                                break;
-                }
+/**
+ * gssdp_resource_browser_get_resource_count:
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Returns: The number of resources currently known to @resource_browser
+ *
+ * Since: 1.8.0
+ */
+guint
+gssdp_resource_browser_get_resource_count
+                                (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
 
-                if (res != 1) {
-                        g_warning ("Invalid 'Cache-Control' header. Assuming "
-                                   "default max-age of %d.\n"
-                                   "Header was:\n%s",
-                                   SSDP_DEFAULT_MAX_AGE,
-                                   header);
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser), 0);
 
-                        timeout = SSDP_DEFAULT_MAX_AGE;
-                }
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
-                soup_header_free_list (list);
-        } else {
-                const char *expires;
+        return g_hash_table_size (priv->resources);
+}
 
-                expires = soup_message_headers_get_one (headers, "Expires");
-                if (expires) {
-                        GDateTime *exp_time;
+/**
+ * gssdp_resource_browser_get_resources:
+ * @resource_browser: A #GSSDPResourceBrowser
+ *
+ * Takes a snapshot of the resources currently known to @resource_browser.
+ *
+ * Returns: (transfer full) (element-type GSSDPResourceInfo): The
+ * known resources, in no particular order
+ *
+ * Since: 1.8.0
+ */
+GPtrArray *
+gssdp_resource_browser_get_resources (GSSDPResourceBrowser *resource_browser)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        GPtrArray *result;
+        GHashTableIter iter;
+        gpointer value;
 
-                        exp_time = soup_date_time_new_from_http_string (expires);
-                        GDateTime *now = g_date_time_new_now_local ();
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser),
+                              NULL);
 
-                        if (g_date_time_compare (now, exp_time) == 1)
-                                timeout = g_date_time_difference (now, exp_time) / 1000 / 1000;
-                        else {
-                                g_warning ("Invalid 'Expires' header. Assuming "
-                                           "default max-age of %d.\n"
-                                           "Header was:\n%s",
-                                           SSDP_DEFAULT_MAX_AGE,
-                                           expires);
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
-                                timeout = SSDP_DEFAULT_MAX_AGE;
-                        }
-                        g_date_time_unref (exp_time);
-                        g_date_time_unref (now);
-                } else {
-                        g_warning ("No 'Cache-Control' nor any 'Expires' "
-                                   "header was specified. Assuming default "
-                                   "max-age of %d.", SSDP_DEFAULT_MAX_AGE);
+        result = g_ptr_array_new_full
+                        (g_hash_table_size (priv->resources),
+                         (GDestroyNotify) gssdp_resource_info_unref);
+        g_hash_table_iter_init (&iter, priv->resources);
+        while (g_hash_table_iter_next (&iter, NULL, &value))
+                g_ptr_array_add (result, resource_to_info (value));
 
-                        timeout = SSDP_DEFAULT_MAX_AGE;
-                }
-        }
+        return result;
+}
 
-        resource->timeout_src = g_timeout_source_new_seconds (timeout);
-        g_source_set_callback (resource->timeout_src,
-                               resource_expire,
-                               resource, NULL);
+/**
+ * gssdp_resource_browser_lookup_resource:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @usn: The USN of the resource
+ *
+ * Looks up a resource by its USN. For resources matched by a versioned
+ * target, the cached resource may announce a newer version of the type
+ * than @usn.
+ *
+ * Returns: (transfer full) (nullable): The resource, or %NULL if it is
+ * not known
+ *
+ * Since: 1.8.0
+ */
+GSSDPResourceInfo *
+gssdp_resource_browser_lookup_resource (GSSDPResourceBrowser *resource_browser,
+                                        const char           *usn)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        Resource *resource;
 
-        g_source_attach (resource->timeout_src,
-                         g_main_context_get_thread_default ());
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser),
+                              NULL);
+        g_return_val_if_fail (usn != NULL, NULL);
 
-        g_source_unref (resource->timeout_src);
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
-        /* Only continue with signal emission if this resource was not
-         * cached already */
-        if (!was_cached) {
-                /* Emit signal */
-                g_signal_emit (resource_browser,
-                               signals[RESOURCE_AVAILABLE],
-                               0,
-                               usn,
-                               locations);
+        resource = g_hash_table_lookup (priv->resources, usn);
+        if (resource == NULL) {
+                guint64 targets;
+                char *canonical_usn;
+
+                targets = check_target_compat (resource_browser,
+                                               get_usn_target (usn));
+                if (targets == 0)
+                        return NULL;
+
+                canonical_usn = get_canonical_usn (resource_browser,
+                                                   usn,
+                                                   targets);
+                resource = g_hash_table_lookup (priv->resources,
+                                                canonical_usn);
+                g_free (canonical_usn);
         }
-        /* Cleanup */
-        if (destroyLocations)
-                g_list_free_full (locations, g_free);
+
+        return resource != NULL ? resource_to_info (resource) : NULL;
 }
 
-static void
-resource_update (GSSDPResourceBrowser *resource_browser,
-                 SoupMessageHeaders   *headers)
+/**
+ * gssdp_resource_browser_lookup_resources_by_host:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @host: A host name or IP address, without brackets for IPv6
+ *
+ * Finds all resources with a location on @host.
+ *
+ * Returns: (transfer full) (element-type GSSDPResourceInfo): The
+ * resources on @host, which may be empty
+ *
+ * Since: 1.8.0
+ */
+GPtrArray *
+gssdp_resource_browser_lookup_resources_by_host
+                                (GSSDPResourceBrowser *resource_browser,
+                                 const char           *host)
 {
         GSSDPResourceBrowserPrivate *priv;
-        const char *usn;
-        const char *boot_id_header;
-        const char *next_boot_id_header;
-        char *canonical_usn;
-        guint boot_id;
-        guint next_boot_id;
-        gint64 out;
+        GPtrArray *hosted;
+        GPtrArray *result;
+        guint i;
+
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser),
+                              NULL);
+        g_return_val_if_fail (host != NULL, NULL);
 
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
-        usn = soup_message_headers_get_one (headers, "USN");
-        boot_id_header = soup_message_headers_get_one (headers, "BOOTID.UPNP.ORG");
-        next_boot_id_header = soup_message_headers_get_one (headers, "NEXTBOOTID.UPNP.ORG");
 
-        if (!usn)
-                return; /* No USN specified */
+        hosted = g_hash_table_lookup (priv->resources_by_host, host);
+        result = g_ptr_array_new_full
+                        (hosted != NULL ? hosted->len : 0,
+                         (GDestroyNotify) gssdp_resource_info_unref);
+        for (i = 0; hosted != NULL && i < hosted->len; i++)
+                g_ptr_array_add (result,
+                                 resource_to_info (g_ptr_array_index (hosted,
+                                                                      i)));
 
-        if (!boot_id_header)
-                return;
+        return result;
+}
 
-        if (!next_boot_id_header)
-                return;
+typedef struct {
+        GSSDPResourceBrowser *resource_browser;
+        Target *target; /* NULL to wait for any of the browser's targets */
+        gulong message_received_id;
+        GSource *search_src;
+        GSource *deadline_src;
+        GSource *cancel_src;
+        guint num_discovery;
+} WaitData;
 
-        if (!g_ascii_string_to_signed (boot_id_header, 10, 0, G_MAXINT32, &out, NULL))
-                return;
-        boot_id = out;
+static void
+wait_data_free (WaitData *data)
+{
+        g_clear_pointer (&data->target, target_free);
+        g_slice_free (WaitData, data);
+}
 
-        if (!g_ascii_string_to_signed (next_boot_id_header, 10, 0, G_MAXINT32, &out, NULL))
-                return;
-        next_boot_id = out;
+/* Matches the announced type and, for UUID targets, also any other type
+ * announced by the same device */
+static gboolean
+wait_matches (WaitData *data, const char *st, const char *usn)
+{
+        char *uuid;
+        gboolean ret;
 
-        if (priv->version > 0) {
-                char *version;
-                version = g_strrstr (usn, ":");
-                canonical_usn = g_strndup (usn, version - usn);
-        } else {
-                canonical_usn = g_strdup (usn);
-        }
+        if (data->target == NULL)
+                return check_target_compat (data->resource_browser, st) != 0;
 
-        /* Only continue if we know about this. if not, there will be an
-         * announcement afterwards anyway */
-        if (!g_hash_table_lookup (priv->resources,
-                                  canonical_usn))
-                goto out;
+        if (target_matches (data->target, st))
+                return TRUE;
 
-        g_signal_emit (resource_browser,
-                       signals[RESOURCE_UPDATE],
-                       0,
-                       usn,
-                       boot_id,
-                       next_boot_id);
-out:
-        g_free (canonical_usn);
+        if (!g_str_has_prefix (data->target->target, "uuid:") || usn == NULL)
+                return FALSE;
 
+        uuid = get_device_uuid (usn);
+        ret = g_strcmp0 (uuid, data->target->target) == 0;
+        g_free (uuid);
+
+        return ret;
 }
 
 static void
-resource_unavailable (GSSDPResourceBrowser *resource_browser,
-                      SoupMessageHeaders   *headers)
+wait_cleanup (GTask *task)
 {
         GSSDPResourceBrowserPrivate *priv;
-        const char *usn;
-        char *canonical_usn;
+        WaitData *data;
 
-        priv = gssdp_resource_browser_get_instance_private (resource_browser);
-        usn = soup_message_headers_get_one (headers, "USN");
-        if (!usn)
-                return; /* No USN specified */
+        data = g_task_get_task_data (task);
+        priv = gssdp_resource_browser_get_instance_private
+                                        (data->resource_browser);
 
-        if (priv->version > 0) {
-                char *version;
+        g_clear_signal_handler (&data->message_received_id, priv->client);
+        g_clear_pointer (&data->search_src, g_source_destroy);
+        g_clear_pointer (&data->deadline_src, g_source_destroy);
+        g_clear_pointer (&data->cancel_src, g_source_destroy);
+}
 
-                version = g_strrstr (usn, ":");
-                canonical_usn = g_strndup (usn, version - usn);
-        } else {
-                canonical_usn = g_strdup (usn);
-        }
+static void
+wait_send_search (GTask *task)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        WaitData *data;
 
-        /* Only process if we were cached */
-        if (!g_hash_table_lookup (priv->resources,
-                                  canonical_usn))
-                goto out;
+        data = g_task_get_task_data (task);
+        priv = gssdp_resource_browser_get_instance_private
+                                        (data->resource_browser);
 
-        g_hash_table_remove (priv->resources,
-                             canonical_usn);
+        if (data->target == NULL) {
+                guint i;
 
-        g_signal_emit (resource_browser,
-                       signals[RESOURCE_UNAVAILABLE],
-                       0,
-                       usn);
+                for (i = 0; i < priv->targets->len; i++) {
+                        Target *target = g_ptr_array_index (priv->targets, i);
 
-out:
-        g_free (canonical_usn);
+                        _gssdp_client_queue_search (priv->client,
+                                                    target->target,
+                                                    WAIT_MX);
+                }
+        } else {
+                _gssdp_client_queue_search (priv->client,
+                                            data->target->target,
+                                            WAIT_MX);
+        }
+
+        data->num_discovery += 1;
 }
 
 static gboolean
-check_target_compat (GSSDPResourceBrowser *resource_browser,
-                     const char           *st)
+wait_search_timeout (gpointer user_data)
 {
         GSSDPResourceBrowserPrivate *priv;
-        GMatchInfo *info;
-        int         version;
-        char       *tmp;
-
-        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+        GTask *task = G_TASK (user_data);
+        WaitData *data;
 
-        if (g_str_equal (priv->target, GSSDP_ALL_RESOURCES))
-                return TRUE;
+        data = g_task_get_task_data (task);
+        priv = gssdp_resource_browser_get_instance_private
+                                        (data->resource_browser);
 
-        if (!g_regex_match (priv->target_regex,
-                            st,
-                            0,
-                            &info)) {
-                g_match_info_free (info);
+        /* Repeat the search a few times in case it got lost, then just
+         * keep listening for announcements */
+        if (data->num_discovery >= priv->max_discovery_messages) {
+                data->search_src = NULL;
 
                 return FALSE;
         }
 
-        /* If there was no version to match, we're done */
-        if (priv->version == 0) {
-                g_match_info_free (info);
-
-                return TRUE;
-        }
-
-        if (g_match_info_get_match_count (info) != 2) {
-                g_match_info_free (info);
+        wait_send_search (task);
 
-                return FALSE;
-        }
+        return TRUE;
+}
 
-        version = atoi ((tmp = g_match_info_fetch (info, 1)));
-        g_free (tmp);
-        g_match_info_free (info);
+static gboolean
+wait_deadline_timeout (gpointer user_data)
+{
+        GTask *task = G_TASK (user_data);
+        WaitData *data;
 
-        if (version < 0) {
-            return FALSE;
-        }
+        data = g_task_get_task_data (task);
+        data->deadline_src = NULL;
+        wait_cleanup (task);
 
-        return (guint) version >= priv->version;
+        g_task_return_new_error (task,
+                                 G_IO_ERROR,
+                                 G_IO_ERROR_TIMED_OUT,
+                                 "No matching resource appeared in time");
+        g_object_unref (task);
+
+        return FALSE;
 }
 
-static void
-received_discovery_response (GSSDPResourceBrowser *resource_browser,
-                             SoupMessageHeaders   *headers)
+static gboolean
+wait_cancelled (G_GNUC_UNUSED GCancellable *cancellable,
+                gpointer                    user_data)
 {
-        const char *st;
+        GTask *task = G_TASK (user_data);
+        WaitData *data;
 
-        st = soup_message_headers_get_one (headers, "ST");
-        if (!st)
-                return; /* No target specified */
+        data = g_task_get_task_data (task);
+        data->cancel_src = NULL;
+        wait_cleanup (task);
 
-        if (!check_target_compat (resource_browser, st))
-                return; /* Target doesn't match */
+        g_task_return_error_if_cancelled (task);
+        g_object_unref (task);
 
-        resource_available (resource_browser, headers);
+        return FALSE;
 }
 
 static void
-received_announcement (GSSDPResourceBrowser *resource_browser,
-                       SoupMessageHeaders   *headers)
+wait_message_received_cb (G_GNUC_UNUSED GSSDPClient *client,
+                          const char                *from_ip,
+                          G_GNUC_UNUSED gushort      from_port,
+                          _GSSDPMessageType          type,
+                          SoupMessageHeaders        *headers,
+                          gpointer                   user_data)
 {
+        GTask *task = G_TASK (user_data);
+        WaitData *data;
+        const char *st;
+        const char *usn;
         const char *header;
+        GList *locations;
+        gint64 now;
+        GSSDPResourceInfo *info;
+
+        data = g_task_get_task_data (task);
+
+        if (type == _GSSDP_DISCOVERY_RESPONSE) {
+                st = soup_message_headers_get_one (headers, "ST");
+        } else if (type == _GSSDP_ANNOUNCEMENT) {
+                st = soup_message_headers_get_one (headers, "NT");
+
+                header = soup_message_headers_get_one (headers, "NTS");
+                if (header == NULL ||
+                    strncmp (header,
+                             SSDP_ALIVE_NTS,
+                             strlen (SSDP_ALIVE_NTS)) != 0)
+                        return;
+        } else {
+                return;
+        }
 
-        header = soup_message_headers_get_one (headers, "NT");
-        if (!header)
-                return; /* No target specified */
+        usn = soup_message_headers_get_one (headers, "USN");
+        if (st == NULL || usn == NULL || !wait_matches (data, st, usn))
+                return;
 
-        if (!check_target_compat (resource_browser, header))
-                return; /* Target doesn't match */
+        if (!check_filters (data->resource_browser, from_ip, headers))
+                return;
 
-        header = soup_message_headers_get_one (headers, "NTS");
-        if (!header)
-                return; /* No announcement type specified */
+        locations = parse_locations (headers);
+        if (!locations)
+                return; /* No location specified */
 
-        /* Check announcement type */
-        if      (strncmp (header,
-                          SSDP_ALIVE_NTS,
-                          strlen (SSDP_ALIVE_NTS)) == 0)
-                resource_available (resource_browser, headers);
-        else if (strncmp (header,
-                          SSDP_BYEBYE_NTS,
-                          strlen (SSDP_BYEBYE_NTS)) == 0)
-                resource_unavailable (resource_browser, headers);
-        else if (strncmp (header,
-                          SSDP_UPDATE_NTS,
-                          strlen (SSDP_UPDATE_NTS)) == 0)
-                resource_update (resource_browser, headers);
+        now = g_get_real_time ();
+        info = _gssdp_resource_info_new
+                        (usn,
+                         locations,
+                         from_ip,
+                         now + (gint64) get_max_age (headers) * G_USEC_PER_SEC,
+                         now,
+                         get_header_int32 (headers, "BOOTID.UPNP.ORG"),
+                         get_header_int32 (headers, "CONFIGID.UPNP.ORG"));
+        g_list_free_full (locations, g_free);
+
+        wait_cleanup (task);
+        g_task_return_pointer (task,
+                               info,
+                               (GDestroyNotify) gssdp_resource_info_unref);
+        g_object_unref (task);
 }
 
-/*
- * Received a message
+/**
+ * gssdp_resource_browser_wait_for_resource_async:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @target: (nullable): The resource type or UUID to wait for, or %NULL for
+ * any of the targets of @resource_browser
+ * @timeout: Time to wait in milliseconds, or 0 to wait forever
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: (scope async): Function to call when a resource was found
+ * @user_data: (closure): User data for @callback
+ *
+ * Waits for the first resource matching @target.
+ *
+ * The cache of @resource_browser is consulted first. If nothing matches, a
+ * search with a short MX is sent right away and the operation completes on
+ * the first matching announcement or search response. If @target is a
+ * device UUID, any resource of that device matches.
+ *
+ * If no resource shows up within @timeout, the operation fails with
+ * %G_IO_ERROR_TIMED_OUT.
+ *
+ * Since: 1.8.0
  */
-static void
-message_received_cb (G_GNUC_UNUSED GSSDPClient *client,
-                     G_GNUC_UNUSED const char  *from_ip,
-                     G_GNUC_UNUSED gushort      from_port,
-                     _GSSDPMessageType          type,
-                     SoupMessageHeaders        *headers,
-                     gpointer                   user_data)
+void
+gssdp_resource_browser_wait_for_resource_async
+                                (GSSDPResourceBrowser *resource_browser,
+                                 const char           *target,
+                                 guint                 timeout,
+                                 GCancellable         *cancellable,
+                                 GAsyncReadyCallback   callback,
+                                 gpointer              user_data)
 {
-        GSSDPResourceBrowser *resource_browser;
         GSSDPResourceBrowserPrivate *priv;
+        WaitData *data;
+        GTask *task;
+        GHashTableIter iter;
+        gpointer value;
 
-        resource_browser = GSSDP_RESOURCE_BROWSER (user_data);
+        g_return_if_fail (GSSDP_IS_RESOURCE_BROWSER (resource_browser));
+        g_return_if_fail (cancellable == NULL ||
+                          G_IS_CANCELLABLE (cancellable));
 
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
-        if (!priv->active)
-                return;
 
-        switch (type) {
-        case _GSSDP_DISCOVERY_RESPONSE:
-                received_discovery_response (resource_browser, headers);
-                break;
-        case _GSSDP_ANNOUNCEMENT:
-                received_announcement (resource_browser, headers);
-                break;
-        case _GSSDP_DISCOVERY_REQUEST:
-                /* Should not happend */
-                break;
-        default:
-                break;
+        task = g_task_new (resource_browser, cancellable, callback, user_data);
+        g_task_set_source_tag (task,
+                               gssdp_resource_browser_wait_for_resource_async);
+
+        if (g_task_return_error_if_cancelled (task)) {
+                g_object_unref (task);
+
+                return;
         }
-}
 
-/*
- * Free a Resource structure and its contained data
- */
-static void
-resource_free (Resource *resource)
-{
-        g_free (resource->usn);
-        g_source_destroy (resource->timeout_src);
-        g_list_free_full (resource->locations, g_free);
-        g_slice_free (Resource, resource);
-}
+        data = g_slice_new0 (WaitData);
+        data->resource_browser = resource_browser;
+        if (target != NULL)
+                data->target = target_new (target);
+        g_task_set_task_data (task, data, (GDestroyNotify) wait_data_free);
+
+        /* Maybe we already know it */
+        g_hash_table_iter_init (&iter, priv->resources);
+        while (g_hash_table_iter_next (&iter, NULL, &value)) {
+                Resource *resource = value;
+
+                if (resource->suspect ||
+                    !wait_matches (data,
+                                   get_usn_target (resource->usn),
+                                   resource->usn))
+                        continue;
+
+                g_task_return_pointer
+                                (task,
+                                 resource_to_info (resource),
+                                 (GDestroyNotify) gssdp_resource_info_unref);
+                g_object_unref (task);
 
-static gboolean
-clear_cache_helper (G_GNUC_UNUSED gpointer key,
-                    gpointer               value,
-                    G_GNUC_UNUSED gpointer data)
-{
-        Resource *resource;
+                return;
+        }
 
-        resource = value;
+        data->message_received_id =
+                g_signal_connect_object (priv->client,
+                                         "message-received",
+                                         G_CALLBACK (wait_message_received_cb),
+                                         task,
+                                         0);
 
-        g_signal_emit (resource->resource_browser,
-                       signals[RESOURCE_UNAVAILABLE],
-                       0,
-                       resource->usn);
+        wait_send_search (task);
+        data->search_src = g_timeout_source_new (priv->discovery_interval);
+        g_source_set_callback (data->search_src,
+                               wait_search_timeout,
+                               task,
+                               NULL);
+        g_source_attach (data->search_src, g_task_get_context (task));
+        g_source_unref (data->search_src);
+
+        if (timeout > 0) {
+                data->deadline_src = g_timeout_source_new (timeout);
+                g_source_set_callback (data->deadline_src,
+                                       wait_deadline_timeout,
+                                       task,
+                                       NULL);
+                g_source_attach (data->deadline_src,
+                                 g_task_get_context (task));
+                g_source_unref (data->deadline_src);
+        }
 
-        return TRUE;
+        if (cancellable != NULL) {
+                data->cancel_src = g_cancellable_source_new (cancellable);
+                g_source_set_callback (data->cancel_src,
+                                       (GSourceFunc) wait_cancelled,
+                                       task,
+                                       NULL);
+                g_source_attach (data->cancel_src, g_task_get_context (task));
+                g_source_unref (data->cancel_src);
+        }
 }
 
-/*
- * Clears the cached resources hash
+/**
+ * gssdp_resource_browser_wait_for_resource_finish:
+ * @resource_browser: A #GSSDPResourceBrowser
+ * @result: The #GAsyncResult passed to the callback
+ * @error: Return location for a #GError, or %NULL
+ *
+ * Finishes an operation started with
+ * [method@GSSDP.ResourceBrowser.wait_for_resource_async].
+ *
+ * Returns: (transfer full): The first matching resource, or %NULL on error
+ *
+ * Since: 1.8.0
  */
-static void
-clear_cache (GSSDPResourceBrowser *resource_browser)
+GSSDPResourceInfo *
+gssdp_resource_browser_wait_for_resource_finish
+                                (GSSDPResourceBrowser *resource_browser,
+                                 GAsyncResult         *result,
+                                 GError              **error)
 {
-        GSSDPResourceBrowserPrivate *priv;
-        priv = gssdp_resource_browser_get_instance_private (resource_browser);
+        g_return_val_if_fail (g_task_is_valid (result, resource_browser),
+                              NULL);
 
-        /* Clear cache */
-        g_hash_table_foreach_remove (priv->resources,
-                                     clear_cache_helper,
-                                     NULL);
+        return g_task_propagate_pointer (G_TASK (result), error);
 }
 
-/* Sends discovery request */
+/* Records a change for the next ::resources-changed emission. Appearing and
+ * disappearing again within one batch cancels out. */
 static void
-send_discovery_request (GSSDPResourceBrowser *resource_browser)
+batch_record (Resource *resource, guint signal_id)
 {
+        GSSDPResourceBrowser *resource_browser;
         GSSDPResourceBrowserPrivate *priv;
-        char *message = NULL;
-        const char *group = NULL;
-        char *dest = NULL;
+        GSSDPResourceInfo *info;
+        char *usn;
 
+        resource_browser = resource->resource_browser;
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
-        group = _gssdp_client_get_mcast_group (priv->client);
 
-        /* FIXME: Check for IPv6 - ugly and remove strcpys */
-        if (strchr (group, ':')) {
-            dest = g_strdup_printf ("[%s]", group);
+        info = resource_to_info (resource);
+        usn = (char *) gssdp_resource_info_get_usn (info);
+
+        if (signal_id == signals[RESOURCE_AVAILABLE]) {
+                if (g_hash_table_remove (priv->batch_removed, usn))
+                        g_hash_table_replace (priv->batch_updated, usn, info);
+                else
+                        g_hash_table_replace (priv->batch_added, usn, info);
+        } else if (signal_id == signals[RESOURCE_UNAVAILABLE]) {
+                g_hash_table_remove (priv->batch_updated, usn);
+                if (g_hash_table_remove (priv->batch_added, usn))
+                        gssdp_resource_info_unref (info);
+                else
+                        g_hash_table_replace (priv->batch_removed, usn, info);
         } else {
-            dest = g_strdup (group);
+                if (g_hash_table_contains (priv->batch_added, usn))
+                        g_hash_table_replace (priv->batch_added, usn, info);
+                else
+                        g_hash_table_replace (priv->batch_updated, usn, info);
         }
 
-        priv = gssdp_resource_browser_get_instance_private (resource_browser);
-        message = g_strdup_printf (SSDP_DISCOVERY_REQUEST,
-                                   dest,
-                                   priv->target,
-                                   priv->mx,
-                                   gssdp_client_get_server_id (priv->client));
+        if (priv->batch_src != NULL)
+                return;
 
-        _gssdp_client_send_message (priv->client,
-                                    NULL,
-                                    0,
-                                    message,
-                                    _GSSDP_DISCOVERY_REQUEST);
+        if (priv->batch_interval == 0)
+                priv->batch_src = g_idle_source_new ();
+        else
+                priv->batch_src = g_timeout_source_new (priv->batch_interval);
+        g_source_set_callback (priv->batch_src,
+                               batch_timeout,
+                               resource_browser,
+                               NULL);
+        g_source_attach (priv->batch_src,
+                         g_main_context_get_thread_default ());
+        g_source_unref (priv->batch_src);
+}
+
+static GPtrArray *
+batch_take (GHashTable *changes)
+{
+        GPtrArray *result;
+        GHashTableIter iter;
+        gpointer value;
+
+        result = g_ptr_array_new_full
+                        (g_hash_table_size (changes),
+                         (GDestroyNotify) gssdp_resource_info_unref);
+        g_hash_table_iter_init (&iter, changes);
+        while (g_hash_table_iter_next (&iter, NULL, &value)) {
+                g_ptr_array_add (result, value);
+                g_hash_table_iter_steal (&iter);
+        }
 
-        g_free (dest);
-        g_free (message);
+        return result;
 }
 
-static gboolean
-discovery_timeout (gpointer data)
+static void
+batch_flush (GSSDPResourceBrowser *resource_browser)
 {
         GSSDPResourceBrowserPrivate *priv;
-        GSSDPResourceBrowser *resource_browser;
+        GPtrArray *added, *removed, *updated;
 
-        resource_browser = GSSDP_RESOURCE_BROWSER (data);
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
-        send_discovery_request (resource_browser);
+        g_clear_pointer (&priv->batch_src, g_source_destroy);
 
-        priv->num_discovery += 1;
+        if (g_hash_table_size (priv->batch_added) == 0 &&
+            g_hash_table_size (priv->batch_removed) == 0 &&
+            g_hash_table_size (priv->batch_updated) == 0)
+                return;
 
-        if (priv->num_discovery >= MAX_DISCOVERY_MESSAGES) {
-                priv->timeout_src = NULL;
-                priv->num_discovery = 0;
+        added = batch_take (priv->batch_added);
+        removed = batch_take (priv->batch_removed);
+        updated = batch_take (priv->batch_updated);
 
-                /* Setup cache refreshing */
-                priv->refresh_cache_src =
-                                  g_timeout_source_new_seconds (RESCAN_TIMEOUT);
-                g_source_set_callback
-                                     (priv->refresh_cache_src,
-                                      refresh_cache,
-                                      resource_browser,
-                                      NULL);
-                g_source_attach (priv->refresh_cache_src,
-                                 g_main_context_get_thread_default ());
-                g_source_unref (priv->refresh_cache_src);
+        g_signal_emit (resource_browser,
+                       signals[RESOURCES_CHANGED],
+                       0,
+                       added,
+                       removed,
+                       updated);
 
-                return FALSE;
-        } else
-                return TRUE;
+        g_ptr_array_unref (added);
+        g_ptr_array_unref (removed);
+        g_ptr_array_unref (updated);
 }
 
-/* Starts sending discovery requests */
-static void
-start_discovery (GSSDPResourceBrowser *resource_browser)
+static gboolean
+batch_timeout (gpointer user_data)
 {
+        GSSDPResourceBrowser *resource_browser;
         GSSDPResourceBrowserPrivate *priv;
 
+        resource_browser = GSSDP_RESOURCE_BROWSER (user_data);
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
-        /* Send one now */
-        send_discovery_request (resource_browser);
+        priv->batch_src = NULL;
+        batch_flush (resource_browser);
 
-        /* And schedule the rest for later */
-        priv->num_discovery = 1;
-        priv->timeout_src =
-                g_timeout_source_new (DISCOVERY_FREQUENCY);
-        g_source_set_callback (priv->timeout_src,
-                               discovery_timeout,
-                               resource_browser, NULL);
+        return FALSE;
+}
 
-        g_source_attach (priv->timeout_src,
-                         g_main_context_get_thread_default ());
+/* Emits @signal_id once for every target in @mask. Takes no Resource,
+ * as handlers may drop it from the cache. */
+static void
+emit_target_signals (GSSDPResourceBrowser *resource_browser,
+                     const char           *usn,
+                     guint64               mask,
+                     guint                 signal_id)
+{
+        GSSDPResourceBrowserPrivate *priv;
+        guint i;
 
-        g_source_unref (priv->timeout_src);
+        priv = gssdp_resource_browser_get_instance_private (resource_browser);
 
-        /* Setup a set of responsive resources for cache refreshing */
-        priv->fresh_resources = g_hash_table_new_full
-                                        (g_str_hash,
-                                         g_str_equal,
-                                         g_free,
-                                         NULL);
+        if (priv->batch_signals)
+                return;
+
+        for (i = 0; i < priv->targets->len; i++) {
+                Target *target = g_ptr_array_index (priv->targets, i);
+
+                if (mask & (G_GUINT64_CONSTANT (1) << i))
+                        g_signal_emit (resource_browser,
+                                       signal_id,
+                                       0,
+                                       usn,
+                                       target->target);
+        }
 }
 
-/* Stops the sending of discovery messages */
 static void
-stop_discovery (GSSDPResourceBrowser *resource_browser)
+emit_resource_available (Resource *resource, const char *usn)
 {
         GSSDPResourceBrowserPrivate *priv;
+        GSSDPResourceBrowser *resource_browser;
+        guint64 targets;
+        char *usn_copy;
 
+        resource_browser = resource->resource_browser;
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
-        if (priv->timeout_src) {
-                priv->num_discovery = 0;
+
+        if (priv->batch_signals) {
+                batch_record (resource, signals[RESOURCE_AVAILABLE]);
+
+                return;
         }
 
-        g_clear_pointer (&priv->timeout_src, g_source_destroy);
-        g_clear_pointer (&priv->refresh_cache_src, g_source_destroy);
-        g_clear_pointer (&priv->fresh_resources, g_hash_table_destroy);
+        targets = resource->targets;
+        usn_copy = g_strdup (usn);
+        g_signal_emit (resource_browser,
+                       signals[RESOURCE_AVAILABLE],
+                       0,
+                       usn,
+                       resource->locations);
+        emit_target_signals (resource_browser,
+                             usn_copy,
+                             targets,
+                             signals[TARGET_AVAILABLE]);
+        g_free (usn_copy);
 }
 
-static gboolean
-refresh_cache_helper (gpointer key, gpointer value, gpointer data)
+/* Must be called while @resource is still cached */
+static void
+emit_resource_unavailable (Resource *resource, const char *usn)
 {
-        Resource *resource;
-        GHashTable *fresh_resources;
+        GSSDPResourceBrowserPrivate *priv;
 
-        resource = value;
-        fresh_resources = data;
+        priv = gssdp_resource_browser_get_instance_private
+                                        (resource->resource_browser);
 
-        if (g_hash_table_contains (fresh_resources, key))
-                return FALSE;
-        else {
-                g_signal_emit (resource->resource_browser,
-                               signals[RESOURCE_UNAVAILABLE],
-                               0,
-                               resource->usn);
+        if (priv->batch_signals) {
+                batch_record (resource, signals[RESOURCE_UNAVAILABLE]);
 
-                return TRUE;
+                return;
         }
+
+        emit_target_signals (resource->resource_browser,
+                             resource->usn,
+                             resource->targets,
+                             signals[TARGET_UNAVAILABLE]);
+        g_signal_emit (resource->resource_browser,
+                       signals[RESOURCE_UNAVAILABLE],
+                       0,
+                       usn);
 }
 
-/* Removes non-responsive resources */
-static gboolean
-refresh_cache (gpointer data)
+/* Drops @resource, cached as @canonical_usn, and reports it as @usn. Outside
+ * of batch mode, the signals come after it left the cache. */
+static void
+remove_resource (Resource   *resource,
+                 const char *canonical_usn,
+                 const char *usn)
 {
         GSSDPResourceBrowser *resource_browser;
         GSSDPResourceBrowserPrivate *priv;
+        guint64 targets;
+        char *usn_copy;
 
-        resource_browser = GSSDP_RESOURCE_BROWSER (data);
+        resource_browser = resource->resource_browser;
         priv = gssdp_resource_browser_get_instance_private (resource_browser);
-        g_hash_table_foreach_remove (priv->resources,
-                                     refresh_cache_helper,
-                                     priv->fresh_resources);
-        g_hash_table_unref (priv->fresh_resources);
-        priv->fresh_resources = NULL;
-        priv->refresh_cache_src = NULL;
 
-        return FALSE;
+        if (priv->batch_signals) {
+                batch_record (resource, signals[RESOURCE_UNAVAILABLE]);
+                g_hash_table_remove (priv->resources, canonical_usn);
+
+                return;
+        }
+
+        /* @usn may belong to the resource */
+        usn_copy = g_strdup (usn);
+        targets = resource->targets;
+        g_hash_table_remove (priv->resources, canonical_usn);
+
+        emit_target_signals (resource_browser,
+                             usn_copy,
+                             targets,
+                             signals[TARGET_UNAVAILABLE]);
+        g_signal_emit (resource_browser,
+                       signals[RESOURCE_UNAVAILABLE],
+                       0,
+                       usn_copy);
+        g_free (usn_copy);
+}
+
+static void
+emit_resource_locations_changed (Resource *resource, const char *usn)
+{
+        GSSDPResourceBrowserPrivate *priv;
+
+        priv = gssdp_resource_browser_get_instance_private
+                                        (resource->resource_browser);
+
+        if (priv->batch_signals) {
+                batch_record (resource, signals[RESOURCE_LOCATIONS_CHANGED]);
+
+                return;
+        }
+
+        g_signal_emit (resource->resource_browser,
+                       signals[RESOURCE_LOCATIONS_CHANGED],
+                       0,
+                       usn,
+                       resource->locations);
 }
@@ -11,6 +11,7 @@
 #define GSSDP_RESOURCE_BROWSER_H
 
 #include "gssdp-client.h"
+#include "gssdp-resource-info.h"
 
 #include <glib-object.h>
 
@@ -40,9 +41,19 @@ struct _GSSDPResourceBrowserClass {
         void (* resource_unavailable) (GSSDPResourceBrowser *resource_browser,
                                        const char           *usn);
 
+        /* Since 1.8.0. These two took the places of _gssdp_reserved1 and
+         * _gssdp_reserved2, so the size of the class is unchanged */
+        void (* resource_locations_changed)
+                                      (GSSDPResourceBrowser *resource_browser,
+                                       const char           *usn,
+                                       const GList          *locations);
+
+        void (* resources_changed)    (GSSDPResourceBrowser *resource_browser,
+                                       GPtrArray            *added,
+                                       GPtrArray            *removed,
+                                       GPtrArray            *updated);
+
         /* future padding */
-        void (* _gssdp_reserved1) (void);
-        void (* _gssdp_reserved2) (void);
         void (* _gssdp_reserved3) (void);
         void (* _gssdp_reserved4) (void);
 };
@@ -68,6 +79,24 @@ gssdp_resource_browser_set_target (GSSDPResourceBrowser *resource_browser,
 const char *
 gssdp_resource_browser_get_target (GSSDPResourceBrowser *resource_browser);
 
+void
+gssdp_resource_browser_add_target (GSSDPResourceBrowser *resource_browser,
+                                   const char           *target);
+
+void
+gssdp_resource_browser_remove_target
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   const char           *target);
+
+char **
+gssdp_resource_browser_get_targets
+                                  (GSSDPResourceBrowser *resource_browser);
+
+char **
+gssdp_resource_browser_get_resource_targets
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   const char           *usn);
+
 void
 gssdp_resource_browser_set_mx     (GSSDPResourceBrowser *resource_browser,
                                    gushort               mx);
@@ -82,9 +111,197 @@ gssdp_resource_browser_set_active (GSSDPResourceBrowser *resource_browser,
 gboolean
 gssdp_resource_browser_get_active (GSSDPResourceBrowser *resource_browser);
 
+void
+gssdp_resource_browser_set_discovery_interval
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   guint                 interval);
+
+guint
+gssdp_resource_browser_get_discovery_interval
+                                  (GSSDPResourceBrowser *resource_browser);
+
+void
+gssdp_resource_browser_set_min_discovery_messages
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   guint                 min_messages);
+
+guint
+gssdp_resource_browser_get_min_discovery_messages
+                                  (GSSDPResourceBrowser *resource_browser);
+
+void
+gssdp_resource_browser_set_max_discovery_messages
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   guint                 max_messages);
+
+guint
+gssdp_resource_browser_get_max_discovery_messages
+                                  (GSSDPResourceBrowser *resource_browser);
+
+void
+gssdp_resource_browser_set_rescan_interval
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   guint                 interval);
+
+guint
+gssdp_resource_browser_get_rescan_interval
+                                  (GSSDPResourceBrowser *resource_browser);
+
+void
+gssdp_resource_browser_set_max_rescan_interval
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   guint                 interval);
+
+guint
+gssdp_resource_browser_get_max_rescan_interval
+                                  (GSSDPResourceBrowser *resource_browser);
+
+void
+gssdp_resource_browser_set_revalidate
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   gboolean              revalidate);
+
+gboolean
+gssdp_resource_browser_get_revalidate
+                                  (GSSDPResourceBrowser *resource_browser);
+
+void
+gssdp_resource_browser_set_max_revalidation_rate
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   guint                 rate);
+
+guint
+gssdp_resource_browser_get_max_revalidation_rate
+                                  (GSSDPResourceBrowser *resource_browser);
+
+void
+gssdp_resource_browser_set_grace_period
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   guint                 grace_period);
+
+guint
+gssdp_resource_browser_get_grace_period
+                                  (GSSDPResourceBrowser *resource_browser);
+
+void
+gssdp_resource_browser_set_track_location_changes
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   gboolean              track);
+
+gboolean
+gssdp_resource_browser_get_track_location_changes
+                                  (GSSDPResourceBrowser *resource_browser);
+
+void
+gssdp_resource_browser_set_batch_signals
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   gboolean              batch_signals);
+
+gboolean
+gssdp_resource_browser_get_batch_signals
+                                  (GSSDPResourceBrowser *resource_browser);
+
+void
+gssdp_resource_browser_set_batch_interval
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   guint                 interval);
+
+guint
+gssdp_resource_browser_get_batch_interval
+                                  (GSSDPResourceBrowser *resource_browser);
+
+void
+gssdp_resource_browser_get_revalidation_stats
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   guint                *sent,
+                                   guint                *suppressed,
+                                   guint                *answered);
+
+gboolean
+gssdp_resource_browser_add_source_filter
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   const char           *cidr,
+                                   GError              **error);
+
+void
+gssdp_resource_browser_add_usn_prefix_filter
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   const char           *prefix);
+
+void
+gssdp_resource_browser_add_server_filter
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   const char           *substring);
+
+void
+gssdp_resource_browser_add_location_host_filter
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   const char           *host);
+
+void
+gssdp_resource_browser_clear_filters
+                                  (GSSDPResourceBrowser *resource_browser);
+
 gboolean
 gssdp_resource_browser_rescan     (GSSDPResourceBrowser *resource_browser);
 
+gboolean
+gssdp_resource_browser_save_cache (GSSDPResourceBrowser *resource_browser,
+                                   const char           *path,
+                                   GError              **error);
+
+gboolean
+gssdp_resource_browser_load_cache (GSSDPResourceBrowser *resource_browser,
+                                   const char           *path,
+                                   GError              **error);
+
+void
+gssdp_resource_browser_discover_async
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   guint                 timeout,
+                                   GCancellable         *cancellable,
+                                   GAsyncReadyCallback   callback,
+                                   gpointer              user_data);
+
+GPtrArray *
+gssdp_resource_browser_discover_finish
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   GAsyncResult         *result,
+                                   GError              **error);
+
+void
+gssdp_resource_browser_wait_for_resource_async
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   const char           *target,
+                                   guint                 timeout,
+                                   GCancellable         *cancellable,
+                                   GAsyncReadyCallback   callback,
+                                   gpointer              user_data);
+
+GSSDPResourceInfo *
+gssdp_resource_browser_wait_for_resource_finish
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   GAsyncResult         *result,
+                                   GError              **error);
+
+guint
+gssdp_resource_browser_get_resource_count
+                                  (GSSDPResourceBrowser *resource_browser);
+
+GPtrArray *
+gssdp_resource_browser_get_resources
+                                  (GSSDPResourceBrowser *resource_browser);
+
+GSSDPResourceInfo *
+gssdp_resource_browser_lookup_resource
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   const char           *usn);
+
+GPtrArray *
+gssdp_resource_browser_lookup_resources_by_host
+                                  (GSSDPResourceBrowser *resource_browser,
+                                   const char           *host);
+
 G_END_DECLS
 
 #endif /* GSSDP_RESOURCE_BROWSER_H */
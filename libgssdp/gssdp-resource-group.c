@@ -29,17 +29,16 @@ struct _GSSDPResourceGroupPrivate {
 
         gboolean     available;
 
-        GList       *resources;
+        GHashTable  *resources_by_id;
+        GQueue       resources; /* In the order they were added */
 
-        gulong       message_received_id;
+        GPtrArray   *bindings; /* One per client, the primary one first */
 
         GSource     *timeout_src;
 
         guint        last_resource_id;
         
         guint        message_delay;
-        GQueue      *message_queue;
-        GSource     *message_src;
 };
 typedef struct _GSSDPResourceGroupPrivate GSSDPResourceGroupPrivate;
 
@@ -66,17 +65,30 @@ typedef struct {
         GList               *responses;
 
         guint                id;
+        GList               *link; /* Into priv->resources */
 
         guint                version;
 
         gboolean             initial_byebye_sent;
 } Resource;
 
+/* A client the group announces its resources on. Every client has its own
+ * message queue so the message delay applies per interface. */
+typedef struct {
+        GSSDPResourceGroup *resource_group;
+        GSSDPClient        *client;
+        gulong              message_received_id;
+        gulong              rebound_id;
+        GQueue             *message_queue;
+        GSource            *message_src;
+} Binding;
+
 typedef struct {
         char     *dest_ip;
         gushort   dest_port;
         char     *target;
         Resource *resource;
+        Binding  *binding;
 
         GSource  *timeout_src;
 } DiscoveryResponse;
@@ -84,11 +96,12 @@ typedef struct {
 #define DEFAULT_MESSAGE_DELAY 120
 #define DEFAULT_ANNOUNCEMENT_SET_SIZE 3
 #define VERSION_PATTERN "[0-9]+$"
+#define LOCATION_HOST_PLACEHOLDER "{host}"
 
 /* Function prototypes */
 
 static void
-queue_message                   (GSSDPResourceGroup *resource_group,
+queue_message                   (Binding            *binding,
                                  char               *message);
 static void
 gssdp_resource_group_set_client (GSSDPResourceGroup *resource_group,
@@ -103,10 +116,19 @@ message_received_cb             (GSSDPClient        *client,
                                  SoupMessageHeaders *headers,
                                  gpointer            user_data);
 static void
+client_rebound_cb               (GSSDPClient        *client,
+                                 gpointer            user_data);
+static void
 resource_alive                  (Resource           *resource);
 static void
 resource_byebye                 (Resource           *resource);
 static void
+resource_alive_on               (Resource           *resource,
+                                 Binding            *binding);
+static void
+resource_byebye_on              (Resource           *resource,
+                                 Binding            *binding);
+static void
 resource_free                   (Resource           *resource);
 static gboolean
 discovery_response_timeout      (gpointer            user_data);
@@ -114,6 +136,9 @@ static void
 discovery_response_free         (DiscoveryResponse  *response);
 static gboolean
 process_queue                   (gpointer            data);
+static void
+send_queued_messages            (Binding            *binding,
+                                 guint               n_messages);
 static char *
 get_version_for_target          (char *target);
 static GRegex *
@@ -122,6 +147,105 @@ create_target_regex             (const char         *target,
                                  GError            **error);
 static void
 send_initial_resource_byebye    (Resource          *resource);
+static char *
+expand_location                 (const char         *location,
+                                 GSSDPClient        *client);
+
+static Binding *
+binding_new (GSSDPResourceGroup *resource_group, GSSDPClient *client)
+{
+        Binding *binding;
+
+        binding = g_slice_new0 (Binding);
+        binding->resource_group = resource_group;
+        binding->client = g_object_ref (client);
+        binding->message_queue = g_queue_new ();
+        binding->message_received_id =
+                g_signal_connect (client,
+                                  "message-received",
+                                  G_CALLBACK (message_received_cb),
+                                  binding);
+        binding->rebound_id =
+                g_signal_connect (client,
+                                  "rebound",
+                                  G_CALLBACK (client_rebound_cb),
+                                  binding);
+        _gssdp_client_hold_role (client, _GSSDP_CLIENT_ROLE_PUBLISHER);
+
+        return binding;
+}
+
+/* Same sequence as when becoming available, on this binding only */
+static void
+binding_announce (Binding *binding)
+{
+        GSSDPResourceGroupPrivate *priv;
+        GList *l;
+        guint i;
+
+        priv = gssdp_resource_group_get_instance_private
+                                        (binding->resource_group);
+
+        for (i = 0; i < DEFAULT_ANNOUNCEMENT_SET_SIZE; i++)
+                for (l = priv->resources.head; l != NULL; l = l->next)
+                        resource_byebye_on (l->data, binding);
+
+        for (i = 0; i < DEFAULT_ANNOUNCEMENT_SET_SIZE; i++)
+                for (l = priv->resources.head; l != NULL; l = l->next)
+                        resource_alive_on (l->data, binding);
+}
+
+/* The client may be on a new address now, let everyone know we are here */
+static void
+client_rebound_cb (G_GNUC_UNUSED GSSDPClient *client,
+                   gpointer                   user_data)
+{
+        Binding *binding = user_data;
+        GSSDPResourceGroupPrivate *priv;
+
+        priv = gssdp_resource_group_get_instance_private
+                                        (binding->resource_group);
+
+        if (priv->available)
+                binding_announce (binding);
+}
+
+/* Sends out whatever is still queued, without the usual delay */
+static void
+binding_flush (Binding *binding)
+{
+        GSSDPResourceGroupPrivate *priv;
+
+        priv = gssdp_resource_group_get_instance_private
+                                        (binding->resource_group);
+
+        if (priv->available)
+                send_queued_messages (binding,
+                                      g_queue_get_length
+                                                (binding->message_queue));
+
+        while (!g_queue_is_empty (binding->message_queue))
+                g_free (g_queue_pop_head (binding->message_queue));
+
+        /* No need to unref sources, already done on creation */
+        g_clear_pointer (&binding->message_src, g_source_destroy);
+}
+
+static void
+binding_free (Binding *binding)
+{
+        binding_flush (binding);
+        g_queue_free (binding->message_queue);
+
+        g_clear_signal_handler (&binding->message_received_id,
+                                binding->client);
+        g_clear_signal_handler (&binding->rebound_id, binding->client);
+        _gssdp_client_release_role (binding->client,
+                                    _GSSDP_CLIENT_ROLE_PUBLISHER);
+        g_object_unref (binding->client);
+
+        g_slice_free (Binding, binding);
+}
 
 static void
 gssdp_resource_group_init (GSSDPResourceGroup *resource_group)
@@ -133,7 +257,11 @@ gssdp_resource_group_init (GSSDPResourceGroup *resource_group)
         priv->max_age = SSDP_DEFAULT_MAX_AGE;
         priv->message_delay = DEFAULT_MESSAGE_DELAY;
 
-        priv->message_queue = g_queue_new ();
+        priv->bindings = g_ptr_array_new ();
+
+        priv->resources_by_id = g_hash_table_new (g_direct_hash,
+                                                  g_direct_equal);
+        g_queue_init (&priv->resources);
 }
 
 static void
@@ -216,42 +344,35 @@ gssdp_resource_group_dispose (GObject *object)
         resource_group = GSSDP_RESOURCE_GROUP (object);
         priv = gssdp_resource_group_get_instance_private (resource_group);
 
-        g_list_free_full (priv->resources, (GFreeFunc) resource_free);
-        priv->resources = NULL;
-
-        if (priv->message_queue) {
-                /* send messages without usual delay */
-                while (!g_queue_is_empty (priv->message_queue)) {
-                        if (priv->available)
-                                process_queue (resource_group);
-                        else
-                                g_free (g_queue_pop_head
-                                        (priv->message_queue));
-                }
-
-                g_clear_pointer (&priv->message_queue, g_queue_free);
-        }
+        g_hash_table_remove_all (priv->resources_by_id);
+        g_queue_clear_full (&priv->resources, (GDestroyNotify) resource_free);
 
+        g_ptr_array_foreach (priv->bindings, (GFunc) binding_free, NULL);
+        g_ptr_array_set_size (priv->bindings, 0);
 
         /* No need to unref sources, already done on creation */
-        g_clear_pointer (&priv->message_src, g_source_destroy);
         g_clear_pointer (&priv->timeout_src, g_source_destroy);
 
-        if (priv->client) {
-                if (g_signal_handler_is_connected
-                        (priv->client,
-                         priv->message_received_id)) {
-                        g_signal_handler_disconnect
-                                (priv->client,
-                                 priv->message_received_id);
-                }
-
-                g_clear_object (&priv->client);
-        }
+        g_clear_object (&priv->client);
 
         G_OBJECT_CLASS (gssdp_resource_group_parent_class)->dispose (object);
 }
 
+static void
+gssdp_resource_group_finalize (GObject *object)
+{
+        GSSDPResourceGroup *resource_group;
+        GSSDPResourceGroupPrivate *priv;
+
+        resource_group = GSSDP_RESOURCE_GROUP (object);
+        priv = gssdp_resource_group_get_instance_private (resource_group);
+
+        g_hash_table_destroy (priv->resources_by_id);
+        g_ptr_array_unref (priv->bindings);
+
+        G_OBJECT_CLASS (gssdp_resource_group_parent_class)->finalize (object);
+}
+
 /**
  * GSSDPResourceGroup:
  *
@@ -272,6 +393,7 @@ gssdp_resource_group_class_init (GSSDPResourceGroupClass *klass)
         object_class->set_property = gssdp_resource_group_set_property;
         object_class->get_property = gssdp_resource_group_get_property;
         object_class->dispose      = gssdp_resource_group_dispose;
+        object_class->finalize     = gssdp_resource_group_finalize;
 
         /**
          * GSSDPResourceGroup:client:(attributes org.gtk.Property.get=gssdp_resource_group_get_client):
@@ -378,12 +500,7 @@ gssdp_resource_group_set_client (GSSDPResourceGroup *resource_group,
         priv = gssdp_resource_group_get_instance_private (resource_group);
         priv->client = g_object_ref (client);
 
-        priv->message_received_id =
-                g_signal_connect_object (priv->client,
-                                         "message-received",
-                                         G_CALLBACK (message_received_cb),
-                                         resource_group,
-                                         0);
+        g_ptr_array_add (priv->bindings, binding_new (resource_group, client));
 
         g_object_notify (G_OBJECT (resource_group), "client");
 }
@@ -406,6 +523,123 @@ gssdp_resource_group_get_client (GSSDPResourceGroup *resource_group)
         return priv->client;
 }
 
+static Binding *
+find_binding (GSSDPResourceGroup *resource_group,
+              GSSDPClient        *client,
+              guint              *index)
+{
+        GSSDPResourceGroupPrivate *priv;
+        guint i;
+
+        priv = gssdp_resource_group_get_instance_private (resource_group);
+
+        for (i = 0; i < priv->bindings->len; i++) {
+                Binding *binding = g_ptr_array_index (priv->bindings, i);
+
+                if (binding->client == client) {
+                        if (index != NULL)
+                                *index = i;
+
+                        return binding;
+                }
+        }
+
+        return NULL;
+}
+
+/**
+ * gssdp_resource_group_add_client:
+ * @resource_group: A #GSSDPResourceGroup
+ * @client: A #GSSDPClient for another network interface
+ *
+ * Additionally announces the resources of @resource_group on the interface
+ * of @client, and answers searches received there.
+ *
+ * Resources are stored once for all clients. Occurrences of `{host}` in
+ * their locations are replaced with the host IP of the client a message is
+ * sent on, so a single resource can be published on every interface.
+ * Each client paces its messages separately, see
+ * [property@GSSDP.ResourceGroup:message-delay], while re-announcements of
+ * all clients are driven by one timer.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_group_add_client (GSSDPResourceGroup *resource_group,
+                                 GSSDPClient        *client)
+{
+        GSSDPResourceGroupPrivate *priv;
+        Binding *binding;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_GROUP (resource_group));
+        g_return_if_fail (GSSDP_IS_CLIENT (client));
+
+        priv = gssdp_resource_group_get_instance_private (resource_group);
+
+        if (find_binding (resource_group, client, NULL) != NULL)
+                return;
+
+        binding = binding_new (resource_group, client);
+        g_ptr_array_add (priv->bindings, binding);
+
+        if (priv->available)
+                binding_announce (binding);
+}
+
+/**
+ * gssdp_resource_group_remove_client:
+ * @resource_group: A #GSSDPResourceGroup
+ * @client: A #GSSDPClient added with
+ * [method@GSSDP.ResourceGroup.add_client]
+ *
+ * Stops announcing the resources of @resource_group on the interface of
+ * @client. If the group is available, its resources are announced as gone
+ * there first. The client passed on construction cannot be removed.
+ *
+ * Since: 1.8.0
+ **/
+void
+gssdp_resource_group_remove_client (GSSDPResourceGroup *resource_group,
+                                    GSSDPClient        *client)
+{
+        GSSDPResourceGroupPrivate *priv;
+        Binding *binding;
+        guint index;
+        GList *r;
+
+        g_return_if_fail (GSSDP_IS_RESOURCE_GROUP (resource_group));
+        g_return_if_fail (GSSDP_IS_CLIENT (client));
+
+        priv = gssdp_resource_group_get_instance_private (resource_group);
+
+        g_return_if_fail (client != priv->client);
+
+        binding = find_binding (resource_group, client, &index);
+        if (binding == NULL)
+                return;
+
+        g_ptr_array_remove_index (priv->bindings, index);
+
+        for (r = priv->resources.head; r != NULL; r = r->next) {
+                Resource *resource = r->data;
+                GList *l = resource->responses;
+
+                /* Drop pending answers to searches from that interface */
+                while (l != NULL) {
+                        DiscoveryResponse *response = l->data;
+
+                        l = l->next;
+                        if (response->binding == binding)
+                                discovery_response_free (response);
+                }
+
+                if (priv->available)
+                        resource_byebye_on (resource, binding);
+        }
+
+        binding_free (binding);
+}
+
 /**
  * gssdp_resource_group_set_max_age:(attributes org.gtk.Method.set_property=max-age):
  * @resource_group: A #GSSDPResourceGroup
@@ -503,12 +737,12 @@ send_initial_resource_byebye (Resource *resource)
 }
 
 static void
-send_announcement_set (GList *resources, GFunc message_function, gpointer user_data)
+send_announcement_set (GQueue *resources, GFunc message_function, gpointer user_data)
 {
         guint8 i;
 
         for (i = 0; i < DEFAULT_ANNOUNCEMENT_SET_SIZE; i++) {
-                g_list_foreach (resources, message_function, user_data);
+                g_queue_foreach (resources, message_function, user_data);
         }
 }
 
@@ -569,16 +803,16 @@ gssdp_resource_group_set_available (GSSDPResourceGroup *resource_group,
                 setup_reannouncement_timeout (resource_group);
                 /* Make sure initial byebyes are sent grouped before initial
                  * alives */
-                send_announcement_set (priv->resources,
+                send_announcement_set (&priv->resources,
                                        (GFunc) send_initial_resource_byebye,
                                        NULL);
 
-                send_announcement_set (priv->resources,
+                send_announcement_set (&priv->resources,
                                        (GFunc) resource_alive,
                                        NULL);
         } else {
                 /* Unannounce all resources */
-                send_announcement_set (priv->resources,
+                send_announcement_set (&priv->resources,
                                        (GFunc) resource_byebye,
                                        NULL);
 
@@ -623,6 +857,10 @@ gssdp_resource_group_get_available (GSSDPResourceGroup *resource_group)
  * If your resource only has one location, you can use [method@GSSDP.ResourceGroup.add_resource_simple]
  * instead.
  *
+ * A location may contain `{host}`, which is replaced with the host IP of the
+ * client each message is sent on. This is useful together with
+ * [method@GSSDP.ResourceGroup.add_client].
+ *
  * The resource id that is returned by this function can be used with
  * [method@GSSDP.ResourceGroup.remove_resource].
  *
@@ -670,10 +908,14 @@ gssdp_resource_group_add_resource (GSSDPResourceGroup *resource_group,
 
         resource->locations = g_list_copy_deep (locations, (GCopyFunc) g_strdup, NULL);
 
-        priv->resources = g_list_prepend (priv->resources, resource);
-
         resource->id = ++priv->last_resource_id;
 
+        g_queue_push_tail (&priv->resources, resource);
+        resource->link = priv->resources.tail;
+        g_hash_table_insert (priv->resources_by_id,
+                             GUINT_TO_POINTER (resource->id),
+                             resource);
+
         if (priv->available)
                 resource_alive (resource);
 
@@ -723,26 +965,65 @@ gssdp_resource_group_remove_resource (GSSDPResourceGroup *resource_group,
                                       guint               resource_id)
 {
         GSSDPResourceGroupPrivate *priv;
-        GList *l;
+        Resource *resource;
 
         g_return_if_fail (GSSDP_IS_RESOURCE_GROUP (resource_group));
         g_return_if_fail (resource_id > 0);
 
         priv = gssdp_resource_group_get_instance_private (resource_group);
-        for (l = priv->resources; l; l = l->next) {
-                Resource *resource;
+        resource = g_hash_table_lookup (priv->resources_by_id,
+                                        GUINT_TO_POINTER (resource_id));
+        if (resource == NULL)
+                return;
 
-                resource = l->data;
+        g_hash_table_remove (priv->resources_by_id,
+                             GUINT_TO_POINTER (resource_id));
 
-                if (resource->id == resource_id) {
-                        priv->resources = g_list_remove (priv->resources,
-                                                         resource);
+        g_queue_delete_link (&priv->resources, resource->link);
+        resource_free (resource);
+}
 
-                        resource_free (resource);
+/**
+ * gssdp_resource_group_lookup_resource:
+ * @resource_group: A #GSSDPResourceGroup
+ * @resource_id: The ID of the resource to look up
+ * @target: (out) (optional) (transfer none): Location to store the target
+ * of the resource
+ * @usn: (out) (optional) (transfer none): Location to store the USN of the
+ * resource
+ *
+ * Looks up the resource with ID @resource_id that was previously added to
+ * @resource_group using [method@GSSDP.ResourceGroup.add_resource].
+ *
+ * Return value: %TRUE if @resource_group contains a resource with ID
+ * @resource_id, %FALSE otherwise.
+ *
+ * Since: 1.8.0
+ **/
+gboolean
+gssdp_resource_group_lookup_resource (GSSDPResourceGroup *resource_group,
+                                      guint               resource_id,
+                                      const char        **target,
+                                      const char        **usn)
+{
+        GSSDPResourceGroupPrivate *priv;
+        Resource *resource;
 
-                        return;
-                }
-        }
+        g_return_val_if_fail (GSSDP_IS_RESOURCE_GROUP (resource_group), FALSE);
+
+        priv = gssdp_resource_group_get_instance_private (resource_group);
+        resource = g_hash_table_lookup (priv->resources_by_id,
+                                        GUINT_TO_POINTER (resource_id));
+        if (resource == NULL)
+                return FALSE;
+
+        if (target != NULL)
+                *target = resource->target;
+
+        if (usn != NULL)
+                *usn = resource->usn;
+
+        return TRUE;
 }
 
 static void
@@ -753,31 +1034,55 @@ resource_update (Resource *resource, gpointer user_data)
         char *message;
         const char *group;
         char *dest;
+        char *location;
         guint next_boot_id = GPOINTER_TO_UINT (user_data);
+        guint i;
 
         priv = gssdp_resource_group_get_instance_private
                                         (resource->resource_group);
 
-        /* Send message */
-        client = priv->client;
+        for (i = 0; i < priv->bindings->len; i++) {
+                Binding *binding = g_ptr_array_index (priv->bindings, i);
 
-        /* FIXME: UGLY V6 stuff */
-        group = _gssdp_client_get_mcast_group (client);
-        if (strchr (group, ':') != NULL)
-                dest = g_strdup_printf ("[%s]", group);
-        else
-                dest = g_strdup (group);
+                /* Send message */
+                client = binding->client;
 
-        message = g_strdup_printf (SSDP_UPDATE_MESSAGE,
-                                   dest,
-                                   (char *) resource->locations->data,
-                                   resource->target,
-                                   resource->usn,
-                                   next_boot_id);
+                /* FIXME: UGLY V6 stuff */
+                group = _gssdp_client_get_mcast_group (client);
+                if (strchr (group, ':') != NULL)
+                        dest = g_strdup_printf ("[%s]", group);
+                else
+                        dest = g_strdup (group);
 
-        queue_message (resource->resource_group, message);
+                location = expand_location (resource->locations->data,
+                                            client);
+                message = g_strdup_printf (SSDP_UPDATE_MESSAGE,
+                                           dest,
+                                           location,
+                                           resource->target,
+                                           resource->usn,
+                                           next_boot_id);
 
-        g_free (dest);
+                queue_message (binding, message);
+
+                g_free (location);
+                g_free (dest);
+        }
+}
+
+static void
+set_boot_id (GSSDPResourceGroup *resource_group, guint boot_id)
+{
+        GSSDPResourceGroupPrivate *priv;
+        guint i;
+
+        priv = gssdp_resource_group_get_instance_private (resource_group);
+
+        for (i = 0; i < priv->bindings->len; i++) {
+                Binding *binding = g_ptr_array_index (priv->bindings, i);
+
+                gssdp_client_set_boot_id (binding->client, boot_id);
+        }
 }
 
 /**
@@ -808,7 +1113,7 @@ gssdp_resource_group_update (GSSDPResourceGroup *self,
                 return;
 
         if (!priv->available) {
-                gssdp_client_set_boot_id (priv->client, next_boot_id);
+                set_boot_id (self, next_boot_id);
 
                 return;
         }
@@ -816,15 +1121,15 @@ gssdp_resource_group_update (GSSDPResourceGroup *self,
         /* Disable timeout */
         g_clear_pointer (&priv->timeout_src, g_source_destroy);
 
-        send_announcement_set (priv->resources, (GFunc) resource_update, GUINT_TO_POINTER (next_boot_id));
+        send_announcement_set (&priv->resources, (GFunc) resource_update, GUINT_TO_POINTER (next_boot_id));
 
         /* FIXME: This causes only the first of the three update messages to be correct. The other two will
          * have the new boot id as and boot id as the same value
          */
-        gssdp_client_set_boot_id (priv->client, next_boot_id);
+        set_boot_id (self, next_boot_id);
 
         setup_reannouncement_timeout (self);
-        send_announcement_set (priv->resources, (GFunc) resource_alive, NULL);
+        send_announcement_set (&priv->resources, (GFunc) resource_alive, NULL);
 }
 
 /*
@@ -839,7 +1144,7 @@ resource_group_timeout (gpointer user_data)
         resource_group = GSSDP_RESOURCE_GROUP (user_data);
         priv = gssdp_resource_group_get_instance_private (resource_group);
 
-        send_announcement_set (priv->resources, (GFunc) resource_alive, NULL);
+        send_announcement_set (&priv->resources, (GFunc) resource_alive, NULL);
 
         return TRUE;
 }
@@ -855,6 +1160,7 @@ message_received_cb (G_GNUC_UNUSED GSSDPClient *client,
                      SoupMessageHeaders        *headers,
                      gpointer                   user_data)
 {
+        Binding *binding = user_data;
         GSSDPResourceGroup *resource_group;
         GSSDPResourceGroupPrivate *priv;
         const char *target, *mx_str, *version_str, *man;
@@ -862,7 +1168,7 @@ message_received_cb (G_GNUC_UNUSED GSSDPClient *client,
         int mx, version;
         GList *l;
 
-        resource_group = GSSDP_RESOURCE_GROUP (user_data);
+        resource_group = binding->resource_group;
         priv = gssdp_resource_group_get_instance_private (resource_group);
 
         /* Only process if we are available */
@@ -909,7 +1215,7 @@ message_received_cb (G_GNUC_UNUSED GSSDPClient *client,
                 version = 0;
 
         /* Find matching resource */
-        for (l = priv->resources; l != NULL; l = l->next) {
+        for (l = priv->resources.head; l != NULL; l = l->next) {
                 Resource *resource;
 
                 resource = l->data;
@@ -933,6 +1239,7 @@ message_received_cb (G_GNUC_UNUSED GSSDPClient *client,
                         response->dest_ip   = g_strdup (from_ip);
                         response->dest_port = from_port;
                         response->resource  = resource;
+                        response->binding   = binding;
 
                         if (want_all)
                                 response->target = g_strdup (resource->target);
@@ -957,11 +1264,40 @@ message_received_cb (G_GNUC_UNUSED GSSDPClient *client,
         }
 }
 
+/*
+ * Replace the host placeholder in @location with the address of @client
+ */
+static char *
+expand_location (const char *location, GSSDPClient *client)
+{
+        const char *host_ip;
+        char *host;
+        GString *expanded;
+
+        if (strstr (location, LOCATION_HOST_PLACEHOLDER) == NULL)
+                return g_strdup (location);
+
+        host_ip = gssdp_client_get_host_ip (client);
+        if (host_ip != NULL && strchr (host_ip, ':') != NULL)
+                host = g_strdup_printf ("[%s]", host_ip);
+        else
+                host = g_strdup (host_ip);
+
+        expanded = g_string_new (location);
+        g_string_replace (expanded,
+                          LOCATION_HOST_PLACEHOLDER,
+                          host != NULL ? host : "",
+                          0);
+        g_free (host);
+
+        return g_string_free (expanded, FALSE);
+}
+
 /*
  * Construct the AL (Alternative Locations) header for @resource
  */
 static char *
-construct_al (Resource *resource)
+construct_al (Resource *resource, GSSDPClient *client)
 {
         GString *al_string;
         GList *l;
@@ -973,9 +1309,12 @@ construct_al (Resource *resource)
         al_string = g_string_new ("AL: ");
 
         for (l = resource->locations->next; l; l = l->next) {
+                char *location = expand_location (l->data, client);
+
                 g_string_append_c (al_string, '<');
-                g_string_append (al_string, l->data);
+                g_string_append (al_string, location);
                 g_string_append_c (al_string, '>');
+                g_free (location);
         }
 
         g_string_append (al_string, "\r\n");
@@ -1015,17 +1354,20 @@ discovery_response_timeout (gpointer user_data)
         char *al, *date_str, *message;
         guint max_age;
         char *usn;
+        char *location;
         GSSDPResourceGroup *self = response->resource->resource_group;
         GSSDPResourceGroupPrivate *priv;
 
         priv = gssdp_resource_group_get_instance_private (self);
 
-        /* Send message */
-        client = priv->client;
+        /* Answer on the interface the search came in on */
+        client = response->binding->client;
 
         max_age = priv->max_age;
 
-        al = construct_al (response->resource);
+        location = expand_location (response->resource->locations->data,
+                                    client);
+        al = construct_al (response->resource, client);
         usn = construct_usn (response->resource->usn,
                              response->target,
                              response->resource->target);
@@ -1034,7 +1376,7 @@ discovery_response_timeout (gpointer user_data)
         g_date_time_unref (date);
 
         message = g_strdup_printf (SSDP_DISCOVERY_RESPONSE,
-                                   (char *) response->resource->locations->data,
+                                   location,
                                    al ? al : "",
                                    usn,
                                    gssdp_client_get_server_id (client),
@@ -1051,6 +1393,7 @@ discovery_response_timeout (gpointer user_data)
         g_free (message);
         g_free (date_str);
         g_free (al);
+        g_free (location);
         g_free (usn);
 
         discovery_response_free (response);
@@ -1081,63 +1424,91 @@ discovery_response_free (DiscoveryResponse *response)
 static gboolean
 process_queue (gpointer data)
 {
-        GSSDPResourceGroup *resource_group;
+        Binding *binding = data;
         GSSDPResourceGroupPrivate *priv;
-        GSSDPClient *client;
-        char *message;
-
-        resource_group = GSSDP_RESOURCE_GROUP (data);
-        priv = gssdp_resource_group_get_instance_private (resource_group);
 
-        if (g_queue_is_empty (priv->message_queue)) {
+        if (g_queue_is_empty (binding->message_queue)) {
                 /* this is the timeout after last message in queue */
-                priv->message_src = NULL;
+                binding->message_src = NULL;
 
                 return FALSE;
         }
 
-        client = priv->client;
-        message = g_queue_pop_head (priv->message_queue);
-
-        _gssdp_client_send_message (client,
-                                    NULL,
-                                    0,
-                                    message,
-                                    _GSSDP_DISCOVERY_RESPONSE);
-        g_free (message);
+        priv = gssdp_resource_group_get_instance_private
+                                        (binding->resource_group);
+
+        /* Without a delay there is no point in spacing the messages out,
+         * send everything that is queued in one go */
+        if (priv->message_delay == 0)
+                send_queued_messages (binding,
+                                      g_queue_get_length
+                                                (binding->message_queue));
+        else
+                send_queued_messages (binding, 1);
 
         return TRUE;
 }
 
+/*
+ * Sends the first @n_messages queued messages of @binding in one batch
+ */
+static void
+send_queued_messages (Binding *binding, guint n_messages)
+{
+        char **messages;
+        guint i;
+
+        n_messages = MIN (n_messages,
+                          g_queue_get_length (binding->message_queue));
+        if (n_messages == 0)
+                return;
+
+        messages = g_new (char *, n_messages);
+        for (i = 0; i < n_messages; i++)
+                messages[i] = g_queue_pop_head (binding->message_queue);
+
+        _gssdp_client_send_messages (binding->client,
+                                     NULL,
+                                     0,
+                                     (const char *const *) messages,
+                                     n_messages,
+                                     _GSSDP_DISCOVERY_RESPONSE);
+
+        for (i = 0; i < n_messages; i++)
+                g_free (messages[i]);
+        g_free (messages);
+}
+
 /*
  * Add a message to sending queue
  * 
  * Do not free @message.
  */
 static void
-queue_message (GSSDPResourceGroup *resource_group,
-               char               *message)
+queue_message (Binding *binding,
+               char    *message)
 {
         GSSDPResourceGroupPrivate *priv;
-        priv = gssdp_resource_group_get_instance_private (resource_group);
+        priv = gssdp_resource_group_get_instance_private
+                                        (binding->resource_group);
 
-        g_queue_push_tail (priv->message_queue, message);
+        g_queue_push_tail (binding->message_queue, message);
 
-        if (priv->message_src != NULL) {
+        if (binding->message_src != NULL) {
                 return;
         }
 
         /* nothing in the queue: process message immediately
            and add a timeout for (possible) next message */
-        process_queue (resource_group);
-        priv->message_src = g_timeout_source_new (priv->message_delay);
-        g_source_set_callback (priv->message_src,
+        process_queue (binding);
+        binding->message_src = g_timeout_source_new (priv->message_delay);
+        g_source_set_callback (binding->message_src,
                                process_queue,
-                               resource_group,
+                               binding,
                                NULL);
-        g_source_attach (priv->message_src,
+        g_source_attach (binding->message_src,
                         g_main_context_get_thread_default ());
-        g_source_unref (priv->message_src);
+        g_source_unref (binding->message_src);
 }
 
 /*
@@ -1145,6 +1516,23 @@ queue_message (GSSDPResourceGroup *resource_group,
  */
 static void
 resource_alive (Resource *resource)
+{
+        GSSDPResourceGroupPrivate *priv;
+        guint i;
+
+        priv = gssdp_resource_group_get_instance_private
+                                        (resource->resource_group);
+
+        /* Send initial byebye if not sent already */
+        send_initial_resource_byebye (resource);
+
+        for (i = 0; i < priv->bindings->len; i++)
+                resource_alive_on (resource,
+                                   g_ptr_array_index (priv->bindings, i));
+}
+
+static void
+resource_alive_on (Resource *resource, Binding *binding)
 {
         GSSDPResourceGroupPrivate *priv;
         GSSDPClient *client;
@@ -1152,19 +1540,18 @@ resource_alive (Resource *resource)
         char *al, *message;
         const char *group;
         char *dest;
+        char *location;
 
         priv = gssdp_resource_group_get_instance_private
                                         (resource->resource_group);
 
-        /* Send initial byebye if not sent already */
-        send_initial_resource_byebye (resource);
-
         /* Send message */
-        client = priv->client;
+        client = binding->client;
 
         max_age = priv->max_age;
 
-        al = construct_al (resource);
+        location = expand_location (resource->locations->data, client);
+        al = construct_al (resource, client);
 
         /* FIXME: UGLY V6 stuff */
         group = _gssdp_client_get_mcast_group (client);
@@ -1176,15 +1563,16 @@ resource_alive (Resource *resource)
         message = g_strdup_printf (SSDP_ALIVE_MESSAGE,
                                    dest,
                                    max_age,
-                                   (char *) resource->locations->data,
+                                   location,
                                    al ? al : "",
                                    gssdp_client_get_server_id (client),
                                    resource->target,
                                    resource->usn);
 
-        queue_message (resource->resource_group, message);
+        queue_message (binding, message);
 
         g_free (dest);
+        g_free (location);
         g_free (al);
 }
 
@@ -1193,15 +1581,27 @@ resource_alive (Resource *resource)
  */
 static void
 resource_byebye (Resource *resource)
+{
+        GSSDPResourceGroupPrivate *priv;
+        guint i;
+
+        priv = gssdp_resource_group_get_instance_private
+                                        (resource->resource_group);
+
+        for (i = 0; i < priv->bindings->len; i++)
+                resource_byebye_on (resource,
+                                    g_ptr_array_index (priv->bindings, i));
+}
+
+static void
+resource_byebye_on (Resource *resource, Binding *binding)
 {
         char *message = NULL;
         const char *group = NULL;
         char *host = NULL;
-        GSSDPResourceGroupPrivate *priv = NULL;
         GSSDPClient *client = NULL;
 
-        priv = gssdp_resource_group_get_instance_private (resource->resource_group);
-        client = priv->client;
+        client = binding->client;
 
         /* FIXME: UGLY V6 stuff */
         group = _gssdp_client_get_mcast_group (client);
@@ -1216,7 +1616,7 @@ resource_byebye (Resource *resource)
                                    resource->target,
                                    resource->usn);
 
-        queue_message (resource->resource_group, message);
+        queue_message (binding, message);
 
         g_free (host);
 }
@@ -40,6 +40,14 @@ gssdp_resource_group_new                 (GSSDPClient        *client);
 GSSDPClient *
 gssdp_resource_group_get_client          (GSSDPResourceGroup *resource_group);
 
+void
+gssdp_resource_group_add_client          (GSSDPResourceGroup *resource_group,
+                                          GSSDPClient        *client);
+
+void
+gssdp_resource_group_remove_client       (GSSDPResourceGroup *resource_group,
+                                          GSSDPClient        *client);
+
 void
 gssdp_resource_group_set_max_age         (GSSDPResourceGroup *resource_group,
                                           guint               max_age);
@@ -77,6 +85,12 @@ void
 gssdp_resource_group_remove_resource     (GSSDPResourceGroup *resource_group,
                                           guint               resource_id);
 
+gboolean
+gssdp_resource_group_lookup_resource     (GSSDPResourceGroup *resource_group,
+                                          guint               resource_id,
+                                          const char        **target,
+                                          const char        **usn);
+
 void
 gssdp_resource_group_update              (GSSDPResourceGroup *resource_group,
                                           guint               new_boot_id);
@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2024 GSSDP contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#ifndef GSSDP_RESOURCE_INFO_PRIVATE_H
+#define GSSDP_RESOURCE_INFO_PRIVATE_H
+
+#include "gssdp-resource-info.h"
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL GSSDPResourceInfo *
+_gssdp_resource_info_new (const char  *usn,
+                          const GList *locations,
+                          const char  *source_ip,
+                          gint64       expires,
+                          gint64       last_seen,
+                          gint32       boot_id,
+                          gint32       config_id);
+
+G_END_DECLS
+
+#endif /* GSSDP_RESOURCE_INFO_PRIVATE_H */
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2024 GSSDP contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#include <config.h>
+
+#include "gssdp-resource-info-private.h"
+
+/**
+ * GSSDPResourceInfo:
+ *
+ * An immutable snapshot of a resource found on the network.
+ *
+ * Since: 1.8.0
+ */
+struct _GSSDPResourceInfo {
+        gatomicrefcount ref_count;
+
+        char   *usn;
+        GList  *locations;
+        char   *source_ip;
+        gint64  expires;
+        gint64  last_seen;
+        gint32  boot_id;
+        gint32  config_id;
+};
+
+G_DEFINE_BOXED_TYPE (GSSDPResourceInfo,
+                     gssdp_resource_info,
+                     gssdp_resource_info_ref,
+                     gssdp_resource_info_unref)
+
+GSSDPResourceInfo *
+_gssdp_resource_info_new (const char  *usn,
+                          const GList *locations,
+                          const char  *source_ip,
+                          gint64       expires,
+                          gint64       last_seen,
+                          gint32       boot_id,
+                          gint32       config_id)
+{
+        GSSDPResourceInfo *info;
+
+        info = g_slice_new0 (GSSDPResourceInfo);
+        g_atomic_ref_count_init (&info->ref_count);
+
+        info->usn = g_strdup (usn);
+        info->locations = g_list_copy_deep ((GList *) locations,
+                                            (GCopyFunc) g_strdup,
+                                            NULL);
+        info->source_ip = g_strdup (source_ip);
+        info->expires = expires;
+        info->last_seen = last_seen;
+        info->boot_id = boot_id;
+        info->config_id = config_id;
+
+        return info;
+}
+
+/**
+ * gssdp_resource_info_ref:
+ * @info: A #GSSDPResourceInfo
+ *
+ * Increases the reference count of @info.
+ *
+ * Returns: (transfer full): @info
+ *
+ * Since: 1.8.0
+ */
+GSSDPResourceInfo *
+gssdp_resource_info_ref (GSSDPResourceInfo *info)
+{
+        g_return_val_if_fail (info != NULL, NULL);
+
+        g_atomic_ref_count_inc (&info->ref_count);
+
+        return info;
+}
+
+/**
+ * gssdp_resource_info_unref:
+ * @info: (transfer full): A #GSSDPResourceInfo
+ *
+ * Decreases the reference count of @info and frees it if it drops to 0.
+ *
+ * Since: 1.8.0
+ */
+void
+gssdp_resource_info_unref (GSSDPResourceInfo *info)
+{
+        g_return_if_fail (info != NULL);
+
+        if (!g_atomic_ref_count_dec (&info->ref_count))
+                return;
+
+        g_free (info->usn);
+        g_list_free_full (info->locations, g_free);
+        g_free (info->source_ip);
+        g_slice_free (GSSDPResourceInfo, info);
+}
+
+/**
+ * gssdp_resource_info_get_usn:
+ * @info: A #GSSDPResourceInfo
+ *
+ * Returns: The USN of the resource
+ *
+ * Since: 1.8.0
+ */
+const char *
+gssdp_resource_info_get_usn (GSSDPResourceInfo *info)
+{
+        g_return_val_if_fail (info != NULL, NULL);
+
+        return info->usn;
+}
+
+/**
+ * gssdp_resource_info_get_locations:
+ * @info: A #GSSDPResourceInfo
+ *
+ * Returns: (transfer none) (element-type utf8): The locations of the
+ * resource
+ *
+ * Since: 1.8.0
+ */
+const GList *
+gssdp_resource_info_get_locations (GSSDPResourceInfo *info)
+{
+        g_return_val_if_fail (info != NULL, NULL);
+
+        return info->locations;
+}
+
+/**
+ * gssdp_resource_info_get_source_ip:
+ * @info: A #GSSDPResourceInfo
+ *
+ * Returns: (nullable): The IP address the resource was last announced
+ * from, or %NULL if unknown
+ *
+ * Since: 1.8.0
+ */
+const char *
+gssdp_resource_info_get_source_ip (GSSDPResourceInfo *info)
+{
+        g_return_val_if_fail (info != NULL, NULL);
+
+        return info->source_ip;
+}
+
+/**
+ * gssdp_resource_info_get_expires:
+ * @info: A #GSSDPResourceInfo
+ *
+ * Returns: The time the resource expires, in the same clock as
+ * [func@GLib.get_real_time]
+ *
+ * Since: 1.8.0
+ */
+gint64
+gssdp_resource_info_get_expires (GSSDPResourceInfo *info)
+{
+        g_return_val_if_fail (info != NULL, 0);
+
+        return info->expires;
+}
+
+/**
+ * gssdp_resource_info_get_remaining_ttl:
+ * @info: A #GSSDPResourceInfo
+ *
+ * Returns: The number of seconds from now until the resource expires, or 0
+ * if it already has
+ *
+ * Since: 1.8.0
+ */
+guint
+gssdp_resource_info_get_remaining_ttl (GSSDPResourceInfo *info)
+{
+        gint64 remaining;
+
+        g_return_val_if_fail (info != NULL, 0);
+
+        remaining = info->expires - g_get_real_time ();
+        if (remaining <= 0)
+                return 0;
+
+        return MIN (remaining / G_USEC_PER_SEC, G_MAXUINT);
+}
+
+/**
+ * gssdp_resource_info_get_last_seen:
+ * @info: A #GSSDPResourceInfo
+ *
+ * Returns: The time the resource was last heard of, in the same clock as
+ * [func@GLib.get_real_time], or 0 if unknown
+ *
+ * Since: 1.8.0
+ */
+gint64
+gssdp_resource_info_get_last_seen (GSSDPResourceInfo *info)
+{
+        g_return_val_if_fail (info != NULL, 0);
+
+        return info->last_seen;
+}
+
+/**
+ * gssdp_resource_info_get_boot_id:
+ * @info: A #GSSDPResourceInfo
+ *
+ * Returns: The value of the BOOTID.UPNP.ORG header, or -1 if unknown
+ *
+ * Since: 1.8.0
+ */
+gint32
+gssdp_resource_info_get_boot_id (GSSDPResourceInfo *info)
+{
+        g_return_val_if_fail (info != NULL, -1);
+
+        return info->boot_id;
+}
+
+/**
+ * gssdp_resource_info_get_config_id:
+ * @info: A #GSSDPResourceInfo
+ *
+ * Returns: The value of the CONFIGID.UPNP.ORG header, or -1 if unknown
+ *
+ * Since: 1.8.0
+ */
+gint32
+gssdp_resource_info_get_config_id (GSSDPResourceInfo *info)
+{
+        g_return_val_if_fail (info != NULL, -1);
+
+        return info->config_id;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2024 GSSDP contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#ifndef GSSDP_RESOURCE_INFO_H
+#define GSSDP_RESOURCE_INFO_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GSSDP_TYPE_RESOURCE_INFO (gssdp_resource_info_get_type ())
+
+typedef struct _GSSDPResourceInfo GSSDPResourceInfo;
+
+GType
+gssdp_resource_info_get_type        (void) G_GNUC_CONST;
+
+GSSDPResourceInfo *
+gssdp_resource_info_ref             (GSSDPResourceInfo *info);
+
+void
+gssdp_resource_info_unref           (GSSDPResourceInfo *info);
+
+const char *
+gssdp_resource_info_get_usn         (GSSDPResourceInfo *info);
+
+const GList *
+gssdp_resource_info_get_locations   (GSSDPResourceInfo *info);
+
+const char *
+gssdp_resource_info_get_source_ip   (GSSDPResourceInfo *info);
+
+gint64
+gssdp_resource_info_get_expires     (GSSDPResourceInfo *info);
+
+guint
+gssdp_resource_info_get_remaining_ttl (GSSDPResourceInfo *info);
+
+gint64
+gssdp_resource_info_get_last_seen   (GSSDPResourceInfo *info);
+
+gint32
+gssdp_resource_info_get_boot_id     (GSSDPResourceInfo *info);
+
+gint32
+gssdp_resource_info_get_config_id   (GSSDPResourceInfo *info);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GSSDPResourceInfo, gssdp_resource_info_unref)
+
+G_END_DECLS
+
+#endif /* GSSDP_RESOURCE_INFO_H */
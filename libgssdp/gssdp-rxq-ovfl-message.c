@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2024 GSSDP contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#include <config.h>
+
+#include "gssdp-rxq-ovfl-message.h"
+
+#include <string.h>
+#include <sys/socket.h>
+
+/* Control message carrying the number of datagrams the kernel dropped on a
+ * socket because its receive queue was full, see SO_RXQ_OVFL in socket(7).
+ * The counter is cumulative since the socket was created.
+ */
+struct _GSSDPRxqOvflMessage {
+        GSocketControlMessage parent;
+
+        guint32 drops;
+};
+
+struct _GSSDPRxqOvflMessageClass {
+        GSocketControlMessageClass parent_class;
+};
+
+G_DEFINE_TYPE (GSSDPRxqOvflMessage,
+               gssdp_rxq_ovfl_message,
+               G_TYPE_SOCKET_CONTROL_MESSAGE)
+
+enum {
+        PROP_0,
+        PROP_DROPS
+};
+
+static gsize
+gssdp_rxq_ovfl_message_get_size (GSocketControlMessage *msg)
+{
+        return sizeof (guint32);
+}
+
+static int
+gssdp_rxq_ovfl_message_get_level (GSocketControlMessage *msg)
+{
+        return SOL_SOCKET;
+}
+
+static int
+gssdp_rxq_ovfl_message_get_msg_type (GSocketControlMessage *msg)
+{
+        return SO_RXQ_OVFL;
+}
+
+static void
+gssdp_rxq_ovfl_message_get_property (GObject    *object,
+                                     guint       property_id,
+                                     GValue     *value,
+                                     GParamSpec *pspec)
+{
+        GSSDPRxqOvflMessage *self = GSSDP_RXQ_OVFL_MESSAGE (object);
+
+        switch (property_id) {
+        case PROP_DROPS:
+                g_value_set_uint (value, self->drops);
+                break;
+        default:
+                G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+                break;
+        }
+}
+
+static void
+gssdp_rxq_ovfl_message_set_property (GObject      *object,
+                                     guint         property_id,
+                                     const GValue *value,
+                                     GParamSpec   *pspec)
+{
+        GSSDPRxqOvflMessage *self = GSSDP_RXQ_OVFL_MESSAGE (object);
+
+        switch (property_id) {
+        case PROP_DROPS:
+                self->drops = g_value_get_uint (value);
+                break;
+        default:
+                G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+                break;
+        }
+}
+
+static GSocketControlMessage *
+gssdp_rxq_ovfl_message_deserialize (int      level,
+                                    int      type,
+                                    gsize    size,
+                                    gpointer data)
+{
+        guint32 drops;
+
+        if (level != SOL_SOCKET || type != SO_RXQ_OVFL)
+                return NULL;
+
+        if (size < sizeof (guint32))
+                return NULL;
+
+        memcpy (&drops, data, sizeof (guint32));
+
+        return gssdp_rxq_ovfl_message_new (drops);
+}
+
+static void
+gssdp_rxq_ovfl_message_init (GSSDPRxqOvflMessage *self)
+{
+}
+
+static void
+gssdp_rxq_ovfl_message_class_init (GSSDPRxqOvflMessageClass *klass)
+{
+        GSocketControlMessageClass *scm_class =
+                G_SOCKET_CONTROL_MESSAGE_CLASS (klass);
+
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+        scm_class->get_size = gssdp_rxq_ovfl_message_get_size;
+        scm_class->get_level = gssdp_rxq_ovfl_message_get_level;
+        scm_class->get_type = gssdp_rxq_ovfl_message_get_msg_type;
+        scm_class->deserialize = gssdp_rxq_ovfl_message_deserialize;
+
+        object_class->get_property = gssdp_rxq_ovfl_message_get_property;
+        object_class->set_property = gssdp_rxq_ovfl_message_set_property;
+
+        g_object_class_install_property
+                (object_class,
+                 PROP_DROPS,
+                 g_param_spec_uint ("drops",
+                                    "drops",
+                                    "Datagrams dropped by the kernel on this socket",
+                                    0,
+                                    G_MAXUINT32,
+                                    0,
+                                    G_PARAM_READWRITE |
+                                    G_PARAM_CONSTRUCT |
+                                    G_PARAM_STATIC_STRINGS));
+}
+
+GSocketControlMessage *
+gssdp_rxq_ovfl_message_new (guint32 drops)
+{
+        return G_SOCKET_CONTROL_MESSAGE (
+                g_object_new (GSSDP_TYPE_RXQ_OVFL_MESSAGE,
+                              "drops", drops,
+                              NULL));
+}
+
+guint32
+gssdp_rxq_ovfl_message_get_drops (GSSDPRxqOvflMessage *message)
+{
+        g_return_val_if_fail (GSSDP_IS_RXQ_OVFL_MESSAGE (message), 0);
+
+        return message->drops;
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2024 GSSDP contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#ifndef GSSDP_RXQ_OVFL_MESSAGE_H
+#define GSSDP_RXQ_OVFL_MESSAGE_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GSSDP_TYPE_RXQ_OVFL_MESSAGE (gssdp_rxq_ovfl_message_get_type())
+
+G_DECLARE_FINAL_TYPE (GSSDPRxqOvflMessage,
+                      gssdp_rxq_ovfl_message,
+                      GSSDP,
+                      RXQ_OVFL_MESSAGE,
+                      GSocketControlMessage)
+
+G_GNUC_INTERNAL GSocketControlMessage *
+gssdp_rxq_ovfl_message_new (guint32 drops);
+
+G_GNUC_INTERNAL guint32
+gssdp_rxq_ovfl_message_get_drops (GSSDPRxqOvflMessage *message);
+
+G_END_DECLS
+
+#endif /* GSSDP_RXQ_OVFL_MESSAGE_H */
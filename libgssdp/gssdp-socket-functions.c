@@ -33,7 +33,18 @@
     #include <arpa/inet.h>
 #endif
 
+#ifdef HAVE_SOCKET_FILTER
+    #include <linux/filter.h>
+#endif
+
 #include "gssdp-pktinfo6-message.h"
+#ifdef HAVE_SO_RXQ_OVFL
+#include "gssdp-rxq-ovfl-message.h"
+#endif
+#ifdef HAVE_SO_TIMESTAMPNS
+#include "gssdp-timestamp-message.h"
+#endif
+
 static char*
 gssdp_socket_error_message (int error) {
 #ifdef G_OS_WIN32
@@ -178,3 +189,441 @@ gssdp_socket_enable_info         (GSocket *socket,
     return TRUE;
 #endif
 }
+
+gboolean
+gssdp_socket_set_receive_buffer_size (GSocket *socket,
+                                      guint    size,
+                                      GError **error)
+{
+        int value = (int) MIN (size, G_MAXINT);
+
+        return gssdp_socket_option_set (socket,
+                                        SOL_SOCKET,
+                                        SO_RCVBUF,
+                                        (char *) &value,
+                                        sizeof (value),
+                                        error);
+}
+
+gboolean
+gssdp_socket_enable_drop_count (GSocket *socket,
+                                gboolean enable,
+                                GError **error)
+{
+#ifdef HAVE_SO_RXQ_OVFL
+        /* Register the type so g_socket_control_message_deserialize() will
+         * find it */
+        g_type_ensure (GSSDP_TYPE_RXQ_OVFL_MESSAGE);
+
+        return gssdp_socket_option_set (socket,
+                                        SOL_SOCKET,
+                                        SO_RXQ_OVFL,
+                                        (char *) &enable,
+                                        sizeof (enable),
+                                        error);
+#else
+    __GSSDP_UNUSED (socket);
+    __GSSDP_UNUSED (enable);
+    __GSSDP_UNUSED (error);
+
+    return TRUE;
+#endif
+}
+
+gboolean
+gssdp_socket_enable_timestamps (GSocket *socket,
+                                gboolean enable,
+                                GError **error)
+{
+#ifdef HAVE_SO_TIMESTAMPNS
+        /* Register the type so g_socket_control_message_deserialize() will
+         * find it */
+        g_type_ensure (GSSDP_TYPE_TIMESTAMP_MESSAGE);
+
+        return gssdp_socket_option_set (socket,
+                                        SOL_SOCKET,
+                                        SO_TIMESTAMPNS,
+                                        (char *) &enable,
+                                        sizeof (enable),
+                                        error);
+#else
+    __GSSDP_UNUSED (socket);
+    __GSSDP_UNUSED (enable);
+    __GSSDP_UNUSED (error);
+
+    return TRUE;
+#endif
+}
+
+/*
+ * Lets the kernel drop the kinds of SSDP messages not set in @accept before
+ * they are queued on @socket. Any other datagram passes.
+ *
+ * If @n_shards is larger than 1, the socket additionally only receives
+ * datagrams whose source address hashes to @shard, so a set of sockets bound
+ * to the same port can split the traffic between them. Datagrams from one
+ * source always end up on the same socket.
+ */
+gboolean
+gssdp_socket_set_message_filter (GSocket                *socket,
+                                 GSSDPSocketAcceptFlags  accept,
+                                 guint                   shard,
+                                 guint                   n_shards,
+                                 GError                **error)
+{
+#ifdef HAVE_SOCKET_FILTER
+        /* The first four bytes of each kind of message, in the same order
+         * as the flags */
+        static const guint32 prefixes[] = {
+                0x4d2d5345, /* "M-SE" */
+                0x4e4f5449, /* "NOTI" */
+                0x48545450, /* "HTTP" */
+        };
+        struct sock_filter code[G_N_ELEMENTS (prefixes) + 6];
+        struct sock_fprog program;
+        guint shard_check = 0;
+        guint first_prefix;
+        guint n = 0;
+        guint i;
+
+        if ((accept & GSSDP_SOCKET_ACCEPT_ALL) == GSSDP_SOCKET_ACCEPT_ALL &&
+            n_shards <= 1) {
+                int value = 0;
+
+                return gssdp_socket_option_set (socket,
+                                                SOL_SOCKET,
+                                                SO_DETACH_FILTER,
+                                                (char *) &value,
+                                                sizeof (value),
+                                                error);
+        }
+
+        if (n_shards > 1) {
+                /* Hash the source address, or the last 32 bits of it for
+                 * IPv6 */
+                guint offset = 12;
+
+                if (g_socket_get_family (socket) == G_SOCKET_FAMILY_IPV6)
+                        offset = 20;
+
+                code[n++] = (struct sock_filter)
+                        BPF_STMT (BPF_LD | BPF_W | BPF_ABS,
+                                  SKF_NET_OFF + offset);
+                code[n++] = (struct sock_filter)
+                        BPF_STMT (BPF_ALU | BPF_MOD | BPF_K, n_shards);
+                shard_check = n;
+                code[n++] = (struct sock_filter)
+                        BPF_JUMP (BPF_JMP | BPF_JEQ | BPF_K, shard, 0, 0);
+        }
+
+        /* On UDP sockets the packet starts at the UDP header, so the payload
+         * is at offset 8 */
+        first_prefix = n + 1;
+        if ((accept & GSSDP_SOCKET_ACCEPT_ALL) != GSSDP_SOCKET_ACCEPT_ALL)
+                code[n++] = (struct sock_filter)
+                        BPF_STMT (BPF_LD | BPF_W | BPF_ABS, 8);
+
+        for (i = 0; i < G_N_ELEMENTS (prefixes); i++) {
+                if (accept & (1 << i))
+                        continue;
+
+                /* Jumps are filled in below, once the length is known */
+                code[n++] = (struct sock_filter)
+                        BPF_JUMP (BPF_JMP | BPF_JEQ | BPF_K, prefixes[i], 0, 0);
+        }
+
+        /* Everything that doesn't match goes to the final "drop" statement */
+        for (i = first_prefix; i < n; i++)
+                code[i].jt = n - i;
+
+        if (n_shards > 1)
+                code[shard_check].jf = n - shard_check;
+
+        code[n++] = (struct sock_filter) BPF_STMT (BPF_RET | BPF_K,
+                                                   G_MAXUINT32);
+        code[n++] = (struct sock_filter) BPF_STMT (BPF_RET | BPF_K, 0);
+
+        program.len = n;
+        program.filter = code;
+
+        return gssdp_socket_option_set (socket,
+                                        SOL_SOCKET,
+                                        SO_ATTACH_FILTER,
+                                        (char *) &program,
+                                        sizeof (program),
+                                        error);
+#else
+    __GSSDP_UNUSED (socket);
+    __GSSDP_UNUSED (accept);
+    __GSSDP_UNUSED (shard);
+    __GSSDP_UNUSED (n_shards);
+    __GSSDP_UNUSED (error);
+
+    return TRUE;
+#endif
+}
+
+/*
+ * Look up the level and name of the socket option behind @option for
+ * sockets of @family. Returns FALSE if the platform does not have it.
+ */
+static gboolean
+gssdp_socket_option_lookup (GSocketFamily     family,
+                            GSSDPSocketOption option,
+                            int              *level,
+                            int              *name)
+{
+        switch (option) {
+        case GSSDP_SOCKET_OPTION_RECEIVE_BUFFER_SIZE:
+                *level = SOL_SOCKET;
+                *name = SO_RCVBUF;
+
+                return TRUE;
+        case GSSDP_SOCKET_OPTION_SEND_BUFFER_SIZE:
+                *level = SOL_SOCKET;
+                *name = SO_SNDBUF;
+
+                return TRUE;
+        case GSSDP_SOCKET_OPTION_DSCP:
+                if (family == G_SOCKET_FAMILY_IPV6) {
+#ifdef IPV6_TCLASS
+                        *level = IPPROTO_IPV6;
+                        *name = IPV6_TCLASS;
+
+                        return TRUE;
+#else
+                        return FALSE;
+#endif
+                }
+
+                *level = IPPROTO_IP;
+                *name = IP_TOS;
+
+                return TRUE;
+        case GSSDP_SOCKET_OPTION_PRIORITY:
+#ifdef SO_PRIORITY
+                *level = SOL_SOCKET;
+                *name = SO_PRIORITY;
+
+                return TRUE;
+#else
+                return FALSE;
+#endif
+        case GSSDP_SOCKET_OPTION_BUSY_POLL:
+#ifdef SO_BUSY_POLL
+                *level = SOL_SOCKET;
+                *name = SO_BUSY_POLL;
+
+                return TRUE;
+#else
+                return FALSE;
+#endif
+        case GSSDP_SOCKET_OPTION_MULTICAST_ALL:
+                if (family == G_SOCKET_FAMILY_IPV6) {
+#ifdef IPV6_MULTICAST_ALL
+                        *level = IPPROTO_IPV6;
+                        *name = IPV6_MULTICAST_ALL;
+
+                        return TRUE;
+#else
+                        return FALSE;
+#endif
+                }
+
+#ifdef IP_MULTICAST_ALL
+                *level = IPPROTO_IP;
+                *name = IP_MULTICAST_ALL;
+
+                return TRUE;
+#else
+                return FALSE;
+#endif
+        case GSSDP_SOCKET_OPTION_MULTICAST_LOOPBACK:
+        default:
+                /* Handled by GSocket */
+                return FALSE;
+        }
+}
+
+static gboolean
+gssdp_socket_set_option_value (GSocket          *socket,
+                               GSSDPSocketOption option,
+                               gint              value,
+                               GError          **error)
+{
+        int level, name;
+
+        if (option == GSSDP_SOCKET_OPTION_MULTICAST_LOOPBACK) {
+                g_socket_set_multicast_loopback (socket, value != 0);
+
+                return TRUE;
+        }
+
+        if (!gssdp_socket_option_lookup (g_socket_get_family (socket),
+                                         option,
+                                         &level,
+                                         &name)) {
+                g_set_error_literal (error,
+                                     G_IO_ERROR,
+                                     G_IO_ERROR_NOT_SUPPORTED,
+                                     "Socket option not supported on this "
+                                     "platform");
+
+                return FALSE;
+        }
+
+        /* DSCP is the upper six bits of the traffic class */
+        if (option == GSSDP_SOCKET_OPTION_DSCP)
+                value <<= 2;
+
+        return gssdp_socket_option_set (socket,
+                                        level,
+                                        name,
+                                        (char *) &value,
+                                        sizeof (value),
+                                        error);
+}
+
+/*
+ * Applies all options of @tuning that differ from the system default to
+ * @socket. Multicast loopback is left to the caller, it only applies to the
+ * socket on the multicast group. On a TCP socket, the multicast options are
+ * skipped as well.
+ */
+gboolean
+gssdp_socket_apply_tuning (GSocket                 *socket,
+                           const GSSDPSocketTuning *tuning,
+                           GError                 **error)
+{
+        if (tuning->receive_buffer_size != 0 &&
+            !gssdp_socket_set_receive_buffer_size (socket,
+                                                   tuning->receive_buffer_size,
+                                                   error))
+                return FALSE;
+
+        if (tuning->send_buffer_size != 0 &&
+            !gssdp_socket_set_option_value (
+                                socket,
+                                GSSDP_SOCKET_OPTION_SEND_BUFFER_SIZE,
+                                (gint) MIN (tuning->send_buffer_size, G_MAXINT),
+                                error))
+                return FALSE;
+
+        if (tuning->dscp >= 0 &&
+            !gssdp_socket_set_option_value (socket,
+                                            GSSDP_SOCKET_OPTION_DSCP,
+                                            tuning->dscp,
+                                            error))
+                return FALSE;
+
+        if (tuning->priority >= 0 &&
+            !gssdp_socket_set_option_value (socket,
+                                            GSSDP_SOCKET_OPTION_PRIORITY,
+                                            tuning->priority,
+                                            error))
+                return FALSE;
+
+        if (tuning->busy_poll != 0 &&
+            !gssdp_socket_set_option_value (
+                                socket,
+                                GSSDP_SOCKET_OPTION_BUSY_POLL,
+                                (gint) MIN (tuning->busy_poll, G_MAXINT),
+                                error))
+                return FALSE;
+
+        if (!tuning->multicast_all &&
+            g_socket_get_socket_type (socket) == G_SOCKET_TYPE_DATAGRAM &&
+            !gssdp_socket_set_option_value (socket,
+                                            GSSDP_SOCKET_OPTION_MULTICAST_ALL,
+                                            FALSE,
+                                            error))
+                return FALSE;
+
+        return TRUE;
+}
+
+/*
+ * Reads the current value of @option back from the kernel.
+ */
+gboolean
+gssdp_socket_get_option_value (GSocket          *socket,
+                               GSSDPSocketOption option,
+                               gint             *value,
+                               GError          **error)
+{
+        int level, name;
+        socklen_t len = sizeof (*value);
+
+        *value = 0;
+
+        if (option == GSSDP_SOCKET_OPTION_MULTICAST_LOOPBACK) {
+                *value = g_socket_get_multicast_loopback (socket);
+
+                return TRUE;
+        }
+
+        if (!gssdp_socket_option_lookup (g_socket_get_family (socket),
+                                         option,
+                                         &level,
+                                         &name)) {
+                g_set_error_literal (error,
+                                     G_IO_ERROR,
+                                     G_IO_ERROR_NOT_SUPPORTED,
+                                     "Socket option not supported on this "
+                                     "platform");
+
+                return FALSE;
+        }
+
+        if (getsockopt (g_socket_get_fd (socket),
+                        level,
+                        name,
+                        (char *) value,
+                        &len) == -1) {
+                char *message;
+
+                message = gssdp_socket_error_message (gssdp_socket_errno ());
+                g_set_error_literal (error,
+                                     GSSDP_ERROR,
+                                     GSSDP_ERROR_FAILED,
+                                     message);
+                g_free (message);
+
+                return FALSE;
+        }
+
+        if (option == GSSDP_SOCKET_OPTION_DSCP)
+                *value >>= 2;
+
+        return TRUE;
+}
+
+/*
+ * Parses the textual IP @address into @bytes without allocating, ignoring
+ * an IPv6 scope. Returns the size of the address, 4 or 16, or 0 if
+ * @address is not an IP address.
+ */
+gsize
+gssdp_socket_parse_address (const char *address, guint8 bytes[16])
+{
+        char buffer[INET6_ADDRSTRLEN];
+        const char *scope;
+
+        if (inet_pton (AF_INET, address, bytes) == 1)
+                return 4;
+
+        scope = strchr (address, '%');
+        if (scope != NULL) {
+                if ((gsize) (scope - address) >= sizeof (buffer))
+                        return 0;
+
+                memcpy (buffer, address, scope - address);
+                buffer[scope - address] = '\0';
+                address = buffer;
+        }
+
+        if (inet_pton (AF_INET6, address, bytes) == 1)
+                return 16;
+
+        return 0;
+}
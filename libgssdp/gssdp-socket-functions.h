@@ -12,6 +12,32 @@
 
 #include <gio/gio.h>
 
+#include "gssdp-client.h"
+
+typedef enum {
+        GSSDP_SOCKET_ACCEPT_SEARCH   = 1 << 0,
+        GSSDP_SOCKET_ACCEPT_NOTIFY   = 1 << 1,
+        GSSDP_SOCKET_ACCEPT_RESPONSE = 1 << 2,
+        GSSDP_SOCKET_ACCEPT_ALL      = GSSDP_SOCKET_ACCEPT_SEARCH |
+                                       GSSDP_SOCKET_ACCEPT_NOTIFY |
+                                       GSSDP_SOCKET_ACCEPT_RESPONSE
+} GSSDPSocketAcceptFlags;
+
+/* Options applied to every socket of a client, see the GSSDPClient properties
+ * of the same name. 0, or -1 for dscp and priority, keeps the system
+ * default. multicast_loopback only applies to the multicast socket */
+typedef struct {
+        guint    receive_buffer_size;
+        guint    send_buffer_size;
+        gint     dscp;
+        gint     priority;
+        guint    busy_poll;
+        gboolean multicast_loopback;
+        gboolean multicast_all;
+} GSSDPSocketTuning;
+
+#define GSSDP_SOCKET_TUNING_INIT { 0, 0, -1, -1, 0, TRUE, TRUE }
+
 G_GNUC_INTERNAL gboolean
 gssdp_socket_mcast_interface_set (GSocket       *socket,
                                   GInetAddress  *iface_address,
@@ -28,4 +54,41 @@ gssdp_socket_enable_info         (GSocket *socket,
                                   gboolean enable,
                                   GError **error);
 
+G_GNUC_INTERNAL gboolean
+gssdp_socket_set_receive_buffer_size (GSocket *socket,
+                                      guint    size,
+                                      GError **error);
+
+G_GNUC_INTERNAL gboolean
+gssdp_socket_enable_drop_count   (GSocket *socket,
+                                  gboolean enable,
+                                  GError **error);
+
+G_GNUC_INTERNAL gboolean
+gssdp_socket_enable_timestamps   (GSocket *socket,
+                                  gboolean enable,
+                                  GError **error);
+
+G_GNUC_INTERNAL gboolean
+gssdp_socket_set_message_filter  (GSocket                *socket,
+                                  GSSDPSocketAcceptFlags  accept,
+                                  guint                   shard,
+                                  guint                   n_shards,
+                                  GError                **error);
+
+G_GNUC_INTERNAL gboolean
+gssdp_socket_apply_tuning        (GSocket                 *socket,
+                                  const GSSDPSocketTuning *tuning,
+                                  GError                 **error);
+
+G_GNUC_INTERNAL gboolean
+gssdp_socket_get_option_value    (GSocket          *socket,
+                                  GSSDPSocketOption option,
+                                  gint             *value,
+                                  GError          **error);
+
+G_GNUC_INTERNAL gsize
+gssdp_socket_parse_address       (const char *address,
+                                  guint8      bytes[16]);
+
 #endif
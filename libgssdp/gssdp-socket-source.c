@@ -44,6 +44,12 @@ struct _GSSDPSocketSourcePrivate {
         guint                 ttl;
         guint                 port;
         gboolean allocate_tcp_socket;
+        GSSDPSocketTuning tuning;
+        guint32 drops;
+        gboolean timestamps;
+        GSSDPSocketAcceptFlags accept;
+        guint shard;
+        guint n_shards;
 };
 typedef struct _GSSDPSocketSourcePrivate GSSDPSocketSourcePrivate;
 
@@ -69,11 +75,21 @@ enum
         PROP_IFA_NAME,
         PROP_IFA_IDX,
         PROP_ALLOCATE_TCP_SOCKET,
+        PROP_TUNING,
+        PROP_TIMESTAMPS,
+        PROP_SHARD,
+        PROP_N_SHARDS,
+        PROP_TCP_SOCKET,
 };
 
 static void
 gssdp_socket_source_init (GSSDPSocketSource *self)
 {
+        GSSDPSocketSourcePrivate *priv;
+
+        priv = gssdp_socket_source_get_instance_private (self);
+        priv->accept = GSSDP_SOCKET_ACCEPT_ALL;
+        priv->tuning = (GSSDPSocketTuning) GSSDP_SOCKET_TUNING_INIT;
 }
 
 static gboolean
@@ -162,6 +178,38 @@ gssdp_socket_source_create_socket (GSSDPSocketSourcePrivate *priv,
                 return FALSE;
         }
 
+        if (!gssdp_socket_apply_tuning (priv->socket,
+                                        &priv->tuning,
+                                        &inner_error)) {
+                g_propagate_prefixed_error (error,
+                                            inner_error,
+                                            "Failed to tune socket");
+                return FALSE;
+        }
+
+        /* Not fatal, we just can't tell about drops then. Each shard gets a
+         * copy of every datagram and the kernel counts the ones its filter
+         * rejects as drops, so a shard's counter says nothing about
+         * overflows */
+        if (!(priv->type == GSSDP_SOCKET_SOURCE_TYPE_MULTICAST &&
+              priv->n_shards > 1) &&
+            !gssdp_socket_enable_drop_count (priv->socket,
+                                             TRUE,
+                                             &inner_error)) {
+                g_debug ("Failed to enable drop count: %s",
+                         inner_error->message);
+                g_clear_error (&inner_error);
+        }
+
+        if (priv->timestamps &&
+            !gssdp_socket_enable_timestamps (priv->socket,
+                                             TRUE,
+                                             &inner_error)) {
+                g_debug ("Failed to enable receive timestamps: %s",
+                         inner_error->message);
+                g_clear_error (&inner_error);
+        }
+
         /* TTL */
         if (priv->ttl == 0) {
                 /* UDA/1.0 says 4, UDA/1.1 says 2 */
@@ -185,8 +233,25 @@ gssdp_socket_source_configure_socket (GSSDPSocketSourcePrivate *priv,
         GError *inner_error = NULL;
 
         if (priv->type == GSSDP_SOCKET_SOURCE_TYPE_MULTICAST) {
-                /* Enable multicast loopback */
-                g_socket_set_multicast_loopback (priv->socket, TRUE);
+                g_socket_set_multicast_loopback (
+                                priv->socket,
+                                priv->tuning.multicast_loopback);
+
+                /* Every socket bound to the group gets a copy of each
+                 * datagram, so the kernel has to pick the ones for this
+                 * shard before the socket is bound */
+                if (priv->n_shards > 1 &&
+                    !gssdp_socket_set_message_filter (priv->socket,
+                                                      priv->accept,
+                                                      priv->shard,
+                                                      priv->n_shards,
+                                                      &inner_error)) {
+                        g_propagate_prefixed_error (error,
+                                                    inner_error,
+                                                    "Failed to set shard filter");
+
+                        return FALSE;
+                }
         } else {
                 if (family != G_SOCKET_FAMILY_IPV6 ||
                     (!g_inet_address_get_is_loopback (priv->address))) {
@@ -352,6 +417,23 @@ gssdp_socket_source_set_property (GObject          *object,
         case PROP_ALLOCATE_TCP_SOCKET:
                 priv->allocate_tcp_socket = g_value_get_boolean (value);
                 break;
+        case PROP_TUNING:
+                if (g_value_get_pointer (value) != NULL)
+                        priv->tuning = *(GSSDPSocketTuning *)
+                                        g_value_get_pointer (value);
+                break;
+        case PROP_TIMESTAMPS:
+                priv->timestamps = g_value_get_boolean (value);
+                break;
+        case PROP_SHARD:
+                priv->shard = g_value_get_uint (value);
+                break;
+        case PROP_N_SHARDS:
+                priv->n_shards = g_value_get_uint (value);
+                break;
+        case PROP_TCP_SOCKET:
+                priv->tcp_socket = g_value_dup_object (value);
+                break;
         default:
                 G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
                 break;
@@ -361,6 +443,9 @@ gssdp_socket_source_set_property (GObject          *object,
 /**
  * gssdp_socket_source_new
  *
+ * @tuning holds the options applied to the socket, or %NULL to use the
+ * system defaults.
+ *
  * Return value: A new #GSSDPSocketSource
  **/
 GSSDPSocketSource *
@@ -369,6 +454,7 @@ gssdp_socket_source_new (GSSDPSocketSourceType type,
                          guint                 ttl,
                          const char           *device_name,
                          guint                 index,
+                         const GSSDPSocketTuning *tuning,
                          GError              **error)
 {
         return g_initable_new (GSSDP_TYPE_SOCKET_SOURCE,
@@ -384,6 +470,8 @@ gssdp_socket_source_new (GSSDPSocketSourceType type,
                                device_name,
                                "index",
                                index,
+                               "tuning",
+                               tuning,
                                NULL);
 }
 
@@ -434,7 +522,10 @@ retry:
                 goto error;
         }
 
-        if (priv->type == GSSDP_SOCKET_SOURCE_TYPE_SEARCH) {
+        /* A TCP socket carried over from a previous search socket still
+         * holds the port, binding another one next to it would fail */
+        if (priv->type == GSSDP_SOCKET_SOURCE_TYPE_SEARCH &&
+            priv->tcp_socket == NULL) {
                 gboolean should_retry = FALSE;
                 if (priv->port == 0) {
                         /* Get assigned port for SEARCH type */
@@ -491,6 +582,15 @@ retry:
                         }
                 }
 
+                if (!gssdp_socket_apply_tuning (socket,
+                                                &priv->tuning,
+                                                &inner_error)) {
+                        g_prefix_error (&inner_error,
+                                        "Failed to tune TCP socket: ");
+
+                        goto error;
+                }
+
                 priv->tcp_socket = g_steal_pointer (&socket);
         }
 
@@ -563,6 +663,74 @@ gssdp_socket_source_steal_associated_tcp_socket (GSSDPSocketSource *self)
         return socket;
 }
 
+/*
+ * Returns the number of datagrams dropped by the kernel on this socket since
+ * the last call, given the cumulative @drops counter reported by the kernel.
+ */
+guint32
+gssdp_socket_source_update_drops (GSSDPSocketSource *self, guint32 drops)
+{
+        GSSDPSocketSourcePrivate *priv;
+        guint32 delta;
+
+        g_return_val_if_fail (GSSDP_IS_SOCKET_SOURCE (self), 0);
+
+        priv = gssdp_socket_source_get_instance_private (self);
+
+        /* The counter is unsigned and may wrap around */
+        delta = drops - priv->drops;
+        priv->drops = drops;
+
+        return delta;
+}
+
+/*
+ * Whether a message filter restricts the socket. The kernel counts the
+ * datagrams it rejects as drops.
+ */
+gboolean
+gssdp_socket_source_is_filtered (GSSDPSocketSource *self)
+{
+        GSSDPSocketSourcePrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_SOCKET_SOURCE (self), FALSE);
+
+        priv = gssdp_socket_source_get_instance_private (self);
+
+        return priv->accept != GSSDP_SOCKET_ACCEPT_ALL;
+}
+
+/*
+ * Sets the kinds of SSDP messages the kernel should queue on the socket,
+ * see gssdp_socket_set_message_filter()
+ */
+gboolean
+gssdp_socket_source_set_message_filter (GSSDPSocketSource     *self,
+                                        GSSDPSocketAcceptFlags accept,
+                                        GError               **error)
+{
+        GSSDPSocketSourcePrivate *priv;
+
+        g_return_val_if_fail (GSSDP_IS_SOCKET_SOURCE (self), FALSE);
+
+        priv = gssdp_socket_source_get_instance_private (self);
+
+        accept &= GSSDP_SOCKET_ACCEPT_ALL;
+        if (priv->accept == accept)
+                return TRUE;
+
+        if (!gssdp_socket_set_message_filter (priv->socket,
+                                              accept,
+                                              priv->shard,
+                                              priv->n_shards,
+                                              error))
+                return FALSE;
+
+        priv->accept = accept;
+
+        return TRUE;
+}
+
 static void
 gssdp_socket_source_dispose (GObject *object)
 {
@@ -705,4 +873,65 @@ gssdp_socket_source_class_init (GSSDPSocketSourceClass *klass)
                                       G_PARAM_READWRITE |
                                               G_PARAM_CONSTRUCT_ONLY |
                                               G_PARAM_STATIC_STRINGS));
+
+        g_object_class_install_property (
+                object_class,
+                PROP_TUNING,
+                g_param_spec_pointer ("tuning",
+                                      "Tuning",
+                                      "GSSDPSocketTuning applied to the "
+                                      "socket, NULL for the system defaults",
+                                      G_PARAM_WRITABLE |
+                                              G_PARAM_CONSTRUCT_ONLY |
+                                              G_PARAM_STATIC_STRINGS));
+
+        g_object_class_install_property (
+                object_class,
+                PROP_TIMESTAMPS,
+                g_param_spec_boolean ("timestamps",
+                                      "Timestamps",
+                                      "Whether to request kernel receive "
+                                      "timestamps",
+                                      FALSE,
+                                      G_PARAM_WRITABLE |
+                                              G_PARAM_CONSTRUCT_ONLY |
+                                              G_PARAM_STATIC_STRINGS));
+
+        g_object_class_install_property (
+                object_class,
+                PROP_SHARD,
+                g_param_spec_uint ("shard",
+                                   "Shard",
+                                   "Share of the multicast traffic this "
+                                   "socket receives",
+                                   0,
+                                   G_MAXUINT,
+                                   0,
+                                   G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY |
+                                           G_PARAM_STATIC_STRINGS));
+
+        g_object_class_install_property (
+                object_class,
+                PROP_N_SHARDS,
+                g_param_spec_uint ("n-shards",
+                                   "Number of shards",
+                                   "Number of sockets sharing the multicast "
+                                   "traffic",
+                                   1,
+                                   G_MAXUINT,
+                                   1,
+                                   G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY |
+                                           G_PARAM_STATIC_STRINGS));
+
+        g_object_class_install_property (
+                object_class,
+                PROP_TCP_SOCKET,
+                g_param_spec_object ("tcp-socket",
+                                     "TCP socket",
+                                     "Bound TCP socket of a previous search "
+                                     "socket on the same port to take over",
+                                     G_TYPE_SOCKET,
+                                     G_PARAM_WRITABLE |
+                                             G_PARAM_CONSTRUCT_ONLY |
+                                             G_PARAM_STATIC_STRINGS));
 }
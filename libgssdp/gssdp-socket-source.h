@@ -16,6 +16,8 @@
 
 #include <gio/gio.h>
 
+#include "gssdp-socket-functions.h"
+
 G_BEGIN_DECLS
 
 #define GSSDP_TYPE_SOCKET_SOURCE (gssdp_socket_source_get_type ())
@@ -38,6 +40,7 @@ gssdp_socket_source_new        (GSSDPSocketSourceType  type,
                                 guint                  ttl,
                                 const char            *device_name,
                                 guint                  index,
+                                const GSSDPSocketTuning *tuning,
                                 GError               **error);
 
 G_GNUC_INTERNAL GSocket*
@@ -54,6 +57,17 @@ gssdp_socket_source_attach       (GSSDPSocketSource   *socket_source);
 G_GNUC_INTERNAL GSocket *
 gssdp_socket_source_steal_associated_tcp_socket (GSSDPSocketSource *self);
 
+G_GNUC_INTERNAL guint32
+gssdp_socket_source_update_drops (GSSDPSocketSource *self, guint32 drops);
+
+G_GNUC_INTERNAL gboolean
+gssdp_socket_source_is_filtered (GSSDPSocketSource *self);
+
+G_GNUC_INTERNAL gboolean
+gssdp_socket_source_set_message_filter (GSSDPSocketSource     *self,
+                                        GSSDPSocketAcceptFlags accept,
+                                        GError               **error);
+
 G_END_DECLS
 
 #endif /* GSSDP_SOCKET_SOURCE_H */
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2024 GSSDP contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#ifndef GSSDP_TIMESTAMP_MESSAGE_H
+#define GSSDP_TIMESTAMP_MESSAGE_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GSSDP_TYPE_TIMESTAMP_MESSAGE (gssdp_timestamp_message_get_type())
+
+G_DECLARE_FINAL_TYPE (GSSDPTimestampMessage,
+                      gssdp_timestamp_message,
+                      GSSDP,
+                      TIMESTAMP_MESSAGE,
+                      GSocketControlMessage)
+
+G_GNUC_INTERNAL GSocketControlMessage *
+gssdp_timestamp_message_new (gint64 time);
+
+G_GNUC_INTERNAL gint64
+gssdp_timestamp_message_get_time (GSSDPTimestampMessage *message);
+
+G_END_DECLS
+
+#endif /* GSSDP_TIMESTAMP_MESSAGE_H */
@@ -9,5 +9,8 @@
 
 #include <libgssdp/gssdp-client.h>
 #include <libgssdp/gssdp-error.h>
+#include <libgssdp/gssdp-network-monitor.h>
+#include <libgssdp/gssdp-resource-aggregator.h>
 #include <libgssdp/gssdp-resource-browser.h>
 #include <libgssdp/gssdp-resource-group.h>
+#include <libgssdp/gssdp-resource-info.h>
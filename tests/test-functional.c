@@ -9,9 +9,19 @@
 
 #include <string.h>
 
+#ifndef G_OS_WIN32
+#include <net/if.h>
+#include <sys/socket.h>
+#endif
+
 #include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
 
+#include <libgssdp/gssdp-error.h>
 #include <libgssdp/gssdp-resource-browser.h>
+#include <libgssdp/gssdp-resource-aggregator.h>
+#include <libgssdp/gssdp-resource-group.h>
 #include <libgssdp/gssdp-protocol.h>
 
 #include "test-util.h"
@@ -21,6 +31,17 @@
 #define VERSIONED_NT_2 "urn:org-gupnp:device:FunctionalTest:9"
 #define VERSIONED_USN_1 UUID_1"::"VERSIONED_NT_1
 #define VERSIONED_USN_2 UUID_1"::"VERSIONED_NT_2
+#define CONVERGENCE_NT "urn:org-gupnp:device:ConvergenceTest:1"
+#define REVALIDATION_NT "urn:org-gupnp:device:RevalidationTest:1"
+#define GRACE_NT "urn:org-gupnp:device:GraceTest:1"
+#define COALESCE_NT "urn:org-gupnp:device:CoalesceTest:1"
+#define BURST_NT "urn:org-gupnp:device:BurstTest:1"
+#define UUID_2 "uuid:d5a5b4c2-3f43-4bd2-9a0f-2c6a2e4f7b19"
+
+/* _GSSDP_DISCOVERY_REQUEST and _GSSDP_ANNOUNCEMENT from
+ * gssdp-client-private.h */
+#define MESSAGE_TYPE_SEARCH 0
+#define MESSAGE_TYPE_ANNOUNCEMENT 2
 
 /* Helper functions */
 
@@ -520,29 +541,2545 @@ test_client_creation ()
         g_clear_object (&addr);
 }
 
-int main(int argc, char *argv[])
+static void
+on_test_client_ready (G_GNUC_UNUSED GObject *source,
+                      GAsyncResult           *res,
+                      gpointer                user_data)
 {
-        g_test_init (&argc, &argv, NULL);
+        GPtrArray *clients = user_data;
+        GError *error = NULL;
+        GSSDPClient *client;
 
-        g_test_add_func ("/functional/resource-group/discovery/ssdp:all",
-                         test_discovery_ssdp_all);
+        client = gssdp_client_new_full_finish (res, &error);
+        g_assert_no_error (error);
+        g_assert_nonnull (client);
 
-        g_test_add_func ("/functional/resource-group/discovery/upnp:rootdevice",
-                         test_discovery_upnp_rootdevice);
+        g_ptr_array_add (clients, client);
+}
 
-        g_test_add_func ("/functional/resource-group/discovery/uuid",
-                         test_discovery_uuid);
+static void
+test_client_creation_async (void)
+{
+        GPtrArray *clients;
+        GInetAddress *lo;
+        GSSDPResourceBrowser *browser;
+        guint i;
+
+        clients = g_ptr_array_new_with_free_func (g_object_unref);
+        lo = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+
+        /* Several clients set up at the same time */
+        for (i = 0; i < 4; i++)
+                gssdp_client_new_full_async (NULL,
+                                             lo,
+                                             0,
+                                             GSSDP_UDA_VERSION_1_0,
+                                             NULL,
+                                             on_test_client_ready,
+                                             clients);
+
+        while (clients->len < 4)
+                g_main_context_iteration (NULL, TRUE);
+
+        for (i = 0; i < clients->len; i++) {
+                GSSDPClient *client = g_ptr_array_index (clients, i);
+
+                g_assert_cmpstr (gssdp_client_get_host_ip (client),
+                                 ==,
+                                 "127.0.0.1");
+                g_assert_cmpuint (gssdp_client_get_port (client), !=, 0);
+        }
+
+        /* The clients are fully usable */
+        browser = gssdp_resource_browser_new (g_ptr_array_index (clients, 0),
+                                              "upnp:rootdevice");
+        gssdp_resource_browser_set_active (browser, TRUE);
+        g_object_unref (browser);
 
-        g_test_add_func ("/functional/resource-group/discovery/versioned/matching",
-                         test_discovery_versioned);
+        g_object_unref (lo);
+        g_ptr_array_unref (clients);
+}
 
-        g_test_add_func ("/functional/resource-group/discovery/versioned/backwards-compatible",
-                         test_discovery_versioned_backwards_compatible);
+static void
+on_test_rebound (G_GNUC_UNUSED GSSDPClient *client, gpointer user_data)
+{
+        gboolean *rebound = user_data;
 
-        g_test_add_func ("/functional/resource-group/discovery/versioned/ignore-older",
-                         test_discovery_versioned_ignore_older);
+        *rebound = TRUE;
+}
 
-        g_test_add_func ("/functional/creation", test_client_creation);
+static void
+test_client_rebind (void)
+{
+        GSSDPClient *client;
+        GError *error = NULL;
+        gboolean rebound = FALSE;
+        char *host_ip;
+        guint port;
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        host_ip = g_strdup (gssdp_client_get_host_ip (client));
+        port = gssdp_client_get_port (client);
+        g_signal_connect (client,
+                          "rebound",
+                          G_CALLBACK (on_test_rebound),
+                          &rebound);
+
+        /* The address is still there, so it is kept */
+        g_assert_true (gssdp_client_rebind (client, &error));
+        g_assert_no_error (error);
+        g_assert_true (rebound);
+        g_assert_cmpstr (gssdp_client_get_host_ip (client), ==, host_ip);
+        g_assert_cmpuint (gssdp_client_get_port (client), ==, port);
+
+        gssdp_client_set_monitor_network (client, TRUE);
+        g_assert_true (gssdp_client_get_monitor_network (client));
+        gssdp_client_set_monitor_network (client, FALSE);
+        g_assert_false (gssdp_client_get_monitor_network (client));
+
+        g_free (host_ip);
+        g_object_unref (client);
+}
+
+static void
+test_client_interface_cache (void)
+{
+        GSSDPClient *client, *other;
+        GError *error = NULL;
+        char *iface;
+        guint index;
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        iface = g_strdup (gssdp_client_get_interface (client));
+        index = gssdp_client_get_index (client);
+        g_assert_cmpuint (index, >, 0);
+#ifndef G_OS_WIN32
+        g_assert_cmpuint (index, ==, if_nametoindex (iface));
+#endif
+
+        /* Served from the same snapshot of the interfaces */
+        other = gssdp_client_new (iface, &error);
+        g_assert_no_error (error);
+        g_assert_cmpstr (gssdp_client_get_interface (other), ==, iface);
+        g_assert_cmpuint (gssdp_client_get_index (other), ==, index);
+        g_object_unref (other);
+
+        /* Rebinding drops the snapshot, the lookup has to give the same */
+        g_assert_true (gssdp_client_rebind (client, &error));
+        g_assert_no_error (error);
+        g_assert_cmpstr (gssdp_client_get_interface (client), ==, iface);
+        g_assert_cmpuint (gssdp_client_get_index (client), ==, index);
+
+        other = gssdp_client_new (iface, &error);
+        g_assert_no_error (error);
+        g_assert_cmpuint (gssdp_client_get_index (other), ==, index);
+        g_object_unref (other);
+
+        g_free (iface);
+        g_object_unref (client);
+}
+
+static void
+test_client_rebind_tcp_socket (void)
+{
+        GSSDPClient *client;
+        GInetAddress *lo;
+        GError *error = NULL;
+        GSocket *tcp_socket, *rebound_socket;
+        guint port;
+
+        lo = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+        client = g_initable_new (GSSDP_TYPE_CLIENT,
+                                 NULL,
+                                 &error,
+                                 "address", lo,
+                                 "allocate-tcp-socket", TRUE,
+                                 NULL);
+        g_assert_no_error (error);
+        g_assert_nonnull (client);
+        g_object_unref (lo);
+
+        port = gssdp_client_get_port (client);
+        tcp_socket = gssdp_client_get_tcp_socket (client);
+        g_assert_nonnull (tcp_socket);
+
+        /* The TCP socket holds the port, so it has to be taken over */
+        g_assert_true (gssdp_client_rebind (client, &error));
+        g_assert_no_error (error);
+        g_assert_cmpuint (gssdp_client_get_port (client), ==, port);
+
+        rebound_socket = gssdp_client_get_tcp_socket (client);
+        g_assert_true (rebound_socket == tcp_socket);
+        g_assert_false (g_socket_is_closed (rebound_socket));
+
+        g_assert_true (gssdp_client_rebind (client, &error));
+        g_assert_no_error (error);
+
+        g_object_unref (rebound_socket);
+        g_object_unref (tcp_socket);
+        g_object_unref (client);
+}
+
+static void
+test_resource_group_lookup_remove (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceGroup *group;
+        GError *error = NULL;
+        const char *target = NULL;
+        const char *usn = NULL;
+        guint ids[3];
+        guint i;
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        group = gssdp_resource_group_new (client);
+        for (i = 0; i < G_N_ELEMENTS (ids); i++) {
+                char *resource_usn;
+
+                resource_usn = g_strdup_printf ("uuid:%u::upnp:rootdevice",
+                                                i);
+                ids[i] = gssdp_resource_group_add_resource_simple
+                                        (group,
+                                         UUID_1,
+                                         resource_usn,
+                                         "http://127.0.0.1:3456/foo");
+                g_free (resource_usn);
+        }
+
+        /* Remove from the middle, the others must still be reachable */
+        gssdp_resource_group_remove_resource (group, ids[1]);
+        g_assert_false (gssdp_resource_group_lookup_resource (group,
+                                                              ids[1],
+                                                              NULL,
+                                                              NULL));
+
+        g_assert_true (gssdp_resource_group_lookup_resource (group,
+                                                             ids[0],
+                                                             &target,
+                                                             &usn));
+        g_assert_cmpstr (target, ==, UUID_1);
+        g_assert_cmpstr (usn, ==, "uuid:0::upnp:rootdevice");
+
+        g_assert_true (gssdp_resource_group_lookup_resource (group,
+                                                             ids[2],
+                                                             NULL,
+                                                             &usn));
+        g_assert_cmpstr (usn, ==, "uuid:2::upnp:rootdevice");
+
+        /* Removing an unknown id is a no-op */
+        gssdp_resource_group_remove_resource (group, ids[1]);
+        gssdp_resource_group_remove_resource (group, ids[2]);
+        g_assert_false (gssdp_resource_group_lookup_resource (group,
+                                                              ids[2],
+                                                              NULL,
+                                                              NULL));
+        g_assert_true (gssdp_resource_group_lookup_resource (group,
+                                                             ids[0],
+                                                             NULL,
+                                                             NULL));
+
+        g_object_unref (group);
+        g_object_unref (client);
+}
+
+static void
+on_test_cache_resource_available (G_GNUC_UNUSED GSSDPResourceBrowser *src,
+                                  const char                         *usn,
+                                  GList                              *locations,
+                                  gpointer                            user_data)
+{
+        gboolean *found = (gboolean *) user_data;
+
+        g_assert_cmpstr (usn, ==, UUID_1"::MyService:1");
+        g_assert_nonnull (locations);
+        g_assert_cmpstr (locations->data, ==, "http://127.0.0.1:1234");
+
+        *found = TRUE;
+}
+
+static void
+cache_write_uint32 (GByteArray *data, guint32 value)
+{
+        value = GUINT32_TO_LE (value);
+        g_byte_array_append (data, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+cache_write_int64 (GByteArray *data, gint64 value)
+{
+        value = GINT64_TO_LE (value);
+        g_byte_array_append (data, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+cache_write_string (GByteArray *data, const char *value)
+{
+        cache_write_uint32 (data, strlen (value));
+        g_byte_array_append (data, (const guint8 *) value, strlen (value));
+}
+
+/* Writes a cache snapshot for @target with the resources in @usns, valid
+ * for half an hour */
+static char *
+write_cache_file (const char *target, const char * const *usns)
+{
+        GError *error = NULL;
+        GByteArray *cache;
+        char *path;
+        guint i;
+        int fd;
+
+        fd = g_file_open_tmp ("gssdp-cache-XXXXXX", &path, &error);
+        g_assert_no_error (error);
+        g_close (fd, NULL);
+
+        cache = g_byte_array_new ();
+        g_byte_array_append (cache, (const guint8 *) "GSSDPBC", 8);
+        cache_write_uint32 (cache, 2);
+        cache_write_uint32 (cache, 1);
+        cache_write_string (cache, target);
+        cache_write_uint32 (cache, g_strv_length ((char **) usns));
+        for (i = 0; usns[i] != NULL; i++) {
+                cache_write_int64 (cache,
+                                   g_get_real_time () +
+                                   1800 * G_USEC_PER_SEC);
+                cache_write_uint32 (cache, 1);
+                cache_write_string (cache, usns[i]);
+                cache_write_uint32 (cache, 1);
+                cache_write_string (cache, "http://127.0.0.1:1234");
+        }
+
+        g_file_set_contents (path,
+                             (const char *) cache->data,
+                             cache->len,
+                             &error);
+        g_assert_no_error (error);
+        g_byte_array_unref (cache);
+
+        return path;
+}
+
+static void
+test_resource_browser_cache (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        TestDiscoverySSDPAllData data;
+        gboolean found = FALSE;
+        char *path;
+        char *contents;
+        gsize length;
+        char **targets;
+        GByteArray *bogus;
+        gint64 expires;
+        GSSDPResourceInfo *info;
+        char *source_ip;
+        char *alive;
+        int fd;
+
+        data.loop = g_main_loop_new (NULL, FALSE);
+        data.usn = UUID_1"::MyService:1";
+        data.found = FALSE;
+
+        fd = g_file_open_tmp ("gssdp-cache-XXXXXX", &path, &error);
+        g_assert_no_error (error);
+        g_close (fd, NULL);
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, "ssdp:all");
+        gssdp_resource_browser_add_target (browser, "urn:example:Other:1");
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_test_discovery_ssdp_all_resource_available),
+                          &data);
+        gssdp_resource_browser_set_active (browser, TRUE);
+
+        alive = g_strdup_printf (SSDP_ALIVE_MESSAGE "\r\n",
+                                 SSDP_ADDR,
+                                 1800,
+                                 "http://127.0.0.1:1234",
+                                 "BOOTID.UPNP.ORG: 1\r\n"
+                                 "CONFIGID.UPNP.ORG: 7\r\n",
+                                 "Linux/3.0 UPnP/1.0 GSSDPTesting/0.0.0",
+                                 "MyService:1",
+                                 UUID_1"::MyService:1");
+
+        g_timeout_add_seconds (10, quit_loop, data.loop);
+        g_timeout_add_seconds (1, test_discovery_send_packet, alive);
+        g_main_loop_run (data.loop);
+        g_assert_true (data.found);
+
+        info = gssdp_resource_browser_lookup_resource (browser,
+                                                       UUID_1"::MyService:1");
+        g_assert_nonnull (info);
+        source_ip = g_strdup (gssdp_resource_info_get_source_ip (info));
+        g_assert_nonnull (source_ip);
+        gssdp_resource_info_unref (info);
+
+        g_assert_true (gssdp_resource_browser_save_cache (browser,
+                                                          path,
+                                                          &error));
+        g_assert_no_error (error);
+        g_object_unref (browser);
+
+        /* A fresh browser gets the resource back without any network
+         * traffic */
+        browser = gssdp_resource_browser_new (client, "ssdp:all");
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_test_cache_resource_available),
+                          &found);
+        g_assert_true (gssdp_resource_browser_load_cache (browser,
+                                                          path,
+                                                          &error));
+        g_assert_no_error (error);
+        g_assert_true (found);
+
+        /* So do its config ID and the address it was heard from */
+        info = gssdp_resource_browser_lookup_resource (browser,
+                                                       UUID_1"::MyService:1");
+        g_assert_nonnull (info);
+        g_assert_cmpint (gssdp_resource_info_get_boot_id (info), ==, 1);
+        g_assert_cmpint (gssdp_resource_info_get_config_id (info), ==, 7);
+        g_assert_cmpstr (gssdp_resource_info_get_source_ip (info),
+                         ==,
+                         source_ip);
+        gssdp_resource_info_unref (info);
+        g_free (source_ip);
+
+        /* Additional targets come back as well */
+        targets = gssdp_resource_browser_get_targets (browser);
+        g_assert_cmpuint (g_strv_length (targets), ==, 2);
+        g_assert_cmpstr (targets[1], ==, "urn:example:Other:1");
+        g_strfreev (targets);
+        g_object_unref (browser);
+
+        /* A truncated file is rejected as a whole */
+        g_file_get_contents (path, &contents, &length, &error);
+        g_assert_no_error (error);
+        g_file_set_contents (path, contents, length - 1, &error);
+        g_assert_no_error (error);
+        g_free (contents);
+
+        found = FALSE;
+        browser = gssdp_resource_browser_new (client, "ssdp:all");
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_test_cache_resource_available),
+                          &found);
+        g_assert_false (gssdp_resource_browser_load_cache (browser,
+                                                           path,
+                                                           &error));
+        g_assert_error (error, GSSDP_ERROR, GSSDP_ERROR_FAILED);
+        g_clear_error (&error);
+        g_assert_false (found);
+        g_assert_cmpuint (gssdp_resource_browser_get_resource_count (browser),
+                          ==,
+                          0);
+        g_object_unref (browser);
+
+        /* Entries with an expiry in the past or absurdly far in the future
+         * are skipped. This also reads the older format without config ID
+         * and source address */
+        bogus = g_byte_array_new ();
+        g_byte_array_append (bogus, (const guint8 *) "GSSDPBC", 8);
+        cache_write_uint32 (bogus, 2);
+        cache_write_uint32 (bogus, 1);
+        cache_write_string (bogus, "ssdp:all");
+        cache_write_uint32 (bogus, 2);
+        expires = GINT64_TO_LE (G_MININT64);
+        g_byte_array_append (bogus, (const guint8 *) &expires, 8);
+        cache_write_uint32 (bogus, 1);
+        cache_write_string (bogus, UUID_1"::MyService:1");
+        cache_write_uint32 (bogus, 1);
+        cache_write_string (bogus, "http://127.0.0.1:1234");
+        expires = GINT64_TO_LE (G_MAXINT64);
+        g_byte_array_append (bogus, (const guint8 *) &expires, 8);
+        cache_write_uint32 (bogus, 1);
+        cache_write_string (bogus, UUID_1"::MyService:1");
+        cache_write_uint32 (bogus, 1);
+        cache_write_string (bogus, "http://127.0.0.1:1234");
+        g_file_set_contents (path,
+                             (const char *) bogus->data,
+                             bogus->len,
+                             &error);
+        g_assert_no_error (error);
+        g_byte_array_unref (bogus);
+
+        browser = gssdp_resource_browser_new (client, "ssdp:all");
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_test_cache_resource_available),
+                          &found);
+        g_assert_true (gssdp_resource_browser_load_cache (browser,
+                                                          path,
+                                                          &error));
+        g_assert_no_error (error);
+        g_assert_false (found);
+        g_object_unref (browser);
+
+        /* Snapshots are tied to the target */
+        browser = gssdp_resource_browser_new (client, "upnp:rootdevice");
+        g_assert_false (gssdp_resource_browser_load_cache (browser,
+                                                           path,
+                                                           &error));
+        g_assert_error (error, GSSDP_ERROR, GSSDP_ERROR_FAILED);
+        g_clear_error (&error);
+        g_object_unref (browser);
+
+        g_remove (path);
+        g_free (path);
+        g_object_unref (client);
+        g_main_loop_unref (data.loop);
+}
+
+typedef struct {
+        const char *target;
+        guint       n_searches;
+} TestSearchCount;
+
+static void
+on_test_count_search (G_GNUC_UNUSED GSSDPClient *client,
+                      G_GNUC_UNUSED const char  *from_ip,
+                      G_GNUC_UNUSED gushort      from_port,
+                      int                        type,
+                      SoupMessageHeaders        *headers,
+                      gpointer                   user_data)
+{
+        TestSearchCount *count = user_data;
+
+        if (type != MESSAGE_TYPE_SEARCH)
+                return;
+
+        if (g_strcmp0 (soup_message_headers_get_one (headers, "ST"),
+                       count->target) == 0)
+                count->n_searches++;
+}
+
+static void
+test_resource_browser_convergence (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        GMainLoop *loop;
+        TestSearchCount count = { CONVERGENCE_NT, 0 };
+
+        loop = g_main_loop_new (NULL, FALSE);
+        client = get_client (&error);
+        g_assert_no_error (error);
+        g_signal_connect (client,
+                          "message-received",
+                          G_CALLBACK (on_test_count_search),
+                          &count);
+
+        /* Nobody answers: the first three requests and nothing more */
+        browser = g_object_new (GSSDP_TYPE_RESOURCE_BROWSER,
+                                "client", client,
+                                "target", CONVERGENCE_NT,
+                                "mx", 1,
+                                "discovery-interval", 100,
+                                "max-discovery-messages", 6,
+                                NULL);
+        gssdp_resource_browser_set_active (browser, TRUE);
+        g_timeout_add_seconds (3, quit_loop, loop);
+        g_main_loop_run (loop);
+        g_assert_cmpuint (count.n_searches, ==, 3);
+        g_object_unref (browser);
+
+        /* With a lower minimum, a silent network ends the round early */
+        count.n_searches = 0;
+        browser = g_object_new (GSSDP_TYPE_RESOURCE_BROWSER,
+                                "client", client,
+                                "target", CONVERGENCE_NT,
+                                "mx", 1,
+                                "discovery-interval", 100,
+                                "min-discovery-messages", 1,
+                                "max-discovery-messages", 6,
+                                NULL);
+        gssdp_resource_browser_set_active (browser, TRUE);
+        g_timeout_add_seconds (3, quit_loop, loop);
+        g_main_loop_run (loop);
+        g_assert_cmpuint (count.n_searches, ==, 1);
+        g_object_unref (browser);
+
+        /* A resource showing up within MX of the third request, i.e. well
+         * after the discovery interval, still counts as not converged */
+        count.n_searches = 0;
+        browser = g_object_new (GSSDP_TYPE_RESOURCE_BROWSER,
+                                "client", client,
+                                "target", CONVERGENCE_NT,
+                                "mx", 1,
+                                "discovery-interval", 100,
+                                "max-discovery-messages", 6,
+                                NULL);
+        gssdp_resource_browser_set_active (browser, TRUE);
+        g_timeout_add (700,
+                       test_discovery_send_packet,
+                       create_alive_message (CONVERGENCE_NT));
+        g_timeout_add_seconds (4, quit_loop, loop);
+        g_main_loop_run (loop);
+        g_assert_cmpuint (count.n_searches, ==, 4);
+        g_object_unref (browser);
+
+        /* The default is three requests, like it always was */
+        count.n_searches = 0;
+        browser = gssdp_resource_browser_new (client, CONVERGENCE_NT);
+        g_assert_cmpuint
+                (gssdp_resource_browser_get_max_discovery_messages (browser),
+                 ==,
+                 3);
+        g_assert_cmpuint
+                (gssdp_resource_browser_get_min_discovery_messages (browser),
+                 ==,
+                 3);
+        gssdp_resource_browser_set_active (browser, TRUE);
+        g_timeout_add (1200,
+                       test_discovery_send_packet,
+                       create_alive_message (CONVERGENCE_NT));
+        g_timeout_add_seconds (4, quit_loop, loop);
+        g_main_loop_run (loop);
+        g_assert_cmpuint (count.n_searches, ==, 3);
+        g_object_unref (browser);
+
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+test_resource_browser_rescan (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        GMainLoop *loop;
+        TestSearchCount count = { CONVERGENCE_NT, 0 };
+
+        loop = g_main_loop_new (NULL, FALSE);
+        client = get_client (&error);
+        g_assert_no_error (error);
+        g_signal_connect (client,
+                          "message-received",
+                          G_CALLBACK (on_test_count_search),
+                          &count);
+
+        browser = g_object_new (GSSDP_TYPE_RESOURCE_BROWSER,
+                                "client", client,
+                                "target", CONVERGENCE_NT,
+                                "discovery-interval", 100,
+                                NULL);
+        gssdp_resource_browser_set_active (browser, TRUE);
+
+        /* Wait for the round, including the cache refresh, to end */
+        g_timeout_add (5500, quit_loop, loop);
+        g_main_loop_run (loop);
+        g_assert_cmpuint (count.n_searches, ==, 3);
+
+        /* Enabling rescans afterwards arms one */
+        gssdp_resource_browser_set_rescan_interval (browser, 1);
+        g_timeout_add (2500, quit_loop, loop);
+        g_main_loop_run (loop);
+        g_assert_cmpuint (count.n_searches, >, 3);
+
+        /* Disabling them again stops them, once a running round is done */
+        gssdp_resource_browser_set_rescan_interval (browser, 0);
+        g_timeout_add (500, quit_loop, loop);
+        g_main_loop_run (loop);
+        count.n_searches = 0;
+        g_timeout_add_seconds (8, quit_loop, loop);
+        g_main_loop_run (loop);
+        g_assert_cmpuint (count.n_searches, ==, 0);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+test_resource_browser_search_coalescing (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *first;
+        GSSDPResourceBrowser *second;
+        GError *error = NULL;
+        GMainLoop *loop;
+        TestSearchCount count = { COALESCE_NT, 0 };
+
+        loop = g_main_loop_new (NULL, FALSE);
+        client = get_client (&error);
+        g_assert_no_error (error);
+        g_signal_connect (client,
+                          "message-received",
+                          G_CALLBACK (on_test_count_search),
+                          &count);
+
+        /* Well before the second discovery request of either */
+        first = gssdp_resource_browser_new (client, COALESCE_NT);
+        second = gssdp_resource_browser_new (client, COALESCE_NT);
+        gssdp_resource_browser_set_active (first, TRUE);
+        gssdp_resource_browser_set_active (second, TRUE);
+        g_timeout_add (200, quit_loop, loop);
+        g_main_loop_run (loop);
+
+        g_assert_cmpuint (count.n_searches, ==, 1);
+
+        g_object_unref (first);
+        g_object_unref (second);
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+on_test_count_resource (G_GNUC_UNUSED GSSDPResourceBrowser *src,
+                        G_GNUC_UNUSED const char           *usn,
+                        G_GNUC_UNUSED gpointer              locations,
+                        gpointer                            user_data)
+{
+        guint *count = user_data;
+
+        (*count)++;
+}
+
+static void
+test_resource_browser_revalidation_byebye (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        GMainLoop *loop;
+        TestSearchCount count = { UUID_1, 0 };
+        const char *usns[] = { UUID_1"::"REVALIDATION_NT, NULL };
+        guint n_available = 0;
+        guint n_unavailable = 0;
+        guint sent;
+        char *path;
+
+        loop = g_main_loop_new (NULL, FALSE);
+        client = get_client (&error);
+        g_assert_no_error (error);
+        g_signal_connect (client,
+                          "message-received",
+                          G_CALLBACK (on_test_count_search),
+                          &count);
+
+        /* A cached resource nobody confirms during discovery */
+        path = write_cache_file (REVALIDATION_NT, usns);
+
+        browser = g_object_new (GSSDP_TYPE_RESOURCE_BROWSER,
+                                "client", client,
+                                "target", REVALIDATION_NT,
+                                "discovery-interval", 10,
+                                "grace-period", 30,
+                                NULL);
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_test_count_resource),
+                          &n_available);
+        g_signal_connect (browser,
+                          "resource-unavailable",
+                          G_CALLBACK (on_test_count_resource),
+                          &n_unavailable);
+        g_assert_true (gssdp_resource_browser_load_cache (browser,
+                                                          path,
+                                                          &error));
+        g_assert_no_error (error);
+        g_assert_cmpuint (n_available, ==, 1);
+
+        /* Once the round is over, the device gets probed */
+        gssdp_resource_browser_set_active (browser, TRUE);
+        g_timeout_add (5500, quit_loop, loop);
+        g_main_loop_run (loop);
+        g_assert_cmpuint (count.n_searches, ==, 1);
+        gssdp_resource_browser_get_revalidation_stats (browser,
+                                                       &sent,
+                                                       NULL,
+                                                       NULL);
+        g_assert_cmpuint (sent, ==, 1);
+
+        /* It leaves while the probe is pending and comes back */
+        g_timeout_add (0,
+                       test_discovery_send_packet,
+                       create_byebye_message (REVALIDATION_NT));
+        g_timeout_add (200,
+                       test_discovery_send_packet,
+                       create_alive_message (REVALIDATION_NT));
+        g_timeout_add (500, quit_loop, loop);
+        g_main_loop_run (loop);
+        g_assert_cmpuint (n_unavailable, ==, 1);
+        g_assert_cmpuint (n_available, ==, 2);
+
+        /* Without a pending probe left behind, the next round probes the
+         * device again */
+        g_assert_true (gssdp_resource_browser_rescan (browser));
+        g_timeout_add (5500, quit_loop, loop);
+        g_main_loop_run (loop);
+        g_assert_cmpuint (count.n_searches, ==, 2);
+        gssdp_resource_browser_get_revalidation_stats (browser,
+                                                       &sent,
+                                                       NULL,
+                                                       NULL);
+        g_assert_cmpuint (sent, ==, 2);
+
+        g_object_unref (browser);
+        g_remove (path);
+        g_free (path);
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+test_resource_browser_revalidation_rate (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        GMainLoop *loop;
+        const char *usns[] = {
+                UUID_1"::"REVALIDATION_NT,
+                UUID_2"::"REVALIDATION_NT,
+                NULL
+        };
+        guint n_unavailable = 0;
+        guint sent;
+        guint suppressed;
+        char *path;
+
+        loop = g_main_loop_new (NULL, FALSE);
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        /* Two cached devices nobody confirms during discovery */
+        path = write_cache_file (REVALIDATION_NT, usns);
+
+        browser = g_object_new (GSSDP_TYPE_RESOURCE_BROWSER,
+                                "client", client,
+                                "target", REVALIDATION_NT,
+                                "discovery-interval", 10,
+                                "grace-period", 30,
+                                "max-revalidation-rate", 1,
+                                NULL);
+        g_signal_connect (browser,
+                          "resource-unavailable",
+                          G_CALLBACK (on_test_count_resource),
+                          &n_unavailable);
+        g_assert_true (gssdp_resource_browser_load_cache (browser,
+                                                          path,
+                                                          &error));
+        g_assert_no_error (error);
+
+        /* Only one probe fits into a second, the other one follows in the
+         * next */
+        gssdp_resource_browser_set_active (browser, TRUE);
+        g_timeout_add (7000, quit_loop, loop);
+        g_main_loop_run (loop);
+
+        gssdp_resource_browser_get_revalidation_stats (browser,
+                                                       &sent,
+                                                       &suppressed,
+                                                       NULL);
+        g_assert_cmpuint (sent, ==, 2);
+        g_assert_cmpuint (suppressed, ==, 1);
+        g_assert_cmpuint (n_unavailable, ==, 0);
+
+        g_object_unref (browser);
+        g_remove (path);
+        g_free (path);
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+test_resource_browser_grace_period (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GSSDPResourceInfo *info;
+        GError *error = NULL;
+        GMainLoop *loop;
+        const char *usns[] = { UUID_1"::"GRACE_NT, UUID_2"::"GRACE_NT, NULL };
+        guint n_available = 0;
+        guint n_unavailable = 0;
+        char *path;
+
+        loop = g_main_loop_new (NULL, FALSE);
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        path = write_cache_file (GRACE_NT, usns);
+
+        browser = g_object_new (GSSDP_TYPE_RESOURCE_BROWSER,
+                                "client", client,
+                                "target", GRACE_NT,
+                                "discovery-interval", 10,
+                                "grace-period", 3,
+                                NULL);
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_test_count_resource),
+                          &n_available);
+        g_signal_connect (browser,
+                          "resource-unavailable",
+                          G_CALLBACK (on_test_count_resource),
+                          &n_unavailable);
+        g_assert_true (gssdp_resource_browser_load_cache (browser,
+                                                          path,
+                                                          &error));
+        g_assert_no_error (error);
+        g_assert_cmpuint (n_available, ==, 2);
+
+        /* Neither answers the round, so both become suspect and now
+         * expire with the grace period instead of their max-age */
+        gssdp_resource_browser_set_active (browser, TRUE);
+        g_timeout_add (5500, quit_loop, loop);
+        g_main_loop_run (loop);
+        g_assert_cmpuint (n_unavailable, ==, 0);
+        g_assert_cmpuint (gssdp_resource_browser_get_resource_count (browser),
+                          ==,
+                          2);
+
+        info = gssdp_resource_browser_lookup_resource (browser,
+                                                       UUID_2"::"GRACE_NT);
+        g_assert_nonnull (info);
+        g_assert_cmpuint (gssdp_resource_info_get_remaining_ttl (info),
+                          <=,
+                          3);
+        g_assert_cmpint (gssdp_resource_info_get_expires (info),
+                         <=,
+                         g_get_real_time () + 3 * G_USEC_PER_SEC);
+        gssdp_resource_info_unref (info);
+
+        /* One of them shows a sign of life in time, silently */
+        g_timeout_add (0,
+                       test_discovery_send_packet,
+                       create_alive_message (GRACE_NT));
+        g_timeout_add (3500, quit_loop, loop);
+        g_main_loop_run (loop);
+
+        g_assert_cmpuint (n_available, ==, 2);
+        g_assert_cmpuint (n_unavailable, ==, 1);
+        g_assert_cmpuint (gssdp_resource_browser_get_resource_count (browser),
+                          ==,
+                          1);
+
+        info = gssdp_resource_browser_lookup_resource (browser,
+                                                       UUID_1"::"GRACE_NT);
+        g_assert_nonnull (info);
+        g_assert_cmpuint (gssdp_resource_info_get_remaining_ttl (info),
+                          >,
+                          3);
+        gssdp_resource_info_unref (info);
+
+        g_object_unref (browser);
+        g_remove (path);
+        g_free (path);
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+on_test_locations_changed (G_GNUC_UNUSED GSSDPResourceBrowser *src,
+                           const char                         *usn,
+                           GList                              *locations,
+                           gpointer                            user_data)
+{
+        guint *count = user_data;
+
+        g_assert_cmpstr (usn, ==, UUID_1"::"GRACE_NT);
+        g_assert_nonnull (locations);
+        g_assert_cmpstr (locations->data, ==, "http://127.0.0.1:4321");
+
+        (*count)++;
+}
+
+static void
+test_resource_browser_locations_changed (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GSSDPResourceInfo *info;
+        GError *error = NULL;
+        GMainLoop *loop;
+        guint n_available = 0;
+        guint n_unavailable = 0;
+        guint n_changed = 0;
+        char *moved;
+
+        loop = g_main_loop_new (NULL, FALSE);
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, GRACE_NT);
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_test_count_resource),
+                          &n_available);
+        g_signal_connect (browser,
+                          "resource-unavailable",
+                          G_CALLBACK (on_test_count_resource),
+                          &n_unavailable);
+        g_signal_connect (browser,
+                          "resource-locations-changed",
+                          G_CALLBACK (on_test_locations_changed),
+                          &n_changed);
+        gssdp_resource_browser_set_track_location_changes (browser, TRUE);
+        gssdp_resource_browser_set_active (browser, TRUE);
+
+        moved = g_strdup_printf (SSDP_ALIVE_MESSAGE "\r\n",
+                                 SSDP_ADDR,
+                                 1800,
+                                 "http://127.0.0.1:4321",
+                                 "",
+                                 "Linux/3.0 UPnP/1.0 GSSDPTesting/0.0.0",
+                                 GRACE_NT,
+                                 UUID_1"::"GRACE_NT);
+
+        g_timeout_add (100,
+                       test_discovery_send_packet,
+                       create_alive_message (GRACE_NT));
+        g_timeout_add (300, test_discovery_send_packet, moved);
+        g_timeout_add (600, quit_loop, loop);
+        g_main_loop_run (loop);
+
+        /* The resource moved in place */
+        g_assert_cmpuint (n_available, ==, 1);
+        g_assert_cmpuint (n_unavailable, ==, 0);
+        g_assert_cmpuint (n_changed, ==, 1);
+
+        info = gssdp_resource_browser_lookup_resource (browser,
+                                                       UUID_1"::"GRACE_NT);
+        g_assert_nonnull (info);
+        g_assert_cmpstr (gssdp_resource_info_get_locations (info)->data,
+                         ==,
+                         "http://127.0.0.1:4321");
+        gssdp_resource_info_unref (info);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+test_resource_browser_moved (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GSSDPResourceInfo *info;
+        GError *error = NULL;
+        GMainLoop *loop;
+        guint n_available = 0;
+        guint n_unavailable = 0;
+        guint n_changed = 0;
+        char *moved;
+
+        loop = g_main_loop_new (NULL, FALSE);
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, GRACE_NT);
+        g_assert_false
+                (gssdp_resource_browser_get_track_location_changes (browser));
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_test_count_resource),
+                          &n_available);
+        g_signal_connect (browser,
+                          "resource-unavailable",
+                          G_CALLBACK (on_test_count_resource),
+                          &n_unavailable);
+        g_signal_connect (browser,
+                          "resource-locations-changed",
+                          G_CALLBACK (on_test_locations_changed),
+                          &n_changed);
+        gssdp_resource_browser_set_active (browser, TRUE);
+
+        moved = g_strdup_printf (SSDP_ALIVE_MESSAGE "\r\n",
+                                 SSDP_ADDR,
+                                 1800,
+                                 "http://127.0.0.1:4321",
+                                 "",
+                                 "Linux/3.0 UPnP/1.0 GSSDPTesting/0.0.0",
+                                 GRACE_NT,
+                                 UUID_1"::"GRACE_NT);
+
+        g_timeout_add (100,
+                       test_discovery_send_packet,
+                       create_alive_message (GRACE_NT));
+        g_timeout_add (300, test_discovery_send_packet, moved);
+        g_timeout_add (600, quit_loop, loop);
+        g_main_loop_run (loop);
+
+        /* By default, a move is reported as a missed byebye */
+        g_assert_cmpuint (n_available, ==, 2);
+        g_assert_cmpuint (n_unavailable, ==, 1);
+        g_assert_cmpuint (n_changed, ==, 0);
+
+        info = gssdp_resource_browser_lookup_resource (browser,
+                                                       UUID_1"::"GRACE_NT);
+        g_assert_nonnull (info);
+        g_assert_cmpstr (gssdp_resource_info_get_locations (info)->data,
+                         ==,
+                         "http://127.0.0.1:4321");
+        gssdp_resource_info_unref (info);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+on_test_target_signal (G_GNUC_UNUSED GSSDPResourceBrowser *src,
+                       const char                         *usn,
+                       const char                         *target,
+                       gpointer                            user_data)
+{
+        GPtrArray *seen = user_data;
+
+        g_ptr_array_add (seen, g_strconcat (usn, " ", target, NULL));
+}
+
+static void
+test_resource_browser_multi_target (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        TestDiscoverySSDPAllData data;
+        GPtrArray *seen;
+        char **targets;
+
+        data.loop = g_main_loop_new (NULL, FALSE);
+        data.usn = VERSIONED_USN_1;
+        data.found = FALSE;
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, "upnp:rootdevice");
+        gssdp_resource_browser_add_target (browser, VERSIONED_NT_1);
+
+        targets = gssdp_resource_browser_get_targets (browser);
+        g_assert_cmpuint (g_strv_length (targets), ==, 2);
+        g_assert_cmpstr (targets[0], ==, "upnp:rootdevice");
+        g_assert_cmpstr (targets[1], ==, VERSIONED_NT_1);
+        g_strfreev (targets);
+
+        seen = g_ptr_array_new_with_free_func (g_free);
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_test_discovery_ssdp_all_resource_available),
+                          &data);
+        g_signal_connect (browser,
+                          "target-available",
+                          G_CALLBACK (on_test_target_signal),
+                          seen);
+        gssdp_resource_browser_set_active (browser, TRUE);
+
+        g_timeout_add_seconds (10, quit_loop, data.loop);
+        g_timeout_add_seconds (1,
+                               test_discovery_send_packet,
+                               create_alive_message (VERSIONED_NT_1));
+        g_main_loop_run (data.loop);
+        g_assert_true (data.found);
+
+        /* Availability is also reported for the matching target only */
+        g_assert_cmpuint (seen->len, ==, 1);
+        g_assert_cmpstr (g_ptr_array_index (seen, 0),
+                         ==,
+                         VERSIONED_USN_1" "VERSIONED_NT_1);
+        g_ptr_array_unref (seen);
+
+        targets = gssdp_resource_browser_get_resource_targets (browser,
+                                                               VERSIONED_USN_1);
+        g_assert_nonnull (targets);
+        g_assert_cmpuint (g_strv_length (targets), ==, 1);
+        g_assert_cmpstr (targets[0], ==, VERSIONED_NT_1);
+        g_strfreev (targets);
+
+        g_assert_null (gssdp_resource_browser_get_resource_targets
+                                (browser, UUID_1"::upnp:rootdevice"));
+
+        g_object_unref (browser);
+        g_object_unref (client);
+        g_main_loop_unref (data.loop);
+}
+
+static void
+test_resource_browser_remove_target (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        const char *usns[] = { UUID_1"::upnp:rootdevice",
+                               VERSIONED_USN_1,
+                               UUID_2"::urn:example:Other:1",
+                               NULL };
+        GPtrArray *seen;
+        guint n_unavailable = 0;
+        char **targets;
+        char *path;
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        path = write_cache_file ("upnp:rootdevice", usns);
+
+        browser = gssdp_resource_browser_new (client, "upnp:rootdevice");
+        gssdp_resource_browser_add_target (browser, VERSIONED_NT_1);
+        gssdp_resource_browser_add_target (browser, "urn:example:Other:1");
+        g_assert_true (gssdp_resource_browser_load_cache (browser,
+                                                          path,
+                                                          &error));
+        g_assert_no_error (error);
+        g_assert_cmpuint (gssdp_resource_browser_get_resource_count (browser),
+                          ==,
+                          3);
+
+        seen = g_ptr_array_new_with_free_func (g_free);
+        g_signal_connect (browser,
+                          "target-unavailable",
+                          G_CALLBACK (on_test_target_signal),
+                          seen);
+        g_signal_connect (browser,
+                          "resource-unavailable",
+                          G_CALLBACK (on_test_count_resource),
+                          &n_unavailable);
+
+        /* The resource only matching the removed target goes away */
+        gssdp_resource_browser_remove_target (browser, VERSIONED_NT_1);
+        g_assert_cmpuint (n_unavailable, ==, 1);
+        g_assert_cmpuint (seen->len, ==, 1);
+        g_assert_cmpstr (g_ptr_array_index (seen, 0),
+                         ==,
+                         VERSIONED_USN_1" "VERSIONED_NT_1);
+        g_assert_cmpuint (gssdp_resource_browser_get_resource_count (browser),
+                          ==,
+                          2);
+
+        /* The others still know which targets they match */
+        targets = gssdp_resource_browser_get_resource_targets
+                                (browser, UUID_2"::urn:example:Other:1");
+        g_assert_nonnull (targets);
+        g_assert_cmpuint (g_strv_length (targets), ==, 1);
+        g_assert_cmpstr (targets[0], ==, "urn:example:Other:1");
+        g_strfreev (targets);
+
+        targets = gssdp_resource_browser_get_resource_targets
+                                (browser, UUID_1"::upnp:rootdevice");
+        g_assert_nonnull (targets);
+        g_assert_cmpuint (g_strv_length (targets), ==, 1);
+        g_assert_cmpstr (targets[0], ==, "upnp:rootdevice");
+        g_strfreev (targets);
+
+        g_ptr_array_unref (seen);
+        g_object_unref (browser);
+        g_remove (path);
+        g_free (path);
+        g_object_unref (client);
+}
+
+static void
+on_test_discover_done (GObject      *source,
+                       GAsyncResult *res,
+                       gpointer      user_data)
+{
+        GPtrArray **result = user_data;
+        GError *error = NULL;
+
+        *result = gssdp_resource_browser_discover_finish
+                                (GSSDP_RESOURCE_BROWSER (source), res, &error);
+        g_assert_no_error (error);
+}
+
+static void
+test_resource_browser_discover (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        GPtrArray *result = NULL;
+        GSSDPResourceInfo *info;
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, VERSIONED_NT_1);
+        gssdp_resource_browser_set_mx (browser, 1);
+
+        gssdp_resource_browser_discover_async (browser,
+                                               10000,
+                                               NULL,
+                                               on_test_discover_done,
+                                               &result);
+        g_timeout_add (200,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+
+        while (result == NULL)
+                g_main_context_iteration (NULL, TRUE);
+
+        g_assert_cmpuint (result->len, ==, 1);
+        info = g_ptr_array_index (result, 0);
+        g_assert_cmpstr (gssdp_resource_info_get_usn (info),
+                         ==,
+                         VERSIONED_USN_1);
+        g_assert_nonnull (gssdp_resource_info_get_locations (info));
+        g_assert_cmpint (gssdp_resource_info_get_expires (info),
+                         >,
+                         g_get_real_time ());
+
+        /* The browser itself must not have picked anything up */
+        g_assert_null (gssdp_resource_browser_get_resource_targets
+                                (browser, VERSIONED_USN_1));
+
+        g_ptr_array_unref (result);
+        g_object_unref (browser);
+        g_object_unref (client);
+}
+
+typedef struct {
+        GSSDPResourceInfo *info;
+        GError *error;
+        gboolean done;
+} TestWaitData;
+
+static void
+on_test_wait_done (GObject      *source,
+                   GAsyncResult *res,
+                   gpointer      user_data)
+{
+        TestWaitData *data = user_data;
+
+        data->info = gssdp_resource_browser_wait_for_resource_finish
+                                (GSSDP_RESOURCE_BROWSER (source),
+                                 res,
+                                 &data->error);
+        data->done = TRUE;
+}
+
+static void
+test_resource_browser_wait_for_resource (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        TestWaitData data = { NULL, NULL, FALSE };
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, "upnp:rootdevice");
+
+        /* Nobody is there */
+        gssdp_resource_browser_wait_for_resource_async (browser,
+                                                        UUID_1,
+                                                        200,
+                                                        NULL,
+                                                        on_test_wait_done,
+                                                        &data);
+        while (!data.done)
+                g_main_context_iteration (NULL, TRUE);
+
+        g_assert_error (data.error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+        g_assert_null (data.info);
+        g_clear_error (&data.error);
+
+        /* Any type announced by the device matches its UUID */
+        data.done = FALSE;
+        gssdp_resource_browser_wait_for_resource_async (browser,
+                                                        UUID_1,
+                                                        10000,
+                                                        NULL,
+                                                        on_test_wait_done,
+                                                        &data);
+        g_timeout_add (200,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+        while (!data.done)
+                g_main_context_iteration (NULL, TRUE);
+
+        g_assert_no_error (data.error);
+        g_assert_nonnull (data.info);
+        g_assert_cmpstr (gssdp_resource_info_get_usn (data.info),
+                         ==,
+                         VERSIONED_USN_1);
+        gssdp_resource_info_unref (data.info);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+}
+
+static void
+test_resource_group_multi_client (void)
+{
+        GSSDPClient *client1, *client2;
+        GSSDPResourceGroup *group;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        TestWaitData data = { NULL, NULL, FALSE };
+        const GList *locations;
+
+        client1 = get_client (&error);
+        g_assert_no_error (error);
+        client2 = get_client (&error);
+        g_assert_no_error (error);
+
+        group = gssdp_resource_group_new (client1);
+        gssdp_resource_group_add_client (group, client2);
+        /* Adding the same client twice is a no-op */
+        gssdp_resource_group_add_client (group, client2);
+        gssdp_resource_group_add_resource_simple (group,
+                                                  "upnp:rootdevice",
+                                                  UUID_1"::upnp:rootdevice",
+                                                  "http://{host}:3456/foo");
+
+        browser = gssdp_resource_browser_new (client1, "upnp:rootdevice");
+        gssdp_resource_browser_wait_for_resource_async (browser,
+                                                        UUID_1,
+                                                        10000,
+                                                        NULL,
+                                                        on_test_wait_done,
+                                                        &data);
+        gssdp_resource_group_set_available (group, TRUE);
+        while (!data.done)
+                g_main_context_iteration (NULL, TRUE);
+
+        g_assert_no_error (data.error);
+        g_assert_nonnull (data.info);
+        locations = gssdp_resource_info_get_locations (data.info);
+        g_assert_nonnull (locations);
+        g_assert_cmpstr (locations->data, ==, "http://127.0.0.1:3456/foo");
+        gssdp_resource_info_unref (data.info);
+
+        gssdp_resource_group_remove_client (group, client2);
+
+        g_object_unref (browser);
+        g_object_unref (group);
+        g_object_unref (client2);
+        g_object_unref (client1);
+}
+
+static GSSDPClient *
+get_lazy_client (void)
+{
+        GSSDPClient *client;
+        GError *error = NULL;
+        GInetAddress *lo = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+
+        client = g_initable_new (GSSDP_TYPE_CLIENT,
+                                 NULL,
+                                 &error,
+                                 "address", lo,
+                                 "lazy-sockets", TRUE,
+                                 NULL);
+        g_assert_no_error (error);
+        g_assert_nonnull (client);
+        g_object_unref (lo);
+
+        return client;
+}
+
+static gboolean
+on_test_idle_expired (gpointer user_data)
+{
+        *(gboolean *) user_data = TRUE;
+
+        return FALSE;
+}
+
+static void
+test_client_lazy_sockets (void)
+{
+        GSSDPClient *publisher, *listener;
+        GSSDPResourceGroup *group;
+        GSSDPResourceBrowser *browser;
+        TestWaitData data = { NULL, NULL, FALSE };
+        gboolean expired = FALSE;
+        guint port;
+
+        publisher = get_lazy_client ();
+        listener = get_lazy_client ();
+
+        group = gssdp_resource_group_new (publisher);
+        gssdp_resource_group_add_resource_simple (group,
+                                                  "upnp:rootdevice",
+                                                  UUID_1"::upnp:rootdevice",
+                                                  "http://127.0.0.1:3456/foo");
+        gssdp_resource_group_set_available (group, TRUE);
+
+        /* The search socket of the listener is created on the first search */
+        gssdp_client_set_socket_idle_timeout (listener, 1);
+        browser = gssdp_resource_browser_new (listener, "upnp:rootdevice");
+        gssdp_resource_browser_wait_for_resource_async (browser,
+                                                        UUID_1,
+                                                        10000,
+                                                        NULL,
+                                                        on_test_wait_done,
+                                                        &data);
+        while (!data.done)
+                g_main_context_iteration (NULL, TRUE);
+
+        g_assert_no_error (data.error);
+        g_assert_nonnull (data.info);
+        gssdp_resource_info_unref (data.info);
+        g_object_unref (browser);
+
+        port = gssdp_client_get_port (listener);
+        g_assert_cmpuint (port, !=, 0);
+
+        /* Querying the port does not bring a released socket back */
+        g_timeout_add (1500, on_test_idle_expired, &expired);
+        while (!expired)
+                g_main_context_iteration (NULL, TRUE);
+        g_assert_cmpuint (gssdp_client_get_port (listener), ==, 0);
+        g_assert_null (gssdp_client_get_tcp_socket (listener));
+
+        /* The next search does, on the same port */
+        data.done = FALSE;
+        browser = gssdp_resource_browser_new (listener, "upnp:rootdevice");
+        gssdp_resource_browser_wait_for_resource_async (browser,
+                                                        UUID_1,
+                                                        10000,
+                                                        NULL,
+                                                        on_test_wait_done,
+                                                        &data);
+        while (!data.done)
+                g_main_context_iteration (NULL, TRUE);
+
+        g_assert_no_error (data.error);
+        g_assert_nonnull (data.info);
+        gssdp_resource_info_unref (data.info);
+        g_object_unref (browser);
+
+        g_assert_cmpuint (gssdp_client_get_port (listener), ==, port);
+
+        g_object_unref (group);
+        g_object_unref (listener);
+        g_object_unref (publisher);
+}
+
+static void
+test_client_listen_only (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GInetAddress *lo;
+        GError *error = NULL;
+        TestWaitData data = { NULL, NULL, FALSE };
+
+        lo = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+        client = g_initable_new (GSSDP_TYPE_CLIENT,
+                                 NULL,
+                                 &error,
+                                 "address", lo,
+                                 "listen-only", TRUE,
+                                 NULL);
+        g_assert_no_error (error);
+        g_assert_nonnull (client);
+        g_object_unref (lo);
+
+        /* No search or TCP socket */
+        g_assert_cmpuint (gssdp_client_get_port (client), ==, 0);
+        g_assert_null (gssdp_client_get_tcp_socket (client));
+
+        /* Announcements still come in */
+        browser = gssdp_resource_browser_new (client, "upnp:rootdevice");
+        gssdp_resource_browser_wait_for_resource_async (browser,
+                                                        UUID_1,
+                                                        10000,
+                                                        NULL,
+                                                        on_test_wait_done,
+                                                        &data);
+        g_timeout_add (200,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+        while (!data.done)
+                g_main_context_iteration (NULL, TRUE);
+
+        g_assert_no_error (data.error);
+        g_assert_nonnull (data.info);
+        gssdp_resource_info_unref (data.info);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+}
+
+static void
+test_client_receive_buffer (void)
+{
+        GSSDPClient *client;
+        GInetAddress *lo;
+        GError *error = NULL;
+        guint size = 0;
+        guint64 drops = G_MAXUINT64;
+
+        lo = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+        client = g_initable_new (GSSDP_TYPE_CLIENT,
+                                 NULL,
+                                 &error,
+                                 "address", lo,
+                                 "receive-buffer-size", 256 * 1024,
+                                 NULL);
+        g_assert_no_error (error);
+        g_assert_nonnull (client);
+        g_object_unref (lo);
+
+        g_object_get (client,
+                      "receive-buffer-size", &size,
+                      "kernel-drops", &drops,
+                      NULL);
+        g_assert_cmpuint (size, ==, 256 * 1024);
+        g_assert_cmpuint (drops, ==, 0);
+        g_assert_cmpuint (gssdp_client_get_kernel_drops (client), ==, 0);
+
+        g_object_unref (client);
+}
+
+static void
+on_message_received_arrival (GSSDPClient                  *client,
+                             G_GNUC_UNUSED const char     *from_ip,
+                             G_GNUC_UNUSED gushort         from_port,
+                             G_GNUC_UNUSED int             type,
+                             G_GNUC_UNUSED gpointer        headers,
+                             gpointer                      user_data)
+{
+        gint64 *arrival_time = user_data;
+
+        if (*arrival_time == 0)
+                *arrival_time = gssdp_client_get_message_arrival_time (client);
+}
+
+static void
+test_client_receive_timestamps (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GInetAddress *lo;
+        GError *error = NULL;
+        TestWaitData data = { NULL, NULL, FALSE };
+        gint64 arrival_time = 0;
+        const guint64 *histogram;
+        guint64 total = 0;
+        guint n_buckets = 0;
+        guint i;
+
+        lo = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+        client = g_initable_new (GSSDP_TYPE_CLIENT,
+                                 NULL,
+                                 &error,
+                                 "address", lo,
+                                 "receive-timestamps", TRUE,
+                                 NULL);
+        g_assert_no_error (error);
+        g_assert_nonnull (client);
+        g_object_unref (lo);
+
+        g_signal_connect (client,
+                          "message-received",
+                          G_CALLBACK (on_message_received_arrival),
+                          &arrival_time);
+
+        browser = gssdp_resource_browser_new (client, "upnp:rootdevice");
+        gssdp_resource_browser_wait_for_resource_async (browser,
+                                                        UUID_1,
+                                                        10000,
+                                                        NULL,
+                                                        on_test_wait_done,
+                                                        &data);
+        g_timeout_add (200,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+        while (!data.done)
+                g_main_context_iteration (NULL, TRUE);
+
+        g_assert_no_error (data.error);
+        gssdp_resource_info_unref (data.info);
+
+        /* Only outside of the signal emission */
+        g_assert_cmpint (gssdp_client_get_message_arrival_time (client), ==, 0);
+
+        histogram = gssdp_client_get_latency_histogram (client, &n_buckets);
+        g_assert_cmpuint (n_buckets, >, 0);
+        for (i = 0; i < n_buckets; i++)
+                total += histogram[i];
+
+#ifdef __linux__
+        g_assert_cmpint (arrival_time, >, 0);
+#endif
+        if (arrival_time != 0) {
+                g_assert_cmpint (arrival_time, <=, g_get_real_time ());
+                g_assert_cmpuint (total, >, 0);
+        } else {
+                g_assert_cmpuint (total, ==, 0);
+        }
+
+        g_object_unref (browser);
+        g_object_unref (client);
+}
+
+static void
+test_client_kernel_filter (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        TestWaitData data = { NULL, NULL, FALSE };
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+        g_assert_nonnull (client);
+
+        gssdp_client_set_kernel_filter (client, TRUE);
+        g_assert_true (gssdp_client_get_kernel_filter (client));
+
+        /* The browser lets announcements through again */
+        browser = gssdp_resource_browser_new (client, "upnp:rootdevice");
+        gssdp_resource_browser_wait_for_resource_async (browser,
+                                                        UUID_1,
+                                                        10000,
+                                                        NULL,
+                                                        on_test_wait_done,
+                                                        &data);
+        g_timeout_add (200,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+        while (!data.done)
+                g_main_context_iteration (NULL, TRUE);
+
+        g_assert_no_error (data.error);
+        g_assert_nonnull (data.info);
+        gssdp_resource_info_unref (data.info);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+}
+
+static void
+test_client_kernel_filter_drops (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        TestWaitData data = { NULL, NULL, FALSE };
+        guint i;
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+        g_assert_nonnull (client);
+
+        /* Nobody uses the client, so the announcements are rejected */
+        gssdp_client_set_kernel_filter (client, TRUE);
+        for (i = 0; i < 3; i++)
+                test_discovery_send_packet (
+                        create_alive_message (VERSIONED_NT_1));
+
+        /* The rejections show up with the next datagram let through */
+        browser = gssdp_resource_browser_new (client, "upnp:rootdevice");
+        gssdp_resource_browser_wait_for_resource_async (browser,
+                                                        UUID_1,
+                                                        10000,
+                                                        NULL,
+                                                        on_test_wait_done,
+                                                        &data);
+        g_timeout_add (200,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+        while (!data.done)
+                g_main_context_iteration (NULL, TRUE);
+
+        g_assert_no_error (data.error);
+        g_assert_nonnull (data.info);
+        gssdp_resource_info_unref (data.info);
+
+        /* They are not mistaken for overflows */
+        g_assert_cmpuint (gssdp_client_get_kernel_drops (client), ==, 0);
+#if defined(__linux__)
+        g_assert_cmpuint (gssdp_client_get_kernel_filter_drops (client),
+                          >=,
+                          3);
+#endif
+
+        g_object_unref (browser);
+        g_object_unref (client);
+}
+
+static void
+on_test_count_burst (G_GNUC_UNUSED GSSDPClient *client,
+                     G_GNUC_UNUSED const char  *from_ip,
+                     G_GNUC_UNUSED gushort      from_port,
+                     int                        type,
+                     SoupMessageHeaders        *headers,
+                     gpointer                   user_data)
+{
+        guint *count = user_data;
+
+        if (type != MESSAGE_TYPE_ANNOUNCEMENT)
+                return;
+
+        if (g_strcmp0 (soup_message_headers_get_one (headers, "NT"),
+                       BURST_NT) == 0)
+                (*count)++;
+}
+
+static void
+test_client_receive_burst (void)
+{
+        GSSDPClient *client;
+        GError *error = NULL;
+        GMainLoop *loop;
+        guint count = 0;
+        guint i;
+
+        loop = g_main_loop_new (NULL, FALSE);
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        g_signal_connect (client,
+                          "message-received",
+                          G_CALLBACK (on_test_count_burst),
+                          &count);
+
+        /* More than a batch of reads, all queued before the first one */
+        for (i = 0; i < 20; i++)
+                test_discovery_send_packet (create_alive_message (BURST_NT));
+
+        g_timeout_add (500, quit_loop, loop);
+        g_main_loop_run (loop);
+
+        g_assert_cmpuint (count, ==, 20);
+
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+test_client_receive_threads (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GInetAddress *lo;
+        GError *error = NULL;
+        TestWaitData data = { NULL, NULL, FALSE };
+
+        /* With three shards, 127.0.0.1 is handled by the second thread */
+        lo = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+        client = g_initable_new (GSSDP_TYPE_CLIENT,
+                                 NULL,
+                                 &error,
+                                 "address", lo,
+                                 "receive-threads", 2,
+                                 NULL);
+        g_assert_no_error (error);
+        g_assert_nonnull (client);
+        g_object_unref (lo);
+
+        browser = gssdp_resource_browser_new (client, "upnp:rootdevice");
+        gssdp_resource_browser_wait_for_resource_async (browser,
+                                                        UUID_1,
+                                                        10000,
+                                                        NULL,
+                                                        on_test_wait_done,
+                                                        &data);
+        g_timeout_add (200,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+        while (!data.done)
+                g_main_context_iteration (NULL, TRUE);
+
+        g_assert_no_error (data.error);
+        g_assert_nonnull (data.info);
+        gssdp_resource_info_unref (data.info);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+}
+
+static void
+test_client_socket_tuning (void)
+{
+        GSSDPClient *client;
+        GInetAddress *lo;
+        GError *error = NULL;
+        GSocket *tcp_socket;
+        gint value = -1;
+
+        lo = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+        client = g_initable_new (GSSDP_TYPE_CLIENT,
+                                 NULL,
+                                 &error,
+                                 "address", lo,
+                                 "send-buffer-size", 64 * 1024,
+                                 "dscp", 46,
+                                 "multicast-loopback", FALSE,
+                                 "allocate-tcp-socket", TRUE,
+                                 NULL);
+        g_assert_no_error (error);
+        g_assert_nonnull (client);
+        g_object_unref (lo);
+
+        /* The kernel may round the buffer size up, e.g. Linux doubles it */
+        g_assert_true (gssdp_client_get_socket_option (
+                                client,
+                                GSSDP_SOCKET_OPTION_SEND_BUFFER_SIZE,
+                                &value,
+                                &error));
+        g_assert_no_error (error);
+        g_assert_cmpint (value, >=, 64 * 1024);
+
+        g_assert_true (gssdp_client_get_socket_option (client,
+                                                       GSSDP_SOCKET_OPTION_DSCP,
+                                                       &value,
+                                                       &error));
+        g_assert_no_error (error);
+        g_assert_cmpint (value, ==, 46);
+
+        g_assert_true (gssdp_client_get_socket_option (
+                                client,
+                                GSSDP_SOCKET_OPTION_MULTICAST_LOOPBACK,
+                                &value,
+                                &error));
+        g_assert_no_error (error);
+        g_assert_cmpint (value, ==, 0);
+
+        /* The TCP socket is tuned as well */
+        tcp_socket = gssdp_client_get_tcp_socket (client);
+        g_assert_nonnull (tcp_socket);
+#ifndef G_OS_WIN32
+        g_assert_true (g_socket_get_option (tcp_socket,
+                                            SOL_SOCKET,
+                                            SO_SNDBUF,
+                                            &value,
+                                            &error));
+        g_assert_no_error (error);
+        g_assert_cmpint (value, >=, 64 * 1024);
+#endif
+        g_object_unref (tcp_socket);
+
+        /* The options survive recreating the sockets */
+        g_assert_true (gssdp_client_rebind (client, &error));
+        g_assert_no_error (error);
+
+        g_assert_true (gssdp_client_get_socket_option (client,
+                                                       GSSDP_SOCKET_OPTION_DSCP,
+                                                       &value,
+                                                       &error));
+        g_assert_no_error (error);
+        g_assert_cmpint (value, ==, 46);
+
+        g_object_unref (client);
+}
+
+static void
+test_resource_browser_query (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        TestDiscoverySSDPAllData data;
+        GSSDPResourceInfo *info;
+        GPtrArray *resources;
+
+        data.loop = g_main_loop_new (NULL, FALSE);
+        data.usn = VERSIONED_USN_1;
+        data.found = FALSE;
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, VERSIONED_NT_1);
+        g_assert_cmpuint (gssdp_resource_browser_get_resource_count (browser),
+                          ==,
+                          0);
+
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_test_discovery_ssdp_all_resource_available),
+                          &data);
+        gssdp_resource_browser_set_active (browser, TRUE);
+
+        g_timeout_add_seconds (10, quit_loop, data.loop);
+        g_timeout_add_seconds (1,
+                               test_discovery_send_packet,
+                               create_alive_message (VERSIONED_NT_1));
+        g_main_loop_run (data.loop);
+        g_assert_true (data.found);
+
+        g_assert_cmpuint (gssdp_resource_browser_get_resource_count (browser),
+                          ==,
+                          1);
+
+        resources = gssdp_resource_browser_get_resources (browser);
+        g_assert_cmpuint (resources->len, ==, 1);
+        g_ptr_array_unref (resources);
+
+        info = gssdp_resource_browser_lookup_resource (browser,
+                                                       VERSIONED_USN_1);
+        g_assert_nonnull (info);
+        g_assert_cmpstr (gssdp_resource_info_get_usn (info),
+                         ==,
+                         VERSIONED_USN_1);
+        g_assert_cmpstr (gssdp_resource_info_get_source_ip (info),
+                         ==,
+                         "127.0.0.1");
+        g_assert_cmpuint (gssdp_resource_info_get_remaining_ttl (info),
+                          >,
+                          0);
+        g_assert_cmpint (gssdp_resource_info_get_last_seen (info), >, 0);
+        gssdp_resource_info_unref (info);
+
+        g_assert_null (gssdp_resource_browser_lookup_resource
+                                (browser, UUID_1"::upnp:rootdevice"));
+
+        resources = gssdp_resource_browser_lookup_resources_by_host
+                                (browser, "127.0.0.1");
+        g_assert_cmpuint (resources->len, ==, 1);
+        g_ptr_array_unref (resources);
+
+        resources = gssdp_resource_browser_lookup_resources_by_host
+                                (browser, "127.0.0.2");
+        g_assert_cmpuint (resources->len, ==, 0);
+        g_ptr_array_unref (resources);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+        g_main_loop_unref (data.loop);
+}
+
+static void
+on_test_batch_resources_changed (G_GNUC_UNUSED GSSDPResourceBrowser *browser,
+                                 GPtrArray                          *added,
+                                 GPtrArray                          *removed,
+                                 GPtrArray                          *updated,
+                                 gpointer                            user_data)
+{
+        TestDiscoverySSDPAllData *data = user_data;
+
+        g_assert_cmpuint (added->len, ==, 1);
+        g_assert_cmpuint (removed->len, ==, 0);
+        g_assert_cmpuint (updated->len, ==, 0);
+        g_assert_cmpstr (gssdp_resource_info_get_usn
+                                (g_ptr_array_index (added, 0)),
+                         ==,
+                         data->usn);
+
+        data->found = TRUE;
+        g_main_loop_quit (data->loop);
+}
+
+static void
+test_resource_browser_batch_signals (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        TestDiscoverySSDPAllData data;
+
+        data.loop = g_main_loop_new (NULL, FALSE);
+        data.usn = VERSIONED_USN_1;
+        data.found = FALSE;
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, VERSIONED_NT_1);
+        gssdp_resource_browser_set_batch_signals (browser, TRUE);
+        gssdp_resource_browser_set_batch_interval (browser, 100);
+
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_resource_available_assert_not_reached),
+                          NULL);
+        g_signal_connect (browser,
+                          "resources-changed",
+                          G_CALLBACK (on_test_batch_resources_changed),
+                          &data);
+        gssdp_resource_browser_set_active (browser, TRUE);
+
+        g_timeout_add_seconds (10, quit_loop, data.loop);
+        g_timeout_add_seconds (1,
+                               test_discovery_send_packet,
+                               create_alive_message (VERSIONED_NT_1));
+        g_main_loop_run (data.loop);
+        g_assert_true (data.found);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+        g_main_loop_unref (data.loop);
+}
+
+typedef struct {
+        guint  added;
+        guint  removed;
+        guint  updated;
+        gint32 boot_id;
+} TestBatchCount;
+
+static void
+on_test_batch_count (G_GNUC_UNUSED GSSDPResourceBrowser *browser,
+                     GPtrArray                          *added,
+                     GPtrArray                          *removed,
+                     GPtrArray                          *updated,
+                     gpointer                            user_data)
+{
+        TestBatchCount *count = user_data;
+
+        count->added += added->len;
+        count->removed += removed->len;
+        count->updated += updated->len;
+        if (updated->len > 0)
+                count->boot_id = gssdp_resource_info_get_boot_id
+                                        (g_ptr_array_index (updated, 0));
+}
+
+static void
+on_test_resource_update_not_reached
+                        (G_GNUC_UNUSED GSSDPResourceBrowser *browser,
+                         G_GNUC_UNUSED const char           *usn,
+                         G_GNUC_UNUSED guint                 boot_id,
+                         G_GNUC_UNUSED guint                 next_boot_id,
+                         G_GNUC_UNUSED gpointer              user_data)
+{
+        g_assert_not_reached ();
+}
+
+static void
+test_resource_browser_batch_update (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        GMainLoop *loop;
+        TestBatchCount count = { 0, 0, 0, -1 };
+        char *update;
+
+        loop = g_main_loop_new (NULL, FALSE);
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, VERSIONED_NT_1);
+        gssdp_resource_browser_set_batch_signals (browser, TRUE);
+        gssdp_resource_browser_set_batch_interval (browser, 100);
+        g_signal_connect (browser,
+                          "resource-update",
+                          G_CALLBACK (on_test_resource_update_not_reached),
+                          NULL);
+        g_signal_connect (browser,
+                          "resources-changed",
+                          G_CALLBACK (on_test_batch_count),
+                          &count);
+        gssdp_resource_browser_set_active (browser, TRUE);
+
+        update = g_strdup_printf (SSDP_UPDATE_MESSAGE
+                                  "BOOTID.UPNP.ORG: 1\r\n"
+                                  "\r\n",
+                                  SSDP_ADDR,
+                                  "http://127.0.0.1:1234",
+                                  VERSIONED_NT_1,
+                                  VERSIONED_USN_1,
+                                  2);
+
+        g_timeout_add (100,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+        g_timeout_add (400, test_discovery_send_packet, update);
+        g_timeout_add (800, quit_loop, loop);
+        g_main_loop_run (loop);
+
+        /* The boot ID change is batched like any other change */
+        g_assert_cmpuint (count.added, ==, 1);
+        g_assert_cmpuint (count.removed, ==, 0);
+        g_assert_cmpuint (count.updated, ==, 1);
+        g_assert_cmpint (count.boot_id, ==, 2);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+on_test_unavailable_not_cached (GSSDPResourceBrowser *browser,
+                                const char           *usn,
+                                gpointer              user_data)
+{
+        gboolean *seen = user_data;
+
+        /* Outside of batch mode, the resource is gone already */
+        g_assert_null (gssdp_resource_browser_lookup_resource (browser, usn));
+        g_assert_cmpuint (gssdp_resource_browser_get_resource_count (browser),
+                          ==,
+                          0);
+
+        *seen = TRUE;
+}
+
+static void
+test_resource_browser_unavailable_order (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        GMainLoop *loop;
+        gboolean seen = FALSE;
+
+        loop = g_main_loop_new (NULL, FALSE);
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, VERSIONED_NT_1);
+        g_signal_connect (browser,
+                          "resource-unavailable",
+                          G_CALLBACK (on_test_unavailable_not_cached),
+                          &seen);
+        gssdp_resource_browser_set_active (browser, TRUE);
+
+        g_timeout_add (100,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+        g_timeout_add (300,
+                       test_discovery_send_packet,
+                       create_byebye_message (VERSIONED_NT_1));
+        g_timeout_add (600, quit_loop, loop);
+        g_main_loop_run (loop);
+
+        g_assert_true (seen);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+test_resource_browser_filters (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        GMainLoop *loop;
+
+        loop = g_main_loop_new (NULL, FALSE);
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, VERSIONED_NT_1);
+
+        g_assert_false (gssdp_resource_browser_add_source_filter (browser,
+                                                                  "10.0.0.0/33",
+                                                                  &error));
+        g_assert_nonnull (error);
+        g_clear_error (&error);
+
+        g_assert_true (gssdp_resource_browser_add_source_filter (browser,
+                                                                 "10.0.0.0/8",
+                                                                 &error));
+        g_assert_no_error (error);
+
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_resource_available_assert_not_reached),
+                          NULL);
+        gssdp_resource_browser_set_active (browser, TRUE);
+
+        g_timeout_add_seconds (2, quit_loop, loop);
+        g_timeout_add (500,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+        g_main_loop_run (loop);
+
+        g_assert_cmpuint (gssdp_resource_browser_get_resource_count (browser),
+                          ==,
+                          0);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+static void
+test_resource_browser_filters_match (void)
+{
+        GSSDPClient *client;
+        GSSDPResourceBrowser *browser;
+        GError *error = NULL;
+        GMainLoop *loop;
+        guint available = 0;
+        char *elsewhere, *alternative;
+
+        loop = g_main_loop_new (NULL, FALSE);
+
+        client = get_client (&error);
+        g_assert_no_error (error);
+
+        browser = gssdp_resource_browser_new (client, VERSIONED_NT_1);
+
+        g_assert_true (gssdp_resource_browser_add_source_filter (browser,
+                                                                 "10.0.0.0/8",
+                                                                 &error));
+        g_assert_no_error (error);
+        g_assert_true (gssdp_resource_browser_add_source_filter (browser,
+                                                                 "127.0.0.0/9",
+                                                                 &error));
+        g_assert_no_error (error);
+        gssdp_resource_browser_add_location_host_filter (browser, "10.0.0.1");
+        gssdp_resource_browser_add_location_host_filter (browser, "127.0.0.1");
+
+        g_signal_connect (browser,
+                          "resource-available",
+                          G_CALLBACK (on_test_count_resource),
+                          &available);
+        gssdp_resource_browser_set_active (browser, TRUE);
+
+        g_timeout_add_seconds (1, quit_loop, loop);
+        g_timeout_add (500,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+        g_main_loop_run (loop);
+
+        g_assert_cmpuint (available, ==, 1);
+
+        /* Only an alternative location matches the host filter */
+        elsewhere = g_strdup_printf (SSDP_ALIVE_MESSAGE "\r\n",
+                                     SSDP_ADDR,
+                                     1800,
+                                     "http://192.168.1.1:1234",
+                                     "AL: <http://192.168.1.2:1234>\r\n",
+                                     "Linux/3.0 UPnP/1.0 GSSDPTesting/0.0.0",
+                                     VERSIONED_NT_1,
+                                     UUID_2"::"VERSIONED_NT_1);
+        alternative = g_strdup_printf
+                        (SSDP_ALIVE_MESSAGE "\r\n",
+                         SSDP_ADDR,
+                         1800,
+                         "http://192.168.1.1:1234",
+                         "AL: <http://192.168.1.2:1234>"
+                         "<http://127.0.0.1:1234/desc.xml>\r\n",
+                         "Linux/3.0 UPnP/1.0 GSSDPTesting/0.0.0",
+                         VERSIONED_NT_1,
+                         UUID_2"::"VERSIONED_NT_1);
+
+        g_timeout_add_seconds (1, quit_loop, loop);
+        g_timeout_add (100, test_discovery_send_packet, elsewhere);
+        g_timeout_add (500, test_discovery_send_packet, alternative);
+        g_main_loop_run (loop);
+
+        g_assert_cmpuint (available, ==, 2);
+
+        g_object_unref (browser);
+        g_object_unref (client);
+        g_main_loop_unref (loop);
+}
+
+typedef struct {
+        guint available;
+        guint reachable;
+} TestAggregatorData;
+
+static void
+on_test_aggregator_available (G_GNUC_UNUSED GSSDPResourceAggregator *aggregator,
+                              const char                            *usn,
+                              G_GNUC_UNUSED GList                   *locations,
+                              gpointer                               user_data)
+{
+        TestAggregatorData *data = user_data;
+
+        g_assert_cmpstr (usn, ==, VERSIONED_USN_1);
+        data->available++;
+}
+
+static void
+on_test_aggregator_reachability_changed
+                        (G_GNUC_UNUSED GSSDPResourceAggregator *aggregator,
+                         G_GNUC_UNUSED const char              *usn,
+                         G_GNUC_UNUSED GSSDPClient             *client,
+                         gboolean                               reachable,
+                         gpointer                               user_data)
+{
+        TestAggregatorData *data = user_data;
+
+        g_assert_true (reachable);
+        data->reachable++;
+}
+
+static void
+test_resource_aggregator (void)
+{
+        GSSDPClient *client1, *client2;
+        GSSDPResourceAggregator *aggregator;
+        GError *error = NULL;
+        GMainLoop *loop;
+        TestAggregatorData data = { 0, 0 };
+        GList *clients;
+
+        loop = g_main_loop_new (NULL, FALSE);
+
+        client1 = get_client (&error);
+        g_assert_no_error (error);
+        client2 = get_client (&error);
+        g_assert_no_error (error);
+
+        aggregator = gssdp_resource_aggregator_new (VERSIONED_NT_1);
+        gssdp_resource_aggregator_add_client (aggregator, client1);
+        gssdp_resource_aggregator_add_client (aggregator, client2);
+        gssdp_resource_aggregator_add_client (aggregator, client2);
+
+        g_signal_connect (aggregator,
+                          "resource-available",
+                          G_CALLBACK (on_test_aggregator_available),
+                          &data);
+        g_signal_connect (aggregator,
+                          "reachability-changed",
+                          G_CALLBACK (on_test_aggregator_reachability_changed),
+                          &data);
+        gssdp_resource_aggregator_set_active (aggregator, TRUE);
+
+        g_timeout_add_seconds (2, quit_loop, loop);
+        g_timeout_add (500,
+                       test_discovery_send_packet,
+                       create_alive_message (VERSIONED_NT_1));
+        g_main_loop_run (loop);
+
+        /* Seen on both clients, but only announced once */
+        g_assert_cmpuint (data.available, ==, 1);
+        clients = gssdp_resource_aggregator_get_clients (aggregator,
+                                                         VERSIONED_USN_1);
+        g_assert_cmpuint (g_list_length (clients), ==, 1 + data.reachable);
+        g_list_free (clients);
+
+        g_object_unref (aggregator);
+        g_object_unref (client1);
+        g_object_unref (client2);
+        g_main_loop_unref (loop);
+}
+
+int main(int argc, char *argv[])
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/functional/resource-group/discovery/ssdp:all",
+                         test_discovery_ssdp_all);
+
+        g_test_add_func ("/functional/resource-group/discovery/upnp:rootdevice",
+                         test_discovery_upnp_rootdevice);
+
+        g_test_add_func ("/functional/resource-group/discovery/uuid",
+                         test_discovery_uuid);
+
+        g_test_add_func ("/functional/resource-group/discovery/versioned/matching",
+                         test_discovery_versioned);
+
+        g_test_add_func ("/functional/resource-group/discovery/versioned/backwards-compatible",
+                         test_discovery_versioned_backwards_compatible);
+
+        g_test_add_func ("/functional/resource-group/discovery/versioned/ignore-older",
+                         test_discovery_versioned_ignore_older);
+
+        g_test_add_func ("/functional/resource-group/lookup-remove",
+                         test_resource_group_lookup_remove);
+
+        g_test_add_func ("/functional/resource-group/multi-client",
+                         test_resource_group_multi_client);
+
+        g_test_add_func ("/functional/resource-browser/cache",
+                         test_resource_browser_cache);
+
+        g_test_add_func ("/functional/resource-browser/convergence",
+                         test_resource_browser_convergence);
+
+        g_test_add_func ("/functional/resource-browser/rescan",
+                         test_resource_browser_rescan);
+
+        g_test_add_func ("/functional/resource-browser/search-coalescing",
+                         test_resource_browser_search_coalescing);
+
+        g_test_add_func ("/functional/resource-browser/revalidation-byebye",
+                         test_resource_browser_revalidation_byebye);
+        g_test_add_func ("/functional/resource-browser/revalidation-rate",
+                         test_resource_browser_revalidation_rate);
+
+        g_test_add_func ("/functional/resource-browser/grace-period",
+                         test_resource_browser_grace_period);
+
+        g_test_add_func ("/functional/resource-browser/locations-changed",
+                         test_resource_browser_locations_changed);
+        g_test_add_func ("/functional/resource-browser/moved",
+                         test_resource_browser_moved);
+
+        g_test_add_func ("/functional/resource-browser/multi-target",
+                         test_resource_browser_multi_target);
+
+        g_test_add_func ("/functional/resource-browser/remove-target",
+                         test_resource_browser_remove_target);
+
+        g_test_add_func ("/functional/resource-browser/discover",
+                         test_resource_browser_discover);
+
+        g_test_add_func ("/functional/resource-browser/wait-for-resource",
+                         test_resource_browser_wait_for_resource);
+
+        g_test_add_func ("/functional/resource-browser/query",
+                         test_resource_browser_query);
+
+        g_test_add_func ("/functional/resource-browser/batch-signals",
+                         test_resource_browser_batch_signals);
+
+        g_test_add_func ("/functional/resource-browser/batch-update",
+                         test_resource_browser_batch_update);
+
+        g_test_add_func ("/functional/resource-browser/unavailable-order",
+                         test_resource_browser_unavailable_order);
+
+        g_test_add_func ("/functional/resource-browser/filters",
+                         test_resource_browser_filters);
+
+        g_test_add_func ("/functional/resource-browser/filters-match",
+                         test_resource_browser_filters_match);
+
+        g_test_add_func ("/functional/resource-aggregator",
+                         test_resource_aggregator);
+
+        g_test_add_func ("/functional/creation", test_client_creation);
+
+        g_test_add_func ("/functional/creation/async",
+                         test_client_creation_async);
+
+        g_test_add_func ("/functional/client/rebind", test_client_rebind);
+        g_test_add_func ("/functional/client/rebind-tcp-socket",
+                         test_client_rebind_tcp_socket);
+        g_test_add_func ("/functional/client/interface-cache",
+                         test_client_interface_cache);
+
+        g_test_add_func ("/functional/client/lazy-sockets",
+                         test_client_lazy_sockets);
+
+        g_test_add_func ("/functional/client/listen-only",
+                         test_client_listen_only);
+
+        g_test_add_func ("/functional/client/receive-buffer",
+                         test_client_receive_buffer);
+
+        g_test_add_func ("/functional/client/receive-timestamps",
+                         test_client_receive_timestamps);
+
+        g_test_add_func ("/functional/client/kernel-filter",
+                         test_client_kernel_filter);
+        g_test_add_func ("/functional/client/kernel-filter-drops",
+                         test_client_kernel_filter_drops);
+        g_test_add_func ("/functional/client/receive-burst",
+                         test_client_receive_burst);
+
+        g_test_add_func ("/functional/client/receive-threads",
+                         test_client_receive_threads);
+
+        g_test_add_func ("/functional/client/socket-tuning",
+                         test_client_socket_tuning);
 
         g_test_run ();
 